@@ -83,6 +83,9 @@ void BaseKeyframeRefObject::setTimeIndex(const qint64 &value)
     if (value != keyframe->timeIndex()) {
         /* after calling BaseKeyframeRefObject#setTimeIndex, you should call BaseMotionTrack#replaceTimeIndex too */
         keyframe->setTimeIndex(static_cast<IKeyframe::TimeIndex>(value));
+        if (BaseMotionTrack *track = parentTrack()) {
+            track->invalidateOrder();
+        }
         emit timeIndexChanged();
     }
 }
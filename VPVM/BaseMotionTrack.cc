@@ -46,9 +46,20 @@
 
 using namespace vpvl2;
 
+namespace {
+
+struct KeyframeTimeIndexLessThan {
+    bool operator()(const IKeyframe *left, const IKeyframe *right) const {
+        return left->timeIndex() < right->timeIndex();
+    }
+};
+
+}
+
 BaseMotionTrack::BaseMotionTrack(MotionProxy *motionProxy, const QString &name)
     : QObject(motionProxy),
       m_parentMotionRef(motionProxy),
+      m_dirty(false),
       m_name(name),
       m_locked(false),
       m_visible(true)
@@ -59,30 +70,86 @@ BaseMotionTrack::BaseMotionTrack(MotionProxy *motionProxy, const QString &name)
 BaseMotionTrack::~BaseMotionTrack()
 {
     m_parentMotionRef = 0;
+    m_dirty = false;
     m_locked = false;
     m_visible = false;
 }
 
 BaseKeyframeRefObject *BaseMotionTrack::findKeyframeAt(int index) const
 {
-    return m_keyframes.at(index);
+    if (m_dirty) {
+        const_cast<BaseMotionTrack *>(this)->sort();
+    }
+    if (index >= 0 && index < m_keyframeRefs.size()) {
+        return resolveKeyframe(m_keyframeRefs.at(index), false);
+    }
+    return 0;
 }
 
 BaseKeyframeRefObject *BaseMotionTrack::findKeyframeByTimeIndex(const qint64 &timeIndex) const
 {
-    return m_timeIndex2RefObjects.value(timeIndex);
+    int index = lowerBound(timeIndex);
+    if (index < m_keyframeRefs.size()) {
+        IKeyframe *keyframe = m_keyframeRefs.at(index);
+        if (static_cast<qint64>(keyframe->timeIndex()) == timeIndex) {
+            return resolveKeyframe(keyframe, false);
+        }
+    }
+    return 0;
+}
+
+QList<QObject *> BaseMotionTrack::findKeyframesInRange(const qint64 &timeIndexFrom, const qint64 &timeIndexTo) const
+{
+    QList<QObject *> keyframes;
+    const int nkeyframes = m_keyframeRefs.size();
+    for (int i = lowerBound(timeIndexFrom); i < nkeyframes; i++) {
+        IKeyframe *keyframe = m_keyframeRefs.at(i);
+        if (static_cast<qint64>(keyframe->timeIndex()) > timeIndexTo) {
+            break;
+        }
+        keyframes.append(resolveKeyframe(keyframe, false));
+    }
+    return keyframes;
+}
+
+QList<QObject *> BaseMotionTrack::findVisibleKeyframesInRange(const qint64 &timeIndexFrom, const qint64 &timeIndexTo) const
+{
+    /* called on painting the timeline, so the wrappers scrolled out of the range are released */
+    releaseTransientKeyframes(timeIndexFrom, timeIndexTo);
+    QList<QObject *> keyframes;
+    const int nkeyframes = m_keyframeRefs.size();
+    for (int i = lowerBound(timeIndexFrom); i < nkeyframes; i++) {
+        IKeyframe *keyframe = m_keyframeRefs.at(i);
+        if (static_cast<qint64>(keyframe->timeIndex()) > timeIndexTo) {
+            break;
+        }
+        keyframes.append(resolveKeyframe(keyframe, true));
+    }
+    return keyframes;
+}
+
+qint64 BaseMotionTrack::timeIndexAt(int index) const
+{
+    if (m_dirty) {
+        const_cast<BaseMotionTrack *>(this)->sort();
+    }
+    if (index >= 0 && index < m_keyframeRefs.size()) {
+        return static_cast<qint64>(m_keyframeRefs.at(index)->timeIndex());
+    }
+    return -1;
 }
 
 bool BaseMotionTrack::contains(BaseKeyframeRefObject *value) const
 {
-    BaseKeyframeRefObjectList::ConstIterator it = qBinaryFind(m_keyframes, value);
-    return it != m_keyframes.constEnd();
+    Q_ASSERT(value);
+    const IKeyframe *keyframe = value->baseKeyframeData();
+    return m_keyframe2RefObjects.value(keyframe) == value && findKeyframeIndex(keyframe) != -1;
 }
 
 bool BaseMotionTrack::containsKeyframe(const IKeyframe *keyframe) const
 {
     Q_ASSERT(keyframe);
-    return m_keyframe2RefObjects.contains(keyframe);
+    return findKeyframeIndex(keyframe) != -1;
 }
 
 void BaseMotionTrack::add(BaseKeyframeRefObject *value, bool doSort)
@@ -93,6 +160,14 @@ void BaseMotionTrack::add(BaseKeyframeRefObject *value, bool doSort)
     }
 }
 
+void BaseMotionTrack::addKeyframeRef(IKeyframe *keyframe)
+{
+    /* add keyframe without creating QObject wrapper (used on loading motion) */
+    Q_ASSERT(keyframe);
+    m_keyframeRefs.append(keyframe);
+    m_dirty = true;
+}
+
 void BaseMotionTrack::remove(BaseKeyframeRefObject *value)
 {
     internalRemove(value);
@@ -100,13 +175,12 @@ void BaseMotionTrack::remove(BaseKeyframeRefObject *value)
 
 void BaseMotionTrack::replaceTimeIndex(const qint64 &newTimeIndex, const qint64 &oldTimeIndex)
 {
-    BaseKeyframeRefObject *keyframeRef = 0;
-    if (m_timeIndex2RefObjects.contains(oldTimeIndex)) {
-        keyframeRef = m_timeIndex2RefObjects.value(oldTimeIndex);
-        m_timeIndex2RefObjects.remove(oldTimeIndex);
-    }
-    if (keyframeRef) {
-        m_timeIndex2RefObjects.insert(newTimeIndex, keyframeRef);
+    /* time index of the keyframe is already changed so resort to find it by the new time index */
+    m_dirty = true;
+    sort();
+    if (BaseKeyframeRefObject *keyframeRef = findKeyframeByTimeIndex(newTimeIndex)) {
+        /* the motion only reorders tracks edited through add/remove/replace so tell it explicitly */
+        m_parentMotionRef->data()->replaceKeyframe(keyframeRef->baseKeyframeData(), false);
         emit timeIndexDidChange(keyframeRef, newTimeIndex, oldTimeIndex);
     }
 }
@@ -119,7 +193,15 @@ void BaseMotionTrack::refresh()
 
 void BaseMotionTrack::sort()
 {
-    qSort(m_keyframes);
+    if (m_dirty) {
+        qStableSort(m_keyframeRefs.begin(), m_keyframeRefs.end(), KeyframeTimeIndexLessThan());
+        m_dirty = false;
+    }
+}
+
+void BaseMotionTrack::invalidateOrder()
+{
+    m_dirty = true;
 }
 
 MotionProxy *BaseMotionTrack::parentMotion() const
@@ -134,27 +216,107 @@ QString BaseMotionTrack::name() const
 
 int BaseMotionTrack::length() const
 {
-    return m_keyframes.size();
+    return m_keyframeRefs.size();
 }
 
 void BaseMotionTrack::internalAdd(BaseKeyframeRefObject *value)
 {
     Q_ASSERT(value);
     IKeyframe *keyframe = value->baseKeyframeData();
-    m_keyframes.append(value);
+    if (m_dirty) {
+        m_keyframeRefs.append(keyframe);
+    }
+    else {
+        m_keyframeRefs.insert(lowerBound(static_cast<qint64>(keyframe->timeIndex())), keyframe);
+    }
     m_keyframe2RefObjects.insert(keyframe, value);
-    m_timeIndex2RefObjects.insert(value->timeIndex(), value);
+    m_transientKeyframeRefs.remove(keyframe);
 }
 
 void BaseMotionTrack::internalRemove(BaseKeyframeRefObject *value)
 {
     Q_ASSERT(value);
-    BaseKeyframeRefObjectList::Iterator it = qBinaryFind(m_keyframes.begin(), m_keyframes.end(), value);
-    if (it != m_keyframes.end()) {
-        m_keyframes.erase(it);
-    }
     IKeyframe *keyframe = value->baseKeyframeData();
+    int index = findKeyframeIndex(keyframe);
+    if (index != -1) {
+        m_keyframeRefs.remove(index);
+    }
     m_keyframe2RefObjects.remove(keyframe);
-    m_timeIndex2RefObjects.remove(value->timeIndex());
+    m_transientKeyframeRefs.remove(keyframe);
+}
+
+void BaseMotionTrack::releaseAllKeyframes()
+{
+    /* wrappers of keyframes not in the track are owned by undo commands */
+    QHashIterator<const IKeyframe *, BaseKeyframeRefObject *> it(m_keyframe2RefObjects);
+    while (it.hasNext()) {
+        it.next();
+        if (findKeyframeIndex(it.key()) != -1) {
+            delete it.value();
+        }
+    }
+    m_keyframe2RefObjects.clear();
+    m_transientKeyframeRefs.clear();
+    m_keyframeRefs.clear();
+}
+
+int BaseMotionTrack::findKeyframeIndex(const IKeyframe *keyframe) const
+{
+    const int nkeyframes = m_keyframeRefs.size();
+    for (int i = lowerBound(static_cast<qint64>(keyframe->timeIndex())); i < nkeyframes; i++) {
+        const IKeyframe *item = m_keyframeRefs.at(i);
+        if (item == keyframe) {
+            return i;
+        }
+        else if (item->timeIndex() != keyframe->timeIndex()) {
+            break;
+        }
+    }
+    /* fallback to linear search if time index of the keyframe is changed after adding */
+    return m_keyframeRefs.indexOf(const_cast<IKeyframe *>(keyframe));
+}
+
+int BaseMotionTrack::lowerBound(const qint64 &timeIndex) const
+{
+    if (m_dirty) {
+        const_cast<BaseMotionTrack *>(this)->sort();
+    }
+    int low = 0, high = m_keyframeRefs.size();
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (static_cast<qint64>(m_keyframeRefs.at(mid)->timeIndex()) < timeIndex) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+BaseKeyframeRefObject *BaseMotionTrack::resolveKeyframe(IKeyframe *keyframe, bool transient) const
+{
+    const bool created = !m_keyframe2RefObjects.contains(keyframe);
+    BaseKeyframeRefObject *value = const_cast<BaseMotionTrack *>(this)->convert(keyframe);
+    if (!transient) {
+        /* the wrapper may be kept by selection or undo commands from now on */
+        m_transientKeyframeRefs.remove(keyframe);
+    }
+    else if (created) {
+        m_transientKeyframeRefs.insert(keyframe);
+    }
+    return value;
 }
 
+void BaseMotionTrack::releaseTransientKeyframes(const qint64 &timeIndexFrom, const qint64 &timeIndexTo) const
+{
+    QMutableSetIterator<const IKeyframe *> it(m_transientKeyframeRefs);
+    while (it.hasNext()) {
+        const IKeyframe *keyframe = it.next();
+        const qint64 timeIndex = static_cast<qint64>(keyframe->timeIndex());
+        if (timeIndex < timeIndexFrom || timeIndex > timeIndexTo) {
+            delete m_keyframe2RefObjects.take(keyframe);
+            it.remove();
+        }
+    }
+}
@@ -40,6 +40,8 @@
 
 #include <QObject>
 #include <QHash>
+#include <QSet>
+#include <QVector>
 
 #include <vpvl2/IKeyframe.h>
 
@@ -61,14 +63,19 @@ public:
 
     Q_INVOKABLE BaseKeyframeRefObject *findKeyframeAt(int index) const;
     Q_INVOKABLE BaseKeyframeRefObject *findKeyframeByTimeIndex(const qint64 &timeIndex) const;
+    Q_INVOKABLE QList<QObject *> findKeyframesInRange(const qint64 &timeIndexFrom, const qint64 &timeIndexTo) const;
+    Q_INVOKABLE QList<QObject *> findVisibleKeyframesInRange(const qint64 &timeIndexFrom, const qint64 &timeIndexTo) const;
+    Q_INVOKABLE qint64 timeIndexAt(int index) const;
 
     bool contains(BaseKeyframeRefObject *value) const;
     bool containsKeyframe(const vpvl2::IKeyframe *keyframe) const;
     void add(BaseKeyframeRefObject *value, bool doSort);
+    void addKeyframeRef(vpvl2::IKeyframe *keyframe);
     void remove(BaseKeyframeRefObject *value);
     void replaceTimeIndex(const qint64 &newTimeIndex, const qint64 &oldTimeIndex);
     void refresh();
     void sort();
+    void invalidateOrder();
 
     virtual BaseKeyframeRefObject *copy(BaseKeyframeRefObject *value, const qint64 &timeIndex, bool doUpdate) = 0;
     virtual BaseKeyframeRefObject *convert(vpvl2::IKeyframe *value) = 0;
@@ -92,12 +99,20 @@ signals:
 protected:
     void internalAdd(BaseKeyframeRefObject *value);
     void internalRemove(BaseKeyframeRefObject *value);
+    void releaseAllKeyframes();
+    int findKeyframeIndex(const vpvl2::IKeyframe *keyframe) const;
+    int lowerBound(const qint64 &timeIndex) const;
+    BaseKeyframeRefObject *resolveKeyframe(vpvl2::IKeyframe *keyframe, bool transient) const;
+    void releaseTransientKeyframes(const qint64 &timeIndexFrom, const qint64 &timeIndexTo) const;
 
-    typedef QList<BaseKeyframeRefObject *> BaseKeyframeRefObjectList;
+    typedef QVector<vpvl2::IKeyframe *> KeyframeRefList;
     MotionProxy *m_parentMotionRef;
-    BaseKeyframeRefObjectList m_keyframes;
-    QHash<const qint64, BaseKeyframeRefObject *> m_timeIndex2RefObjects;
-    QHash<const vpvl2::IKeyframe *, BaseKeyframeRefObject *> m_keyframe2RefObjects;
+    /* keyframes are kept as a compact sorted array and wrapped by QObject only when requested */
+    mutable KeyframeRefList m_keyframeRefs;
+    mutable QHash<const vpvl2::IKeyframe *, BaseKeyframeRefObject *> m_keyframe2RefObjects;
+    /* wrappers only used to paint the visible range, released when they are scrolled out */
+    mutable QSet<const vpvl2::IKeyframe *> m_transientKeyframeRefs;
+    mutable bool m_dirty;
     const QString m_name;
     bool m_locked;
     bool m_visible;
@@ -51,10 +51,7 @@ BoneMotionTrack::BoneMotionTrack(MotionProxy *motionProxy, const QString &name)
 
 BoneMotionTrack::~BoneMotionTrack()
 {
-    m_timeIndex2RefObjects.clear();
-    m_keyframe2RefObjects.clear();
-    qDeleteAll(m_keyframes);
-    m_keyframes.clear();
+    releaseAllKeyframes();
     m_parentMotionRef = 0;
 }
 
@@ -69,10 +69,12 @@ ModelProxy::ModelProxy(ProjectProxy *project,
                        IModel *model,
                        const QUuid &uuid,
                        const QUrl &fileUrl,
-                       const QUrl &faviconUrl)
+                       const QUrl &faviconUrl,
+                       IEncoding *encoding)
     : QObject(project),
       m_parentProjectRef(project),
       m_childMotionRef(0),
+      m_encoding(encoding),
       m_model(model),
       m_uuid(uuid),
       m_fileUrl(fileUrl),
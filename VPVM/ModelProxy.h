@@ -113,7 +113,8 @@ public:
                vpvl2::IModel *model,
                const QUuid &uuid,
                const QUrl &fileUrl,
-               const QUrl &faviconUrl);
+               const QUrl &faviconUrl,
+               vpvl2::IEncoding *encoding);
     ~ModelProxy();
 
     void initialize();
@@ -231,6 +232,8 @@ private:
 
     ProjectProxy *m_parentProjectRef;
     MotionProxy *m_childMotionRef;
+    /* declared before m_model to outlive the model referring it */
+    QScopedPointer<vpvl2::IEncoding> m_encoding;
     QScopedPointer<vpvl2::IModel> m_model;
     typedef QPair<vpvl2::Vector3, vpvl2::Quaternion> InternalTransform;
     QHash<BoneRefObject *, InternalTransform> m_transformState;
@@ -52,7 +52,7 @@ MorphMotionTrack::MorphMotionTrack(MotionProxy *motionProxy, const QString &name
 
 MorphMotionTrack::~MorphMotionTrack()
 {
-    qDeleteAll(m_keyframes);
+    releaseAllKeyframes();
     m_parentMotionRef = 0;
 }
 
@@ -65,6 +65,15 @@ using namespace vpvl2::extensions::icu4c;
 
 namespace {
 
+/* motionBeLoading is emitted at most this count while loading a motion */
+static const int kMaxLoadingProgressNotifications = 100;
+
+static inline bool shouldNotifyLoadingProgress(int numLoadedKeyframes, int numEstimatedKeyframes)
+{
+    const int step = qMax(numEstimatedKeyframes / kMaxLoadingProgressNotifications, 1);
+    return numLoadedKeyframes % step == 0 || numLoadedKeyframes == numEstimatedKeyframes;
+}
+
 class BaseKeyframeCommand : public QUndoCommand {
 public:
     BaseKeyframeCommand(const QList<BaseKeyframeRefObject *> &keyframes, QUndoCommand *parent)
@@ -704,7 +713,7 @@ void MotionProxy::setCameraMotionTrack(CameraMotionTrack *track, const Factory *
     const int nkeyframes = motionRef->countKeyframes(track->type());
     for (int i = 0; i < nkeyframes; i++) {
         ICameraKeyframe *keyframe = motionRef->findCameraKeyframeRefAt(i);
-        track->add(track->convertCameraKeyframe(keyframe), false);
+        track->addKeyframeRef(keyframe);
     }
     if (!track->findKeyframeByTimeIndex(0)) {
         QScopedPointer<ICamera> cameraRef(m_projectRef->projectInstanceRef()->createCamera());
@@ -728,7 +737,7 @@ void MotionProxy::setLightMotionTrack(LightMotionTrack *track, const Factory *fa
     const int nkeyframes = motionRef->countKeyframes(track->type());
     for (int i = 0; i < nkeyframes; i++) {
         ILightKeyframe *keyframe = motionRef->findLightKeyframeRefAt(i);
-        track->add(track->convertLightKeyframe(keyframe), false);
+        track->addKeyframeRef(keyframe);
     }
     if (!track->findKeyframeByTimeIndex(0)) {
         QScopedPointer<ILight> lightRef(m_projectRef->projectInstanceRef()->createLight());
@@ -1235,8 +1244,10 @@ void MotionProxy::loadBoneTrackBundle(IMotion *motionRef,
             track = addBoneTrack(key);
         }
         Q_ASSERT(track);
-        track->add(track->convertBoneKeyframe(keyframe), false);
-        emit motionBeLoading(numLoadedKeyframes++, numEstimatedKeyframes);
+        track->addKeyframeRef(keyframe);
+        if (shouldNotifyLoadingProgress(++numLoadedKeyframes, numEstimatedKeyframes)) {
+            emit motionBeLoading(numLoadedKeyframes, numEstimatedKeyframes);
+        }
     }
 }
 
@@ -1253,8 +1264,10 @@ void MotionProxy::loadMorphTrackBundle(IMotion *motionRef, int numMorphKeyframes
             track = addMorphTrack(key);
         }
         Q_ASSERT(track);
-        track->add(track->convertMorphKeyframe(keyframe), false);
-        emit motionBeLoading(numLoadedKeyframes++, numEstimatedKeyframes);
+        track->addKeyframeRef(keyframe);
+        if (shouldNotifyLoadingProgress(++numLoadedKeyframes, numEstimatedKeyframes)) {
+            emit motionBeLoading(numLoadedKeyframes, numEstimatedKeyframes);
+        }
     }
 }
 
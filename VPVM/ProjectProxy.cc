@@ -74,56 +74,103 @@ using namespace vpvl2::extensions;
 
 namespace {
 
-struct ProjectDelegate : public XMLProject::IDelegate {
-    ProjectDelegate(ProjectProxy *proxy)
-        : m_projectRef(proxy)
+#ifdef VPVL2_ENABLE_TRACE
+class IODeviceDataSink : public IDataSink {
+public:
+    IODeviceDataSink(QIODevice *device)
+        : m_device(device)
     {
     }
-    ~ProjectDelegate() {
-        m_projectRef = 0;
+    bool write(const uint8_t *data, vsize size) {
+        return m_device->write(reinterpret_cast<const char *>(data), size) == qint64(size);
     }
-    const std::string toStdFromString(const IString *value) const {
-        return Util::toQString(value).toStdString();
+
+private:
+    QIODevice *m_device;
+};
+
+static void writeTrace(const Tracer &tracer, const QUrl &fileUrl)
+{
+    const QString &filename = QStringLiteral("VPVM-trace-%1.json").arg(QFileInfo(fileUrl.toLocalFile()).fileName());
+    QFile file(QDir::temp().absoluteFilePath(filename));
+    if (file.open(QFile::WriteOnly)) {
+        IODeviceDataSink sink(&file);
+        if (tracer.writeChromeTraceEvents(&sink)) {
+            VPVL2_VLOG(1, "Trace events of loading " << fileUrl.toString().toStdString() << " are written to " << file.fileName().toStdString());
+        }
     }
-    const IString *toStringFromStd(const std::string &value) const {
-        return new icu4c::String(Util::fromQString(QString::fromStdString(value)));
+}
+#endif
+
+class BaseLoadingTask : public QRunnable {
+public:
+    BaseLoadingTask()
+        : m_eventLoop(new QEventLoop()),
+          m_running(1)
+    {
+        setAutoDelete(false);
     }
-    bool loadModel(const XMLProject::UUID &uuid, const XMLProject::StringMap &settings, IModel::Type /* type */, IModel *&model, IRenderEngine *&engine, int &priority) {
-        const std::string &uri = settings.value(XMLProject::kSettingURIKey);
-        if (ModelProxy *modelProxy = m_projectRef->loadModel(QUrl::fromLocalFile(QString::fromStdString(uri)), QUuid(QString::fromStdString(uuid)), true)) {
-            m_projectRef->internalAddModel(modelProxy, settings.value("selected") == "true", true);
-            priority = XMLProject::toIntFromString(settings.value(XMLProject::kSettingOrderKey));;
-            /* upload render engine later */
-            model = modelProxy->data();
+
+    inline bool isRunning() const { return m_running.loadAcquire() != 0; }
+    void waitForDone() {
+        /* quit is posted after m_running is cleared so the wakeup cannot be missed */
+        if (isRunning()) {
+            m_eventLoop->exec();
         }
-        engine = 0;
-        return model;
     }
-    ProjectProxy *m_projectRef;
+
+protected:
+    void notifyDone() {
+        m_running.storeRelease(0);
+        QMetaObject::invokeMethod(m_eventLoop.data(), "quit", Qt::QueuedConnection);
+    }
+
+private:
+    QScopedPointer<QEventLoop> m_eventLoop;
+    QAtomicInt m_running;
 };
 
-class LoadingModelTask : public QRunnable {
+class LoadingModelTask : public BaseLoadingTask {
 public:
     LoadingModelTask(const Factory *factoryRef, const QUrl &fileUrl)
         : m_factoryRef(factoryRef),
+          m_dictionaryRef(0),
           m_fileUrl(fileUrl),
-          m_result(false),
-          m_running(true)
+          m_result(false)
+    {
+    }
+    LoadingModelTask(const icu4c::Encoding::Dictionary *dictionaryRef, const QUrl &fileUrl)
+        : m_factoryRef(0),
+          m_dictionaryRef(dictionaryRef),
+          m_fileUrl(fileUrl),
+          m_result(false)
     {
-        setAutoDelete(false);
     }
 
     inline IModel *takeModel() { return m_model.take(); }
+    inline IEncoding *takeEncoding() { return m_encoding.take(); }
     inline QString errorString() const { return m_errorString; }
-    inline bool isRunning() const { return m_running; }
 
 private:
     void run() {
+#ifdef VPVL2_ENABLE_TRACE
+        /* models are loaded on the worker thread so trace them with the tracer of this thread */
+        Tracer tracer;
+        tracer.attach();
+#endif
         QFile file(m_fileUrl.toLocalFile());
         if (file.open(QFile::ReadOnly)) {
             const QByteArray &bytes = file.readAll();
             const uint8_t *ptr = reinterpret_cast<const uint8_t *>(bytes.constData());
-            m_model.reset(m_factoryRef->createModel(ptr, file.size(), m_result));
+            if (m_dictionaryRef) {
+                /* Encoding is not thread safe so the prefetched model gets its own one to keep referring */
+                m_encoding.reset(new icu4c::Encoding(m_dictionaryRef));
+                Factory factory(m_encoding.data());
+                m_model.reset(factory.createModel(ptr, file.size(), m_result));
+            }
+            else {
+                m_model.reset(m_factoryRef->createModel(ptr, file.size(), m_result));
+            }
             if (m_result) {
                 /* set filename of the model if the name of the model is null such as asset */
                 if (!m_model->name(IEncoding::kDefaultLanguage)) {
@@ -139,32 +186,92 @@ private:
         else {
             m_errorString = QApplication::tr("Cannot open model %1: %2").arg(m_fileUrl.toDisplayString()).arg(file.errorString());
         }
-        m_running = false;
+#ifdef VPVL2_ENABLE_TRACE
+        tracer.detach();
+        writeTrace(tracer, m_fileUrl);
+#endif
+        notifyDone();
     }
 
     const Factory *m_factoryRef;
+    const icu4c::Encoding::Dictionary *m_dictionaryRef;
     const QUrl m_fileUrl;
+    QScopedPointer<IEncoding> m_encoding;
     QScopedPointer<IModel> m_model;
     QString m_errorString;
     bool m_result;
-    volatile bool m_running;
 };
 
-class LoadingMotionTask : public QRunnable {
+struct ProjectDelegate : public XMLProject::IDelegate {
+    ProjectDelegate(ProjectProxy *proxy)
+        : m_projectRef(proxy)
+    {
+    }
+    ~ProjectDelegate() {
+        /* wait for the prefetched tasks that were not taken by loadModel */
+        m_prefetchingThreadPool.waitForDone();
+        qDeleteAll(m_prefetchingTasks);
+        m_projectRef = 0;
+    }
+    const std::string toStdFromString(const IString *value) const {
+        return Util::toQString(value).toStdString();
+    }
+    const IString *toStringFromStd(const std::string &value) const {
+        return new icu4c::String(Util::fromQString(QString::fromStdString(value)));
+    }
+    bool loadModel(const XMLProject::UUID &uuid, const XMLProject::StringMap &settings, IModel::Type /* type */, IModel *&model, IRenderEngine *&engine, int &priority) {
+        const std::string &uri = settings.value(XMLProject::kSettingURIKey);
+        const QUrl &fileUrl = QUrl::fromLocalFile(QString::fromStdString(uri));
+        const QUuid modelUuid(QString::fromStdString(uuid));
+        ModelProxy *modelProxy = 0;
+        if (LoadingModelTask *task = m_prefetchingTasks.take(QString::fromStdString(uuid))) {
+            QScopedPointer<LoadingModelTask> taskPtr(task);
+            task->waitForDone();
+            if (IModel *prefetchedModel = task->takeModel()) {
+                /* the proxy owns the encoding of the prefetched model too */
+                modelProxy = m_projectRef->createModelProxy(prefetchedModel, task->takeEncoding(), modelUuid, fileUrl, true);
+            }
+        }
+        if (!modelProxy) {
+            /* fallback to load synchronously to report the error */
+            modelProxy = m_projectRef->loadModel(fileUrl, modelUuid, true);
+        }
+        if (modelProxy) {
+            m_projectRef->internalAddModel(modelProxy, settings.value("selected") == "true", true);
+            priority = XMLProject::toIntFromString(settings.value(XMLProject::kSettingOrderKey));;
+            /* upload render engine later */
+            model = modelProxy->data();
+        }
+        engine = 0;
+        return model;
+    }
+    void prefetchModel(const XMLProject::UUID &uuid, const XMLProject::StringMap &settings, IModel::Type /* type */) {
+        const QString &key = QString::fromStdString(uuid);
+        if (!m_prefetchingTasks.contains(key)) {
+            const std::string &uri = settings.value(XMLProject::kSettingURIKey);
+            const QUrl &fileUrl = QUrl::fromLocalFile(QString::fromStdString(uri));
+            LoadingModelTask *task = new LoadingModelTask(m_projectRef->dictionaryInstanceRef(), fileUrl);
+            m_prefetchingTasks.insert(key, task);
+            m_prefetchingThreadPool.start(task);
+        }
+    }
+    ProjectProxy *m_projectRef;
+    QThreadPool m_prefetchingThreadPool;
+    QHash<QString, LoadingModelTask *> m_prefetchingTasks;
+};
+
+class LoadingMotionTask : public BaseLoadingTask {
 public:
     LoadingMotionTask(const ModelProxy *modelProxy, const Factory *factoryRef, const QUrl &fileUrl)
         : m_modelProxy(modelProxy),
           m_factoryRef(factoryRef),
           m_fileUrl(fileUrl),
-          m_result(false),
-          m_running(true)
+          m_result(false)
     {
-        setAutoDelete(false);
     }
 
     inline IMotion *takeMotion() { return m_motion.take(); }
     inline QString errorString() const { return m_errorString; }
-    inline bool isRunning() const { return m_running; }
 
 private:
     void run() {
@@ -182,7 +289,7 @@ private:
         else {
             m_errorString = QApplication::tr("Cannot open motion %1: %2").arg(m_fileUrl.toDisplayString()).arg(file.errorString());
         }
-        m_running = false;
+        notifyDone();
     }
 
     const ModelProxy *m_modelProxy;
@@ -191,7 +298,6 @@ private:
     QScopedPointer<IMotion> m_motion;
     QString m_errorString;
     bool m_result;
-    volatile bool m_running;
 };
 
 static void convertStringFromVariant(const QVariant &value, std::string &result)
@@ -377,9 +483,7 @@ bool ProjectProxy::loadMotion(const QUrl &fileUrl, ModelProxy *modelProxy, Motio
     Q_ASSERT(fileUrl.isValid());
     QScopedPointer<LoadingMotionTask> task(new LoadingMotionTask(modelProxy, m_factory.data(), fileUrl));
     QThreadPool::globalInstance()->start(task.data());
-    while (task->isRunning()) {
-        qApp->processEvents(QEventLoop::AllEvents);
-    }
+    task->waitForDone();
     m_errorString.clear();
     if (IMotion *motion = task->takeMotion()) {
         const QUuid &uuid = QUuid::createUuid();
@@ -866,11 +970,9 @@ ModelProxy *ProjectProxy::loadModel(const QUrl &fileUrl, const QUuid &uuid, bool
     ModelProxy *modelProxy = 0;
     QScopedPointer<LoadingModelTask> task(new LoadingModelTask(m_factory.data(), fileUrl));
     QThreadPool::globalInstance()->start(task.data());
-    while (task->isRunning()) {
-        qApp->processEvents(QEventLoop::AllEvents);
-    }
+    task->waitForDone();
     if (IModel *model = task->takeModel()) {
-        modelProxy = createModelProxy(model, uuid, fileUrl, skipConfirm);
+        modelProxy = createModelProxy(model, 0, uuid, fileUrl, skipConfirm);
     }
     else {
         setErrorString(task->errorString());
@@ -880,7 +982,7 @@ ModelProxy *ProjectProxy::loadModel(const QUrl &fileUrl, const QUuid &uuid, bool
 
 bool ProjectProxy::loadEffect(const QUrl &fileUrl)
 {
-    ModelProxy *modelProxy = new ModelProxy(this, m_factory->newModel(IModel::kPMXModel), QUuid::createUuid(), fileUrl, QUrl());
+    ModelProxy *modelProxy = new ModelProxy(this, m_factory->newModel(IModel::kPMXModel), QUuid::createUuid(), fileUrl, QUrl(), 0);
     m_modelProxies.append(modelProxy);
     m_instance2ModelProxyRefs.insert(modelProxy->data(), modelProxy);
     m_uuid2ModelProxyRefs.insert(modelProxy->uuid(), modelProxy);
@@ -889,7 +991,7 @@ bool ProjectProxy::loadEffect(const QUrl &fileUrl)
     return true;
 }
 
-ModelProxy *ProjectProxy::createModelProxy(IModel *model, const QUuid &uuid, const QUrl &fileUrl, bool skipConfirm)
+ModelProxy *ProjectProxy::createModelProxy(IModel *model, IEncoding *encoding, const QUuid &uuid, const QUrl &fileUrl, bool skipConfirm)
 {
     QUrl faviconUrl;
     const QFileInfo finfo(fileUrl.toLocalFile());
@@ -899,7 +1001,7 @@ ModelProxy *ProjectProxy::createModelProxy(IModel *model, const QUuid &uuid, con
         faviconUrl = QUrl::fromLocalFile(finfo.absoluteDir().filePath(faviconLocations.first()));
     }
     model->setPhysicsEnable(m_worldProxy->simulationType() != WorldProxy::DisableSimulation);
-    ModelProxy *modelProxy = new ModelProxy(this, model, uuid, fileUrl, faviconUrl);
+    ModelProxy *modelProxy = new ModelProxy(this, model, uuid, fileUrl, faviconUrl, encoding);
     emit modelWillLoad(modelProxy);
     modelProxy->initialize();
     emit modelDidLoad(modelProxy, skipConfirm);
@@ -1054,6 +1156,11 @@ Factory *ProjectProxy::factoryInstanceRef() const
     return m_factory.data();
 }
 
+const icu4c::Encoding::Dictionary *ProjectProxy::dictionaryInstanceRef() const
+{
+    return &m_dictionary;
+}
+
 XMLProject *ProjectProxy::projectInstanceRef() const
 {
     return m_project.data();
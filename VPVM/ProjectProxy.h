@@ -158,7 +158,7 @@ public:
     Q_INVOKABLE void updateParentBindingModel();
 
     ModelProxy *loadModel(const QUrl &fileUrl, const QUuid &uuid, bool skipConfirm);
-    ModelProxy *createModelProxy(vpvl2::IModel *model, const QUuid &uuid, const QUrl &fileUrl, bool skipConfirm);
+    ModelProxy *createModelProxy(vpvl2::IModel *model, vpvl2::IEncoding *encoding, const QUuid &uuid, const QUrl &fileUrl, bool skipConfirm);
     MotionProxy *createMotionProxy(vpvl2::IMotion *motion, const QUuid &uuid, const QUrl &fileUrl, bool emitSignal);
     ModelProxy *resolveModelProxy(const vpvl2::IModel *value) const;
     MotionProxy *resolveMotionProxy(const vpvl2::IMotion *value) const;
@@ -208,6 +208,7 @@ public:
 
     vpvl2::IEncoding *encodingInstanceRef() const;
     vpvl2::Factory *factoryInstanceRef() const;
+    const vpvl2::extensions::icu4c::Encoding::Dictionary *dictionaryInstanceRef() const;
     vpvl2::extensions::XMLProject *projectInstanceRef() const;
 
 public slots:
@@ -39,6 +39,8 @@
 #include <vpvl2/extensions/gl/Texture2D.h>
 #include <vpvl2/extensions/BaseApplicationContext.h>
 #include <vpvl2/extensions/XMLProject.h>
+#include <vpvl2/gl2/BatchRenderer.h>
+#include <vpvl2/gl2/PMXRenderEngine.h>
 
 #include "Common.h"
 #include <QtMultimedia>
@@ -166,6 +168,7 @@ public:
 
     ApplicationContext(const ProjectProxy *proxy, const StringMap *stringMap)
         : BaseApplicationContext(proxy->projectInstanceRef(), proxy->encodingInstanceRef(), stringMap),
+          m_batchRenderer(new gl2::BatchRenderer(this)),
           m_orderIndex(1)
     {
     }
@@ -255,38 +258,58 @@ public:
         }
         return true;
     }
-    QList<ModelProxyPair> uploadEnqueuedModelProxies(ProjectProxy *projectProxy) {
-        QList<ModelProxyPair> uploadedModelProxies;
+    bool uploadEnqueuedModelProxies(ProjectProxy *projectProxy, qint64 timeSlice, QList<ModelProxyPair> &uploadedModelProxies) {
         XMLProject *projectRef = projectProxy->projectInstanceRef();
-        while (!m_uploadingModels.isEmpty()) {
-            const ModelProxyPair &pair = m_uploadingModels.dequeue();
-            ModelProxy *modelProxy = pair.first;
-            const QFileInfo fileInfo(modelProxy->fileUrl().toLocalFile());
-            const String dir(Util::fromQString(fileInfo.absoluteDir().absolutePath()));
-            ModelContext context(this, 0, &dir);
-            IModel *modelRef = modelProxy->data();
-            IRenderEngineSmartPtr engine(projectRef->createRenderEngine(this, modelRef, Scene::kEffectCapable));
-            engine->setUpdateOptions(IRenderEngine::kParallelUpdate);
-            IEffect *effectRef = 0;
-            engine->setEffect(effectRef, IEffect::kAutoDetection, &context);
-            if (engine->upload(&context)) {
-                parseOffscreenSemantic(effectRef, &dir);
-                modelRef->setEdgeWidth(1.0f);
-                const XMLProject::UUID &uuid = modelProxy->uuid().toString().toStdString();
+        QElapsedTimer timer;
+        timer.start();
+        /* advance one step at least and continue while the time slice of this frame remains */
+        while (!m_uploadingModels.isEmpty() || !m_currentUploadingModel.isNull()) {
+            if (m_currentUploadingModel.isNull()) {
+                const ModelProxyPair &pair = m_uploadingModels.dequeue();
+                m_currentUploadingModel.reset(new UploadingModel(pair, this));
+                UploadingModel *uploading = m_currentUploadingModel.data();
+                IModel *modelRef = pair.first->data();
+                uploading->engineRef = projectRef->createRenderEngine(this, modelRef, Scene::kEffectCapable);
+                uploading->engineRef->setUpdateOptions(IRenderEngine::kParallelUpdate);
+                uploading->engineRef->setEffect(uploading->effectRef, IEffect::kAutoDetection, &uploading->context);
+                /* the model is drawn with fallback materials while its textures are being uploaded */
+                const XMLProject::UUID &uuid = pair.first->uuid().toString().toStdString();
                 /* remove model reference from project first to add model/engine correctly after loading project */
                 projectRef->removeModel(modelRef);
-                projectRef->addModel(modelRef, engine.release(), uuid, m_orderIndex++);
+                projectRef->addModel(modelRef, uploading->engineRef, uuid, m_orderIndex++);
+            }
+            UploadingModel *uploading = m_currentUploadingModel.data();
+            ModelProxy *modelProxy = uploading->pair.first;
+            IModel *modelRef = modelProxy->data();
+            IRenderEngine *engineRef = uploading->engineRef;
+            const IRenderEngine::UploadStatus status = engineRef->uploadIncrementally(&uploading->context, 1, uploading);
+            if (status == IRenderEngine::kUploadCompleted) {
+                parseOffscreenSemantic(uploading->effectRef, &uploading->dir);
+                modelRef->setEdgeWidth(1.0f);
                 projectProxy->setModelSetting(modelProxy, QString::fromStdString(XMLProject::kSettingNameKey), modelProxy->name());
                 projectProxy->setModelSetting(modelProxy, QString::fromStdString(XMLProject::kSettingURIKey), modelProxy->fileUrl().toLocalFile());
-                if (!pair.second) {
+                if (!uploading->pair.second) {
                     projectProxy->setModelSetting(modelProxy, "selected", false);
                 }
-                addModelPath(modelRef, fileInfo.absoluteFilePath().toStdString());
-                setEffectOwner(effectRef, modelRef);
-                uploadedModelProxies.append(pair);
+                addModelPath(modelRef, uploading->fileInfo.absoluteFilePath().toStdString());
+                setEffectOwner(uploading->effectRef, modelRef);
+                if (isBatchableModel(modelRef)) {
+                    m_batchRenderer->addEngineRef(static_cast<gl2::PMXRenderEngine *>(engineRef));
+                }
+                uploadedModelProxies.append(uploading->pair);
+                m_currentUploadingModel.reset();
+            }
+            else if (status == IRenderEngine::kUploadFailed) {
+                projectRef->removeModel(modelRef);
+                engineRef->release();
+                delete engineRef;
+                m_currentUploadingModel.reset();
+            }
+            if (timer.hasExpired(timeSlice)) {
+                break;
             }
         }
-        return uploadedModelProxies;
+        return m_uploadingModels.isEmpty() && m_currentUploadingModel.isNull();
     }
     QList<ModelProxy *> uploadEnqueuedEffects(ProjectProxy *projectProxy) {
         QList<ModelProxy *> uploadedEffects;
@@ -323,8 +346,15 @@ public:
         while (!m_deletingModels.isEmpty()) {
             ModelProxy *modelProxy = m_deletingModels.dequeue();
             IModel *modelRef = modelProxy->data();
+            /* the render engine of the model being uploaded is owned by the project and released below */
+            if (!m_currentUploadingModel.isNull() && m_currentUploadingModel->pair.first == modelProxy) {
+                m_currentUploadingModel.reset();
+            }
             /* Failed loading effect will have null IRenderEngine instance case  */
             if (IRenderEngine *engine = projectRef->findRenderEngine(modelRef)) {
+                if (isBatchableModel(modelRef)) {
+                    m_batchRenderer->removeEngineRef(static_cast<gl2::PMXRenderEngine *>(engine));
+                }
                 projectRef->removeModel(modelRef);
                 engine->release();
                 delete engine;
@@ -348,6 +378,9 @@ public:
     void resetOrderIndex(int startOrderIndex) {
         m_orderIndex = startOrderIndex;
     }
+    gl2::BatchRenderer *batchRendererRef() const {
+        return m_batchRenderer.data();
+    }
 
     static QOpenGLFramebufferObjectFormat framebufferObjectFormat(const QQuickWindow *win) {
         QOpenGLFramebufferObjectFormat format;
@@ -357,9 +390,43 @@ public:
     }
 
 private:
+    static bool isBatchableModel(const IModel *modelRef) {
+        /* Scene#createRenderEngine creates gl2::PMXRenderEngine for PMD/PMX models only without effect support */
+#if defined(VPVL2_ENABLE_NVIDIA_CG) || defined(VPVL2_LINK_NVFX)
+        Q_UNUSED(modelRef);
+        return false;
+#else
+        const IModel::Type type = modelRef->type();
+        return type == IModel::kPMDModel || type == IModel::kPMXModel;
+#endif
+    }
+
+    struct UploadingModel : IRenderEngine::UploadProgressListener {
+        UploadingModel(const ModelProxyPair &pair, ApplicationContext *applicationContextRef)
+            : pair(pair),
+              fileInfo(pair.first->fileUrl().toLocalFile()),
+              dir(Util::fromQString(fileInfo.absoluteDir().absolutePath())),
+              context(applicationContextRef, 0, &dir),
+              engineRef(0),
+              effectRef(0)
+        {
+        }
+        void uploadDidProgress(IRenderEngine * /* engine */, int nfinishedSteps, int nsteps) {
+            VPVL2_VLOG(2, "Uploading the model " << pair.first->name().toStdString() << ": " << nfinishedSteps << "/" << nsteps);
+        }
+        const ModelProxyPair pair;
+        const QFileInfo fileInfo;
+        const String dir;
+        ModelContext context;
+        IRenderEngine *engineRef;
+        IEffect *effectRef;
+    };
+
+    QScopedPointer<UploadingModel> m_currentUploadingModel;
     QQueue<ModelProxyPair> m_uploadingModels;
     QQueue<ModelProxy *> m_uploadingEffects;
     QQueue<ModelProxy *> m_deletingModels;
+    QScopedPointer<gl2::BatchRenderer> m_batchRenderer;
     int m_orderIndex;
 };
 
@@ -1861,7 +1928,9 @@ void RenderTarget::enqueueDeletingModel(ModelProxy *model)
 void RenderTarget::commitUploadingModels()
 {
     Q_ASSERT(window());
-    connect(window(), &QQuickWindow::beforeRendering, this, &RenderTarget::performUploadingEnqueuedModels, Qt::DirectConnection);
+    /* stays connected across frames until all enqueued models are uploaded */
+    connect(window(), &QQuickWindow::beforeRendering, this, &RenderTarget::performUploadingEnqueuedModels,
+            static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection));
 }
 
 void RenderTarget::commitUploadingEffects()
@@ -1883,8 +1952,10 @@ void RenderTarget::commitDeletingModels()
 void RenderTarget::performUploadingEnqueuedModels()
 {
     Q_ASSERT(window() && m_applicationContext);
-    disconnect(window(), &QQuickWindow::beforeRendering, this, &RenderTarget::performUploadingEnqueuedModels);
-    const QList<ApplicationContext::ModelProxyPair> &uploadedModelProxies = m_applicationContext->uploadEnqueuedModelProxies(m_projectProxyRef);
+    /* uploading large models is split into time slices to keep the viewport responsive */
+    static const qint64 kUploadingModelTimeSlice = 8;
+    QList<ApplicationContext::ModelProxyPair> uploadedModelProxies;
+    bool finished = m_applicationContext->uploadEnqueuedModelProxies(m_projectProxyRef, kUploadingModelTimeSlice, uploadedModelProxies);
     foreach (const ApplicationContext::ModelProxyPair &pair, uploadedModelProxies) {
         ModelProxy *modelProxy = pair.first;
         VPVL2_VLOG(1, "The model " << modelProxy->uuid().toString().toStdString() << " a.k.a " << modelProxy->name().toStdString() << " is uploaded" << (pair.second ? " from the project." : "."));
@@ -1892,7 +1963,14 @@ void RenderTarget::performUploadingEnqueuedModels()
         connect(modelProxy, &ModelProxy::firstTargetBoneChanged, this, &RenderTarget::updateGizmo);
         emit modelDidUpload(modelProxy, pair.second);
     }
-    emit enqueuedModelsDidUpload();
+    if (finished) {
+        disconnect(window(), &QQuickWindow::beforeRendering, this, &RenderTarget::performUploadingEnqueuedModels);
+        emit enqueuedModelsDidUpload();
+    }
+    else {
+        /* requests the next frame to continue uploading the rest */
+        QMetaObject::invokeMethod(window(), "update", Qt::QueuedConnection);
+    }
 }
 
 void RenderTarget::performUploadingEnqueuedEffects()
@@ -2057,14 +2135,7 @@ void RenderTarget::drawScene()
         IRenderEngine *engine = enginesForPreProcess[i];
         engine->performPreProcess();
     }
-    for (int i = 0, nengines = enginesForStandard.count(); i < nengines; i++) {
-        IRenderEngine *engine = enginesForStandard[i];
-        engine->renderModel();
-        engine->renderEdge();
-        if (isProjectiveShadow) {
-            engine->renderShadow();
-        }
-    }
+    m_applicationContext->batchRendererRef()->render(enginesForStandard, isProjectiveShadow);
     for (int i = 0, nengines = enginesForPostProcess.count(); i < nengines; i++) {
         IRenderEngine *engine = enginesForPostProcess[i];
         IEffect *const *nextPostEffect = nextPostEffects[engine];
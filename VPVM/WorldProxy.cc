@@ -45,8 +45,8 @@
 
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
 #include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
-#include <BulletCollision/CollisionShapes/btSphereShape.h>
 #include <BulletCollision/CollisionShapes/btStaticPlaneShape.h>
+#include <BulletCollision/BroadphaseCollision/btDbvt.h>
 #include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
 #include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h>
 #include <BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
@@ -59,32 +59,112 @@ using namespace vpvl2::extensions;
 
 namespace {
 
-class SynchronizedBoneMotionState : public btMotionState {
+static const Scalar kBoneSphereRadius = 0.5;
+
+class ClosestBoneSphereCallback : public btDbvt::ICollide {
 public:
-    SynchronizedBoneMotionState(const IBone *boneRef)
-        : m_boneRef(boneRef)
+    ClosestBoneSphereCallback(const Vector3 &from, const Vector3 &to)
+        : m_from(from),
+          m_direction(to - from),
+          m_closestFraction(1),
+          m_closestBoneRef(0)
     {
     }
-    ~SynchronizedBoneMotionState() {
-        m_boneRef = 0;
+    ~ClosestBoneSphereCallback() {
+        m_closestBoneRef = 0;
     }
 
-    void getWorldTransform(btTransform &worldTrans) const {
-        worldTrans = m_boneRef->worldTransform();
+    void Process(const btDbvtNode *leaf) {
+        /* the leaf AABB only culls the ray, so test the ray against the bone sphere itself */
+        const Vector3 &delta = m_from - leaf->volume.Center();
+        const Scalar &a = m_direction.length2(), &b = delta.dot(m_direction),
+                &c = delta.length2() - kBoneSphereRadius * kBoneSphereRadius;
+        const Scalar &discriminant = b * b - a * c;
+        if (btFuzzyZero(a) || discriminant < 0) {
+            return;
+        }
+        /* the ray starting inside of the sphere hits it immediately */
+        const Scalar &fraction = c > 0 ? (-b - btSqrt(discriminant)) / a : Scalar(0);
+        if (fraction >= 0 && fraction <= m_closestFraction) {
+            m_closestFraction = fraction;
+            m_closestBoneRef = static_cast<BoneRefObject *>(leaf->data);
+        }
     }
-    void setWorldTransform(const btTransform & /* worldTrans */) {
+    BoneRefObject *closestBoneRef() const {
+        return m_closestBoneRef;
     }
 
 private:
-    const IBone *m_boneRef;
+    const Vector3 m_from;
+    const Vector3 m_direction;
+    Scalar m_closestFraction;
+    BoneRefObject *m_closestBoneRef;
 };
 
 }
 
+class WorldProxy::BonePickingTree {
+public:
+    BonePickingTree() {
+    }
+    ~BonePickingTree() {
+        clear();
+    }
+
+    void build(const ModelProxy *value) {
+        clear();
+        foreach (BoneRefObject *bone, value->allBoneRefs()) {
+            const IBone *boneRef = bone->data();
+            if (boneRef->isInteractive()) {
+                const Vector3 origin = boneRef->worldTransform().getOrigin();
+                Leaf leaf;
+                leaf.node = m_tree.insert(btDbvtVolume::FromCR(origin, kBoneSphereRadius), bone);
+                leaf.boneRef = boneRef;
+                leaf.origin = origin;
+                m_leaves.append(leaf);
+            }
+        }
+    }
+    void clear() {
+        m_tree.clear();
+        m_leaves.clear();
+    }
+    BoneRefObject *rayTest(const Vector3 &from, const Vector3 &to) {
+        ClosestBoneSphereCallback callback(from, to);
+        refit();
+        btDbvt::rayTest(m_tree.m_root, from, to, callback);
+        return callback.closestBoneRef();
+    }
+
+private:
+    struct Leaf {
+        btDbvtNode *node;
+        const IBone *boneRef;
+        Vector3 origin;
+    };
+
+    void refit() {
+        /* the tree follows the current pose only when picked and reinserts leaves of moved bones */
+        const int nleaves = m_leaves.size();
+        for (int i = 0; i < nleaves; i++) {
+            Leaf &leaf = m_leaves[i];
+            const Vector3 origin = leaf.boneRef->worldTransform().getOrigin();
+            if (origin != leaf.origin) {
+                btDbvtVolume volume = btDbvtVolume::FromCR(origin, kBoneSphereRadius);
+                m_tree.update(leaf.node, volume);
+                leaf.origin = origin;
+            }
+        }
+    }
+
+    btDbvt m_tree;
+    QVector<Leaf> m_leaves;
+};
+
 WorldProxy::WorldProxy(ProjectProxy *parent)
     : QObject(parent),
       m_sceneWorld(new World()),
-      m_modelWorld(new World()),
+      m_bonePickingTree(new BonePickingTree()),
       m_parentProjectProxyRef(parent),
       m_simulationType(DisableSimulation),
       m_gravity(0, -10, 0),
@@ -110,47 +190,16 @@ WorldProxy::~WorldProxy()
 
 BoneRefObject *WorldProxy::ray(const Vector3 &from, const Vector3 &to)
 {
-    btCollisionWorld::ClosestRayResultCallback callback(from, to);
-    btDiscreteDynamicsWorld *worldRef = m_modelWorld->dynamicWorldRef();
-    worldRef->stepSimulation(1);
-    worldRef->rayTest(from, to, callback);
-    if (callback.hasHit()) {
-        BoneRefObject *value = static_cast<BoneRefObject *>(callback.m_collisionObject->getUserPointer());
-        return value;
-    }
-    return 0;
+    return m_bonePickingTree->rayTest(from, to);
 }
 
 void WorldProxy::joinWorld(ModelProxy *value)
 {
-    btDiscreteDynamicsWorld *world = m_modelWorld->dynamicWorldRef();
-    const int numCollidables = world->getNumCollisionObjects();
-    for (int i = numCollidables - 1; i >= 0; i--) {
-        btCollisionObject *object = world->getCollisionObjectArray().at(i);
-        if (btRigidBody *body = btRigidBody::upcast(object)) {
-            world->removeRigidBody(body);
-            delete body->getMotionState();
-        }
-        else {
-            world->removeCollisionObject(object);
-        }
-        delete object->getCollisionShape();
-        delete object;
-    }
     if (value) {
-        foreach (BoneRefObject *bone, value->allBoneRefs()) {
-            const IBone *boneRef = bone->data();
-            if (boneRef->isInteractive()) {
-                QScopedPointer<btSphereShape> shape(new btSphereShape(0.5));
-                QScopedPointer<btMotionState> state(new SynchronizedBoneMotionState(boneRef));
-                btRigidBody::btRigidBodyConstructionInfo info(0, state.take(), shape.take(), kZeroV3);
-                QScopedPointer<btRigidBody> body(new btRigidBody(info));
-                //body->setActivationState(DISABLE_DEACTIVATION);
-                body->setCollisionFlags(body->getCollisionFlags() | btRigidBody::CF_KINEMATIC_OBJECT);
-                body->setUserPointer(bone);
-                world->addRigidBody(body.take());
-            }
-        }
+        m_bonePickingTree->build(value);
+    }
+    else {
+        m_bonePickingTree->clear();
     }
 }
 
@@ -103,8 +103,9 @@ signals:
     void enableFloorChanged();
 
 private:
+    class BonePickingTree;
     QScopedPointer<vpvl2::extensions::World> m_sceneWorld;
-    QScopedPointer<vpvl2::extensions::World> m_modelWorld;
+    QScopedPointer<BonePickingTree> m_bonePickingTree;
     QScopedPointer<btRigidBody> m_groundBody;
     ProjectProxy *m_parentProjectProxyRef;
     SimulationType m_simulationType;
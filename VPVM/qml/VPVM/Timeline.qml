@@ -138,9 +138,12 @@ FocusScope {
         console.assert(keyframe)
         var track = findTrack(keyframe.opaque)
         if (track) {
-            var trackKeyframes = track.keyframes
-            trackKeyframes.push(keyframe)
-            sortTrackKeyframes(trackKeyframes)
+            /* not materialized track will contain the keyframe on resolving */
+            var trackKeyframes = track.__keyframes
+            if (trackKeyframes) {
+                trackKeyframes.push(keyframe)
+                sortTrackKeyframes(trackKeyframes)
+            }
             canvas.requestPaint()
         }
     }
@@ -148,29 +151,46 @@ FocusScope {
         console.assert(keyframe)
         var track = findTrack(keyframe.opaque)
         if (track) {
-            var index = track.keyframes.indexOf(keyframe)
-            track.keyframes.splice(index, 1)
+            var trackKeyframes = track.__keyframes
+            if (trackKeyframes) {
+                var index = trackKeyframes.indexOf(keyframe)
+                trackKeyframes.splice(index, 1)
+            }
             canvas.requestPaint()
         }
     }
     function replaceKeyframe(dst, src) {
         var track = findTrack(dst.opaque)
         if (track) {
-            var index = track.keyframes.indexOf(src)
-            track.keyframes.splice(index, 1, dst)
+            var trackKeyframes = track.__keyframes
+            if (trackKeyframes) {
+                var index = trackKeyframes.indexOf(src)
+                trackKeyframes.splice(index, 1, dst)
+            }
             canvas.requestPaint()
         }
     }
 
+    function __resolveTrackKeyframes(track) {
+        var keyframes = track.__keyframes
+        if (!keyframes) {
+            var motionTrack = track.parentMotionTrack
+            keyframes = []
+            if (motionTrack) {
+                var numKeyframes = motionTrack.length
+                for (var i = 0; i < numKeyframes; i++) {
+                    keyframes.push(motionTrack.findKeyframeAt(i))
+                }
+                sortTrackKeyframes(keyframes)
+            }
+            track.__keyframes = keyframes
+        }
+        return keyframes
+    }
     function __assignTrack(track, motionTrack) {
-        var numKeyframes = motionTrack.length
-        track.keyframes = []
+        /* keyframe objects of the track are created on demand by __resolveTrackKeyframes */
         track.parentMotionTrack = motionTrack
-        for (var i = 0; i < numKeyframes; i++) {
-            var keyframe = motionTrack.findKeyframeAt(i)
-            track.keyframes.push(keyframe)
-        }
-        sortTrackKeyframes(track.keyframes)
+        track.__keyframes = null
     }
     function __assignBoneTracks(bones, motion) {
         for (var i in bones) {
@@ -344,9 +364,13 @@ FocusScope {
     function selectKeyframesByTimeIndex(timeIndex) {
         var tracks = __tracks, numTracks = tracks.length, selectedKeyframes = [];
         for (var i = 0; i < numTracks; i++) {
-            var track = tracks[i],
-                    keyframes = track.keyframes || [],
-                    keyframe = findKeyframeByTimeIndex(keyframes, timeIndex)
+            var track = tracks[i], motionTrack = track.parentMotionTrack, keyframe = null
+            if (track.__keyframes || !motionTrack) {
+                keyframe = findKeyframeByTimeIndex(track.keyframes || [], timeIndex)
+            }
+            else {
+                keyframe = motionTrack.findKeyframeByTimeIndex(timeIndex)
+            }
             if (keyframe) {
                 selectedKeyframes.push(keyframe)
             }
@@ -358,7 +382,14 @@ FocusScope {
     function selectRange(timeIndexFrom, timeIndexTo, visibleOnly) {
         var tracks = visibleOnly ? getVisibleTracks() : __tracks, numTracks = tracks.length, selectedKeyframes = []
         for (var i = 0; i < numTracks; i++) {
-            var track = tracks[i], keyframes = track.keyframes || [], numKeyframes = keyframes.length
+            var track = tracks[i], motionTrack = track.parentMotionTrack, keyframes
+            if (track.__keyframes || !motionTrack) {
+                keyframes = track.keyframes || []
+            }
+            else {
+                keyframes = motionTrack.findKeyframesInRange(timeIndexFrom, timeIndexTo)
+            }
+            var numKeyframes = keyframes.length
             for (var j = 0; j < numKeyframes; j++) {
                 var keyframe = keyframes[j]
                 if (keyframe.timeIndex >= timeIndexFrom && keyframe.timeIndex <= timeIndexTo) {
@@ -446,8 +477,12 @@ FocusScope {
                     "target": label,
                     "parent": objectTrack,
                     "parentMotionTrack": null,
-                    "keyframes": []
+                    "__keyframes": []
                 }
+                Object.defineProperty(propertyTrack, "keyframes", {
+                    "get": function() { return __resolveTrackKeyframes(this) },
+                    "set": function(value) { this.__keyframes = value }
+                })
                 // find place to insert
                 var parentObjectTrack = null, nextObjectTrack = null;
                 tracks = __tracks;
@@ -783,7 +818,6 @@ FocusScope {
             var xshift = 5,
                     canvasWidth = canvas.width,
                     timelineTrackLabelWidth = __trackLabelWidth,
-                    trackKeyframes = track.keyframes,
                     trackLabelHeight = __trackLabelHeight,
                     halfTrackLabelHeight = trackLabelHeight * 0.5,
                     fontAwesomeFont = [ iconPointSize, fontAwesome.name ].join(" "),
@@ -842,7 +876,6 @@ FocusScope {
                         trackWidth = __trackWidth,
                         timeScrollX = __timeScrollX,
                         timeShift = Math.max(0, (animationEnd - visibleTime) * timeScrollX),
-                        numKeyframes = trackKeyframes.length,
                         selectedKeyframes = __selectedKeyframes,
                         delta = 0;
                 if (visibleTime < animationEnd) {
@@ -851,11 +884,27 @@ FocusScope {
                 function memoizedTimeToX(time) {
                     return timelineTrackLabelWidth + (time - delta) * trackWidth + 10;
                 }
-                var timeScrollableX = timeScrollX + canvasWidth;
+                function memoizedXToTimeIndex(x) {
+                    return ((x - timelineTrackLabelWidth - 10) / trackWidth + delta) * framesPerSecond;
+                }
+                var timeScrollableX = timeScrollX + canvasWidth, trackKeyframes, firstTimeIndex, lastTimeIndex;
+                if (track.__keyframes || !parentMotionTrack) {
+                    trackKeyframes = track.keyframes
+                    firstTimeIndex = trackKeyframes.length > 0 ? trackKeyframes[0].timeIndex : -1
+                    lastTimeIndex = trackKeyframes.length > 0 ? trackKeyframes[trackKeyframes.length - 1].timeIndex : -1
+                }
+                else {
+                    /* create keyframe objects only in the visible range of the track */
+                    trackKeyframes = parentMotionTrack.findVisibleKeyframesInRange(Math.floor(memoizedXToTimeIndex(timeScrollX)) - 1,
+                                                                                   Math.ceil(memoizedXToTimeIndex(timeScrollableX)) + 1)
+                    firstTimeIndex = parentMotionTrack.timeIndexAt(0)
+                    lastTimeIndex = parentMotionTrack.timeIndexAt(parentMotionTrack.length - 1)
+                }
+                var numKeyframes = trackKeyframes.length
                 for (var i = 0; i < numKeyframes; i++) {
                     var keyframe = trackKeyframes[i],
                             selected = (selectedKeyframes.indexOf(keyframe) > -1),
-                            first = (i === 0), last = (i === numKeyframes - 1),
+                            first = (keyframe.timeIndex === firstTimeIndex), last = (keyframe.timeIndex === lastTimeIndex),
                             x = memoizedTimeToX(keyframe.time), y2 = y - halfTrackLabelHeight;
                     if (x >= timeScrollX && x < timeScrollableX) {
                         drawRombus(ctx, x, y2, halfTrackLabelHeight, halfTrackLabelHeight, rombusBaseFillColor, true, true, selected ? rombusSelectedStrokeColor : rombusBaseStrokeColor);
@@ -514,6 +514,9 @@ function(vpvl2_add_qt)
       add_executable(vpvl2_generator_test "${CMAKE_CURRENT_SOURCE_DIR}/test/generator/main.cc")
       target_link_libraries(vpvl2_generator_test ${VPVL2_PROJECT_NAME})
       vpvl2_link_all(vpvl2_generator_test)
+      add_executable(vpvl2_benchmark "${CMAKE_CURRENT_SOURCE_DIR}/test/benchmark/main.cc")
+      target_link_libraries(vpvl2_benchmark ${VPVL2_PROJECT_NAME})
+      vpvl2_link_all(vpvl2_benchmark)
     endif()
   endif()
 endfunction()
@@ -628,6 +631,20 @@ function(vpvl2_add_egl_renderer)
   endif()
 endfunction()
 
+function(vpvl2_add_batch_renderer)
+  if(VPVL2_BUILD_BATCH_RENDERER AND VPVL2_LINK_EGL AND VPVL2_ENABLE_EXTENSIONS_PROJECT)
+    find_path(EGL_INCLUDE_DIR NAMES EGL/egl.h)
+    find_library(EGL_LIBRARY NAMES EGL)
+    find_package(Threads REQUIRED)
+    set(vpvl2_batch_sources "render/batch/main.cc")
+    set(VPVL2_EXECUTABLE vpvl2_batch)
+    add_executable(${VPVL2_EXECUTABLE} ${vpvl2_batch_sources})
+    target_link_libraries(${VPVL2_EXECUTABLE} ${EGL_LIBRARY} ${CMAKE_THREAD_LIBS_INIT})
+    include_directories(${EGL_INCLUDE_DIR})
+    vpvl2_create_executable(${VPVL2_EXECUTABLE})
+  endif()
+endfunction()
+
 function(vpvl2_find_all)
   vpvl2_find_vpvl()
   vpvl2_find_nvfx()
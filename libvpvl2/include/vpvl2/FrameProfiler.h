@@ -0,0 +1,255 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_FRAMEPROFILER_H_
+#define VPVL2_FRAMEPROFILER_H_
+
+#include "vpvl2/Common.h"
+
+namespace vpvl2
+{
+
+/**
+ * シーンの更新と描画にかかる時間をフレームごとに記録するクラスです.
+ *
+ * attach を呼び出したスレッドで beginFrame と endFrame に囲まれた区間において、
+ * VPVL2_PROFILE_STAGE によって囲まれた各段階の経過時間をナノ秒単位で集計し、
+ * VPVL2_PROFILE_COUNT によって加算された描画命令数などのカウンタと共に記録します。
+ * 段階が入れ子になった場合、外側の段階の経過時間には内側の段階の経過時間は含まれません。
+ *
+ * 記録したフレームは作成時に指定した数だけ保持され、それを超えると古いフレームから上書きされます。
+ * 記録中のメモリ確保は行われず、attach されていない場合はスレッドローカル変数の参照のみで済むため、
+ * 常に有効にした状態でも処理の負荷はほとんど増えません。
+ */
+class VPVL2_API FrameProfiler VPVL2_DECL_FINAL
+{
+public:
+    enum Stage {
+        kMotionSeekStage,
+        kMorphUpdateStage,
+        kBoneTransformStage,
+        kIKStage,
+        kPhysicsStepStage,
+        kRigidBodySyncStage,
+        kSkinningStage,
+        kBufferUploadStage,
+        kDrawStage,
+        kMaxStage
+    };
+    enum CounterType {
+        kUpdatedModelCounter,
+        kSkinnedVertexCounter,
+        kUploadedBytesCounter,
+        kDrawCallCounter,
+        kSavedStateChangeCounter,
+        kMaxCounterType
+    };
+    struct Frame {
+        uint64 index;
+        uint64 timestamp;
+        uint64 duration;
+        uint64 stageDurations[kMaxStage];
+        int stageCalls[kMaxStage];
+        vsize counters[kMaxCounterType];
+    };
+
+    /**
+     * 生存期間中の区間を現在のスレッドの FrameProfiler の段階 stage として記録するクラスです.
+     */
+    class VPVL2_API Scope VPVL2_DECL_FINAL {
+    public:
+        explicit Scope(Stage stage);
+        ~Scope();
+
+    private:
+        FrameProfiler *m_profilerRef;
+        int m_previousStage;
+        VPVL2_DISABLE_COPY_AND_ASSIGN(Scope)
+    };
+
+    /**
+     * 現在のスレッドに attach されている FrameProfiler を返します.
+     *
+     * 存在しない場合は 0 を返します。
+     *
+     * @brief currentProfilerRef
+     * @return FrameProfiler
+     */
+    static FrameProfiler *currentProfilerRef();
+
+    /**
+     * 現在のスレッドの FrameProfiler のカウンタ type に value を加算します.
+     *
+     * @brief count
+     * @param type
+     * @param value
+     */
+    static void count(CounterType type, vsize value);
+
+    /**
+     * 段階 stage の名前を返します.
+     *
+     * @brief stageName
+     * @param stage
+     * @return const char
+     */
+    static const char *stageName(Stage stage);
+
+    /**
+     * 直近 capacity フレーム分を保持する FrameProfiler を作成します.
+     *
+     * @brief FrameProfiler
+     * @param capacity
+     */
+    explicit FrameProfiler(int capacity = 120);
+    ~FrameProfiler();
+
+    /**
+     * 現在のスレッドで記録を開始します.
+     *
+     * @brief attach
+     */
+    void attach();
+
+    /**
+     * 現在のスレッドでの記録を終了します.
+     *
+     * @brief detach
+     */
+    void detach();
+
+    /**
+     * 記録した全てのフレームを破棄します.
+     *
+     * @brief clear
+     */
+    void clear();
+
+    /**
+     * フレームの開始を記録します.
+     *
+     * 前のフレームが終了していない場合はそのフレームを終了させてから新しいフレームを開始します。
+     *
+     * @brief beginFrame
+     */
+    void beginFrame();
+
+    /**
+     * フレームの終了を記録します.
+     *
+     * @brief endFrame
+     */
+    void endFrame();
+
+    /**
+     * beginFrame が呼ばれてから endFrame が呼ばれるまでの間であれば true を返します.
+     *
+     * @brief isInFrame
+     * @return bool
+     */
+    bool isInFrame() const;
+
+    /**
+     * 現在のフレームのカウンタ type に value を加算します.
+     *
+     * フレームの外で呼び出された場合は何もしません。
+     *
+     * @brief addCounter
+     * @param type
+     * @param value
+     */
+    void addCounter(CounterType type, vsize value);
+
+    /**
+     * 保持できるフレームの数を返します.
+     *
+     * @brief capacity
+     * @return int
+     */
+    int capacity() const;
+
+    /**
+     * 保持している終了済みのフレームの数を返します.
+     *
+     * @brief countFrames
+     * @return int
+     */
+    int countFrames() const;
+
+    /**
+     * index 番目に古いフレームを返します.
+     *
+     * countFrames() - 1 が最も新しいフレームになります。
+     * timestamp と duration はナノ秒で表し、timestamp は FrameProfiler を作成した時刻からの経過時間です。
+     *
+     * @brief frameAt
+     * @param index
+     * @return Frame
+     */
+    const Frame &frameAt(int index) const;
+
+    /**
+     * 保持しているフレームにおける段階 stage の平均経過時間をナノ秒で返します.
+     *
+     * @brief averageStageDuration
+     * @param stage
+     * @return uint64
+     */
+    uint64 averageStageDuration(Stage stage) const;
+
+private:
+    friend class Scope;
+    void enterStage(Stage stage, int &previousStage);
+    void leaveStage(int previousStage);
+
+    struct PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(FrameProfiler)
+};
+
+} /* namespace vpvl2 */
+
+#define VPVL2_PROFILE_CONCAT_IMPL(a, b) a ## b
+#define VPVL2_PROFILE_CONCAT(a, b) VPVL2_PROFILE_CONCAT_IMPL(a, b)
+#define VPVL2_PROFILE_STAGE(stage) \
+    vpvl2::FrameProfiler::Scope VPVL2_PROFILE_CONCAT(vpvl2ProfileScope, __LINE__)(vpvl2::FrameProfiler::stage)
+#define VPVL2_PROFILE_COUNT(type, value) \
+    vpvl2::FrameProfiler::count(vpvl2::FrameProfiler::type, vsize(value))
+
+#endif
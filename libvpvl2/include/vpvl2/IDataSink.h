@@ -0,0 +1,74 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#pragma once
+#ifndef VPVL2_IDATASINK_H_
+#define VPVL2_IDATASINK_H_
+
+#include "vpvl2/Common.h"
+
+namespace vpvl2
+{
+
+/**
+ * モデルやモーションの保存先を表すインターフェースです.
+ *
+ * pmx::Model::save(IDataSink *) や vmd::Motion::save(IDataSink *) に渡すと、
+ * 出力全体のバッファを確保せずにセクションごとに逐次書き出します。
+ * ファイルディスクリプタやメモリマップの窓、チャンクのリストなどを実装先として想定しています。
+ */
+class VPVL2_API IDataSink
+{
+public:
+    virtual ~IDataSink() {}
+
+    /**
+     * data から size バイト分を書き出します.
+     *
+     * 書き出しに失敗した場合は false を返します。false が返された時点で保存処理は中断されます。
+     *
+     * @param data
+     * @param size
+     * @return bool
+     */
+    virtual bool write(const uint8 *data, vsize size) = 0;
+};
+
+} /* namespace vpvl2 */
+
+#endif
@@ -79,6 +79,7 @@ public:
             kUVA3Stride,
             kUVA4Stride,
             kIndexStride,
+            kBonePaletteIndexStride,
             kMaxStrideType
         };
         virtual ~Buffer() {}
@@ -110,8 +111,10 @@ public:
     struct MatrixBuffer {
         virtual ~MatrixBuffer() {}
         virtual void update(void *address) = 0;
-        virtual const float32 *bytes(int materialIndex) const = 0;
-        virtual vsize size(int materialIndex) const = 0;
+        virtual int countSubsets(int materialIndex) const = 0;
+        virtual int indexCount(int materialIndex, int subsetIndex) const = 0;
+        virtual const float32 *bytes(int materialIndex, int subsetIndex) const = 0;
+        virtual vsize size(int materialIndex, int subsetIndex) const = 0;
     };
     class PropertyEventListener {
     public:
@@ -664,6 +667,8 @@ public:
      * 引数は delete で一度解放してから IMatrixBuffer のインスタンスが入ります。
      * IDynamicVertexBuffer と IIndexBuffer は同じ型で取得したインスタンスを渡す必要があります。
      * 条件を満たさない場合は matrixBuffer に 0 が入ります。
+     * 材質の頂点が参照するボーンが多い場合は材質を複数の描画 (サブセット) に分割したボーン行列を返します。
+     * 分割できない場合も matrixBuffer に 0 が入ります。
      *
      * @brief getMatrixBuffer
      * @param matrixBuffer
@@ -374,6 +374,7 @@ public:
      * 同様にメモリの所有権が IMotion 側に移動するため、メモリを解放しないようにする必要があります。
      * alsoDelete を true にして渡すと論理削除ではなく物理削除で行います。
      * removeKeyframe/deleteKeyframe と異なり、timeIndex が 0 であっても処理が実行されます。
+     * 追加済みのキーフレームの timeIndex を直接変更した場合は、そのキーフレームを渡して並び順を更新する必要があります。
      *
      * @param IKeyframe
      * @param alsoDelete
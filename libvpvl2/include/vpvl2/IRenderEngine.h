@@ -55,6 +55,29 @@ public:
         kNone = 0,
         kParallelUpdate = 1
     };
+    enum UploadStatus {
+        kUploadFailed,
+        kUploadInProgress,
+        kUploadCompleted
+    };
+
+    /**
+     * IRenderEngine#uploadIncrementally の進捗を受け取るためのインターフェースです.
+     */
+    class UploadProgressListener {
+    public:
+        virtual ~UploadProgressListener() {}
+
+        /**
+         * アップロード処理が1ステップ進んだ時に呼ばれます.
+         *
+         * @brief uploadDidProgress
+         * @param engine
+         * @param nfinishedSteps
+         * @param nsteps
+         */
+        virtual void uploadDidProgress(IRenderEngine *engine, int nfinishedSteps, int nsteps) = 0;
+    };
 
     virtual ~IRenderEngine() {}
 
@@ -79,6 +102,22 @@ public:
      */
     virtual bool upload(void *userData) = 0;
 
+    /**
+     * IRenderEngine#upload の処理を最大 maxSteps 分だけ行います.
+     *
+     * 戻り値が kUploadInProgress の間は同じ userData で再度呼び出しを行う必要があります。
+     * 全てのリソースのアップロードが完了するまではテクスチャを持たない代替の材質で描画されます。
+     * 処理を分割しないエンジンの場合は一度の呼び出しで全てのアップロードを行います。
+     * IRenderEngine#upload と併用することはできません。
+     *
+     * @brief uploadIncrementally
+     * @param userData
+     * @param maxSteps
+     * @param listener
+     * @return
+     */
+    virtual UploadStatus uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener) = 0;
+
     /**
      * 使用しているグラフィック API に対して確保したリソースを解放します.
      *
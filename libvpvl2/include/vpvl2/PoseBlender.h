@@ -0,0 +1,216 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_POSEBLENDER_H_
+#define VPVL2_POSEBLENDER_H_
+
+#include "vpvl2/Common.h"
+#include "vpvl2/PoseEvaluator.h"
+
+namespace vpvl2
+{
+
+class IModel;
+class PoseCache;
+
+/**
+ * 複数のモーションをレイヤーとして合成してモデルに反映するクラスです.
+ *
+ * 各レイヤーは PoseEvaluator または PoseCache を元に作成し、レイヤーの追加順に合成されます。
+ * 合成結果は内部の Pose に書き込まれ、apply を呼び出した時に一度だけモデルに反映されます。
+ * 重みが 0 のレイヤーは評価されず、いずれかのレイヤーがキーフレームを持つボーン及びモーフのみが反映されます。
+ */
+class VPVL2_API PoseBlender VPVL2_DECL_FINAL
+{
+public:
+    enum LayerType {
+        /** 重みに基づいてそれまでの合成結果と補間します */
+        kBlendLayer,
+        /** 重みを乗じた値をそれまでの合成結果に加算します */
+        kAdditiveLayer,
+        kMaxLayerType
+    };
+
+    explicit PoseBlender(IModel *modelRef);
+    ~PoseBlender();
+
+    /**
+     * evaluator を元にしたレイヤーを追加し、そのレイヤーの番号を返します.
+     *
+     * 追加したレイヤーの重みは 1 です。evaluator は PoseBlender より長く存在する必要があります。
+     *
+     * @brief addLayer
+     * @param evaluator
+     * @param type
+     * @return int
+     */
+    int addLayer(const PoseEvaluator *evaluator, LayerType type);
+
+    /**
+     * cache を元にしたレイヤーを追加し、そのレイヤーの番号を返します.
+     *
+     * @brief addLayer
+     * @param cache
+     * @param type
+     * @return int
+     */
+    int addLayer(const PoseCache *cache, LayerType type);
+
+    /**
+     * 全てのレイヤーを削除します.
+     *
+     * @brief removeAllLayers
+     */
+    void removeAllLayers();
+
+    /**
+     * レイヤーの合成対象となるボーンを boneIndices の IBone::index() に限定します.
+     *
+     * 空の配列を渡した場合は制限を解除します。モーフは制限されません。
+     *
+     * @brief setLayerBoneMask
+     * @param index
+     * @param boneIndices
+     */
+    void setLayerBoneMask(int index, const Array<int> &boneIndices);
+
+    /**
+     * index 番目のレイヤーの重みを設定します.
+     *
+     * @brief setLayerWeight
+     * @param index
+     * @param value
+     */
+    void setLayerWeight(int index, const Scalar &value);
+
+    /**
+     * index 番目のレイヤーのフレーム位置を設定します.
+     *
+     * @brief setLayerTimeIndex
+     * @param index
+     * @param value
+     */
+    void setLayerTimeIndex(int index, const IKeyframe::TimeIndex &value);
+
+    Scalar layerWeight(int index) const;
+    IKeyframe::TimeIndex layerTimeIndex(int index) const;
+    LayerType layerType(int index) const;
+    int countLayers() const VPVL2_DECL_NOEXCEPT;
+
+    /**
+     * fromIndex 番目のレイヤーから toIndex 番目のレイヤーへ duration の時間をかけてクロスフェードします.
+     *
+     * advance を呼び出すたびに fromIndex の重みが 1 から 0 に、toIndex の重みが 0 から 1 に変化します。
+     *
+     * @brief crossfade
+     * @param fromIndex
+     * @param toIndex
+     * @param duration
+     */
+    void crossfade(int fromIndex, int toIndex, const IKeyframe::TimeIndex &duration);
+
+    /**
+     * 全てのレイヤーのフレーム位置を timeIndex に設定します.
+     *
+     * @brief seek
+     * @param timeIndex
+     */
+    void seek(const IKeyframe::TimeIndex &timeIndex);
+
+    /**
+     * 全てのレイヤーのフレーム位置とクロスフェードを delta だけ進めます.
+     *
+     * @brief advance
+     * @param delta
+     */
+    void advance(const IKeyframe::TimeIndex &delta);
+
+    /**
+     * 全てのレイヤーを評価して合成結果を内部の Pose に書き込みます.
+     *
+     * モデルの状態は変更しません。
+     *
+     * @brief evaluate
+     */
+    void evaluate();
+
+    /**
+     * evaluate で求めた合成結果をモデルに反映します.
+     *
+     * 反映後は IModel::performUpdate を呼び出してください。
+     *
+     * @brief apply
+     */
+    void apply();
+
+    /**
+     * 合成結果の Pose を返します.
+     *
+     * @brief pose
+     * @return Pose
+     */
+    const PoseEvaluator::Pose &pose() const VPVL2_DECL_NOEXCEPT;
+
+    /**
+     * 直前の evaluate で合成されたボーンの数を返します.
+     *
+     * @brief countBlendedBones
+     * @return int
+     */
+    int countBlendedBones() const VPVL2_DECL_NOEXCEPT;
+
+    /**
+     * 直前の evaluate で合成されたモーフの数を返します.
+     *
+     * @brief countBlendedMorphs
+     * @return int
+     */
+    int countBlendedMorphs() const VPVL2_DECL_NOEXCEPT;
+
+    IModel *parentModelRef() const VPVL2_DECL_NOEXCEPT;
+
+private:
+    struct PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(PoseBlender)
+};
+
+} /* namespace vpvl2 */
+
+#endif
@@ -0,0 +1,192 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_POSECACHE_H_
+#define VPVL2_POSECACHE_H_
+
+#include "vpvl2/Common.h"
+#include "vpvl2/PoseEvaluator.h"
+
+namespace vpvl2
+{
+
+class IModel;
+
+/**
+ * モーションを一定間隔で標本化し、圧縮した姿勢のキャッシュとして保持するクラスです.
+ *
+ * 同じモーションを繰り返し再生する場合にベジェ曲線の補間を毎フレーム行う代わりに、
+ * 標本化済みの値を線形補間 (回転は nlerp) するだけで姿勢を求めることができます。
+ * 各チャンネルは定数、線形、標本の三種類のいずれかで格納され、回転は 16bit に量子化されます。
+ * save で書き出したデータを load で読み込むことでセッション間で再利用することができます。
+ */
+class VPVL2_API PoseCache VPVL2_DECL_FINAL
+{
+public:
+    enum ChannelType {
+        kConstantChannel,
+        kLinearChannel,
+        kSampledChannel,
+        kMaxChannelType
+    };
+
+    PoseCache();
+    ~PoseCache();
+
+    /**
+     * evaluator のモーションを interval 間隔で標本化してキャッシュを作成します.
+     *
+     * 既存のキャッシュは破棄されます。
+     *
+     * @brief bake
+     * @param evaluator
+     * @param interval
+     */
+    void bake(const PoseEvaluator *evaluator, const IKeyframe::TimeIndex &interval);
+
+    /**
+     * キャッシュ作成時のモデルのボーンとモーフの数に合わせて pose の領域を確保します.
+     *
+     * @brief allocate
+     * @param pose
+     */
+    void allocate(PoseEvaluator::Pose &pose) const;
+
+    /**
+     * timeIndex における姿勢をキャッシュから求めて pose に書き込みます.
+     *
+     * PoseEvaluator::evaluate と同じくモデルの状態は変更せず、複数のスレッドから同時に呼び出すことができます。
+     *
+     * @brief evaluate
+     * @param timeIndex
+     * @param pose
+     */
+    void evaluate(const IKeyframe::TimeIndex &timeIndex, PoseEvaluator::Pose &pose) const;
+
+    /**
+     * boneTrackIndices で指定されたボーンのトラックと全てのモーフのトラックのみ timeIndex における姿勢をキャッシュから求めます.
+     *
+     * boneTrackIndices の値は getBoneIndices で得られる配列の添字です。
+     *
+     * @brief evaluate
+     * @param timeIndex
+     * @param boneTrackIndices
+     * @param pose
+     */
+    void evaluate(const IKeyframe::TimeIndex &timeIndex, const Array<int> &boneTrackIndices, PoseEvaluator::Pose &pose) const;
+
+    /**
+     * pose の値のうちキャッシュに含まれるボーン及びモーフの値を model に反映します.
+     *
+     * @brief bind
+     * @param pose
+     * @param model
+     */
+    void bind(const PoseEvaluator::Pose &pose, IModel *model) const;
+
+    /**
+     * save で書き出したデータからキャッシュを読み込みます.
+     *
+     * 読み込みに失敗した場合は false を返し、キャッシュは空になります。
+     *
+     * @brief load
+     * @param data
+     * @param size
+     * @return bool
+     */
+    bool load(const uint8 *data, vsize size);
+
+    /**
+     * キャッシュを data に書き出します.
+     *
+     * data は estimateSize の値以上の大きさを持つ必要があります。
+     *
+     * @brief save
+     * @param data
+     */
+    void save(uint8 *data) const;
+
+    /**
+     * save で書き出すのに必要な大きさを返します.
+     *
+     * @brief estimateSize
+     * @return vsize
+     */
+    vsize estimateSize() const;
+
+    /**
+     * キャッシュに含まれるボーンの IBone::index() の値を value に格納します.
+     *
+     * @brief getBoneIndices
+     * @param value
+     */
+    void getBoneIndices(Array<int> &value) const;
+
+    /**
+     * キャッシュに含まれるモーフの IMorph::index() の値を value に格納します.
+     *
+     * @brief getMorphIndices
+     * @param value
+     */
+    void getMorphIndices(Array<int> &value) const;
+
+    /**
+     * 指定された種類のチャンネルの数を返します.
+     *
+     * @brief countChannels
+     * @param value
+     * @return int
+     */
+    int countChannels(ChannelType value) const VPVL2_DECL_NOEXCEPT;
+
+    int countSamples() const VPVL2_DECL_NOEXCEPT;
+    int countBoneTracks() const VPVL2_DECL_NOEXCEPT;
+    int countMorphTracks() const VPVL2_DECL_NOEXCEPT;
+    IKeyframe::TimeIndex interval() const VPVL2_DECL_NOEXCEPT;
+    IKeyframe::TimeIndex duration() const VPVL2_DECL_NOEXCEPT;
+
+private:
+    struct PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(PoseCache)
+};
+
+} /* namespace vpvl2 */
+
+#endif
@@ -0,0 +1,193 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_POSEEVALUATOR_H_
+#define VPVL2_POSEEVALUATOR_H_
+
+#include "vpvl2/Common.h"
+#include "vpvl2/IKeyframe.h"
+#include "vpvl2/IMorph.h"
+
+namespace vpvl2
+{
+
+class IModel;
+class IMotion;
+
+/**
+ * モデルとモーションから指定されたフレーム位置の姿勢を求めるクラスです.
+ *
+ * IMotion::seek と異なりモデルのボーンやモーフの状態を一切変更せず、
+ * 呼び出し側が用意した Pose に結果を書き込みます。
+ * evaluate は const メソッドで内部状態を持たないため、モーションを編集しない限り
+ * 複数のスレッドから同時に呼び出すことができます。物理演算を無効にした状態での書き出しにおいて、
+ * 各フレームの姿勢を並列に事前計算する用途を想定しています。
+ *
+ * 対象となるのはコンストラクタで指定されたレイヤーのボーン及びモーフのキーフレームのみです。
+ * MVD の複数のレイヤーを合成する場合はレイヤー毎に作成して PoseBlender に渡してください。
+ */
+class VPVL2_API PoseEvaluator VPVL2_DECL_FINAL
+{
+public:
+    /**
+     * 姿勢の計算結果を格納する構造体です.
+     *
+     * 各配列の添字は IBone::index() または IMorph::index() に対応します。
+     * allocate で確保してから evaluate に渡してください。
+     */
+    struct Pose {
+        Array<Vector3> localTranslations;
+        Array<Quaternion> localOrientations;
+        Array<IMorph::WeightPrecision> morphWeights;
+        IKeyframe::TimeIndex timeIndex;
+    };
+
+    PoseEvaluator(const IModel *modelRef, const IMotion *motionRef, const IKeyframe::LayerIndex &layerIndex = 0);
+    ~PoseEvaluator();
+
+    /**
+     * モーションのキーフレームから計算用のトラックを再構築します.
+     *
+     * モーションのキーフレームを追加・削除・変更した場合は evaluate を呼ぶ前に呼び出してください。
+     *
+     * @brief reload
+     */
+    void reload();
+
+    /**
+     * モデルのボーンとモーフの数に合わせて pose の領域を確保し、初期値で埋めます.
+     *
+     * @brief allocate
+     * @param pose
+     */
+    void allocate(Pose &pose) const;
+
+    /**
+     * timeIndex における姿勢を求めて pose に書き込みます.
+     *
+     * キーフレームを持たないボーン及びモーフの値は変更しません。
+     *
+     * @brief evaluate
+     * @param timeIndex
+     * @param pose
+     */
+    void evaluate(const IKeyframe::TimeIndex &timeIndex, Pose &pose) const;
+
+    /**
+     * boneTrackIndices で指定されたボーンのトラックと全てのモーフのトラックのみ timeIndex における姿勢を求めて pose に書き込みます.
+     *
+     * boneTrackIndices の値は getBoneIndices で得られる配列の添字です。
+     * PoseBlender でボーンマスクが設定されたレイヤーを評価する際に使われます。
+     *
+     * @brief evaluate
+     * @param timeIndex
+     * @param boneTrackIndices
+     * @param pose
+     */
+    void evaluate(const IKeyframe::TimeIndex &timeIndex, const Array<int> &boneTrackIndices, Pose &pose) const;
+
+    /**
+     * timeIndices のそれぞれのフレーム位置における姿勢を求めて poses に書き込みます.
+     *
+     * timeIndices と poses の数は同じである必要があります。
+     * enableParallel が true かつ TBB または OpenMP が有効の場合は並列に計算します。
+     *
+     * @brief evaluateAll
+     * @param timeIndices
+     * @param poses
+     * @param enableParallel
+     */
+    void evaluateAll(const Array<IKeyframe::TimeIndex> &timeIndices, const Array<Pose *> &poses, bool enableParallel) const;
+
+    /**
+     * pose の値を model のボーン及びモーフに反映します.
+     *
+     * キーフレームを持つボーン及びモーフのみ反映します。反映後は IModel::performUpdate を呼び出してください。
+     *
+     * @brief bind
+     * @param pose
+     * @param model
+     */
+    void bind(const Pose &pose, IModel *model) const;
+
+    /**
+     * キーフレームを持つボーンの数を返します.
+     *
+     * @brief countBoneTracks
+     * @return int
+     */
+    int countBoneTracks() const VPVL2_DECL_NOEXCEPT;
+
+    /**
+     * キーフレームを持つモーフの数を返します.
+     *
+     * @brief countMorphTracks
+     * @return int
+     */
+    int countMorphTracks() const VPVL2_DECL_NOEXCEPT;
+
+    /**
+     * キーフレームを持つボーンの IBone::index() の値を value に格納します.
+     *
+     * @brief getBoneIndices
+     * @param value
+     */
+    void getBoneIndices(Array<int> &value) const;
+
+    /**
+     * キーフレームを持つモーフの IMorph::index() の値を value に格納します.
+     *
+     * @brief getMorphIndices
+     * @param value
+     */
+    void getMorphIndices(Array<int> &value) const;
+
+    const IModel *parentModelRef() const VPVL2_DECL_NOEXCEPT;
+    const IMotion *motionRef() const VPVL2_DECL_NOEXCEPT;
+    IKeyframe::LayerIndex layerIndex() const VPVL2_DECL_NOEXCEPT;
+
+private:
+    struct PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(PoseEvaluator)
+};
+
+} /* namespace vpvl2 */
+
+#endif
@@ -66,6 +66,7 @@ public:
         kOpenCLAccelerationType1,
         kVertexShaderAccelerationType1,
         kOpenCLAccelerationType2,
+        kVertexShaderAccelerationType2,
         kMaxAccelerationType
     };
     enum RenderEngineTypeFlags {
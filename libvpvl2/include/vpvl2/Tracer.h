@@ -0,0 +1,224 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#pragma once
+#ifndef VPVL2_TRACER_H_
+#define VPVL2_TRACER_H_
+
+#include "vpvl2/Common.h"
+
+namespace vpvl2
+{
+
+class IDataSink;
+
+/**
+ * モデルやモーション、プロジェクトの読み込みにかかる時間を記録するクラスです.
+ *
+ * attach を呼び出したスレッドで VPVL2_TRACE_SCOPE によって囲まれた区間の開始時刻と経過時間、
+ * 区間内で VPVL2_TRACE_COUNT によって加算された読み込んだ頂点やキーフレームなどのレコード数や文字列変換の回数を記録します。
+ * 記録した内容は writeChromeTraceEvents で Chrome のトレースイベント形式 (chrome://tracing) で書き出せます。
+ *
+ * VPVL2_TRACE_SCOPE と VPVL2_TRACE_COUNT は VPVL2_ENABLE_TRACE が有効な場合のみ展開され、
+ * 無効な場合は何も記録されません。
+ * Tracer は一つのスレッドに対してのみ attach することができます。別のスレッドの区間を記録する場合は
+ * スレッドごとに Tracer を作成してください。
+ */
+class VPVL2_API Tracer VPVL2_DECL_FINAL
+{
+public:
+    enum CounterType {
+        kParsedObjectCounter,     /* 読み込んだ頂点やキーフレームなどのレコード数 */
+        kStringConversionCounter, /* IEncoding::toString の呼び出し回数 */
+        kMaxCounterType
+    };
+    struct Event {
+        const char *category;
+        const char *name;
+        uint64 timestamp;
+        uint64 duration;
+        int depth;
+        vsize counters[kMaxCounterType];
+    };
+
+    /**
+     * 生存期間中の区間を現在のスレッドの Tracer に記録するクラスです.
+     *
+     * category と name は静的な文字列である必要があります。
+     */
+    class VPVL2_API Scope VPVL2_DECL_FINAL {
+    public:
+        Scope(const char *category, const char *name);
+        ~Scope();
+
+    private:
+        Tracer *m_tracerRef;
+        int m_index;
+        VPVL2_DISABLE_COPY_AND_ASSIGN(Scope)
+    };
+
+    /**
+     * 現在のスレッドに attach されている Tracer を返します.
+     *
+     * 存在しない場合は 0 を返します。
+     *
+     * @brief currentTracerRef
+     * @return Tracer
+     */
+    static Tracer *currentTracerRef();
+
+    /**
+     * 現在のスレッドの Tracer のカウンタ type に value を加算します.
+     *
+     * @brief count
+     * @param type
+     * @param value
+     */
+    static void count(CounterType type, vsize value);
+
+    Tracer();
+    ~Tracer();
+
+    /**
+     * 現在のスレッドで記録を開始します.
+     *
+     * @brief attach
+     */
+    void attach();
+
+    /**
+     * 現在のスレッドでの記録を終了します.
+     *
+     * @brief detach
+     */
+    void detach();
+
+    /**
+     * 記録した全ての区間とカウンタを破棄します.
+     *
+     * @brief clear
+     */
+    void clear();
+
+    /**
+     * 区間の開始を記録し、区間のインデックスを返します.
+     *
+     * timestamp は Tracer を作成した時刻からの経過時間をマイクロ秒で表します。
+     *
+     * @brief beginEvent
+     * @param category
+     * @param name
+     * @return int
+     */
+    int beginEvent(const char *category, const char *name);
+
+    /**
+     * beginEvent が返したインデックスの区間の終了を記録します.
+     *
+     * @brief endEvent
+     * @param index
+     */
+    void endEvent(int index);
+
+    /**
+     * カウンタ type に value を加算します.
+     *
+     * @brief addCounter
+     * @param type
+     * @param value
+     */
+    void addCounter(CounterType type, vsize value);
+
+    /**
+     * 記録を開始してからのカウンタ type の合計値を返します.
+     *
+     * @brief counter
+     * @param type
+     * @return vsize
+     */
+    vsize counter(CounterType type) const;
+
+    /**
+     * 記録した区間の数を返します.
+     *
+     * @brief countEvents
+     * @return int
+     */
+    int countEvents() const;
+
+    /**
+     * index 番目に開始された区間を返します.
+     *
+     * @brief eventAt
+     * @param index
+     * @return Event
+     */
+    const Event &eventAt(int index) const;
+
+    /**
+     * 記録した区間を Chrome のトレースイベント形式の JSON として sink に書き出します.
+     *
+     * @brief writeChromeTraceEvents
+     * @param sink
+     * @return bool
+     */
+    bool writeChromeTraceEvents(IDataSink *sink) const;
+
+private:
+    struct PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(Tracer)
+};
+
+} /* namespace vpvl2 */
+
+#define VPVL2_TRACE_CONCAT_IMPL(a, b) a ## b
+#define VPVL2_TRACE_CONCAT(a, b) VPVL2_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef VPVL2_ENABLE_TRACE
+#define VPVL2_TRACE_SCOPE(category, name) \
+    vpvl2::Tracer::Scope VPVL2_TRACE_CONCAT(vpvl2TraceScope, __LINE__)(category, name)
+#define VPVL2_TRACE_COUNT(type, value) \
+    vpvl2::Tracer::count(vpvl2::Tracer::type, vsize(value))
+#else
+#define VPVL2_TRACE_SCOPE(category, name)
+#define VPVL2_TRACE_COUNT(type, value)
+#endif /* VPVL2_ENABLE_TRACE */
+
+#endif
@@ -175,6 +175,14 @@ public:
     void removeRigidBody(IRigidBody *value);
     void removeVertex(IVertex *value);
 
+    int addInstanceTransform(const Transform &value);
+    void setInstanceTransform(int index, const Transform &value);
+    void removeInstanceTransformAt(int index);
+    void removeAllInstanceTransforms();
+    int countInstanceTransforms() const;
+    Transform instanceTransformAt(int index) const;
+    int revision() const { return m_revision; }
+
 #if defined(VPVL2_LINK_ASSIMP) || defined(VPVL2_LINK_ASSIMP3)
     const aiScene *aiScenePtr() const { return m_scene; }
 #endif
@@ -206,12 +214,14 @@ private:
     mutable Array<uint32> m_indices;
     Hash<HashString, IBone *> m_name2boneRefs;
     Hash<HashString, IMorph *> m_name2morphRefs;
+    Array<Transform> m_instanceTransforms;
     Vector3 m_aabbMax;
     Vector3 m_aabbMin;
     Vector3 m_position;
     Quaternion m_rotation;
     Scalar m_opacity;
     Scalar m_scaleFactor;
+    int m_revision;
     bool m_visible;
 };
 
@@ -51,6 +51,27 @@ class Scene;
 namespace cl
 {
 
+class PMXAccelerator;
+
+class VPVL2_API SceneAccelerator VPVL2_DECL_FINAL
+{
+public:
+    SceneAccelerator(const Scene *sceneRef, IApplicationContext *applicationContextRef, Scene::AccelerationType accelerationType);
+    ~SceneAccelerator();
+
+    bool isAvailable() const;
+    bool isHostResident() const;
+    void flush();
+    void finish();
+
+private:
+    friend class PMXAccelerator;
+    struct PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(SceneAccelerator)
+};
+
 class VPVL2_API PMXAccelerator VPVL2_DECL_FINAL
 {
 public:
@@ -61,17 +82,22 @@ public:
     };
     typedef Array<VertexBufferBridge> VertexBufferBridgeArray;
 
-    PMXAccelerator(const Scene *sceneRef, IApplicationContext *applicationContextRef, IModel *modelRef, Scene::AccelerationType accelerationType);
+    PMXAccelerator(SceneAccelerator *sceneAcceleratorRef, IModel *modelRef);
     ~PMXAccelerator();
 
     bool isAvailable() const;
-    void upload(VertexBufferBridgeArray &buffers, const IModel::IndexBuffer *indexBufferRef);
-    void update(const IModel::DynamicVertexBuffer *dynamicBufferRef, const VertexBufferBridge &buffer, Vector3 &aabbMax, Vector3 &aabbMin);
+    bool isHostResident() const;
+    void upload(VertexBufferBridgeArray &buffers, const IModel::DynamicVertexBuffer *dynamicBufferRef, const IModel::IndexBuffer *indexBufferRef);
+    void update(const IModel::DynamicVertexBuffer *dynamicBufferRef, const VertexBufferBridge &buffer, Vector3 &aabbMin, Vector3 &aabbMax);
+    void synchronize();
     void release(VertexBufferBridgeArray &buffers) const;
 
 private:
+    friend class SceneAccelerator;
     struct PrivateContext;
     PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(PMXAccelerator)
 };
 
 } /* namespace cl */
@@ -286,6 +286,7 @@ public:
     void createShadowMap(const Vector3 &size);
     void releaseShadowMap();
     void renderShadowMap();
+    void invalidateStaticShadowCasters();
 
     virtual bool mapFile(const std::string &path, MapBuffer *bufferRef) const = 0;
     virtual bool unmapFile(MapBuffer *bufferRef) const = 0;
@@ -327,6 +328,8 @@ protected:
     glm::mat4x4 m_cameraWorldMatrix;
     glm::mat4x4 m_cameraViewMatrix;
     glm::mat4x4 m_cameraProjectionMatrix;
+    glm::mat4x4 m_staticShadowLightMatrix;
+    glm::mat4x4 m_staticShadowCameraWorldMatrix;
     glm::ivec4 m_viewportRegion;
     glm::mediump_float m_aspectRatio;
 
@@ -354,9 +357,12 @@ protected:
     OffscreenTextureList m_offscreenTextures;
     SharedTextureParameterMap m_sharedParameters;
     Array<vpvl2::IEffect::Technique *> m_offscreenTechniques;
+    Array<IRenderEngine *> m_staticShadowCasterRefs;
+    Array<int> m_staticShadowCasterRevisions;
     mutable IStringSmartPtr m_effectPathPtr;
     int m_samplesMSAA;
     bool m_viewportRegionInvalidated;
+    bool m_staticShadowCastersInvalidated;
 
 private:
     static void debugMessageCallback(gl::GLenum source, gl::GLenum type, gl::GLuint id, gl::GLenum severity,
@@ -84,6 +84,10 @@ public:
             }
         }
     };
+    enum KeyframeFormat {
+        kTextKeyframeFormat,
+        kBinaryKeyframeFormat
+    };
     typedef std::string UUID;
     typedef std::vector<UUID> UUIDList;
     typedef std::map<XMLProject::UUID, StringMap> ModelSettings;
@@ -94,6 +98,18 @@ public:
         virtual const std::string toStdFromString(const IString *value) const = 0;
         virtual const IString *toStringFromStd(const std::string &value) const = 0;
         virtual bool loadModel(const UUID &uuid, const StringMap &settings, IModel::Type type, IModel *&model, IRenderEngine *&engine, int &priority) = 0;
+        /**
+         * モデルの読み込みを先行して開始します.
+         *
+         * プロジェクトの読み込み中にモデルの要素を読み終えた時点で呼ばれます。
+         * 非同期で読み込みを開始しておくと、後で loadModel が呼ばれるまでの間に
+         * モーションの読み込みと並行して処理されます。既定では何もしません。
+         *
+         * @param uuid
+         * @param settings
+         * @param type
+         */
+        virtual void prefetchModel(const UUID & /* uuid */, const StringMap & /* settings */, IModel::Type /* type */) {}
     };
 
     static const UUID kNullUUID;
@@ -122,6 +138,25 @@ public:
     bool save(const char *path);
     void clear();
 
+    /**
+     * 保存時のキーフレームの形式を返します.
+     *
+     * 読み込み時はプロジェクトファイルの形式から自動的に設定されます。
+     *
+     * @return KeyframeFormat
+     */
+    KeyframeFormat keyframeFormat() const;
+
+    /**
+     * 保存時のキーフレームの形式を設定します.
+     *
+     * kBinaryKeyframeFormat の場合はメタデータを XML として保存し、
+     * キーフレームを長さ付きのバイナリのチャンクとして XML の後ろに保存します。
+     *
+     * @param value
+     */
+    void setKeyframeFormat(KeyframeFormat value);
+
     std::string version() const;
     std::string globalSetting(const std::string &key) const;
     std::string modelSetting(const IModel *model, const std::string &key) const;
@@ -0,0 +1,144 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_EXTENSIONS_GL_BONEMATRIXTEXTURE_H_
+#define VPVL2_EXTENSIONS_GL_BONEMATRIXTEXTURE_H_
+
+#include <vpvl2/IBone.h>
+#include <vpvl2/IModel.h>
+#include <vpvl2/extensions/gl/Texture2D.h>
+
+namespace vpvl2
+{
+namespace extensions
+{
+namespace gl
+{
+
+class BoneMatrixTexture VPVL2_DECL_FINAL {
+public:
+    static const GLenum kGL_MAX_VERTEX_TEXTURE_IMAGE_UNITS = 0x8B4C;
+
+    static bool isSupported(const IApplicationContext::FunctionResolver *resolver) {
+        typedef void (GLAPIENTRY * PFNGLGETINTEGERVPROC) (GLenum pname, GLint *params);
+        /* texture fetch in vertex shader is optional on GL 2.x and ES 2.0 and no unit is reported in that case */
+        GLint nunits = 0;
+        reinterpret_cast<PFNGLGETINTEGERVPROC>(resolver->resolveSymbol("glGetIntegerv"))(kGL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &nunits);
+        if (nunits <= 0) {
+            return false;
+        }
+        if (resolver->query(IApplicationContext::FunctionResolver::kQueryVersion) >= makeVersion(3, 0)) {
+            return true;
+        }
+        return resolver->hasExtension("ARB_texture_float") || resolver->hasExtension("OES_texture_float");
+    }
+
+    BoneMatrixTexture(const IApplicationContext::FunctionResolver *resolver)
+        : m_resolver(resolver),
+          m_texture(0)
+    {
+    }
+    ~BoneMatrixTexture() {
+        delete m_texture;
+        m_texture = 0;
+    }
+
+    void upload(const IModel *modelRef) {
+        modelRef->getBoneRefs(m_boneRefs);
+        const int nbones = countBones();
+        /* a bone matrix is stored as a row of four RGBA texels, one texel per column */
+        m_matrices.resize(nbones * 16);
+        updateMatrices();
+        delete m_texture;
+        BaseSurface::Format format(kGL_RGBA, kGL_RGBA32F, kGL_FLOAT, Texture2D::kGL_TEXTURE_2D);
+        m_texture = new Texture2D(m_resolver, format, Vector3(4, Scalar(nbones), 1), 0);
+        m_texture->create();
+        m_texture->bind();
+        m_texture->allocate(&m_matrices[0]);
+        m_texture->setParameter(BaseTexture::kGL_TEXTURE_MAG_FILTER, int(BaseTexture::kGL_NEAREST));
+        m_texture->setParameter(BaseTexture::kGL_TEXTURE_MIN_FILTER, int(BaseTexture::kGL_NEAREST));
+        m_texture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_S, int(BaseTexture::kGL_CLAMP_TO_EDGE));
+        m_texture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_T, int(BaseTexture::kGL_CLAMP_TO_EDGE));
+        m_texture->unbind();
+    }
+    void update() {
+        if (m_texture) {
+            updateMatrices();
+            m_texture->bind();
+            m_texture->write(&m_matrices[0]);
+            m_texture->unbind();
+        }
+    }
+    void bind() {
+        m_texture->bind();
+    }
+    void unbind() {
+        m_texture->unbind();
+    }
+    GLuint name() const {
+        return m_texture ? static_cast<GLuint>(m_texture->data()) : 0;
+    }
+    int countBones() const {
+        return btMax(m_boneRefs.count(), 1);
+    }
+    vsize size() const {
+        return m_matrices.count() * sizeof(float32);
+    }
+
+private:
+    void updateMatrices() {
+        const int nbones = m_boneRefs.count();
+        for (int i = 0; i < nbones; i++) {
+            const IBone *bone = m_boneRefs[i];
+            bone->localTransform().getOpenGLMatrix(&m_matrices[i * 16]);
+        }
+    }
+
+    const IApplicationContext::FunctionResolver *m_resolver;
+    Texture2D *m_texture;
+    Array<IBone *> m_boneRefs;
+    Array<float32> m_matrices;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(BoneMatrixTexture)
+};
+
+} /* namespace gl */
+} /* namespace extensions */
+} /* namespace vpvl2 */
+
+#endif
@@ -63,15 +63,20 @@ public:
           deleteRenderbuffers(reinterpret_cast<PFNGLDELETERENDERBUFFERSPROC>(resolver->resolveSymbol("glDeleteRenderbuffers"))),
           texParameteri(reinterpret_cast<PFNGLTEXPARAMETERIPROC>(resolver->resolveSymbol("glTexParameteri"))),
           framebufferTexture2D(reinterpret_cast<PFNGLFRAMEBUFFERTEXTURE2DPROC>(resolver->resolveSymbol("glFramebufferTexture2D"))),
+          blitFramebuffer(reinterpret_cast<PFNGLBLITFRAMEBUFFERPROC>(resolver->resolveSymbol("glBlitFramebuffer"))),
           m_motionRef(0),
           m_position(kZeroV3),
           m_size(Scalar(width), Scalar(height), 1),
           m_frameBuffer(0),
           m_depthBuffer(0),
           m_colorTexture(0),
+          m_staticFrameBuffer(0),
+          m_staticDepthBuffer(0),
+          m_staticColorTexture(0),
           m_distance(7.5f)
     {
         m_colorTexture = new Texture2D(resolver, BaseSurface::Format(kGL_RED, kGL_R32F, kGL_FLOAT, 0), m_size, 0);
+        m_staticColorTexture = new Texture2D(resolver, BaseSurface::Format(kGL_RED, kGL_R32F, kGL_FLOAT, 0), m_size, 0);
     }
     ~SimpleShadowMap() {
         release();
@@ -79,23 +84,7 @@ public:
 
     void create() {
         if (!m_frameBuffer) {
-            genFramebuffers(1, &m_frameBuffer);
-            m_colorTexture->create();
-            m_colorTexture->bind();
-            m_colorTexture->allocate(0);
-            m_colorTexture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_S, int(BaseTexture::kGL_CLAMP_TO_EDGE));
-            m_colorTexture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_T, int(BaseTexture::kGL_CLAMP_TO_EDGE));
-            m_colorTexture->setParameter(BaseTexture::kGL_TEXTURE_MAG_FILTER, int(BaseTexture::kGL_LINEAR));
-            m_colorTexture->setParameter(BaseTexture::kGL_TEXTURE_MIN_FILTER, int(BaseTexture::kGL_LINEAR));
-            m_colorTexture->unbind();
-            genRenderbuffers(1, &m_depthBuffer);
-            bindRenderbuffer(FrameBufferObject::kGL_RENDERBUFFER, m_depthBuffer);
-            renderbufferStorage(FrameBufferObject::kGL_RENDERBUFFER, FrameBufferObject::kGL_DEPTH_COMPONENT32F, m_size.x(), m_size.y());
-            bindRenderbuffer(FrameBufferObject::kGL_RENDERBUFFER, 0);
-            bind();
-            framebufferTexture2D(FrameBufferObject::kGL_FRAMEBUFFER, FrameBufferObject::kGL_COLOR_ATTACHMENT0, Texture2D::kGL_TEXTURE_2D, m_colorTexture->data(), 0);
-            framebufferRenderbuffer(FrameBufferObject::kGL_FRAMEBUFFER, FrameBufferObject::kGL_DEPTH_ATTACHMENT, FrameBufferObject::kGL_RENDERBUFFER, m_depthBuffer);
-            unbind();
+            createLayer(m_colorTexture, m_frameBuffer, m_depthBuffer);
         }
     }
     void bind() {
@@ -104,6 +93,20 @@ public:
     void unbind() {
         bindFramebuffer(FrameBufferObject::kGL_FRAMEBUFFER, 0);
     }
+    void bindStaticLayer() {
+        /* the static layer is allocated on demand as most scenes have no static casters */
+        if (!m_staticFrameBuffer) {
+            createLayer(m_staticColorTexture, m_staticFrameBuffer, m_staticDepthBuffer);
+        }
+        bindFramebuffer(FrameBufferObject::kGL_FRAMEBUFFER, m_staticFrameBuffer);
+    }
+    void copyStaticLayer() {
+        const GLint width = GLint(m_size.x()), height = GLint(m_size.y());
+        bindFramebuffer(FrameBufferObject::kGL_READ_FRAMEBUFFER, m_staticFrameBuffer);
+        bindFramebuffer(FrameBufferObject::kGL_DRAW_FRAMEBUFFER, m_frameBuffer);
+        blitFramebuffer(0, 0, width, height, 0, 0, width, height, kGL_COLOR_BUFFER_BIT | kGL_DEPTH_BUFFER_BIT, FrameBufferObject::kGL_NEAREST);
+        bind();
+    }
     void reset() {
         m_position.setZero();
         m_distance = 7.5;
@@ -129,6 +132,7 @@ private:
     typedef void (GLAPIENTRY * PFNGLDELETERENDERBUFFERSPROC) (GLsizei n, const GLuint* renderbuffers);
     typedef void (GLAPIENTRY * PFNGLTEXPARAMETERIPROC) (GLenum target, GLenum pname, GLint param);
     typedef void (GLAPIENTRY * PFNGLFRAMEBUFFERTEXTURE2DPROC) (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    typedef void (GLAPIENTRY * PFNGLBLITFRAMEBUFFERPROC) (GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
     PFNGLGENFRAMEBUFFERSPROC genFramebuffers;
     PFNGLBINDFRAMEBUFFERPROC bindFramebuffer;
     PFNGLDELETEFRAMEBUFFERSPROC deleteFramebuffers;
@@ -139,15 +143,41 @@ private:
     PFNGLDELETERENDERBUFFERSPROC deleteRenderbuffers;
     PFNGLTEXPARAMETERIPROC texParameteri;
     PFNGLFRAMEBUFFERTEXTURE2DPROC framebufferTexture2D;
-
+    PFNGLBLITFRAMEBUFFERPROC blitFramebuffer;
+
+    void createLayer(ITexture *texture, GLuint &frameBuffer, GLuint &depthBuffer) {
+        genFramebuffers(1, &frameBuffer);
+        texture->create();
+        texture->bind();
+        texture->allocate(0);
+        texture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_S, int(BaseTexture::kGL_CLAMP_TO_EDGE));
+        texture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_T, int(BaseTexture::kGL_CLAMP_TO_EDGE));
+        texture->setParameter(BaseTexture::kGL_TEXTURE_MAG_FILTER, int(BaseTexture::kGL_LINEAR));
+        texture->setParameter(BaseTexture::kGL_TEXTURE_MIN_FILTER, int(BaseTexture::kGL_LINEAR));
+        texture->unbind();
+        genRenderbuffers(1, &depthBuffer);
+        bindRenderbuffer(FrameBufferObject::kGL_RENDERBUFFER, depthBuffer);
+        renderbufferStorage(FrameBufferObject::kGL_RENDERBUFFER, FrameBufferObject::kGL_DEPTH_COMPONENT32F, m_size.x(), m_size.y());
+        bindRenderbuffer(FrameBufferObject::kGL_RENDERBUFFER, 0);
+        bindFramebuffer(FrameBufferObject::kGL_FRAMEBUFFER, frameBuffer);
+        framebufferTexture2D(FrameBufferObject::kGL_FRAMEBUFFER, FrameBufferObject::kGL_COLOR_ATTACHMENT0, Texture2D::kGL_TEXTURE_2D, texture->data(), 0);
+        framebufferRenderbuffer(FrameBufferObject::kGL_FRAMEBUFFER, FrameBufferObject::kGL_DEPTH_ATTACHMENT, FrameBufferObject::kGL_RENDERBUFFER, depthBuffer);
+        unbind();
+    }
     void release() {
         m_motionRef = 0;
         delete m_colorTexture;
         m_colorTexture = 0;
+        delete m_staticColorTexture;
+        m_staticColorTexture = 0;
         deleteFramebuffers(1, &m_frameBuffer);
         m_frameBuffer = 0;
         deleteRenderbuffers(1, &m_depthBuffer);
         m_depthBuffer = 0;
+        deleteFramebuffers(1, &m_staticFrameBuffer);
+        m_staticFrameBuffer = 0;
+        deleteRenderbuffers(1, &m_staticDepthBuffer);
+        m_staticDepthBuffer = 0;
     }
 
     IMotion *m_motionRef;
@@ -156,6 +186,9 @@ private:
     GLuint m_frameBuffer;
     GLuint m_depthBuffer;
     ITexture *m_colorTexture;
+    GLuint m_staticFrameBuffer;
+    GLuint m_staticDepthBuffer;
+    ITexture *m_staticColorTexture;
     Scalar m_distance;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(SimpleShadowMap)
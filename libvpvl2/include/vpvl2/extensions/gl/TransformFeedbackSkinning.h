@@ -0,0 +1,298 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_EXTENSIONS_GL_TRANSFORMFEEDBACKSKINNING_H_
+#define VPVL2_EXTENSIONS_GL_TRANSFORMFEEDBACKSKINNING_H_
+
+#include <vpvl2/IMaterial.h>
+#include <vpvl2/IModel.h>
+#include <vpvl2/IVertex.h>
+#include <vpvl2/extensions/gl/BoneMatrixTexture.h>
+#include <vpvl2/extensions/gl/ShaderProgram.h>
+#include <vpvl2/extensions/gl/VertexBundle.h>
+#include <vpvl2/extensions/gl/VertexBundleLayout.h>
+
+namespace vpvl2
+{
+namespace extensions
+{
+namespace gl
+{
+
+class TransformFeedbackSkinning VPVL2_DECL_FINAL : public ShaderProgram {
+public:
+    static bool isSupported(const IApplicationContext::FunctionResolver *resolver) {
+        if (resolver->query(IApplicationContext::FunctionResolver::kQueryVersion) >= makeVersion(3, 0)) {
+            return true;
+        }
+        return resolver->hasExtension("EXT_transform_feedback") && resolver->hasExtension("ARB_texture_float");
+    }
+
+    TransformFeedbackSkinning(const IApplicationContext::FunctionResolver *resolver)
+        : ShaderProgram(resolver),
+          enable(reinterpret_cast<PFNGLENABLEPROC>(resolver->resolveSymbol("glEnable"))),
+          disable(reinterpret_cast<PFNGLDISABLEPROC>(resolver->resolveSymbol("glDisable"))),
+          drawArrays(reinterpret_cast<PFNGLDRAWARRAYSPROC>(resolver->resolveSymbol("glDrawArrays"))),
+          bindBuffer(reinterpret_cast<PFNGLBINDBUFFERPROC>(resolver->resolveSymbol("glBindBuffer"))),
+          vertexAttribPointer(reinterpret_cast<PFNGLVERTEXATTRIBPOINTERPROC>(resolver->resolveSymbol("glVertexAttribPointer"))),
+          enableVertexAttribArray(reinterpret_cast<PFNGLENABLEVERTEXATTRIBARRAYPROC>(resolver->resolveSymbol("glEnableVertexAttribArray"))),
+          disableVertexAttribArray(reinterpret_cast<PFNGLDISABLEVERTEXATTRIBARRAYPROC>(resolver->resolveSymbol("glDisableVertexAttribArray"))),
+          m_modelRef(0),
+          m_dynamicBufferRef(0),
+          m_staticBufferRef(0),
+          m_bundle(resolver),
+          m_layout(resolver),
+          m_matrixPalette(resolver),
+          m_staticBuffer(0),
+          m_matrixPaletteUniformLocation(-1),
+          m_numBoneIndicesUniformLocation(-1),
+          m_edgeScaleFactorUniformLocation(-1)
+    {
+    }
+    ~TransformFeedbackSkinning() {
+        m_modelRef = 0;
+        m_dynamicBufferRef = 0;
+        m_staticBufferRef = 0;
+        m_staticBuffer = 0;
+    }
+
+    bool link(const IString *vertexShaderSource) {
+        static const char *const kOutputNames[] = { "gl_Position", "vpvl2_outNormal", "vpvl2_outEdge" };
+        create();
+        if (!addShaderSource(vertexShaderSource, kGL_VERTEX_SHADER)) {
+            VPVL2_LOG(WARNING, "Compile failed: " << message());
+            return false;
+        }
+        Array<const char *> names;
+        for (vsize i = 0; i < sizeof(kOutputNames) / sizeof(kOutputNames[0]); i++) {
+            names.append(kOutputNames[i]);
+        }
+        m_bundle.setFeedbackOutput(m_program, names, VertexBundle::kGL_INTERLEAVED_ATTRIBS);
+        bindAttribLocation(m_program, kPositionAttribute, "vpvl2_inPosition");
+        bindAttribLocation(m_program, kNormalAttribute, "vpvl2_inNormal");
+        bindAttribLocation(m_program, kBoneIndexAttribute, "vpvl2_inBoneIndices");
+        bindAttribLocation(m_program, kBoneWeightAttribute, "vpvl2_inBoneWeights");
+        bindAttribLocation(m_program, kEdgeSizeAttribute, "vpvl2_inEdgeSize");
+        if (!ShaderProgram::link()) {
+            VPVL2_LOG(WARNING, "Link failed: " << message());
+            return false;
+        }
+        m_bundle.dumpFeedbackOutput(m_program, names.count());
+        m_matrixPaletteUniformLocation = getUniformLocation(m_program, "matrixPalette");
+        m_numBoneIndicesUniformLocation = getUniformLocation(m_program, "numBoneIndices");
+        m_edgeScaleFactorUniformLocation = getUniformLocation(m_program, "edgeScaleFactor");
+        VPVL2_VLOG(2, "Created a transform feedback skinning program (ID=" << m_program << ")");
+        return true;
+    }
+    void upload(const IModel *modelRef,
+                const IModel::DynamicVertexBuffer *dynamicBufferRef,
+                const IModel::StaticVertexBuffer *staticBufferRef,
+                GLuint staticBuffer) {
+        m_modelRef = modelRef;
+        m_dynamicBufferRef = dynamicBufferRef;
+        m_staticBufferRef = staticBufferRef;
+        m_staticBuffer = staticBuffer;
+        modelRef->getMaterialRefs(m_materialRefs);
+        modelRef->getVertexRefs(m_vertexRefs);
+        const int nvertices = m_vertexRefs.count();
+        m_matrixPalette.upload(modelRef);
+        const int nmaterials = m_materialRefs.count();
+        m_materialEdgeSizes.resize(nmaterials);
+        for (int i = 0; i < nmaterials; i++) {
+            m_materialEdgeSizes[i] = -1;
+        }
+        m_edgeSizes.resize(nvertices);
+        for (int i = 0; i < nvertices; i++) {
+            m_edgeSizes[i] = 0;
+        }
+        updateEdgeSizes();
+        m_bundle.create(VertexBundle::kVertexBuffer, kEdgeSizeVertexBuffer, VertexBundle::kGL_DYNAMIC_DRAW,
+                        nvertices > 0 ? &m_edgeSizes[0] : 0, sizeof(float32) * nvertices);
+        m_bundle.create(VertexBundle::kVertexBuffer, kSkinnedVertexBuffer, VertexBundle::kGL_DYNAMIC_COPY,
+                        0, strideSize() * nvertices);
+        m_layout.create();
+        VPVL2_VLOG(1, "Created bone matrices palette texture for transform feedback: ID=" << m_matrixPalette.name() << " bones=" << m_matrixPalette.countBones());
+    }
+    void update(const Vector3 &cameraPosition, GLuint bindPoseBuffer) {
+        const int nvertices = m_vertexRefs.count();
+        if (!m_modelRef || nvertices == 0) {
+            return;
+        }
+        m_matrixPalette.update();
+        if (updateEdgeSizes()) {
+            m_bundle.bind(VertexBundle::kVertexBuffer, kEdgeSizeVertexBuffer);
+            m_bundle.write(VertexBundle::kVertexBuffer, 0, sizeof(float32) * nvertices, &m_edgeSizes[0]);
+            m_bundle.unbind(VertexBundle::kVertexBuffer);
+        }
+        enable(VertexBundle::kGL_RASTERIZER_DISCARD);
+        bind();
+        activeTexture(Texture2D::kGL_TEXTURE0);
+        m_matrixPalette.bind();
+        uniform1i(m_matrixPaletteUniformLocation, 0);
+        uniform1f(m_numBoneIndicesUniformLocation, GLfloat(m_matrixPalette.countBones()));
+        uniform1f(m_edgeScaleFactorUniformLocation, GLfloat(m_modelRef->edgeScaleFactor(cameraPosition)));
+        const bool hasLayout = m_layout.bind();
+        bindInputAttributePointers(bindPoseBuffer);
+        m_bundle.beginTransform(kGL_POINTS, kSkinnedVertexBuffer);
+        drawArrays(kGL_POINTS, 0, nvertices);
+        m_bundle.endTransform();
+        if (hasLayout) {
+            m_layout.unbind();
+        }
+        else {
+            for (int i = 0; i < kMaxAttributeType; i++) {
+                disableVertexAttribArray(i);
+            }
+        }
+        bindBuffer(VertexBundle::kGL_ARRAY_BUFFER, 0);
+        m_matrixPalette.unbind();
+        unbind();
+        disable(VertexBundle::kGL_RASTERIZER_DISCARD);
+    }
+    void bindSkinnedVertexBuffer() {
+        m_bundle.bind(VertexBundle::kVertexBuffer, kSkinnedVertexBuffer);
+    }
+    vsize strideOffset(IModel::Buffer::StrideType type) const {
+        switch (type) {
+        case IModel::Buffer::kVertexStride:
+            return 0;
+        case IModel::Buffer::kNormalStride:
+            return sizeof(float32) * 4;
+        case IModel::Buffer::kEdgeVertexStride:
+            return sizeof(float32) * 8;
+        default:
+            return 0;
+        }
+    }
+    vsize strideSize() const {
+        return sizeof(float32) * 12;
+    }
+
+private:
+    enum AttributeType {
+        kPositionAttribute,
+        kNormalAttribute,
+        kBoneIndexAttribute,
+        kBoneWeightAttribute,
+        kEdgeSizeAttribute,
+        kMaxAttributeType
+    };
+    enum VertexBufferObjectType {
+        kSkinnedVertexBuffer,
+        kEdgeSizeVertexBuffer,
+        kMaxVertexBufferObjectType
+    };
+    typedef void (GLAPIENTRY * PFNGLENABLEPROC) (GLenum cap);
+    typedef void (GLAPIENTRY * PFNGLDISABLEPROC) (GLenum cap);
+    typedef void (GLAPIENTRY * PFNGLDRAWARRAYSPROC) (GLenum mode, GLint first, GLsizei count);
+    typedef void (GLAPIENTRY * PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+    typedef void (GLAPIENTRY * PFNGLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+    typedef void (GLAPIENTRY * PFNGLENABLEVERTEXATTRIBARRAYPROC) (GLuint index);
+    typedef void (GLAPIENTRY * PFNGLDISABLEVERTEXATTRIBARRAYPROC) (GLuint index);
+    PFNGLENABLEPROC enable;
+    PFNGLDISABLEPROC disable;
+    PFNGLDRAWARRAYSPROC drawArrays;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLVERTEXATTRIBPOINTERPROC vertexAttribPointer;
+    PFNGLENABLEVERTEXATTRIBARRAYPROC enableVertexAttribArray;
+    PFNGLDISABLEVERTEXATTRIBARRAYPROC disableVertexAttribArray;
+
+    void bindInputAttributePointers(GLuint bindPoseBuffer) {
+        /* the bind pose buffer is double buffered by the render engine so pointers are respecified every frame */
+        GLsizei stride = GLsizei(m_dynamicBufferRef->strideSize());
+        bindBuffer(VertexBundle::kGL_ARRAY_BUFFER, bindPoseBuffer);
+        vsize offset = m_dynamicBufferRef->strideOffset(IModel::DynamicVertexBuffer::kVertexStride);
+        vertexAttribPointer(kPositionAttribute, 4, kGL_FLOAT, kGL_FALSE, stride, reinterpret_cast<const GLvoid *>(offset));
+        offset = m_dynamicBufferRef->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
+        vertexAttribPointer(kNormalAttribute, 4, kGL_FLOAT, kGL_FALSE, stride, reinterpret_cast<const GLvoid *>(offset));
+        stride = GLsizei(m_staticBufferRef->strideSize());
+        bindBuffer(VertexBundle::kGL_ARRAY_BUFFER, m_staticBuffer);
+        offset = m_staticBufferRef->strideOffset(IModel::StaticVertexBuffer::kBoneIndexStride);
+        vertexAttribPointer(kBoneIndexAttribute, 4, kGL_FLOAT, kGL_FALSE, stride, reinterpret_cast<const GLvoid *>(offset));
+        offset = m_staticBufferRef->strideOffset(IModel::StaticVertexBuffer::kBoneWeightStride);
+        vertexAttribPointer(kBoneWeightAttribute, 4, kGL_FLOAT, kGL_FALSE, stride, reinterpret_cast<const GLvoid *>(offset));
+        m_bundle.bind(VertexBundle::kVertexBuffer, kEdgeSizeVertexBuffer);
+        vertexAttribPointer(kEdgeSizeAttribute, 1, kGL_FLOAT, kGL_FALSE, 0, 0);
+        for (int i = 0; i < kMaxAttributeType; i++) {
+            enableVertexAttribArray(i);
+        }
+    }
+    bool updateEdgeSizes() {
+        /* edge sizes of materials are changed only by material morphs so rebuild per vertex values lazily */
+        const int nmaterials = m_materialRefs.count(), nvertices = m_vertexRefs.count();
+        bool changed = false;
+        for (int i = 0; i < nmaterials; i++) {
+            const float32 edgeSize = float32(m_materialRefs[i]->edgeSize());
+            if (m_materialEdgeSizes[i] != edgeSize) {
+                m_materialEdgeSizes[i] = edgeSize;
+                changed = true;
+            }
+        }
+        if (changed) {
+            for (int i = 0; i < nvertices; i++) {
+                const IVertex *vertex = m_vertexRefs[i];
+                const IMaterial *material = vertex->materialRef();
+                m_edgeSizes[i] = float32(vertex->edgeSize() * (material ? material->edgeSize() : 1));
+            }
+        }
+        return changed;
+    }
+
+    const IModel *m_modelRef;
+    const IModel::DynamicVertexBuffer *m_dynamicBufferRef;
+    const IModel::StaticVertexBuffer *m_staticBufferRef;
+    VertexBundle m_bundle;
+    VertexBundleLayout m_layout;
+    BoneMatrixTexture m_matrixPalette;
+    Array<IMaterial *> m_materialRefs;
+    Array<IVertex *> m_vertexRefs;
+    Array<float32> m_materialEdgeSizes;
+    Array<float32> m_edgeSizes;
+    GLuint m_staticBuffer;
+    GLint m_matrixPaletteUniformLocation;
+    GLint m_numBoneIndicesUniformLocation;
+    GLint m_edgeScaleFactorUniformLocation;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(TransformFeedbackSkinning)
+};
+
+} /* namespace gl */
+} /* namespace extensions */
+} /* namespace vpvl2 */
+
+#endif
@@ -53,6 +53,7 @@ public:
     static const GLenum kGL_STREAM_DRAW = 0x88E0;
     static const GLenum kGL_STATIC_DRAW = 0x88E4;
     static const GLenum kGL_DYNAMIC_DRAW = 0x88E8;
+    static const GLenum kGL_DYNAMIC_COPY = 0x88EA;
     static const GLenum kGL_ARRAY_BUFFER = 0x8892;
     static const GLenum kGL_ELEMENT_ARRAY_BUFFER = 0x8893;
     static const GLenum kGL_WRITE_ONLY = 0x88B9;
@@ -190,6 +191,7 @@ public:
     }
     void endTransform() {
         endTransformFeedback();
+        bindBufferBase(kGL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
     }
     void beginFeedbackQuery() {
         if (!m_query) {
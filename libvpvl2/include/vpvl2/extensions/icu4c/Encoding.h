@@ -54,6 +54,22 @@ namespace icu4c
 class VPVL2_API Encoding VPVL2_DECL_FINAL : public IEncoding {
 public:
     typedef Hash<HashInt, const String *> Dictionary;
+    struct DecodeStatistics {
+        DecodeStatistics()
+            : numASCIIDecodes(0),
+              numConverterDecodes(0),
+              numCacheHits(0),
+              numCacheMisses(0),
+              numCacheEvictions(0)
+        {
+        }
+        vsize numASCIIDecodes;
+        vsize numConverterDecodes;
+        vsize numCacheHits;
+        vsize numCacheMisses;
+        vsize numCacheEvictions;
+    };
+    static const int kDefaultDecodeCacheCapacity = 1024;
 
     static const char *commonDataPath();
 
@@ -69,11 +85,36 @@ public:
 
     IString *createString(const UnicodeString &value) const;
 
+    /**
+     * toString でデコードした文字列を保持するキャッシュの最大数を設定します.
+     *
+     * 0 を指定するとキャッシュを無効にします。キャッシュはスレッドセーフではありません。
+     *
+     * @param value
+     */
+    void setDecodeCacheCapacity(int value);
+
+    /**
+     * toString のデコード処理の統計を返します.
+     *
+     * @return DecodeStatistics
+     */
+    DecodeStatistics decodeStatistics() const;
+
+    /**
+     * toString のデコード処理の統計を初期化します.
+     */
+    void resetDecodeStatistics();
+
 private:
+    struct DecodeCache;
+    String *decode(const uint8 *value, vsize size, IString::Codec codec) const;
+
     const Dictionary *m_dictionaryRef;
     const String m_null;
     String::Converter m_converter;
     UCharsetDetector *m_detector;
+    DecodeCache *m_cache;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(Encoding)
 };
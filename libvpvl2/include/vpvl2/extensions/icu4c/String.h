@@ -111,6 +111,8 @@ public:
     vsize length(Codec codec) const;
 
 private:
+    String(const UnicodeString &value, const Array<uint8> &bytes, const Converter *converterRef);
+
     const Converter *m_converterRef;
     const UnicodeString m_value;
     Array<uint8> m_bytes;
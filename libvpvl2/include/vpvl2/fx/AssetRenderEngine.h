@@ -90,6 +90,7 @@ public:
 
     IModel *parentModelRef() const;
     bool upload(void *userData);
+    UploadStatus uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener);
     void release();
     void update();
     void setUpdateOptions(int options);
@@ -58,6 +58,7 @@ class PMXAccelerator;
 }
 namespace extensions {
 namespace gl {
+class TransformFeedbackSkinning;
 class VertexBundle;
 class VertexBundleLayout;
 }
@@ -79,6 +80,7 @@ public:
 
     IModel *parentModelRef() const;
     bool upload(void *userData);
+    UploadStatus uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener);
     void release();
     void update();
     void setUpdateOptions(int options);
@@ -105,13 +107,11 @@ public:
 
 private:
     class PrivateEffectEngine;
-    class TransformFeedbackProgram;
     enum VertexBufferObjectType {
         kModelDynamicVertexBufferEven,
         kModelDynamicVertexBufferOdd,
         kModelStaticVertexBuffer,
         kModelIndexBuffer,
-        kModelBindPoseVertexBuffer,
         kMaxVertexBufferObjectType
     };
     enum VertexArrayObjectType {
@@ -119,7 +119,6 @@ private:
         kVertexArrayObjectOdd,
         kEdgeVertexArrayObjectEven,
         kEdgeVertexArrayObjectOdd,
-        kBindPoseVertexArrayObject,
         kMaxVertexArrayObjectType
     };
     struct MaterialContext {
@@ -160,7 +159,8 @@ private:
     PFNGLDELETEQUERIESPROC deleteQueries;
     PFNGLDRAWARRAYSPROC drawArrays;
 
-    bool uploadMaterials(void *userData);
+    void uploadBuffers(void *userData);
+    bool uploadMaterial(const IMaterial *material, int index, void *userData);
     bool releaseUserData0(void *userData);
     void initializeEffectParameters(int extraCameraFlags);
     void createVertexBundle(extensions::gl::VertexBundleLayout *layout, IModel::Buffer::StrideType strideType, extensions::gl::GLuint dvbo);
@@ -193,7 +193,7 @@ private:
     cl::PMXAccelerator::VertexBufferBridgeArray m_accelerationBuffers;
 #endif
     IApplicationContext *m_applicationContextRef;
-    TransformFeedbackProgram *m_transformFeedbackProgram;
+    extensions::gl::TransformFeedbackSkinning *m_skinning;
     Scene *m_sceneRef;
     IModel *m_modelRef;
     IModel::StaticVertexBuffer *m_staticBuffer;
@@ -210,8 +210,10 @@ private:
     extensions::gl::GLenum m_indexType;
     Vector3 m_aabbMin;
     Vector3 m_aabbMax;
+    int m_uploadStep;
     bool m_cullFaceState;
     bool m_updateEvenBuffer;
+    bool m_renderable;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(PMXRenderEngine)
 };
@@ -94,6 +94,7 @@ public:
 
     IModel *parentModelRef() const;
     bool upload(void *userData);
+    UploadStatus uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener);
     void release();
     void update();
     void setUpdateOptions(int options);
@@ -119,12 +120,20 @@ private:
     typedef void (GLAPIENTRY * PFNGLDRAWELEMENTS) (extensions::gl::GLenum mode, extensions::gl::GLsizei count, extensions::gl::GLenum type, const extensions::gl::GLvoid *indices);
     typedef void (GLAPIENTRY * PFNGLENABLEVERTEXATTRIBARRAYPROC) (extensions::gl::GLuint);
     typedef void (GLAPIENTRY * PFNGLVERTEXATTRIBPOINTERPROC) (extensions::gl::GLuint index, extensions::gl::GLint size, extensions::gl::GLenum type, extensions::gl::GLboolean normalized, extensions::gl::GLsizei stride, const extensions::gl::GLvoid* pointer);
+    typedef void (GLAPIENTRY * PFNGLDISABLEVERTEXATTRIBARRAYPROC) (extensions::gl::GLuint);
+    typedef void (GLAPIENTRY * PFNGLVERTEXATTRIB4FVPROC) (extensions::gl::GLuint index, const extensions::gl::GLfloat *v);
+    typedef void (GLAPIENTRY * PFNGLVERTEXATTRIBDIVISORPROC) (extensions::gl::GLuint index, extensions::gl::GLuint divisor);
+    typedef void (GLAPIENTRY * PFNGLDRAWELEMENTSINSTANCEDPROC) (extensions::gl::GLenum mode, extensions::gl::GLsizei count, extensions::gl::GLenum type, const extensions::gl::GLvoid *indices, extensions::gl::GLsizei primcount);
     PFNGLCULLFACEPROC cullFace;
     PFNGLENABLEPROC enable;
     PFNGLDISABLEPROC disable;
     PFNGLDRAWELEMENTS drawElements;
     PFNGLENABLEVERTEXATTRIBARRAYPROC enableVertexAttribArray;
     PFNGLVERTEXATTRIBPOINTERPROC vertexAttribPointer;
+    PFNGLDISABLEVERTEXATTRIBARRAYPROC disableVertexAttribArray;
+    PFNGLVERTEXATTRIB4FVPROC vertexAttrib4fv;
+    PFNGLVERTEXATTRIBDIVISORPROC vertexAttribDivisor;
+    PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
 
     struct Vertex {
         Vertex() {}
@@ -150,6 +159,8 @@ private:
     void bindVertexBundle(const aiMesh *mesh);
     void unbindVertexBundle(const aiMesh *mesh);
     void bindStaticVertexAttributePointers();
+    void updateInstanceTransforms();
+    void drawInstances(const aiMesh *mesh);
 
     IApplicationContext *m_applicationContextRef;
     Scene *m_sceneRef;
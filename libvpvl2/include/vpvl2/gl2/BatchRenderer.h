@@ -0,0 +1,221 @@
+/**
+
+ Copyright (c) 2009-2011  Nagoya Institute of Technology
+                          Department of Computer Science
+               2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_GL2_BATCHRENDERER_H_
+#define VPVL2_GL2_BATCHRENDERER_H_
+
+#include "vpvl2/IApplicationContext.h"
+#include "vpvl2/extensions/gl/Global.h"
+
+namespace vpvl2
+{
+
+class IRenderEngine;
+
+namespace extensions
+{
+namespace gl
+{
+class ShaderProgram;
+}
+}
+
+namespace gl2
+{
+
+class PMXRenderEngine;
+
+/**
+ * 登録された gl2::PMXRenderEngine をパス単位でまとめて描画するクラスです.
+ *
+ * リソースを共有する (PMXRenderEngine::batchKey が等しい) エンジンが連続している場合、
+ * それらのモデル、輪郭、影をそれぞれまとめて描画し、シェーダプログラムの切り替えや
+ * カリング及びブレンドの状態変更を実際に値が変わる場合のみ行います。
+ * 半透明のモデルの前後関係を保つため、描画順は render に渡されたエンジンの順番のまま並べ替えません。
+ * そのため異なるリソースを持つエンジン同士の描画はまとめられません。
+ */
+class VPVL2_API BatchRenderer
+{
+public:
+    /**
+     * BatchRenderer が描画中に保持する OpenGL の状態です.
+     *
+     * PMXRenderEngine::setBatchStateRef で設定されたエンジンはプログラムのバインドや状態変更を
+     * 直接行わず、このクラスを経由して行います。
+     */
+    class VPVL2_API State
+    {
+    public:
+        explicit State(const IApplicationContext::FunctionResolver *resolver);
+        ~State();
+
+        void begin();
+        void end();
+        /**
+         * program をバインドします. 既にバインドされている場合は何もしません.
+         *
+         * フレーム内で同じ値となる nframeUniforms 個の uniform はプログラムごとにフレームで一度だけ設定されます。
+         *
+         * @brief bindProgram
+         * @param program
+         * @param nframeUniforms
+         * @return フレーム内で初めてバインドされ、フレーム単位の uniform を設定する必要がある場合は true
+         */
+        bool bindProgram(extensions::gl::ShaderProgram *program, int nframeUniforms);
+        void setCullFaceEnable(bool value);
+        void setCullFaceMode(extensions::gl::GLenum value);
+        void setBlendEnable(bool value);
+        /**
+         * BatchRenderer を使わずに描画した場合に発生する状態変更の数を加算します.
+         *
+         * countSavedStateChanges の計算に利用されます。
+         *
+         * @brief addUnbatchedStateChanges
+         * @param value
+         */
+        void addUnbatchedStateChanges(int value);
+        /**
+         * インデックスバッファの offset から count 個のインデックスの描画を予約します.
+         *
+         * 直前に予約した範囲と連続している場合は一つの範囲にまとめられます。
+         *
+         * @brief appendDrawElements
+         * @param count
+         * @param offset
+         * @param size インデックスの大きさ
+         */
+        void appendDrawElements(extensions::gl::GLsizei count, vsize offset, vsize size);
+        /**
+         * appendDrawElements で予約した範囲をまとめて描画します.
+         *
+         * @brief flushDrawElements
+         * @param type
+         * @return 実際に発行した描画命令の数
+         */
+        int flushDrawElements(extensions::gl::GLenum type);
+        int countStateChanges() const;
+        int countSavedStateChanges() const;
+        int countSavedDrawCalls() const;
+
+    private:
+        typedef void (GLAPIENTRY * PFNGLCULLFACEPROC) (extensions::gl::GLenum mode);
+        typedef void (GLAPIENTRY * PFNGLENABLEPROC) (extensions::gl::GLenum cap);
+        typedef void (GLAPIENTRY * PFNGLDISABLEPROC) (extensions::gl::GLenum cap);
+        typedef void (GLAPIENTRY * PFNGLDRAWELEMENTSPROC) (extensions::gl::GLenum mode, extensions::gl::GLsizei count, extensions::gl::GLenum type, const extensions::gl::GLvoid *indices);
+        typedef void (GLAPIENTRY * PFNGLMULTIDRAWELEMENTSPROC) (extensions::gl::GLenum mode, const extensions::gl::GLsizei *count, extensions::gl::GLenum type, const extensions::gl::GLvoid *const *indices, extensions::gl::GLsizei drawcount);
+        PFNGLCULLFACEPROC cullFace;
+        PFNGLENABLEPROC enable;
+        PFNGLDISABLEPROC disable;
+        PFNGLDRAWELEMENTSPROC drawElements;
+        PFNGLMULTIDRAWELEMENTSPROC multiDrawElements;
+
+        Hash<HashPtr, int> m_boundProgramRefs;
+        Array<extensions::gl::GLsizei> m_counts;
+        Array<const extensions::gl::GLvoid *> m_offsets;
+        extensions::gl::ShaderProgram *m_currentProgramRef;
+        extensions::gl::GLenum m_cullFaceMode;
+        vsize m_nextOffset;
+        int m_nappendedDraws;
+        int m_nstateChanges;
+        int m_nunbatchedStateChanges;
+        int m_nsavedDrawCalls;
+        bool m_cullFaceEnabled;
+        bool m_blendEnabled;
+
+        VPVL2_DISABLE_COPY_AND_ASSIGN(State)
+    };
+
+    explicit BatchRenderer(IApplicationContext *applicationContextRef);
+    ~BatchRenderer();
+
+    /**
+     * まとめて描画するエンジンとして value を登録します.
+     *
+     * エンジンの所有権は移動しません。
+     *
+     * @brief addEngineRef
+     * @param value
+     */
+    void addEngineRef(PMXRenderEngine *value);
+    void removeEngineRef(PMXRenderEngine *value);
+    bool containsEngineRef(const IRenderEngine *value) const;
+    /**
+     * engines を渡された順番で描画します.
+     *
+     * 登録されていないエンジンは通常通り個別に描画されます。
+     *
+     * @brief render
+     * @param engines
+     * @param rendersShadow 影を描画する場合は true
+     */
+    void render(const Array<IRenderEngine *> &engines, bool rendersShadow);
+    /**
+     * 直前の render で発行した状態変更の数を返します.
+     *
+     * @brief countStateChanges
+     * @return
+     */
+    int countStateChanges() const;
+    /**
+     * 直前の render でエンジンを個別に描画した場合と比べて削減された状態変更の数を返します.
+     *
+     * @brief countSavedStateChanges
+     * @return
+     */
+    int countSavedStateChanges() const;
+    /**
+     * 直前の render で描画範囲をまとめることにより削減された描画命令の数を返します.
+     *
+     * @brief countSavedDrawCalls
+     * @return
+     */
+    int countSavedDrawCalls() const;
+
+private:
+    class PrivateContext;
+    PrivateContext *m_context;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(BatchRenderer)
+};
+
+} /* namespace gl2 */
+} /* namespace vpvl2 */
+
+#endif
@@ -44,9 +44,11 @@
 #include "vpvl2/IApplicationContext.h"
 #include "vpvl2/IRenderEngine.h"
 #include "vpvl2/extensions/gl/Global.h"
+#include "vpvl2/gl2/BatchRenderer.h"
 
 namespace vpvl2 {
 
+class IMaterial;
 class Scene;
 
 namespace cl {
@@ -72,6 +74,7 @@ public:
 
     IModel *parentModelRef() const;
     bool upload(void *userData);
+    UploadStatus uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener);
     void release();
     void update();
     void setUpdateOptions(int options);
@@ -89,6 +92,15 @@ public:
     void setOverridePass(IEffect::Pass *pass);
     bool testVisible();
 
+    void setFrustumCullingEnable(bool value);
+    bool isFrustumCullingEnabled() const;
+    int countCulledDrawCalls() const;
+    int countIssuedDrawCalls() const;
+    bool shareResources(const PMXRenderEngine *sourceRef);
+    bool isResourceShared() const;
+    void setBatchStateRef(BatchRenderer::State *value);
+    const void *batchKey() const;
+
 private:
     typedef void (GLAPIENTRY * PFNGLCULLFACEPROC) (extensions::gl::GLenum mode);
     typedef void (GLAPIENTRY * PFNGLENABLEPROC) (extensions::gl::GLenum cap);
@@ -119,9 +131,14 @@ private:
                        IApplicationContext::ShaderType vertexSkinningShaderType,
                        IApplicationContext::ShaderType fragmentShaderType,
                        void *userData);
-    bool uploadMaterials(void *userData);
+    bool performUploadStep(int step, const Array<IMaterial *> &materials, void *userData);
+    bool uploadSkinning(void *userData);
+    void uploadBuffers();
+    bool uploadMaterial(const IMaterial *material, int index, void *userData);
+    void setCullFaceEnable(bool value);
     void createVertexBundle(extensions::gl::GLuint dvbo);
     void createEdgeBundle(extensions::gl::GLuint dvbo);
+    void synchronizeAccelerator();
     void bindVertexBundle();
     void bindEdgeBundle();
     void unbindVertexBundle();
@@ -0,0 +1,342 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#pragma once
+#ifndef VPVL2_INTERNAL_BONEPALETTE_H_
+#define VPVL2_INTERNAL_BONEPALETTE_H_
+
+#include "vpvl2/Common.h"
+#include "vpvl2/IBone.h"
+#include "vpvl2/IMaterial.h"
+#include "vpvl2/IVertex.h"
+
+namespace vpvl2
+{
+namespace internal
+{
+
+/*
+ * Partitions the triangles of each material into subsets whose bone palettes fit in
+ * maxBonesPerDraw matrices, so vertex shader skinning no longer depends on the size of
+ * the uniform array for large materials.
+ *
+ * Every bone gets one palette slot for the whole model by coloring the graph of bones
+ * referred from the same primitive, so the static vertex buffer stores one slot per vertex
+ * bone regardless of the subset drawing it. Colors are handed out in the order bones
+ * appear, taking the least recently used one, so a material with fewer bones than the
+ * palette usually stays in a single subset. Triangles are then visited in index order and
+ * a subset is closed when a slot is taken by another bone, keeping each subset a
+ * contiguous index range of its material. Both passes are linear to the number of indices.
+ */
+class BonePalette VPVL2_DECL_FINAL {
+public:
+    static const int kNullBoneSlot = 0;
+    static const int kMaxVertexBones = 4;
+    static const int kMaxPrimitiveBones = kMaxVertexBones * 3;
+    static const int kMinBonesPerDraw = kMaxPrimitiveBones + 1;
+
+    struct Subset {
+        Subset(int materialIndex, int indexOffset)
+            : materialIndex(materialIndex),
+              indexOffset(indexOffset),
+              indexCount(0)
+        {
+        }
+        int materialIndex;
+        int indexOffset;
+        int indexCount;
+        /* slot to bone index, -1 is the null bone which uses the identity matrix */
+        Array<int> boneIndices;
+    };
+
+    static int countVertexBones(IVertex::Type type) {
+        switch (type) {
+        case IVertex::kBdef1:
+            return 1;
+        case IVertex::kBdef2:
+        case IVertex::kSdef:
+            return 2;
+        case IVertex::kBdef4:
+        case IVertex::kQdef:
+            return 4;
+        case IVertex::kMaxType:
+        default:
+            return 0;
+        }
+    }
+
+    explicit BonePalette(int maxBonesPerDraw)
+        : m_maxBonesPerDraw(btMax(maxBonesPerDraw, int(kMinBonesPerDraw)))
+    {
+    }
+    ~BonePalette() {
+        m_subsets.releaseAll();
+    }
+
+    template<typename TMaterial, typename TVertex>
+    bool build(const Array<TMaterial *> &materials, const Array<TVertex *> &vertices, const Array<int> &indices, int nbones) {
+        const int nmaterials = materials.count(), nvertices = vertices.count(), nindices = indices.count();
+        m_subsets.releaseAll();
+        m_firstSubsetIndices.clear();
+        m_boneSlots.resize(nbones);
+        for (int i = 0; i < nbones; i++) {
+            m_boneSlots[i] = kUnusedBone;
+        }
+        for (int i = 0, offset = 0; i < nmaterials; i++) {
+            const int count = materials[i]->indexRange().count;
+            if (count < 0 || offset + count > nindices) {
+                return false;
+            }
+            for (int j = offset; j < offset + count; j++) {
+                const int vertexIndex = indices[j];
+                if (vertexIndex < 0 || vertexIndex >= nvertices) {
+                    return false;
+                }
+            }
+            offset += count;
+        }
+        if (!assignSlots(materials, vertices, indices)) {
+            return false;
+        }
+        int primitiveBones[kMaxPrimitiveBones];
+        Array<int> slotBones;
+        slotBones.resize(m_maxBonesPerDraw);
+        for (int i = 0, offset = 0; i < nmaterials; i++) {
+            const int count = materials[i]->indexRange().count;
+            m_firstSubsetIndices.append(m_subsets.count());
+            Subset *subset = openSubset(i, offset, slotBones);
+            for (int j = 0; j < count; j += 3) {
+                const int nprimitiveVertices = btMin(count - j, 3);
+                const int nprimitiveBones = collectPrimitiveBones(vertices, indices, offset + j, nprimitiveVertices, primitiveBones);
+                bool fit = true;
+                for (int k = 0; fit && k < nprimitiveBones; k++) {
+                    const int boneIndex = slotBones[m_boneSlots[primitiveBones[k]]];
+                    fit = boneIndex == kEmptySlot || boneIndex == primitiveBones[k];
+                }
+                if (!fit) {
+                    closeSubset(subset, slotBones);
+                    subset = openSubset(i, offset + j, slotBones);
+                }
+                for (int k = 0; k < nprimitiveBones; k++) {
+                    const int boneIndex = primitiveBones[k];
+                    slotBones[m_boneSlots[boneIndex]] = boneIndex;
+                }
+                subset->indexCount += nprimitiveVertices;
+            }
+            closeSubset(subset, slotBones);
+            offset += count;
+        }
+        m_firstSubsetIndices.append(m_subsets.count());
+        return true;
+    }
+
+    int maxBonesPerDraw() const {
+        return m_maxBonesPerDraw;
+    }
+    int countSubsets() const {
+        return m_subsets.count();
+    }
+    int countSubsets(int materialIndex) const {
+        if (materialIndex >= 0 && materialIndex < m_firstSubsetIndices.count() - 1) {
+            return m_firstSubsetIndices[materialIndex + 1] - m_firstSubsetIndices[materialIndex];
+        }
+        return 0;
+    }
+    int findSubsetIndex(int materialIndex, int subsetIndex) const {
+        if (subsetIndex >= 0 && subsetIndex < countSubsets(materialIndex)) {
+            return m_firstSubsetIndices[materialIndex] + subsetIndex;
+        }
+        return -1;
+    }
+    const Subset *subsetAt(int index) const {
+        return index >= 0 && index < m_subsets.count() ? m_subsets[index] : 0;
+    }
+    int findSlot(const IBone *boneRef) const {
+        const int boneIndex = boneRef ? boneRef->index() : -1;
+        if (boneIndex >= 0 && boneIndex < m_boneSlots.count() && m_boneSlots[boneIndex] > kNullBoneSlot) {
+            return m_boneSlots[boneIndex];
+        }
+        return kNullBoneSlot;
+    }
+
+private:
+    static const int kEmptySlot = -2;
+    static const int kUnusedBone = -1;
+    static const int kUncoloredBone = -2;
+
+    template<typename TVertex>
+    int collectPrimitiveBones(const Array<TVertex *> &vertices, const Array<int> &indices, int offset, int nprimitiveVertices, int *primitiveBones) const {
+        const int nbones = m_boneSlots.count();
+        int nprimitiveBones = 0;
+        for (int i = 0; i < nprimitiveVertices; i++) {
+            const IVertex *vertexRef = vertices[indices[offset + i]];
+            const int nvertexBones = countVertexBones(vertexRef->type());
+            for (int j = 0; j < nvertexBones; j++) {
+                const IBone *boneRef = vertexRef->boneRef(j);
+                const int boneIndex = boneRef ? boneRef->index() : -1;
+                if (boneIndex < 0 || boneIndex >= nbones) {
+                    continue;
+                }
+                /* keeps the bones sorted and unique with the insertion sort as there are 12 at most */
+                int k = nprimitiveBones;
+                while (k > 0 && primitiveBones[k - 1] > boneIndex) {
+                    k--;
+                }
+                if (k > 0 && primitiveBones[k - 1] == boneIndex) {
+                    continue;
+                }
+                for (int l = nprimitiveBones; l > k; l--) {
+                    primitiveBones[l] = primitiveBones[l - 1];
+                }
+                primitiveBones[k] = boneIndex;
+                nprimitiveBones++;
+            }
+        }
+        return nprimitiveBones;
+    }
+    template<typename TMaterial, typename TVertex>
+    bool assignSlots(const Array<TMaterial *> &materials, const Array<TVertex *> &vertices, const Array<int> &indices) {
+        const int nmaterials = materials.count(), nbones = m_boneSlots.count();
+        PointerArray<Array<int> > neighbors;
+        Array<int> order;
+        int primitiveBones[kMaxPrimitiveBones], previousBones[kMaxPrimitiveBones], npreviousBones = 0;
+        neighbors.reserve(nbones);
+        for (int i = 0; i < nbones; i++) {
+            neighbors.append(new Array<int>());
+        }
+        for (int i = 0, offset = 0; i < nmaterials; i++) {
+            const int count = materials[i]->indexRange().count;
+            for (int j = 0; j < count; j += 3) {
+                const int nprimitiveBones = collectPrimitiveBones(vertices, indices, offset + j, btMin(count - j, 3), primitiveBones);
+                for (int k = 0; k < nprimitiveBones; k++) {
+                    const int boneIndex = primitiveBones[k];
+                    if (m_boneSlots[boneIndex] == kUnusedBone) {
+                        m_boneSlots[boneIndex] = kUncoloredBone;
+                        order.append(boneIndex);
+                    }
+                }
+                /* adjacent primitives mostly refer the same bones */
+                bool same = nprimitiveBones == npreviousBones;
+                for (int k = 0; same && k < nprimitiveBones; k++) {
+                    same = primitiveBones[k] == previousBones[k];
+                }
+                if (same) {
+                    continue;
+                }
+                for (int k = 0; k < nprimitiveBones; k++) {
+                    Array<int> *neighborBones = neighbors[primitiveBones[k]];
+                    for (int l = 0; l < nprimitiveBones; l++) {
+                        const int neighborBoneIndex = primitiveBones[l];
+                        const int nneighborBones = neighborBones->count();
+                        if (l != k && (nneighborBones == 0 || (*neighborBones)[nneighborBones - 1] != neighborBoneIndex)) {
+                            neighborBones->append(neighborBoneIndex);
+                        }
+                    }
+                    previousBones[k] = primitiveBones[k];
+                }
+                npreviousBones = nprimitiveBones;
+            }
+            offset += count;
+        }
+        Array<int> slotMarks, slotSequences;
+        slotMarks.resize(m_maxBonesPerDraw);
+        slotSequences.resize(m_maxBonesPerDraw);
+        for (int i = 0; i < m_maxBonesPerDraw; i++) {
+            slotMarks[i] = -1;
+            slotSequences[i] = 0;
+        }
+        const int nordered = order.count();
+        bool colored = true;
+        for (int i = 0; colored && i < nordered; i++) {
+            const int boneIndex = order[i];
+            const Array<int> &neighborBones = *neighbors[boneIndex];
+            const int nneighborBones = neighborBones.count();
+            for (int j = 0; j < nneighborBones; j++) {
+                const int slot = m_boneSlots[neighborBones[j]];
+                if (slot > kNullBoneSlot) {
+                    slotMarks[slot] = i;
+                }
+            }
+            int foundSlot = -1;
+            for (int j = kNullBoneSlot + 1; j < m_maxBonesPerDraw; j++) {
+                if (slotMarks[j] != i && (foundSlot < 0 || slotSequences[j] < slotSequences[foundSlot])) {
+                    foundSlot = j;
+                }
+            }
+            if (foundSlot > kNullBoneSlot) {
+                m_boneSlots[boneIndex] = foundSlot;
+                slotSequences[foundSlot] = i + 1;
+            }
+            else {
+                /* too many bones around the bone to fit in the palette */
+                colored = false;
+            }
+        }
+        neighbors.releaseAll();
+        return colored;
+    }
+    Subset *openSubset(int materialIndex, int indexOffset, Array<int> &slotBones) {
+        for (int i = 0; i < m_maxBonesPerDraw; i++) {
+            slotBones[i] = kEmptySlot;
+        }
+        slotBones[kNullBoneSlot] = -1;
+        return m_subsets.append(new Subset(materialIndex, indexOffset));
+    }
+    void closeSubset(Subset *subset, const Array<int> &slotBones) {
+        int nslots = m_maxBonesPerDraw;
+        while (nslots > 1 && slotBones[nslots - 1] == kEmptySlot) {
+            nslots--;
+        }
+        subset->boneIndices.resize(nslots);
+        for (int i = 0; i < nslots; i++) {
+            const int boneIndex = slotBones[i];
+            subset->boneIndices[i] = boneIndex == kEmptySlot ? -1 : boneIndex;
+        }
+    }
+
+    const int m_maxBonesPerDraw;
+    PointerArray<Subset> m_subsets;
+    Array<int> m_firstSubsetIndices;
+    Array<int> m_boneSlots;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(BonePalette)
+};
+
+} /* namespace internal */
+} /* namespace vpvl2 */
+
+#endif
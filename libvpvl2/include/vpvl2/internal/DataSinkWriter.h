@@ -0,0 +1,145 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#pragma once
+#ifndef VPVL2_INTERNAL_DATASINKWRITER_H_
+#define VPVL2_INTERNAL_DATASINKWRITER_H_
+
+#include "vpvl2/Common.h"
+#include "vpvl2/IDataSink.h"
+#include "vpvl2/internal/util.h"
+
+namespace vpvl2
+{
+namespace internal
+{
+
+class DataSinkWriter VPVL2_DECL_FINAL {
+public:
+    static const vsize kDefaultChunkSize = 65536;
+
+    DataSinkWriter(IDataSink *sinkRef, vsize chunkSize = kDefaultChunkSize)
+        : m_sinkRef(sinkRef),
+          m_offset(0),
+          m_written(0),
+          m_ok(sinkRef != 0)
+    {
+        m_buffer.resize(int(chunkSize));
+    }
+    ~DataSinkWriter() {
+        m_sinkRef = 0;
+        m_offset = 0;
+        m_written = 0;
+        m_ok = false;
+    }
+
+    uint8 *reserve(vsize size) {
+        /* an object larger than the chunk grows the buffer to the size of it and is written alone */
+        if (m_offset + size > vsize(m_buffer.count())) {
+            flush();
+            if (size > vsize(m_buffer.count())) {
+                m_buffer.resize(int(size));
+            }
+        }
+        return &m_buffer[int(m_offset)];
+    }
+    void commit(vsize size) {
+        m_offset += size;
+        m_written += size;
+    }
+    void write(const void *data, vsize size) {
+        if (size > 0) {
+            uint8 *ptr = reserve(size);
+            copyBytes(ptr, reinterpret_cast<const uint8 *>(data), size);
+            commit(size);
+        }
+    }
+    template<typename T>
+    void writeValue(const T &value) {
+        write(&value, sizeof(value));
+    }
+    void writeString(const IString *value, IString::Codec codec) {
+        uint8 *start = reserve(estimateSize(value, codec)), *ptr = start;
+        internal::writeString(value, codec, ptr);
+        commit(ptr - start);
+    }
+    void writeSignedIndex(int value, vsize size) {
+        uint8 *start = reserve(size), *ptr = start;
+        internal::writeSignedIndex(value, size, ptr);
+        commit(ptr - start);
+    }
+    template<typename T, typename TInfo>
+    void writeObjects(const Array<T *> &objects, const TInfo &info) {
+        const int32 nobjects = objects.count();
+        writeValue(nobjects);
+        for (int32 i = 0; i < nobjects && m_ok; i++) {
+            const T *object = objects[i];
+            uint8 *start = reserve(object->estimateSize(info)), *ptr = start;
+            object->write(ptr, info);
+            commit(ptr - start);
+        }
+    }
+    template<typename T>
+    void writeKeyframe(const T *keyframe, vsize size) {
+        keyframe->write(reserve(size));
+        commit(size);
+    }
+    bool flush() {
+        if (m_ok && m_offset > 0) {
+            m_ok = m_sinkRef->write(&m_buffer[0], m_offset);
+        }
+        m_offset = 0;
+        return m_ok;
+    }
+    bool isOK() const { return m_ok; }
+    vsize written() const { return m_written; }
+
+private:
+    IDataSink *m_sinkRef;
+    Array<uint8> m_buffer;
+    vsize m_offset;
+    vsize m_written;
+    bool m_ok;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(DataSinkWriter)
+};
+
+} /* namespace internal */
+} /* namespace vpvl2 */
+
+#endif
@@ -98,6 +98,112 @@ public:
         fromIndex = toIndex <= 1 ? 0 : toIndex - 1;
         lastIndex = fromIndex;
     }
+    /*
+     * Tracks are kept as contiguous sorted arrays so seeking stays a binary search over plain pointers.
+     * The position is found in O(log n), but moving the following pointers is still O(n) per edit
+     * (one block move, which is cheap compared with resorting or rebuilding the whole track).
+     */
+    template<typename T>
+    static int insertKeyframe(T *keyframe, Array<T *> &keyframes)
+    {
+        /* find the upper bound with binary search and shift the rest of keyframes to keep the order */
+        KeyframeTimeIndexPredication predication;
+        int low = 0, high = keyframes.count();
+        while (low < high) {
+            const int mid = (low + high) / 2;
+            if (predication(keyframe, keyframes[mid])) {
+                high = mid;
+            }
+            else {
+                low = mid + 1;
+            }
+        }
+        keyframes.append(keyframe);
+        const int nmoves = keyframes.count() - 1 - low;
+        if (nmoves > 0) {
+            std::memmove(&keyframes[low + 1], &keyframes[low], nmoves * sizeof(T *));
+        }
+        keyframes[low] = keyframe;
+        return low;
+    }
+    template<typename T>
+    static int removeKeyframe(const IKeyframe *keyframe, Array<T *> &keyframes)
+    {
+        KeyframeTimeIndexPredication predication;
+        const int nkeyframes = keyframes.count();
+        int low = 0, high = nkeyframes, found = -1;
+        while (low < high) {
+            const int mid = (low + high) / 2;
+            if (predication(keyframes[mid], keyframe)) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        for (int i = low; i < nkeyframes && !predication(keyframe, keyframes[i]); i++) {
+            if (keyframes[i] == keyframe) {
+                found = i;
+                break;
+            }
+        }
+        if (found == -1) {
+            /* time index of the keyframe may be changed after inserting so fallback to linear search */
+            for (int i = 0; i < nkeyframes; i++) {
+                if (keyframes[i] == keyframe) {
+                    found = i;
+                    break;
+                }
+            }
+        }
+        if (found != -1) {
+            const int nmoves = nkeyframes - 1 - found;
+            if (nmoves > 0) {
+                std::memmove(&keyframes[found], &keyframes[found + 1], nmoves * sizeof(T *));
+            }
+            keyframes.resize(nkeyframes - 1);
+        }
+        return found;
+    }
+    template<typename T>
+    static int findKeyframeIndex(const IKeyframe::TimeIndex &timeIndex,
+                                 const IKeyframe::LayerIndex &layerIndex,
+                                 const Array<T *> &keyframes) VPVL2_DECL_NOEXCEPT
+    {
+        int low = 0, high = keyframes.count();
+        while (low < high) {
+            const int mid = (low + high) / 2;
+            const IKeyframe *keyframe = keyframes[mid];
+            const IKeyframe::LayerIndex &midLayerIndex = keyframe->layerIndex();
+            if (midLayerIndex < layerIndex || (midLayerIndex == layerIndex && keyframe->timeIndex() < timeIndex)) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        if (low < keyframes.count()) {
+            const IKeyframe *keyframe = keyframes[low];
+            if (keyframe->layerIndex() == layerIndex && keyframe->timeIndex() == timeIndex) {
+                return low;
+            }
+        }
+        return -1;
+    }
+    template<typename T>
+    static bool sortKeyframesIfNeeded(Array<T *> &keyframes)
+    {
+        /* keyframes are almost always sorted already so check it in linear time before sorting */
+        KeyframeTimeIndexPredication predication;
+        const int nkeyframes = keyframes.count();
+        for (int i = 1; i < nkeyframes; i++) {
+            if (predication(keyframes[i], keyframes[i - 1])) {
+                keyframes.sort(predication);
+                return true;
+            }
+        }
+        return false;
+    }
     template<typename TMotion>
     static inline bool isReachedToDuration(const TMotion &motion, const IKeyframe::TimeIndex &atEnd) VPVL2_DECL_NOEXCEPT
     {
@@ -57,8 +57,10 @@ class BaseAnimationTrack
 public:
     typedef PointerArray<IKeyframe> KeyframeCollection;
     KeyframeCollection keyframes;
+    bool dirty;
     BaseAnimationTrack()
-        : m_lastIndex(0)
+        : dirty(false),
+          m_lastIndex(0)
     {
     }
     virtual ~BaseAnimationTrack() {
@@ -66,6 +68,10 @@ public:
         m_lastIndex = 0;
     }
 
+    void reset() {
+        m_lastIndex = 0;
+    }
+
 protected:
     mutable int m_lastIndex;
 
@@ -81,7 +87,8 @@ public:
           m_nameListSectionRef(motionRef->nameListSection()),
           m_durationTimeIndex(0),
           m_currentTimeIndex(0),
-          m_previousTimeIndex(0)
+          m_previousTimeIndex(0),
+          m_durationDirty(false)
     {
     }
     virtual ~BaseSection() {
@@ -93,6 +100,7 @@ public:
         m_currentTimeIndex = 0;
         m_previousTimeIndex = 0;
         m_durationTimeIndex = 0;
+        m_durationDirty = false;
     }
     virtual void read(const uint8 *data) = 0;
     virtual void seek(const IKeyframe::TimeIndex &timeIndex) = 0;
@@ -115,11 +123,20 @@ public:
     }
 
     const Motion *parentMotionRef() const { return m_motionRef; }
-    IKeyframe::TimeIndex duration() const { return m_durationTimeIndex; }
+    IKeyframe::TimeIndex duration() const {
+        if (m_durationDirty) {
+            m_durationTimeIndex = calculateDuration();
+            m_durationDirty = false;
+        }
+        return m_durationTimeIndex;
+    }
     IKeyframe::TimeIndex currentTimeIndex() const { return m_currentTimeIndex; }
     IKeyframe::TimeIndex previousTimeIndex() const { return m_previousTimeIndex; }
 
 protected:
+    virtual IKeyframe::TimeIndex calculateDuration() const {
+        return m_durationTimeIndex;
+    }
     virtual void setDuration(IKeyframe *keyframe) {
         btSetMax(m_durationTimeIndex, keyframe->timeIndex());
     }
@@ -130,9 +147,10 @@ protected:
 
     const Motion *m_motionRef;
     NameListSection *m_nameListSectionRef;
-    IKeyframe::TimeIndex m_durationTimeIndex;
+    mutable IKeyframe::TimeIndex m_durationTimeIndex;
     IKeyframe::TimeIndex m_currentTimeIndex;
     IKeyframe::TimeIndex m_previousTimeIndex;
+    mutable bool m_durationDirty;
 
 private:
     VPVL2_DISABLE_COPY_AND_ASSIGN(BaseSection)
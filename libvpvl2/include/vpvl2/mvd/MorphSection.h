@@ -81,6 +81,7 @@ public:
 
 private:
     struct PrivateContext;
+    IKeyframe::TimeIndex calculateDuration() const;
     PrivateContext *m_context;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(MorphSection)
@@ -148,6 +148,7 @@ public:
     void setParentBoneRef(IBone *value);
     void setParentInherentBoneRef(IBone *value, float32 coefficient);
     void setEffectorBoneRef(IBone *effector, int numIteration, float angleLimit);
+    void addInverseKinematicsConstraint(IBone *jointBone, bool hasAngleLimit, const Vector3 &lowerLimit, const Vector3 &upperLimit);
     void setDestinationOriginBoneRef(IBone *value);
     void setName(const IString *value, IEncoding::LanguageType type);
     void setOrigin(const Vector3 &value);
@@ -41,6 +41,7 @@
 
 #include "vpvl2/Common.h"
 #include "vpvl2/IBone.h"
+#include "vpvl2/IDataSink.h"
 #include "vpvl2/IEncoding.h"
 #include "vpvl2/IModel.h"
 #include "vpvl2/IMorph.h"
@@ -73,6 +74,12 @@ class Vertex;
 class VPVL2_API Model VPVL2_DECL_FINAL : public IModel
 {
 public:
+    /**
+     * Upper bound of maxBonesPerDraw, which is also the size of the bone matrix uniform array
+     * that the skinning vertex shader of gl2::PMXRenderEngine declares.
+     */
+    static const int kMaxBonesPerDraw = 50;
+    static const int kDefaultMaxBonesPerDraw = kMaxBonesPerDraw;
     enum StrideType {
         kVertexStride,
         kNormalStride,
@@ -143,6 +150,13 @@ public:
 
     bool load(const uint8 *data, vsize size);
     void save(uint8 *data, vsize &written) const;
+    /**
+     * Serialize the model into sink section by section without allocating whole of the output.
+     *
+     * @param sink The destination of the serialized model
+     * @return false if sink fails to write
+     */
+    bool save(IDataSink *sink) const;
     vsize estimateSize() const;
 
     void addEventListenerRef(PropertyEventListener *value);
@@ -228,6 +242,14 @@ public:
     void setVersion(float32 value);
     int maxUVCount() const;
     void setMaxUVCount(int value);
+    int maxBonesPerDraw() const;
+    /**
+     * Set the number of bones drawn at once, clamped between the bones a triangle may refer
+     * and kMaxBonesPerDraw.
+     *
+     * @param value The number of bones per draw
+     */
+    void setMaxBonesPerDraw(int value);
     IBone *createBone();
     IJoint *createJoint();
     ILabel *createLabel();
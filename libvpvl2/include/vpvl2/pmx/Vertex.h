@@ -77,6 +77,17 @@ public:
     void getEventListenerRefs(Array<PropertyEventListener *> &value);
 
     static bool preparse(uint8 *&data, vsize &rest, Model::DataInfo &info);
+    /**
+     * Read and parse all vertices in the buffer of info and appends them to vertices.
+     *
+     * Vertices are decoded with the same parser as read but the bone index size
+     * is resolved at compile time and no per-field logging is done.
+     *
+     * @param info Model information that preparse is already done
+     * @param modelRef Parent model of vertices
+     * @param vertices Output vertices
+     */
+    static void readVertices(const Model::DataInfo &info, IModel *modelRef, Array<Vertex *> &vertices);
     static bool loadVertices(const Array<Vertex *> &vertices, const Array<Bone *> &bones);
     static void writeVertices(const Array<Vertex *> &vertices, const Model::DataInfo &info, uint8 *&data);
     static vsize estimateTotalSize(const Array<Vertex *> &vertices, const Model::DataInfo &info);
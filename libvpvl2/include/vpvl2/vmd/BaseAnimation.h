@@ -71,19 +71,21 @@ public:
     void advance(const IKeyframe::TimeIndex &deltaTimeIndex);
     void rewind(const IKeyframe::TimeIndex &target, const IKeyframe::TimeIndex &deltaTimeIndex);
     void reset();
-    void addKeyframe(IKeyframe *keyframe);
-    void removeKeyframe(IKeyframe *keyframe);
+    virtual void addKeyframe(IKeyframe *keyframe);
+    virtual void removeKeyframe(IKeyframe *keyframe);
     void deleteKeyframe(IKeyframe *&keyframe);
     void getKeyframes(const IKeyframe::TimeIndex &timeIndex, Array<IKeyframe *> &keyframes) const;
     void getAllKeyframes(Array<IKeyframe *> &value) const;
-    void setAllKeyframes(const Array<IKeyframe *> &value, IKeyframe::Type type);
+    virtual void setAllKeyframes(const Array<IKeyframe *> &value, IKeyframe::Type type);
 
     int countKeyframes() const { return m_keyframes.count(); }
     IKeyframe::TimeIndex previousTimeIndex() const { return m_previousTimeIndex; }
     IKeyframe::TimeIndex currentTimeIndex() const { return m_currentTimeIndex; }
-    IKeyframe::TimeIndex duration() const { return m_durationTimeIndex; }
+    IKeyframe::TimeIndex duration() const;
 
 protected:
+    virtual IKeyframe::TimeIndex calculateDuration() const;
+
     template<typename T>
     static int findKeyframeIndex(const IKeyframe::TimeIndex &key, const Array<T *> &keyframes) {
         int min = 0, max = keyframes.count() - 1;
@@ -105,9 +107,10 @@ protected:
 
     PointerArray<IKeyframe> m_keyframes;
     int m_lastTimeIndex;
-    IKeyframe::TimeIndex m_durationTimeIndex;
+    mutable IKeyframe::TimeIndex m_durationTimeIndex;
     IKeyframe::TimeIndex m_currentTimeIndex;
     IKeyframe::TimeIndex m_previousTimeIndex;
+    mutable bool m_durationDirty;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(BaseAnimation)
 };
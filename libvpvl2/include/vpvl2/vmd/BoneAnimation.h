@@ -73,6 +73,10 @@ public:
     void seek(const IKeyframe::TimeIndex &timeIndexAt);
     void reset();
     void setParentModelRef(IModel *model);
+    void refresh(IModel *model);
+    void addKeyframe(IKeyframe *keyframe);
+    void removeKeyframe(IKeyframe *keyframe);
+    void setAllKeyframes(const Array<IKeyframe *> &value, IKeyframe::Type type);
     BoneKeyframe *findKeyframeAt(int i) const;
     BoneKeyframe *findKeyframe(const IKeyframe::TimeIndex &timeIndex, const IString *name) const;
 
@@ -90,13 +94,18 @@ private:
                             const IKeyframe::SmoothPrecision &w,
                             int at,
                             IKeyframe::SmoothPrecision &value);
+    IKeyframe::TimeIndex calculateDuration() const;
+    PrivateContext *resolvePrivateContext(const IString *name, IModel *model);
     void createPrivateContexts(IModel *model);
     void calculateKeyframes(const IKeyframe::TimeIndex &timeIndexAt, PrivateContext *context);
+    void markContextDirty(PrivateContext *context);
 
     IEncoding *m_encodingRef;
     PointerHash<HashString, PrivateContext> m_name2contexts;
+    Array<PrivateContext *> m_dirtyContextRefs;
     IModel *m_modelRef;
     bool m_enableNullFrame;
+    bool m_dirty;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(BoneAnimation)
 };
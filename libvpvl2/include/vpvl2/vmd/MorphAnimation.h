@@ -73,6 +73,10 @@ public:
     void read(const uint8 *data, int size);
     void seek(const IKeyframe::TimeIndex &timeIndexAt);
     void setParentModelRef(IModel *model);
+    void refresh(IModel *model);
+    void addKeyframe(IKeyframe *keyframe);
+    void removeKeyframe(IKeyframe *keyframe);
+    void setAllKeyframes(const Array<IKeyframe *> &value, IKeyframe::Type type);
     void reset();
     MorphKeyframe *findKeyframeAt(int i) const;
     MorphKeyframe *findKeyframe(const IKeyframe::TimeIndex &timeIndex, const IString *name) const;
@@ -82,13 +86,18 @@ public:
 
 private:
     struct PrivateContext;
+    IKeyframe::TimeIndex calculateDuration() const;
+    PrivateContext *resolvePrivateContext(const IString *name, IModel *model);
     void createPrivateContexts(IModel *model);
     void calculateFrames(const IKeyframe::TimeIndex &timeIndexAt, PrivateContext *context);
+    void markContextDirty(PrivateContext *context);
 
     IEncoding *m_encodingRef;
     PointerHash<HashString, PrivateContext> m_name2contexts;
+    Array<PrivateContext *> m_dirtyContextRefs;
     IModel *m_modelRef;
     bool m_enableNullFrame;
+    bool m_dirty;
 
     VPVL2_DISABLE_COPY_AND_ASSIGN(MorphAnimation)
 };
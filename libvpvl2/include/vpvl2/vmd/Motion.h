@@ -41,6 +41,7 @@
 #ifndef VPVL2_VMD_VMDMOTION_H_
 #define VPVL2_VMD_VMDMOTION_H_
 
+#include "vpvl2/IDataSink.h"
 #include "vpvl2/IEncoding.h"
 #include "vpvl2/IMotion.h"
 #include "vpvl2/vmd/BoneAnimation.h"
@@ -118,6 +119,13 @@ public:
     bool preparse(const uint8 *data, vsize size, DataInfo &info);
     bool load(const uint8 *data, vsize size);
     void save(uint8 *data) const;
+    /**
+     * Serialize the motion into sink incrementally without allocating whole of the output.
+     *
+     * @param sink The destination of the serialized motion
+     * @return false if sink fails to write
+     */
+    bool save(IDataSink *sink) const;
     vsize estimateSize() const;
     void setParentSceneRef(Scene *value);
     void setParentModelRef(IModel *value);
@@ -41,10 +41,12 @@
 
 #include "vpvl2/Common.h"
 #include "vpvl2/Factory.h"
+#include "vpvl2/FrameProfiler.h"
 #include "vpvl2/IBone.h"
 #include "vpvl2/IBoneKeyframe.h"
 #include "vpvl2/ICamera.h"
 #include "vpvl2/ICameraKeyframe.h"
+#include "vpvl2/IDataSink.h"
 #include "vpvl2/IEffect.h"
 #include "vpvl2/IEffectKeyframe.h"
 #include "vpvl2/IEncoding.h"
@@ -66,6 +68,10 @@
 #include "vpvl2/IString.h"
 #include "vpvl2/ITexture.h"
 #include "vpvl2/IVertex.h"
+#include "vpvl2/PoseBlender.h"
+#include "vpvl2/PoseCache.h"
+#include "vpvl2/PoseEvaluator.h"
 #include "vpvl2/Scene.h"
+#include "vpvl2/Tracer.h"
 
 #endif /* vpvl2_vpvl2_H_ */
@@ -137,7 +137,8 @@ public:
         }
         m_applicationContext->updateCameraMatrices(glm::vec2(m_width, m_height));
         ::ui::initializeDictionary(m_config, m_dictionary);
-        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get());
+        m_batchRenderer.reset(::ui::createBatchRenderer(m_config, m_applicationContext.get()));
+        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get(), m_batchRenderer.get());
         m_scene->seek(0, Scene::kUpdateAll);
         m_scene->update(Scene::kUpdateAll | Scene::kResetMotionState);
 #ifdef VPVL2_LINK_ATB
@@ -201,7 +202,7 @@ public:
         m_applicationContext->renderShadowMap();
         m_applicationContext->renderOffscreen();
         m_applicationContext->updateCameraMatrices(glm::vec2(m_width, m_height));
-        ::ui::drawScreen(*m_scene.get(), m_width, m_height);
+        ::ui::drawScreen(*m_scene.get(), m_batchRenderer.get());
         double current = al_get_time() - base;
         const IKeyframe::TimeIndex &timeIndex = IKeyframe::TimeIndex((current * 1000) / Scene::defaultFPS());
         m_scene->seek(timeIndex, Scene::kUpdateAll);
@@ -333,6 +334,7 @@ private:
     FactorySmartPtr m_factory;
     SceneSmartPtr m_scene;
     ApplicationContextSmartPtr m_applicationContext;
+    gl2::BatchRendererSmartPtr m_batchRenderer;
     vsize m_width;
     vsize m_height;
     double m_restarted;
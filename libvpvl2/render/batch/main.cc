@@ -0,0 +1,704 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../helper.h"
+#include <vpvl2/extensions/XMLProject.h>
+#include <vpvl2/extensions/egl/ApplicationContext.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace vpvl2;
+using namespace vpvl2::extensions;
+using namespace vpvl2::extensions::egl;
+using namespace vpvl2::extensions::icu4c;
+
+namespace {
+
+VPVL2_MAKE_SMARTPTR(XMLProject);
+VPVL2_MAKE_SMARTPTR(ApplicationContext);
+
+static int64 UIGetNanoseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static bool UIWriteFully(int fd, const uint8 *data, vsize size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= vsize(written);
+    }
+    return true;
+}
+
+struct Options {
+    Options()
+        : projectPath(),
+          outputPath("-"),
+          width(0),
+          height(0),
+          beginFrame(0),
+          endFrame(-1),
+          shardIndex(0),
+          shardCount(1),
+          poseWindow(64),
+          fps(Scene::defaultFPS()),
+          flip(true)
+    {
+    }
+    bool parse(int argc, char **argv) {
+        for (int i = 1; i < argc; i++) {
+            const char *arg = argv[i];
+            if (strncmp(arg, "--output=", 9) == 0) {
+                outputPath = arg + 9;
+            }
+            else if (strncmp(arg, "--width=", 8) == 0) {
+                width = atoi(arg + 8);
+            }
+            else if (strncmp(arg, "--height=", 9) == 0) {
+                height = atoi(arg + 9);
+            }
+            else if (strncmp(arg, "--begin=", 8) == 0) {
+                beginFrame = atoi(arg + 8);
+            }
+            else if (strncmp(arg, "--end=", 6) == 0) {
+                endFrame = atoi(arg + 6);
+            }
+            else if (strncmp(arg, "--fps=", 6) == 0) {
+                fps = Scalar(atof(arg + 6));
+            }
+            else if (strncmp(arg, "--shard=", 8) == 0) {
+                if (sscanf(arg + 8, "%d/%d", &shardIndex, &shardCount) != 2) {
+                    return false;
+                }
+            }
+            else if (strncmp(arg, "--pose-window=", 14) == 0) {
+                poseWindow = btMax(atoi(arg + 14), 1);
+            }
+            else if (strcmp(arg, "--no-flip") == 0) {
+                flip = false;
+            }
+            else if (arg[0] != '-' && projectPath.empty()) {
+                projectPath = arg;
+            }
+            else {
+                return false;
+            }
+        }
+        return !projectPath.empty() && fps > 0 && shardCount > 0 && shardIndex >= 0 && shardIndex < shardCount;
+    }
+    static void usage(const char *argv0) {
+        std::cerr << "usage: " << argv0 << " [options] project.vpvx" << std::endl
+                  << "  --output=PATH  write raw RGBA frames to PATH (\"-\" is stdout, default)" << std::endl
+                  << "  --width=N      override window.width of config.ini" << std::endl
+                  << "  --height=N     override window.height of config.ini" << std::endl
+                  << "  --begin=N      first frame to render (default 0)" << std::endl
+                  << "  --end=N        frame to stop rendering, exclusive (default is the project duration)" << std::endl
+                  << "  --fps=N        output frames per second (default 30)" << std::endl
+                  << "  --shard=I/N    render only the I-th of N contiguous parts of the frame range" << std::endl
+                  << "  --pose-window=N  number of frames to evaluate poses ahead in parallel (default 64)" << std::endl
+                  << "  --no-flip      keep bottom-up row order of OpenGL" << std::endl;
+    }
+
+    std::string projectPath;
+    std::string outputPath;
+    int width;
+    int height;
+    int beginFrame;
+    int endFrame;
+    int shardIndex;
+    int shardCount;
+    int poseWindow;
+    Scalar fps;
+    bool flip;
+};
+
+struct StageTimer {
+    enum Type {
+        kUpdate,
+        kSkinning,
+        kDraw,
+        kReadback,
+        kMaxType
+    };
+    StageTimer()
+        : m_current(0),
+          m_nframes(0)
+    {
+        for (int i = 0; i < kMaxType; i++) {
+            m_elapsed[i] = 0;
+        }
+    }
+    void start() {
+        m_current = UIGetNanoseconds();
+    }
+    void lap(Type type) {
+        int64 now = UIGetNanoseconds();
+        m_elapsed[type] += now - m_current;
+        m_current = now;
+    }
+    void finishFrame() {
+        m_nframes++;
+    }
+    void report(std::ostream &stream) const {
+        static const char *const kNames[] = { "update", "skinning", "draw", "readback" };
+        const int nframes = btMax(m_nframes, 1);
+        int64 total = 0;
+        for (int i = 0; i < kMaxType; i++) {
+            const int64 &elapsed = m_elapsed[i];
+            stream << kNames[i] << ": total=" << (elapsed / 1000000.0) << "ms average="
+                   << (elapsed / (nframes * 1000000.0)) << "ms" << std::endl;
+            total += elapsed;
+        }
+        stream << "frames=" << m_nframes << " total=" << (total / 1000000.0) << "ms fps="
+               << (total > 0 ? m_nframes / (total / 1000000000.0) : 0) << std::endl;
+    }
+
+private:
+    int64 m_elapsed[kMaxType];
+    int64 m_current;
+    int m_nframes;
+};
+
+class PrefetchingModelTask {
+public:
+    PrefetchingModelTask(const UnicodeString &path, BaseApplicationContext *applicationContextRef, const Encoding::Dictionary *dictionaryRef)
+        : m_path(path),
+          m_applicationContextRef(applicationContextRef),
+          m_encoding(new Encoding(dictionaryRef)),
+          m_started(false),
+          m_result(false)
+    {
+    }
+    ~PrefetchingModelTask() {
+        wait();
+        m_applicationContextRef = 0;
+    }
+
+    bool start() {
+        m_started = pthread_create(&m_thread, 0, &PrefetchingModelTask::run, this) == 0;
+        return m_started;
+    }
+    bool wait() {
+        if (m_started) {
+            pthread_join(m_thread, 0);
+            m_started = false;
+        }
+        return m_result;
+    }
+    void take(ArchiveSmartPtr &archive, IModelSmartPtr &model, EncodingSmartPtr &encoding) {
+        archive.reset(m_archive.release());
+        model.reset(m_model.release());
+        encoding.reset(m_encoding.release());
+    }
+
+private:
+    static void *run(void *userData) {
+        PrefetchingModelTask *self = static_cast<PrefetchingModelTask *>(userData);
+        /* Encoding is not thread safe so the prefetched model gets its own one to keep referring */
+        Factory factory(self->m_encoding.get());
+        self->m_result = ::ui::loadModel(self->m_path, self->m_applicationContextRef, &factory, self->m_encoding.get(), self->m_archive, self->m_model);
+        return 0;
+    }
+
+    const UnicodeString m_path;
+    BaseApplicationContext *m_applicationContextRef;
+    EncodingSmartPtr m_encoding;
+    ArchiveSmartPtr m_archive;
+    IModelSmartPtr m_model;
+    pthread_t m_thread;
+    bool m_started;
+    bool m_result;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(PrefetchingModelTask)
+};
+
+class ProjectDelegate : public XMLProject::IDelegate {
+public:
+    ProjectDelegate(Factory *factoryRef, IEncoding *encodingRef, const Encoding::Dictionary *dictionaryRef)
+        : m_projectRef(0),
+          m_applicationContextRef(0),
+          m_batchRendererRef(0),
+          m_factoryRef(factoryRef),
+          m_encodingRef(encodingRef),
+          m_dictionaryRef(dictionaryRef)
+    {
+    }
+    ~ProjectDelegate() {
+        /* the prefetched tasks that were not taken by loadModel wait for their threads on deleting */
+        for (PrefetchingModelTaskMap::const_iterator it = m_prefetchingTasks.begin(); it != m_prefetchingTasks.end(); ++it) {
+            delete it->second;
+        }
+        m_prefetchingTasks.clear();
+        m_prefetchedEncodings.releaseAll();
+        m_projectRef = 0;
+        m_applicationContextRef = 0;
+        m_batchRendererRef = 0;
+        m_factoryRef = 0;
+        m_encodingRef = 0;
+        m_dictionaryRef = 0;
+    }
+
+    void setRefs(XMLProject *projectRef, BaseApplicationContext *applicationContextRef, gl2::BatchRenderer *batchRendererRef) {
+        m_projectRef = projectRef;
+        m_applicationContextRef = applicationContextRef;
+        m_batchRendererRef = batchRendererRef;
+    }
+    const std::string toStdFromString(const IString *value) const {
+        return value ? icu4c::String::toStdString(static_cast<const icu4c::String *>(value)->value()) : std::string();
+    }
+    const IString *toStringFromStd(const std::string &value) const {
+        return new icu4c::String(UnicodeString::fromUTF8(value));
+    }
+    bool loadModel(const XMLProject::UUID &uuid, const XMLProject::StringMap &settings, IModel::Type /* type */, IModel *&model, IRenderEngine *&engine, int &priority) {
+        const UnicodeString &path = UnicodeString::fromUTF8(settings.value(XMLProject::kSettingURIKey));
+        ArchiveSmartPtr archive;
+        IModelSmartPtr modelPtr;
+        bool loaded = false;
+        model = 0;
+        engine = 0;
+        PrefetchingModelTaskMap::iterator it = m_prefetchingTasks.find(uuid);
+        if (it != m_prefetchingTasks.end()) {
+            PrefetchingModelTask *task = it->second;
+            m_prefetchingTasks.erase(it);
+            if (task->wait()) {
+                EncodingSmartPtr encoding;
+                task->take(archive, modelPtr, encoding);
+                /* models of the project are alive until the end of rendering so are their encodings */
+                m_prefetchedEncodings.append(encoding.release());
+                loaded = true;
+            }
+            delete task;
+        }
+        if (!loaded) {
+            loaded = ::ui::loadModel(path, m_applicationContextRef, m_factoryRef, m_encodingRef, archive, modelPtr);
+        }
+        if (loaded) {
+            icu4c::String dir(path.tempSubString(0, path.lastIndexOf("/")));
+            BaseApplicationContext::ModelContext modelContext(m_applicationContextRef, archive.get(), &dir);
+            m_applicationContextRef->addModelPath(modelPtr.get(), icu4c::String::toStdString(path));
+            IRenderEngineSmartPtr enginePtr(m_projectRef->createRenderEngine(m_applicationContextRef, modelPtr.get(), 0));
+            if (enginePtr.get() && enginePtr->upload(&modelContext)) {
+                enginePtr->setUpdateOptions(IRenderEngine::kParallelUpdate);
+                /* physics is always disabled to make each frame depend only on its time index */
+                modelPtr->setPhysicsEnable(false);
+                /* only gl2::PMXRenderEngine is created for PMD/PMX models without effects */
+                if (m_batchRendererRef && (modelPtr->type() == IModel::kPMDModel || modelPtr->type() == IModel::kPMXModel)) {
+                    m_batchRendererRef->addEngineRef(static_cast<gl2::PMXRenderEngine *>(enginePtr.get()));
+                }
+                priority = XMLProject::toIntFromString(settings.value(XMLProject::kSettingOrderKey));
+                engine = enginePtr.release();
+                model = modelPtr.release();
+            }
+        }
+        else {
+            VPVL2_LOG(WARNING, "Cannot load a model from " << icu4c::String::toStdString(path));
+        }
+        return model != 0;
+    }
+    void prefetchModel(const XMLProject::UUID &uuid, const XMLProject::StringMap &settings, IModel::Type /* type */) {
+        if (m_prefetchingTasks.find(uuid) == m_prefetchingTasks.end()) {
+            const UnicodeString &path = UnicodeString::fromUTF8(settings.value(XMLProject::kSettingURIKey));
+            PrefetchingModelTask *task = new PrefetchingModelTask(path, m_applicationContextRef, m_dictionaryRef);
+            if (task->start()) {
+                m_prefetchingTasks.insert(std::make_pair(uuid, task));
+            }
+            else {
+                /* loadModel loads it synchronously instead */
+                delete task;
+            }
+        }
+    }
+
+private:
+    typedef std::map<XMLProject::UUID, PrefetchingModelTask *> PrefetchingModelTaskMap;
+    XMLProject *m_projectRef;
+    BaseApplicationContext *m_applicationContextRef;
+    gl2::BatchRenderer *m_batchRendererRef;
+    Factory *m_factoryRef;
+    IEncoding *m_encodingRef;
+    const Encoding::Dictionary *m_dictionaryRef;
+    PrefetchingModelTaskMap m_prefetchingTasks;
+    PointerArray<IEncoding> m_prefetchedEncodings;
+};
+
+class PosePrecomputer {
+public:
+    PosePrecomputer()
+        : m_window(0)
+    {
+    }
+    ~PosePrecomputer() {
+        m_poses.releaseAll();
+        m_evaluators.releaseAll();
+    }
+
+    void initialize(const Scene *sceneRef, int window) {
+        Array<IMotion *> motions;
+        sceneRef->getMotionRefs(motions);
+        const int nmotions = motions.count();
+        for (int i = 0; i < nmotions; i++) {
+            IMotion *motion = motions[i];
+            if (IModel *model = motion->parentModelRef()) {
+                /* model keyframes (visibility and IK) are not covered by PoseEvaluator */
+                if (motion->countKeyframes(IKeyframe::kModelKeyframe) == 0) {
+                    m_evaluators.append(new PoseEvaluator(model, motion));
+                    m_models.append(model);
+                }
+                else {
+                    m_seekingMotions.append(motion);
+                }
+            }
+        }
+        const int nevaluators = m_evaluators.count();
+        m_window = window;
+        for (int i = 0; i < nevaluators; i++) {
+            const PoseEvaluator *evaluator = m_evaluators[i];
+            for (int j = 0; j < window; j++) {
+                evaluator->allocate(*m_poses.append(new PoseEvaluator::Pose()));
+            }
+        }
+    }
+    void precompute(const Array<IKeyframe::TimeIndex> &timeIndices) {
+        /* timeIndices must not have more elements than the window */
+        const int nevaluators = m_evaluators.count(), ntimeIndices = timeIndices.count();
+        Array<PoseEvaluator::Pose *> poses;
+        for (int i = 0; i < nevaluators; i++) {
+            const PoseEvaluator *evaluator = m_evaluators[i];
+            poses.clear();
+            for (int j = 0; j < ntimeIndices; j++) {
+                poses.append(m_poses[i * m_window + j]);
+            }
+            evaluator->evaluateAll(timeIndices, poses, true);
+        }
+    }
+    void bind(int offset, const IKeyframe::TimeIndex &timeIndex) {
+        const int nevaluators = m_evaluators.count();
+        for (int i = 0; i < nevaluators; i++) {
+            m_evaluators[i]->bind(*m_poses[i * m_window + offset], m_models[i]);
+        }
+        const int nmotions = m_seekingMotions.count();
+        for (int i = 0; i < nmotions; i++) {
+            m_seekingMotions[i]->seek(timeIndex);
+        }
+    }
+
+private:
+    PointerArray<PoseEvaluator> m_evaluators;
+    PointerArray<PoseEvaluator::Pose> m_poses;
+    Array<IModel *> m_models;
+    Array<IMotion *> m_seekingMotions;
+    int m_window;
+};
+
+class ProjectFrameRenderer {
+public:
+    ProjectFrameRenderer(const Options &options)
+        : m_options(options),
+          m_display(EGL_NO_DISPLAY),
+          m_surface(EGL_NO_SURFACE),
+          m_context(EGL_NO_CONTEXT),
+          m_encoding(&m_dictionary),
+          m_factory(&m_encoding),
+          m_delegate(&m_factory, &m_encoding, &m_dictionary),
+          m_outputFd(-1),
+          m_width(0),
+          m_height(0)
+    {
+    }
+    ~ProjectFrameRenderer() {
+        if (m_project.get()) {
+            m_project->setWorldRef(0);
+        }
+        m_batchRenderer.reset();
+        m_project.reset();
+        if (m_applicationContext.get()) {
+            m_applicationContext->release();
+        }
+        m_applicationContext.reset();
+        terminateEGLSession();
+        if (m_outputFd > STDERR_FILENO) {
+            ::close(m_outputFd);
+        }
+        m_dictionary.releaseAll();
+    }
+
+    bool initialize() {
+        ::ui::loadSettings("config.ini", m_config);
+        m_width = m_options.width > 0 ? m_options.width : m_config.value("window.width", 640);
+        m_height = m_options.height > 0 ? m_options.height : m_config.value("window.height", 480);
+        if (!initializeEGLSession()) {
+            return false;
+        }
+        if (!Scene::initialize(ApplicationContext::staticSharedFunctionResolverInstance())) {
+            std::cerr << "Cannot initialize Scene" << std::endl;
+            return false;
+        }
+        ::ui::initializeDictionary(m_config, m_dictionary);
+        if (m_options.outputPath == "-") {
+            m_outputFd = STDOUT_FILENO;
+        }
+        else if ((m_outputFd = ::open(m_options.outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+            std::cerr << "Cannot open " << m_options.outputPath << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+    bool load() {
+        m_project.reset(new XMLProject(&m_delegate, &m_factory, true));
+        m_applicationContext.reset(new ApplicationContext(m_project.get(), &m_encoding, &m_config, false));
+        m_applicationContext->initialize(false);
+        m_applicationContext->setViewportRegion(glm::ivec4(0, 0, m_width, m_height));
+        m_batchRenderer.reset(::ui::createBatchRenderer(m_config, m_applicationContext.get()));
+        m_delegate.setRefs(m_project.get(), m_applicationContext.get(), m_batchRenderer.get());
+        if (m_config.value("enable.vss", false)) {
+            m_project->setAccelerationType(Scene::kVertexShaderAccelerationType1);
+        }
+        else if (m_config.value("enable.opencl", false)) {
+            m_project->setAccelerationType(Scene::kOpenCLAccelerationType1);
+        }
+        if (!m_project->load(m_options.projectPath.c_str())) {
+            std::cerr << "Cannot load project " << m_options.projectPath << std::endl;
+            return false;
+        }
+        Array<IMotion *> motions;
+        m_project->getMotionRefs(motions);
+        const int nmotions = motions.count();
+        for (int i = 0; i < nmotions; i++) {
+            IMotion *motion = motions[i];
+            if (!motion->parentModelRef()) {
+                if (motion->countKeyframes(IKeyframe::kCameraKeyframe) > 0) {
+                    m_project->cameraRef()->setMotion(motion);
+                }
+                if (motion->countKeyframes(IKeyframe::kLightKeyframe) > 0) {
+                    m_project->lightRef()->setMotion(motion);
+                }
+            }
+        }
+        return true;
+    }
+    bool render() {
+        const Scalar &step = Scene::defaultFPS() / m_options.fps;
+        int beginFrame, endFrame;
+        getFrameRange(step, beginFrame, endFrame);
+        const vsize stride = vsize(m_width) * 4, frameSize = stride * m_height;
+        Array<uint8> pixels, flipped;
+        pixels.resize(int(frameSize));
+        flipped.resize(int(frameSize));
+        StageTimer timer;
+        PosePrecomputer precomputer;
+        Array<IKeyframe::TimeIndex> timeIndices;
+        const int window = m_options.poseWindow;
+        precomputer.initialize(m_project.get(), window);
+        bool ok = true;
+        VPVL2_VLOG(1, "Rendering frames from " << beginFrame << " to " << endFrame << " (shard " << m_options.shardIndex << "/" << m_options.shardCount << ")");
+        glViewport(0, 0, m_width, m_height);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (int frameIndex = beginFrame; frameIndex < endFrame && ok; frameIndex++) {
+            const IKeyframe::TimeIndex &timeIndex = frameIndex * step;
+            const int offset = (frameIndex - beginFrame) % window;
+            timer.start();
+            if (offset == 0) {
+                const int nframes = btMin(window, endFrame - frameIndex);
+                timeIndices.clear();
+                for (int i = 0; i < nframes; i++) {
+                    timeIndices.append((frameIndex + i) * step);
+                }
+                precomputer.precompute(timeIndices);
+            }
+            m_project->seek(timeIndex, Scene::kUpdateCamera | Scene::kUpdateLight);
+            precomputer.bind(offset, timeIndex);
+            m_project->update(Scene::kUpdateModels | Scene::kUpdateCamera | Scene::kUpdateLight);
+            m_applicationContext->updateCameraMatrices();
+            timer.lap(StageTimer::kUpdate);
+            m_project->update(Scene::kUpdateRenderEngines);
+            timer.lap(StageTimer::kSkinning);
+            glClearColor(1, 1, 1, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            ::ui::drawScreen(*m_project, m_batchRenderer.get());
+            glFinish();
+            timer.lap(StageTimer::kDraw);
+            glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+            const uint8 *frame = &pixels[0];
+            if (m_options.flip) {
+                for (int y = 0; y < m_height; y++) {
+                    memcpy(&flipped[int(y * stride)], &pixels[int((m_height - y - 1) * stride)], stride);
+                }
+                frame = &flipped[0];
+            }
+            timer.lap(StageTimer::kReadback);
+            ok = UIWriteFully(m_outputFd, frame, frameSize);
+            timer.finishFrame();
+        }
+        timer.report(std::cerr);
+        if (!ok) {
+            std::cerr << "Cannot write a frame: " << strerror(errno) << std::endl;
+        }
+        return ok;
+    }
+
+private:
+    void getFrameRange(const Scalar &step, int &beginFrame, int &endFrame) const {
+        const int nframes = int(m_project->duration() / step) + 1;
+        const int first = btClamped(m_options.beginFrame, 0, nframes);
+        const int last = m_options.endFrame >= 0 ? btClamped(m_options.endFrame, first, nframes) : nframes;
+        const int count = last - first, shardCount = m_options.shardCount, shardIndex = m_options.shardIndex;
+        /* distribute the remainder to the first shards to keep sizes within one frame */
+        const int size = count / shardCount, remainder = count % shardCount;
+        beginFrame = first + shardIndex * size + btMin(shardIndex, remainder);
+        endFrame = beginFrame + size + (shardIndex < remainder ? 1 : 0);
+    }
+    bool initializeEGLSession() {
+        eglBindAPI(EGL_OPENGL_API);
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (!eglInitialize(m_display, &major, &minor)) {
+            std::cerr << "Cannot initialize EGL session: " << eglGetError() << std::endl;
+            return false;
+        }
+        EGLint attrs[] = {
+            EGL_RED_SIZE, m_config.value("opengl.size.red", 8),
+            EGL_GREEN_SIZE, m_config.value("opengl.size.green", 8),
+            EGL_BLUE_SIZE, m_config.value("opengl.size.blue", 8),
+            EGL_ALPHA_SIZE, m_config.value("opengl.size.alpha", 8),
+            EGL_DEPTH_SIZE, m_config.value("opengl.size.depth", 24),
+            EGL_STENCIL_SIZE, m_config.value("opengl.size.stencil", 8),
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint nconfigs;
+        if (!eglChooseConfig(m_display, attrs, &config, 1, &nconfigs) || nconfigs == 0) {
+            std::cerr << "Cannot choose EGL configuration: " << eglGetError() << std::endl;
+            return false;
+        }
+        EGLint surfaceAttribs[] = {
+            EGL_WIDTH, m_width,
+            EGL_HEIGHT, m_height,
+            EGL_NONE
+        };
+        m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttribs);
+        if (m_surface == EGL_NO_SURFACE) {
+            std::cerr << "Cannot create EGL pbuffer surface: " << eglGetError() << std::endl;
+            return false;
+        }
+        m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, 0);
+        if (m_context == EGL_NO_CONTEXT) {
+            std::cerr << "Cannot create EGL context: " << eglGetError() << std::endl;
+            return false;
+        }
+        if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+            std::cerr << "Cannot make OpenGL context current: " << eglGetError() << std::endl;
+            return false;
+        }
+        VPVL2_VLOG(1, "GL_VERSION: " << glGetString(GL_VERSION));
+        VPVL2_VLOG(1, "GL_RENDERER: " << glGetString(GL_RENDERER));
+        return true;
+    }
+    void terminateEGLSession() {
+        if (m_display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (m_context != EGL_NO_CONTEXT) {
+                eglDestroyContext(m_display, m_context);
+            }
+            if (m_surface != EGL_NO_SURFACE) {
+                eglDestroySurface(m_display, m_surface);
+            }
+            eglTerminate(m_display);
+        }
+        m_display = EGL_NO_DISPLAY;
+        m_surface = EGL_NO_SURFACE;
+        m_context = EGL_NO_CONTEXT;
+    }
+
+    const Options m_options;
+    EGLDisplay m_display;
+    EGLSurface m_surface;
+    EGLContext m_context;
+    StringMap m_config;
+    Encoding::Dictionary m_dictionary;
+    Encoding m_encoding;
+    Factory m_factory;
+    ProjectDelegate m_delegate;
+    XMLProjectSmartPtr m_project;
+    ApplicationContextSmartPtr m_applicationContext;
+    gl2::BatchRendererSmartPtr m_batchRenderer;
+    int m_outputFd;
+    int m_width;
+    int m_height;
+};
+
+} /* namespace anonymous */
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!options.parse(argc, argv)) {
+        Options::usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    /* a closed pipe should be reported as a write error instead of killing the process */
+    signal(SIGPIPE, SIG_IGN);
+    tbb::task_scheduler_init initializer; (void) initializer;
+    BaseApplicationContext::initializeOnce(argv[0], 0, 2);
+    int ret = EXIT_FAILURE;
+    {
+        ProjectFrameRenderer renderer(options);
+        if (renderer.initialize() && renderer.load() && renderer.render()) {
+            ret = EXIT_SUCCESS;
+        }
+    }
+    BaseApplicationContext::terminate();
+    return ret;
+}
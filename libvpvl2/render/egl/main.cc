@@ -240,7 +240,8 @@ int main(int /* argc */, char **argv)
     applicationContext.setViewportRegion(glm::vec4(0, 0, width, height));
     applicationContext.updateCameraMatrices();
     ::ui::initializeDictionary(settings, dictionary);
-    ::ui::loadAllModels(settings, &applicationContext, &scene, &factory, &encoding);
+    gl2::BatchRendererSmartPtr batchRenderer(::ui::createBatchRenderer(settings, &applicationContext));
+    ::ui::loadAllModels(settings, &applicationContext, &scene, &factory, &encoding, batchRenderer.get());
     scene.setWorldRef(world.dynamicWorldRef());
 
     scene.seek(0, Scene::kUpdateAll);
@@ -250,7 +251,7 @@ int main(int /* argc */, char **argv)
     int nframes = 0;
     glClearColor(0, 0, 1, 1);
     while (active) {
-        ::ui::drawScreen(scene);
+        ::ui::drawScreen(scene, batchRenderer.get());
         scene.advance(0, Scene::kUpdateAll);
         world.stepSimulation(0);
         scene.update(Scene::kUpdateAll);
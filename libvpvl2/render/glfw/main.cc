@@ -158,6 +158,7 @@ public:
           m_pressed(false),
           m_autoplay(false)
     {
+        m_profiler.attach();
     }
     ~Application() {
         m_debugDrawer.reset();
@@ -179,6 +180,10 @@ public:
             snprintf(title, sizeof(title), "libvpvl2 with GLFW (FPS:%d)", m_currentFPS);
 #endif
             glfwSetWindowTitle(m_window, title);
+            for (int i = 0; i < FrameProfiler::kMaxStage; i++) {
+                const FrameProfiler::Stage stage = static_cast<FrameProfiler::Stage>(i);
+                VPVL2_VLOG(1, "stage=" << FrameProfiler::stageName(stage) << " average=" << m_profiler.averageStageDuration(stage) << "ns");
+            }
             m_restarted = m_current;
             m_currentFPS = 0;
         }
@@ -263,7 +268,8 @@ public:
         }
         m_applicationContext->setViewportRegion(glm::ivec4(0, 0, m_width, m_height));
         ::ui::initializeDictionary(m_config, m_dictionary);
-        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get());
+        m_batchRenderer.reset(::ui::createBatchRenderer(m_config, m_applicationContext.get()));
+        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get(), m_batchRenderer.get());
         m_debugDrawer->setDebugMode(//btIDebugDraw::DBG_DrawAabb |
                                     //btIDebugDraw::DBG_DrawConstraints |
                                     //btIDebugDraw::DBG_DrawConstraintLimits |
@@ -322,9 +328,10 @@ public:
         return !glfwWindowShouldClose(m_window);
     }
     void handleFrame(double base, double &last, uint64 &oldTimeIndex) {
+        m_profiler.beginFrame();
         m_applicationContext->renderShadowMap();
         m_applicationContext->renderOffscreen();
-        ::ui::drawScreen(*m_scene.get());
+        ::ui::drawScreen(*m_scene.get(), m_batchRenderer.get());
         m_applicationContext->renderEffectParameterUIWidgets();
         double current = glfwGetTime();
         if (m_autoplay) {
@@ -332,14 +339,20 @@ public:
             m_scene->seek(newTimeIndex, Scene::kUpdateAll);
             uint64 delta = newTimeIndex - oldTimeIndex;
             oldTimeIndex = newTimeIndex;
-            m_world->dynamicWorldRef()->stepSimulation(delta / Scene::defaultFPS(), 2 * delta);
+            {
+                VPVL2_PROFILE_STAGE(kPhysicsStepStage);
+                m_world->dynamicWorldRef()->stepSimulation(delta / Scene::defaultFPS(), 2 * delta);
+            }
             m_scene->update(Scene::kUpdateAll & ~Scene::kUpdateCamera);
             updateFPS();
             last = current;
         }
         else if (m_pressedKey == GLFW_KEY_SPACE) {
             m_scene->seek(last, Scene::kUpdateAll);
-            m_world->dynamicWorldRef()->stepSimulation(1 / Scene::defaultFPS(), 2);
+            {
+                VPVL2_PROFILE_STAGE(kPhysicsStepStage);
+                m_world->dynamicWorldRef()->stepSimulation(1 / Scene::defaultFPS(), 2);
+            }
             m_scene->update(Scene::kUpdateAll & ~Scene::kUpdateCamera);
             last += 1;
         }
@@ -359,6 +372,7 @@ public:
 #endif
         m_scene->update(Scene::kUpdateCamera);
         m_pressedKey = 0;
+        m_profiler.endFrame();
         glfwSwapBuffers(m_window);
         glfwPollEvents();
     }
@@ -471,7 +485,9 @@ private:
     FactorySmartPtr m_factory;
     SceneSmartPtr m_scene;
     ApplicationContextSmartPtr m_applicationContext;
+    gl2::BatchRendererSmartPtr m_batchRenderer;
     DebugDrawerSmartPtr m_debugDrawer;
+    FrameProfiler m_profiler;
     glm::vec2 m_lastCursorPosition;
     vsize m_width;
     vsize m_height;
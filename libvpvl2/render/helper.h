@@ -41,6 +41,8 @@
 #include <vpvl2/extensions/World.h>
 #include <vpvl2/extensions/icu4c/Encoding.h>
 #include <vpvl2/extensions/icu4c/StringMap.h>
+#include <vpvl2/gl2/BatchRenderer.h>
+#include <vpvl2/gl2/PMXRenderEngine.h>
 
 #ifdef VPVL2_OS_OSX
 #include <OpenGL/gl.h>
@@ -52,17 +54,30 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <string>
 #include <sstream>
 
+namespace vpvl2 {
+namespace gl2 {
+VPVL2_MAKE_SMARTPTR(BatchRenderer);
+}
+}
+
 using namespace vpvl2;
 using namespace vpvl2::extensions;
 
 namespace ui {
 
-static void drawScreen(const Scene &scene)
+static gl2::BatchRenderer *createBatchRenderer(const icu4c::StringMap &settings, IApplicationContext *applicationContextRef)
+{
+    return settings.value("enable.batch", true) ? new gl2::BatchRenderer(applicationContextRef) : 0;
+}
+
+static void drawScreen(const Scene &scene, gl2::BatchRenderer *batchRendererRef = 0)
 {
     Array<IRenderEngine *> enginesForPreProcess, enginesForStandard, enginesForPostProcess;
     Hash<HashPtr, IEffect *> nextPostEffects;
@@ -78,12 +93,17 @@ static void drawScreen(const Scene &scene)
         IRenderEngine *engine = enginesForPreProcess[i];
         engine->performPreProcess();
     }
-    for (int i = 0, nengines = enginesForStandard.count(); i < nengines; i++) {
-        IRenderEngine *engine = enginesForStandard[i];
-        engine->renderModel();
-        engine->renderEdge();
-        if (!scene.shadowMapRef()) {
-            engine->renderShadow();
+    if (batchRendererRef) {
+        batchRendererRef->render(enginesForStandard, !scene.shadowMapRef());
+    }
+    else {
+        for (int i = 0, nengines = enginesForStandard.count(); i < nengines; i++) {
+            IRenderEngine *engine = enginesForStandard[i];
+            engine->renderModel();
+            engine->renderEdge();
+            if (!scene.shadowMapRef()) {
+                engine->renderShadow();
+            }
         }
     }
     for (int i = 0, nengines = enginesForPostProcess.count(); i < nengines; i++) {
@@ -93,6 +113,34 @@ static void drawScreen(const Scene &scene)
     }
 }
 
+class FileDataSink : public IDataSink {
+public:
+    FileDataSink(const std::string &path)
+        : m_file(std::fopen(path.c_str(), "wb"))
+    {
+    }
+    ~FileDataSink() {
+        if (m_file) {
+            std::fclose(m_file);
+            m_file = 0;
+        }
+    }
+    bool write(const uint8 *data, vsize size) {
+        return m_file && std::fwrite(data, 1, size, m_file) == size;
+    }
+
+private:
+    std::FILE *m_file;
+};
+
+static void writeTrace(const Tracer &tracer, const std::string &path)
+{
+    FileDataSink sink(path);
+    if (!tracer.writeChromeTraceEvents(&sink)) {
+        VPVL2_LOG(WARNING, "Cannot write trace events to " << path);
+    }
+}
+
 static void loadSettings(const std::string &path, icu4c::StringMap &settings)
 {
     std::ifstream stream(path.c_str());
@@ -139,6 +187,7 @@ static bool loadModel(const UnicodeString &path,
                       IModelSmartPtr &model)
 {
     static const UnicodeString kPMDExtension(".pmd"), kPMXExtension(".pmx");
+    VPVL2_TRACE_SCOPE("render", "loadModel");
     BaseApplicationContext::MapBuffer buffer(applicationContextRef);
     bool ok = false;
     if (path.endsWith(".zip")) {
@@ -170,7 +219,8 @@ static void loadAllModels(const icu4c::StringMap &settings,
                           BaseApplicationContext *applicationContextRef,
                           Scene *sceneRef,
                           Factory *factoryRef,
-                          IEncoding *encodingRef)
+                          IEncoding *encodingRef,
+                          gl2::BatchRenderer *batchRendererRef = 0)
 {
     const std::string &globalMotionPath = icu4c::String::toStdString(settings.value("file.motion", UnicodeString()));
     int nmodels = settings.value("models/size", 0);
@@ -178,6 +228,12 @@ static void loadAllModels(const icu4c::StringMap &settings,
     ArchiveSmartPtr archive;
     IModelSmartPtr model;
     std::ostringstream stream;
+    std::map<std::string, gl2::PMXRenderEngine *> path2EngineRefs;
+    const std::string &tracePath = icu4c::String::toStdString(settings.value("file.trace", UnicodeString()));
+    Tracer tracer;
+    if (!tracePath.empty()) {
+        tracer.attach();
+    }
     if (settings.value("enable.vss", false)) {
         sceneRef->setAccelerationType(Scene::kVertexShaderAccelerationType1);
     }
@@ -213,8 +269,24 @@ static void loadAllModels(const icu4c::StringMap &settings,
                 //}
                 effectRef = engine->effectRef(IEffect::kDefault);
             }
+            /* only gl2::PMXRenderEngine is created for PMD/PMX models without effects */
+            gl2::PMXRenderEngine *pmxEngineRef = 0;
+            if ((flags & Scene::kEffectCapable) == 0 && (model->type() == IModel::kPMDModel || model->type() == IModel::kPMXModel)) {
+                pmxEngineRef = static_cast<gl2::PMXRenderEngine *>(engine.get());
+                const std::string &key = icu4c::String::toStdString(modelPath);
+                std::map<std::string, gl2::PMXRenderEngine *>::const_iterator it = path2EngineRefs.find(key);
+                if (it != path2EngineRefs.end() && pmxEngineRef->shareResources(it->second)) {
+                    VPVL2_VLOG(2, "Sharing GPU resources with the model loaded from the same path: " << key);
+                }
+            }
             if (engine->upload(&modelContext)) {
                 engine->setUpdateOptions(parallel ? IRenderEngine::kParallelUpdate : IRenderEngine::kNone);
+                if (pmxEngineRef) {
+                    path2EngineRefs.insert(std::make_pair(icu4c::String::toStdString(modelPath), pmxEngineRef));
+                    if (batchRendererRef) {
+                        batchRendererRef->addEngineRef(pmxEngineRef);
+                    }
+                }
                 model->setEdgeWidth(settings.value(prefix + "/edge.width", 1.0f));
                 model->setPhysicsEnable(settings.value(prefix + "/enable.physics", true));
                 sceneRef->addModel(model.get(), engine.release(), i);
@@ -246,6 +318,10 @@ static void loadAllModels(const icu4c::StringMap &settings,
             }
         }
     }
+    if (!tracePath.empty()) {
+        tracer.detach();
+        writeTrace(tracer, tracePath);
+    }
 }
 
 }
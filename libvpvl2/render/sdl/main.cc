@@ -136,7 +136,8 @@ public:
             m_applicationContext->setLightMatrices(glm::mat4(), view, projection);
         }
         ::ui::initializeDictionary(m_config, m_dictionary);
-        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get());
+        m_batchRenderer.reset(::ui::createBatchRenderer(m_config, m_applicationContext.get()));
+        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get(), m_batchRenderer.get());
         m_scene->setWorldRef(m_world->dynamicWorldRef());
         m_scene->seek(0, Scene::kUpdateAll);
         m_scene->update(Scene::kUpdateAll | Scene::kResetMotionState);
@@ -175,7 +176,7 @@ public:
         }
         m_applicationContext->renderShadowMap();
         m_applicationContext->renderOffscreen();
-        ::ui::drawScreen(*m_scene.get());
+        ::ui::drawScreen(*m_scene.get(), m_batchRenderer.get());
         Uint32 current = SDL_GetTicks();
         const IKeyframe::TimeIndex &timeIndex = IKeyframe::TimeIndex((current - base) / Scene::defaultFPS());
         m_scene->seek(timeIndex, Scene::kUpdateAll);
@@ -366,6 +367,7 @@ private:
     FactorySmartPtr m_factory;
     SceneSmartPtr m_scene;
     ApplicationContextSmartPtr m_applicationContext;
+    gl2::BatchRendererSmartPtr m_batchRenderer;
     Uint32 m_restarted;
     Uint32 m_current;
     int m_currentFPS;
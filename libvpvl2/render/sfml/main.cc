@@ -117,7 +117,8 @@ public:
             m_applicationContext->setLightMatrices(glm::mat4(), view, projection);
         }
         ::ui::initializeDictionary(m_config, m_dictionary);
-        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get());
+        m_batchRenderer.reset(::ui::createBatchRenderer(m_config, m_applicationContext.get()));
+        ::ui::loadAllModels(m_config, m_applicationContext.get(), m_scene.get(), m_factory.get(), m_encoding.get(), m_batchRenderer.get());
         m_scene->setWorldRef(m_world->dynamicWorldRef());
         m_scene->seek(0, Scene::kUpdateAll);
         m_scene->update(Scene::kUpdateAll | Scene::kResetMotionState);
@@ -177,7 +178,7 @@ public:
         }
         m_applicationContext->renderShadowMap();
         m_applicationContext->renderOffscreen();
-        ::ui::drawScreen(*m_scene.get());
+        ::ui::drawScreen(*m_scene.get(), m_batchRenderer.get());
         sf::Time current = base.getElapsedTime();
         const IKeyframe::TimeIndex &timeIndex = IKeyframe::TimeIndex(current.asMilliseconds() / Scene::defaultFPS());
         m_scene->seek(timeIndex, Scene::kUpdateAll);
@@ -293,6 +294,7 @@ private:
     FactorySmartPtr m_factory;
     SceneSmartPtr m_scene;
     ApplicationContextSmartPtr m_applicationContext;
+    gl2::BatchRendererSmartPtr m_batchRenderer;
     sf::Clock m_clock;
     sf::Time m_restarted;
     sf::Time m_current;
@@ -564,6 +564,7 @@ Model::Model(IEncoding *encoding)
       m_rotation(Quaternion::getIdentity()),
       m_opacity(1),
       m_scaleFactor(10),
+      m_revision(0),
       m_visible(false)
 {
 #if defined(VPVL2_LINK_ASSIMP) || defined(VPVL2_LINK_ASSIMP3)
@@ -594,6 +595,7 @@ Model::~Model()
     m_rotation.setValue(0, 0, 0, 1);
     m_opacity = 0;
     m_scaleFactor = 0;
+    m_revision = 0;
     m_visible = false;
 #if defined(VPVL2_LINK_ASSIMP) || defined(VPVL2_LINK_ASSIMP3)
     m_scene = 0;
@@ -737,7 +739,10 @@ void Model::setWorldTranslation(const Vector3 &value)
 
 void Model::setWorldPositionInternal(const Vector3 &value)
 {
-    m_position = value;
+    if (m_position != value) {
+        m_position = value;
+        m_revision++;
+    }
 }
 
 void Model::setWorldOrientation(const Quaternion &value)
@@ -747,12 +752,18 @@ void Model::setWorldOrientation(const Quaternion &value)
 
 void Model::setWorldRotationInternal(const Quaternion &value)
 {
-    m_rotation = value;
+    if (m_rotation != value) {
+        m_rotation = value;
+        m_revision++;
+    }
 }
 
 void Model::setOpacity(const Scalar &value)
 {
-    m_opacity = value;
+    if (m_opacity != value) {
+        m_opacity = value;
+        m_revision++;
+    }
 }
 
 void Model::setScaleFactor(const Scalar &value)
@@ -762,7 +773,10 @@ void Model::setScaleFactor(const Scalar &value)
 
 void Model::setScaleFactorInternal(const Scalar &value)
 {
-    m_scaleFactor = value;
+    if (m_scaleFactor != value) {
+        m_scaleFactor = value;
+        m_revision++;
+    }
 }
 
 void Model::setParentSceneRef(Scene *value)
@@ -774,6 +788,7 @@ void Model::setParentModelRef(IModel *value)
 {
     if (!internal::ModelHelper::hasModelLoopChain(value, this)) {
         m_parentModelRef = value;
+        m_revision++;
     }
 }
 
@@ -781,12 +796,16 @@ void Model::setParentBoneRef(IBone *value)
 {
     if (!internal::ModelHelper::hasBoneLoopChain(value, m_parentModelRef)) {
         m_parentBoneRef = value;
+        m_revision++;
     }
 }
 
 void Model::setVisible(bool value)
 {
-    m_visible = value;
+    if (m_visible != value) {
+        m_visible = value;
+        m_revision++;
+    }
 }
 
 void Model::setAabb(const Vector3 &min, const Vector3 &max)
@@ -966,6 +985,50 @@ void Model::removeVertex(IVertex * /* value */)
     /* do nothing */
 }
 
+int Model::addInstanceTransform(const Transform &value)
+{
+    m_instanceTransforms.append(value);
+    m_revision++;
+    return m_instanceTransforms.count() - 1;
+}
+
+void Model::setInstanceTransform(int index, const Transform &value)
+{
+    if (internal::checkBound(index, 0, m_instanceTransforms.count())) {
+        m_instanceTransforms[index] = value;
+        m_revision++;
+    }
+}
+
+void Model::removeInstanceTransformAt(int index)
+{
+    const int ntransforms = m_instanceTransforms.count();
+    if (internal::checkBound(index, 0, ntransforms)) {
+        /* keep the order of the rest of placements as their indices are exposed */
+        for (int i = index; i < ntransforms - 1; i++) {
+            m_instanceTransforms[i] = m_instanceTransforms[i + 1];
+        }
+        m_instanceTransforms.resize(ntransforms - 1);
+        m_revision++;
+    }
+}
+
+void Model::removeAllInstanceTransforms()
+{
+    m_instanceTransforms.clear();
+    m_revision++;
+}
+
+int Model::countInstanceTransforms() const
+{
+    return m_instanceTransforms.count();
+}
+
+Transform Model::instanceTransformAt(int index) const
+{
+    return internal::checkBound(index, 0, m_instanceTransforms.count()) ? m_instanceTransforms[index] : Transform::getIdentity();
+}
+
 #if defined(VPVL2_LINK_ASSIMP) || defined(VPVL2_LINK_ASSIMP3)
 void Model::setIndicesRecurse(const aiScene *scene, const aiNode *node)
 {
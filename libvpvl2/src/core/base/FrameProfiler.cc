@@ -0,0 +1,314 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/util.h"
+
+#if defined(VPVL2_OS_WINDOWS)
+#include <windows.h>
+#elif defined(VPVL2_OS_OSX)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+namespace
+{
+
+using namespace vpvl2;
+
+VPVL2_DECL_TLS static FrameProfiler *g_currentProfilerRef = 0;
+
+static const char *const kStageNames[] = {
+    "motionSeek",
+    "morphUpdate",
+    "boneTransform",
+    "IK",
+    "physicsStep",
+    "rigidBodySync",
+    "skinning",
+    "bufferUpload",
+    "draw"
+};
+
+static uint64 currentTimeNanoseconds()
+{
+#if defined(VPVL2_OS_WINDOWS)
+    static LARGE_INTEGER frequency = { 0 };
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        ::QueryPerformanceFrequency(&frequency);
+    }
+    ::QueryPerformanceCounter(&counter);
+    return uint64(counter.QuadPart / frequency.QuadPart) * 1000000000ull
+            + uint64(counter.QuadPart % frequency.QuadPart) * 1000000000ull / uint64(frequency.QuadPart);
+#elif defined(VPVL2_OS_OSX)
+    static mach_timebase_info_data_t timebase = { 0, 0 };
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64(ts.tv_sec) * 1000000000ull + uint64(ts.tv_nsec);
+#endif
+}
+
+}
+
+namespace vpvl2
+{
+
+struct FrameProfiler::PrivateContext {
+    PrivateContext(int capacity)
+        : origin(currentTimeNanoseconds()),
+          stageStartedAt(0),
+          nextFrameIndex(0),
+          head(0),
+          nframes(0),
+          currentStage(-1),
+          inFrame(false)
+    {
+        frames.resize(btMax(capacity, 1));
+        resetFrame(current);
+    }
+    ~PrivateContext() {
+        head = nframes = 0;
+        inFrame = false;
+    }
+
+    static void resetFrame(Frame &frame) {
+        frame.index = 0;
+        frame.timestamp = 0;
+        frame.duration = 0;
+        for (int i = 0; i < kMaxStage; i++) {
+            frame.stageDurations[i] = 0;
+            frame.stageCalls[i] = 0;
+        }
+        for (int i = 0; i < kMaxCounterType; i++) {
+            frame.counters[i] = 0;
+        }
+    }
+    void flushStage(uint64 now) {
+        if (currentStage >= 0) {
+            current.stageDurations[currentStage] += now - stageStartedAt;
+        }
+        stageStartedAt = now;
+    }
+
+    Array<Frame> frames;
+    Frame current;
+    uint64 origin;
+    uint64 stageStartedAt;
+    uint64 nextFrameIndex;
+    int head;
+    int nframes;
+    int currentStage;
+    bool inFrame;
+};
+
+FrameProfiler::Scope::Scope(Stage stage)
+    : m_profilerRef(g_currentProfilerRef),
+      m_previousStage(-1)
+{
+    if (m_profilerRef) {
+        if (m_profilerRef->isInFrame()) {
+            m_profilerRef->enterStage(stage, m_previousStage);
+        }
+        else {
+            m_profilerRef = 0;
+        }
+    }
+}
+
+FrameProfiler::Scope::~Scope()
+{
+    if (m_profilerRef) {
+        m_profilerRef->leaveStage(m_previousStage);
+    }
+    m_profilerRef = 0;
+    m_previousStage = -1;
+}
+
+FrameProfiler *FrameProfiler::currentProfilerRef()
+{
+    return g_currentProfilerRef;
+}
+
+void FrameProfiler::count(CounterType type, vsize value)
+{
+    if (FrameProfiler *profiler = g_currentProfilerRef) {
+        profiler->addCounter(type, value);
+    }
+}
+
+const char *FrameProfiler::stageName(Stage stage)
+{
+    return internal::checkBound(stage, kMotionSeekStage, kMaxStage) ? kStageNames[stage] : "";
+}
+
+FrameProfiler::FrameProfiler(int capacity)
+    : m_context(new PrivateContext(capacity))
+{
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    detach();
+    internal::deleteObject(m_context);
+}
+
+void FrameProfiler::attach()
+{
+    g_currentProfilerRef = this;
+}
+
+void FrameProfiler::detach()
+{
+    if (g_currentProfilerRef == this) {
+        g_currentProfilerRef = 0;
+    }
+}
+
+void FrameProfiler::clear()
+{
+    PrivateContext::resetFrame(m_context->current);
+    m_context->nextFrameIndex = 0;
+    m_context->head = m_context->nframes = 0;
+    m_context->currentStage = -1;
+    m_context->inFrame = false;
+}
+
+void FrameProfiler::beginFrame()
+{
+    if (m_context->inFrame) {
+        endFrame();
+    }
+    Frame &frame = m_context->current;
+    PrivateContext::resetFrame(frame);
+    const uint64 now = currentTimeNanoseconds();
+    frame.index = m_context->nextFrameIndex++;
+    frame.timestamp = now - m_context->origin;
+    m_context->stageStartedAt = now;
+    m_context->currentStage = -1;
+    m_context->inFrame = true;
+}
+
+void FrameProfiler::endFrame()
+{
+    if (!m_context->inFrame) {
+        return;
+    }
+    const uint64 now = currentTimeNanoseconds();
+    Frame &frame = m_context->current;
+    m_context->flushStage(now);
+    frame.duration = now - m_context->origin - frame.timestamp;
+    /* overwrite the oldest frame when the ring buffer is full */
+    Array<Frame> &frames = m_context->frames;
+    const int capacity = frames.count();
+    frames[(m_context->head + m_context->nframes) % capacity] = frame;
+    if (m_context->nframes < capacity) {
+        m_context->nframes++;
+    }
+    else {
+        m_context->head = (m_context->head + 1) % capacity;
+    }
+    m_context->currentStage = -1;
+    m_context->inFrame = false;
+}
+
+bool FrameProfiler::isInFrame() const
+{
+    return m_context->inFrame;
+}
+
+void FrameProfiler::addCounter(CounterType type, vsize value)
+{
+    if (m_context->inFrame && internal::checkBound(type, kUpdatedModelCounter, kMaxCounterType)) {
+        m_context->current.counters[type] += value;
+    }
+}
+
+int FrameProfiler::capacity() const
+{
+    return m_context->frames.count();
+}
+
+int FrameProfiler::countFrames() const
+{
+    return m_context->nframes;
+}
+
+const FrameProfiler::Frame &FrameProfiler::frameAt(int index) const
+{
+    const Array<Frame> &frames = m_context->frames;
+    return frames[(m_context->head + index) % frames.count()];
+}
+
+uint64 FrameProfiler::averageStageDuration(Stage stage) const
+{
+    const int nframes = m_context->nframes;
+    if (nframes == 0 || !internal::checkBound(stage, kMotionSeekStage, kMaxStage)) {
+        return 0;
+    }
+    uint64 sum = 0;
+    for (int i = 0; i < nframes; i++) {
+        sum += frameAt(i).stageDurations[stage];
+    }
+    return sum / nframes;
+}
+
+void FrameProfiler::enterStage(Stage stage, int &previousStage)
+{
+    /* stop the clock of the enclosing stage so that each stage gets its exclusive time */
+    m_context->flushStage(currentTimeNanoseconds());
+    previousStage = m_context->currentStage;
+    m_context->currentStage = stage;
+    m_context->current.stageCalls[stage]++;
+}
+
+void FrameProfiler::leaveStage(int previousStage)
+{
+    if (m_context->inFrame) {
+        m_context->flushStage(currentTimeNanoseconds());
+        m_context->currentStage = previousStage;
+    }
+}
+
+} /* namespace vpvl2 */
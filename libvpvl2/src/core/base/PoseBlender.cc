@@ -0,0 +1,468 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/util.h"
+
+namespace
+{
+
+using namespace vpvl2;
+
+static void allocatePose(int nbones, int nmorphs, PoseEvaluator::Pose &pose)
+{
+    pose.localTranslations.resize(nbones);
+    pose.localOrientations.resize(nbones);
+    for (int i = 0; i < nbones; i++) {
+        pose.localTranslations[i].setZero();
+        pose.localOrientations[i].setValue(0, 0, 0, 1);
+    }
+    pose.morphWeights.resize(nmorphs);
+    for (int i = 0; i < nmorphs; i++) {
+        pose.morphWeights[i] = 0;
+    }
+    pose.timeIndex = 0;
+}
+
+struct Layer {
+    Layer(const PoseEvaluator *evaluatorRef, const PoseCache *cacheRef, PoseBlender::LayerType type)
+        : evaluatorRef(evaluatorRef),
+          cacheRef(cacheRef),
+          type(type),
+          weight(1),
+          timeIndex(0),
+          hasBoneMask(false)
+    {
+        if (evaluatorRef) {
+            evaluatorRef->getBoneIndices(sourceBoneIndices);
+            evaluatorRef->getMorphIndices(morphIndices);
+        }
+        else if (cacheRef) {
+            cacheRef->getBoneIndices(sourceBoneIndices);
+            cacheRef->getMorphIndices(morphIndices);
+        }
+        boneIndices.copy(sourceBoneIndices);
+    }
+    ~Layer() {
+        evaluatorRef = 0;
+        cacheRef = 0;
+    }
+
+    void evaluate() {
+        /* masked layers evaluate only the tracks of the masked bones */
+        if (evaluatorRef) {
+            if (hasBoneMask) {
+                evaluatorRef->evaluate(timeIndex, boneTrackIndices, pose);
+            }
+            else {
+                evaluatorRef->evaluate(timeIndex, pose);
+            }
+        }
+        else if (cacheRef) {
+            if (hasBoneMask) {
+                cacheRef->evaluate(timeIndex, boneTrackIndices, pose);
+            }
+            else {
+                cacheRef->evaluate(timeIndex, pose);
+            }
+        }
+    }
+    void setBoneMask(const Array<int> &value, int nbones) {
+        const int nindices = value.count();
+        if (nindices > 0) {
+            Array<uint8> masks;
+            masks.resize(nbones);
+            for (int i = 0; i < nbones; i++) {
+                masks[i] = 0;
+            }
+            for (int i = 0; i < nindices; i++) {
+                const int index = value[i];
+                if (internal::checkBound(index, 0, nbones)) {
+                    masks[index] = 1;
+                }
+            }
+            const int nsources = sourceBoneIndices.count();
+            boneIndices.clear();
+            boneTrackIndices.clear();
+            for (int i = 0; i < nsources; i++) {
+                const int index = sourceBoneIndices[i];
+                if (internal::checkBound(index, 0, nbones) && masks[index]) {
+                    boneIndices.append(index);
+                    boneTrackIndices.append(i);
+                }
+            }
+            hasBoneMask = true;
+        }
+        else {
+            boneIndices.copy(sourceBoneIndices);
+            boneTrackIndices.clear();
+            hasBoneMask = false;
+        }
+    }
+
+    const PoseEvaluator *evaluatorRef;
+    const PoseCache *cacheRef;
+    const PoseBlender::LayerType type;
+    Scalar weight;
+    IKeyframe::TimeIndex timeIndex;
+    Array<int> sourceBoneIndices;
+    Array<int> boneIndices;
+    Array<int> boneTrackIndices;
+    Array<int> morphIndices;
+    PoseEvaluator::Pose pose;
+    bool hasBoneMask;
+};
+
+struct Crossfade {
+    int fromIndex;
+    int toIndex;
+    IKeyframe::TimeIndex duration;
+    IKeyframe::TimeIndex elapsed;
+};
+
+}
+
+namespace vpvl2
+{
+
+struct PoseBlender::PrivateContext {
+    PrivateContext(IModel *modelRef)
+        : modelRef(modelRef),
+          nbones(0),
+          nmorphs(0)
+    {
+        if (modelRef) {
+            Array<IBone *> bones;
+            Array<IMorph *> morphs;
+            modelRef->getBoneRefs(bones);
+            modelRef->getMorphRefs(morphs);
+            nbones = bones.count();
+            nmorphs = morphs.count();
+        }
+        allocatePose(nbones, nmorphs, pose);
+        boneFlags.resize(nbones);
+        for (int i = 0; i < nbones; i++) {
+            boneFlags[i] = 0;
+        }
+        morphFlags.resize(nmorphs);
+        for (int i = 0; i < nmorphs; i++) {
+            morphFlags[i] = 0;
+        }
+    }
+    ~PrivateContext() {
+        layers.releaseAll();
+        modelRef = 0;
+    }
+
+    int addLayer(Layer *layer) {
+        allocatePose(nbones, nmorphs, layer->pose);
+        layers.append(layer);
+        return layers.count() - 1;
+    }
+    Layer *findLayer(int index) const {
+        return internal::checkBound(index, 0, layers.count()) ? layers[index] : 0;
+    }
+    void resetBlendedValues() {
+        const int nblendedBones = blendedBones.count();
+        for (int i = 0; i < nblendedBones; i++) {
+            const int index = blendedBones[i];
+            boneFlags[index] = 0;
+            pose.localTranslations[index].setZero();
+            pose.localOrientations[index].setValue(0, 0, 0, 1);
+        }
+        blendedBones.clear();
+        const int nblendedMorphs = blendedMorphs.count();
+        for (int i = 0; i < nblendedMorphs; i++) {
+            const int index = blendedMorphs[i];
+            morphFlags[index] = 0;
+            pose.morphWeights[index] = 0;
+        }
+        blendedMorphs.clear();
+    }
+    void blendBones(const Layer *layer) {
+        const Array<int> &boneIndices = layer->boneIndices;
+        const PoseEvaluator::Pose &source = layer->pose;
+        const Scalar &weight = btMin(layer->weight, Scalar(1));
+        const int nindices = boneIndices.count();
+        for (int i = 0; i < nindices; i++) {
+            const int index = boneIndices[i];
+            if (!internal::checkBound(index, 0, nbones)) {
+                continue;
+            }
+            if (!boneFlags[index]) {
+                boneFlags[index] = 1;
+                blendedBones.append(index);
+            }
+            const Vector3 &translation = source.localTranslations[index];
+            const Quaternion &orientation = source.localOrientations[index];
+            Vector3 &destTranslation = pose.localTranslations[index];
+            Quaternion &destOrientation = pose.localOrientations[index];
+            if (layer->type == kAdditiveLayer) {
+                destTranslation += translation * weight;
+                destOrientation *= Quaternion::getIdentity().slerp(orientation, weight);
+                destOrientation.normalize();
+            }
+            else if (weight >= 1) {
+                destTranslation = translation;
+                destOrientation = orientation;
+            }
+            else {
+                destTranslation.setInterpolate3(destTranslation, translation, weight);
+                destOrientation = destOrientation.slerp(orientation, weight);
+            }
+        }
+    }
+    void blendMorphs(const Layer *layer) {
+        const Array<int> &morphIndices = layer->morphIndices;
+        const PoseEvaluator::Pose &source = layer->pose;
+        const IMorph::WeightPrecision &weight = btMin(layer->weight, Scalar(1));
+        const int nindices = morphIndices.count();
+        for (int i = 0; i < nindices; i++) {
+            const int index = morphIndices[i];
+            if (!internal::checkBound(index, 0, nmorphs)) {
+                continue;
+            }
+            if (!morphFlags[index]) {
+                morphFlags[index] = 1;
+                blendedMorphs.append(index);
+            }
+            const IMorph::WeightPrecision &value = source.morphWeights[index];
+            IMorph::WeightPrecision &dest = pose.morphWeights[index];
+            if (layer->type == kAdditiveLayer) {
+                dest += value * weight;
+            }
+            else {
+                dest += (value - dest) * weight;
+            }
+        }
+    }
+    void evaluate() {
+        resetBlendedValues();
+        const int nlayers = layers.count();
+        for (int i = 0; i < nlayers; i++) {
+            Layer *layer = layers[i];
+            if (layer->weight > 0) {
+                layer->evaluate();
+                blendBones(layer);
+                blendMorphs(layer);
+            }
+        }
+    }
+    void apply() {
+        if (!modelRef) {
+            return;
+        }
+        const int nblendedBones = blendedBones.count();
+        for (int i = 0; i < nblendedBones; i++) {
+            const int index = blendedBones[i];
+            if (IBone *bone = modelRef->findBoneRefAt(index)) {
+                bone->setLocalTranslation(pose.localTranslations[index]);
+                bone->setLocalOrientation(pose.localOrientations[index]);
+            }
+        }
+        const int nblendedMorphs = blendedMorphs.count();
+        for (int i = 0; i < nblendedMorphs; i++) {
+            const int index = blendedMorphs[i];
+            if (IMorph *morph = modelRef->findMorphRefAt(index)) {
+                morph->setWeight(pose.morphWeights[index]);
+            }
+        }
+    }
+    void advanceCrossfades(const IKeyframe::TimeIndex &delta) {
+        int nfades = crossfades.count();
+        for (int i = 0; i < nfades; i++) {
+            Crossfade &fade = crossfades[i];
+            fade.elapsed += delta;
+            const Scalar &t = fade.duration > 0 ? Scalar(btMin(fade.elapsed / fade.duration, IKeyframe::TimeIndex(1))) : Scalar(1);
+            if (Layer *from = findLayer(fade.fromIndex)) {
+                from->weight = 1 - t;
+            }
+            if (Layer *to = findLayer(fade.toIndex)) {
+                to->weight = t;
+            }
+            if (t >= 1) {
+                crossfades.removeAt(i);
+                nfades--;
+                i--;
+            }
+        }
+    }
+
+    IModel *modelRef;
+    PointerArray<Layer> layers;
+    Array<Crossfade> crossfades;
+    PoseEvaluator::Pose pose;
+    Array<uint8> boneFlags;
+    Array<uint8> morphFlags;
+    Array<int> blendedBones;
+    Array<int> blendedMorphs;
+    int nbones;
+    int nmorphs;
+};
+
+PoseBlender::PoseBlender(IModel *modelRef)
+    : m_context(new PrivateContext(modelRef))
+{
+}
+
+PoseBlender::~PoseBlender()
+{
+    internal::deleteObject(m_context);
+}
+
+int PoseBlender::addLayer(const PoseEvaluator *evaluator, LayerType type)
+{
+    return evaluator ? m_context->addLayer(new Layer(evaluator, 0, type)) : -1;
+}
+
+int PoseBlender::addLayer(const PoseCache *cache, LayerType type)
+{
+    return cache ? m_context->addLayer(new Layer(0, cache, type)) : -1;
+}
+
+void PoseBlender::removeAllLayers()
+{
+    m_context->resetBlendedValues();
+    m_context->crossfades.clear();
+    m_context->layers.releaseAll();
+}
+
+void PoseBlender::setLayerBoneMask(int index, const Array<int> &boneIndices)
+{
+    if (Layer *layer = m_context->findLayer(index)) {
+        layer->setBoneMask(boneIndices, m_context->nbones);
+    }
+}
+
+void PoseBlender::setLayerWeight(int index, const Scalar &value)
+{
+    if (Layer *layer = m_context->findLayer(index)) {
+        layer->weight = value;
+    }
+}
+
+void PoseBlender::setLayerTimeIndex(int index, const IKeyframe::TimeIndex &value)
+{
+    if (Layer *layer = m_context->findLayer(index)) {
+        layer->timeIndex = value;
+    }
+}
+
+Scalar PoseBlender::layerWeight(int index) const
+{
+    const Layer *layer = m_context->findLayer(index);
+    return layer ? layer->weight : 0;
+}
+
+IKeyframe::TimeIndex PoseBlender::layerTimeIndex(int index) const
+{
+    const Layer *layer = m_context->findLayer(index);
+    return layer ? layer->timeIndex : 0;
+}
+
+PoseBlender::LayerType PoseBlender::layerType(int index) const
+{
+    const Layer *layer = m_context->findLayer(index);
+    return layer ? layer->type : kMaxLayerType;
+}
+
+int PoseBlender::countLayers() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->layers.count();
+}
+
+void PoseBlender::crossfade(int fromIndex, int toIndex, const IKeyframe::TimeIndex &duration)
+{
+    Crossfade fade;
+    fade.fromIndex = fromIndex;
+    fade.toIndex = toIndex;
+    fade.duration = duration;
+    fade.elapsed = 0;
+    m_context->crossfades.append(fade);
+    m_context->advanceCrossfades(0);
+}
+
+void PoseBlender::seek(const IKeyframe::TimeIndex &timeIndex)
+{
+    const PointerArray<Layer> &layers = m_context->layers;
+    const int nlayers = layers.count();
+    for (int i = 0; i < nlayers; i++) {
+        layers[i]->timeIndex = timeIndex;
+    }
+}
+
+void PoseBlender::advance(const IKeyframe::TimeIndex &delta)
+{
+    const PointerArray<Layer> &layers = m_context->layers;
+    const int nlayers = layers.count();
+    for (int i = 0; i < nlayers; i++) {
+        layers[i]->timeIndex += delta;
+    }
+    m_context->advanceCrossfades(delta);
+}
+
+void PoseBlender::evaluate()
+{
+    m_context->evaluate();
+}
+
+void PoseBlender::apply()
+{
+    m_context->apply();
+}
+
+const PoseEvaluator::Pose &PoseBlender::pose() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->pose;
+}
+
+int PoseBlender::countBlendedBones() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->blendedBones.count();
+}
+
+int PoseBlender::countBlendedMorphs() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->blendedMorphs.count();
+}
+
+IModel *PoseBlender::parentModelRef() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->modelRef;
+}
+
+} /* namespace vpvl2 */
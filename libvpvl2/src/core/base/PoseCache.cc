@@ -0,0 +1,711 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/util.h"
+
+namespace
+{
+
+using namespace vpvl2;
+
+#pragma pack(push, 1)
+
+struct Header {
+    uint8 signature[8];
+    float32 interval;
+    int32 nsamples;
+    int32 nbones;
+    int32 nmorphs;
+    int32 nboneTracks;
+    int32 nmorphTracks;
+};
+
+struct BoneTrackHeader {
+    int32 index;
+    uint8 translationType;
+    uint8 rotationType;
+};
+
+struct MorphTrackHeader {
+    int32 index;
+    uint8 weightType;
+};
+
+struct QuantizedQuaternion {
+    int16 x;
+    int16 y;
+    int16 z;
+    int16 w;
+};
+
+#pragma pack(pop)
+
+static const uint8 kSignature[] = "vpvl2pc";
+static const int kBakeChunkSize = 256;
+static const Scalar kQuantizeScale = 32767.0f;
+static const Scalar kTranslationEpsilon = 0.0001f;
+static const Scalar kRotationEpsilon = 0.00001f;
+static const Scalar kWeightEpsilon = 0.0001f;
+
+static inline int16 quantizeComponent(const Scalar &value)
+{
+    return int16(value * kQuantizeScale + (value >= 0 ? 0.5f : -0.5f));
+}
+
+static inline void quantizeQuaternion(const Quaternion &value, QuantizedQuaternion &q)
+{
+    Quaternion v(value.normalized());
+    /* q and -q are the same rotation, keep w positive to make constant channels detectable */
+    if (v.w() < 0) {
+        v = -v;
+    }
+    q.x = quantizeComponent(v.x());
+    q.y = quantizeComponent(v.y());
+    q.z = quantizeComponent(v.z());
+    q.w = quantizeComponent(v.w());
+}
+
+static inline Quaternion dequantizeQuaternion(const QuantizedQuaternion &q)
+{
+    Quaternion v(q.x / kQuantizeScale, q.y / kQuantizeScale, q.z / kQuantizeScale, q.w / kQuantizeScale);
+    return v.normalize();
+}
+
+static inline bool equalsQuaternion(const QuantizedQuaternion &left, const QuantizedQuaternion &right)
+{
+    return left.x == right.x && left.y == right.y && left.z == right.z && left.w == right.w;
+}
+
+static inline Quaternion nlerp(const Quaternion &from, const Quaternion &to, const Scalar &t)
+{
+    const Quaternion &target = from.dot(to) < 0 ? -to : to;
+    Quaternion value(from * (1 - t) + target * t);
+    return value.normalize();
+}
+
+static inline int countValues(PoseCache::ChannelType type, int nsamples)
+{
+    switch (type) {
+    case PoseCache::kConstantChannel:
+        return 1;
+    case PoseCache::kLinearChannel:
+        return 2;
+    default:
+        return nsamples;
+    }
+}
+
+struct SamplePosition {
+    SamplePosition(const IKeyframe::TimeIndex &timeIndex, const IKeyframe::TimeIndex &interval, int nsamples)
+        : from(0),
+          to(0),
+          weight(0),
+          linearWeight(0)
+    {
+        if (nsamples > 1 && interval > 0) {
+            const Scalar &position = btClamped(Scalar(timeIndex / interval), Scalar(0), Scalar(nsamples - 1));
+            from = int(position);
+            to = btMin(from + 1, nsamples - 1);
+            weight = position - from;
+            linearWeight = position / (nsamples - 1);
+        }
+    }
+    int from;
+    int to;
+    Scalar weight;
+    Scalar linearWeight;
+};
+
+struct BoneTrack {
+    BoneTrack(int index)
+        : index(index),
+          translationType(PoseCache::kSampledChannel),
+          rotationType(PoseCache::kSampledChannel)
+    {
+    }
+    ~BoneTrack() {
+        index = -1;
+    }
+
+    void compress(int nsamples) {
+        const Vector3 &firstTranslation = translations[0], &lastTranslation = translations[nsamples - 1];
+        bool constant = true, linear = nsamples > 2;
+        for (int i = 1; i < nsamples && (constant || linear); i++) {
+            const Vector3 &value = translations[i];
+            constant = constant && (value - firstTranslation).length2() < kTranslationEpsilon * kTranslationEpsilon;
+            const Vector3 &expected = firstTranslation.lerp(lastTranslation, Scalar(i) / (nsamples - 1));
+            linear = linear && (value - expected).length2() < kTranslationEpsilon * kTranslationEpsilon;
+        }
+        if (constant) {
+            translationType = PoseCache::kConstantChannel;
+            translations.resize(1);
+        }
+        else if (linear) {
+            translationType = PoseCache::kLinearChannel;
+            translations[1] = translations[nsamples - 1];
+            translations.resize(2);
+        }
+        const QuantizedQuaternion &firstRotation = rotations[0], &lastRotation = rotations[nsamples - 1];
+        const Quaternion &from = dequantizeQuaternion(firstRotation), &to = dequantizeQuaternion(lastRotation);
+        constant = true;
+        linear = nsamples > 2;
+        for (int i = 1; i < nsamples && (constant || linear); i++) {
+            const QuantizedQuaternion &value = rotations[i];
+            constant = constant && equalsQuaternion(value, firstRotation);
+            const Quaternion &expected = nlerp(from, to, Scalar(i) / (nsamples - 1));
+            linear = linear && btFabs(expected.dot(dequantizeQuaternion(value))) >= 1 - kRotationEpsilon;
+        }
+        if (constant) {
+            rotationType = PoseCache::kConstantChannel;
+            rotations.resize(1);
+        }
+        else if (linear) {
+            rotationType = PoseCache::kLinearChannel;
+            rotations[1] = rotations[nsamples - 1];
+            rotations.resize(2);
+        }
+    }
+    void evaluate(const SamplePosition &position, PoseEvaluator::Pose &pose) const {
+        Vector3 &translation = pose.localTranslations[index];
+        switch (translationType) {
+        case PoseCache::kConstantChannel:
+            translation = translations[0];
+            break;
+        case PoseCache::kLinearChannel:
+            translation = translations[0].lerp(translations[1], position.linearWeight);
+            break;
+        default:
+            translation = translations[position.from].lerp(translations[position.to], position.weight);
+            break;
+        }
+        Quaternion &rotation = pose.localOrientations[index];
+        switch (rotationType) {
+        case PoseCache::kConstantChannel:
+            rotation = dequantizeQuaternion(rotations[0]);
+            break;
+        case PoseCache::kLinearChannel:
+            rotation = nlerp(dequantizeQuaternion(rotations[0]), dequantizeQuaternion(rotations[1]), position.linearWeight);
+            break;
+        default:
+            rotation = nlerp(dequantizeQuaternion(rotations[position.from]), dequantizeQuaternion(rotations[position.to]), position.weight);
+            break;
+        }
+    }
+
+    int index;
+    PoseCache::ChannelType translationType;
+    PoseCache::ChannelType rotationType;
+    Array<Vector3> translations;
+    Array<QuantizedQuaternion> rotations;
+};
+
+struct MorphTrack {
+    MorphTrack(int index)
+        : index(index),
+          weightType(PoseCache::kSampledChannel)
+    {
+    }
+    ~MorphTrack() {
+        index = -1;
+    }
+
+    void compress(int nsamples) {
+        const float32 &first = weights[0], &last = weights[nsamples - 1];
+        bool constant = true, linear = nsamples > 2;
+        for (int i = 1; i < nsamples && (constant || linear); i++) {
+            const float32 &value = weights[i];
+            constant = constant && btFabs(value - first) < kWeightEpsilon;
+            const Scalar &expected = first + (last - first) * (Scalar(i) / (nsamples - 1));
+            linear = linear && btFabs(value - expected) < kWeightEpsilon;
+        }
+        if (constant) {
+            weightType = PoseCache::kConstantChannel;
+            weights.resize(1);
+        }
+        else if (linear) {
+            weightType = PoseCache::kLinearChannel;
+            weights[1] = weights[nsamples - 1];
+            weights.resize(2);
+        }
+    }
+    void evaluate(const SamplePosition &position, PoseEvaluator::Pose &pose) const {
+        IMorph::WeightPrecision &weight = pose.morphWeights[index];
+        switch (weightType) {
+        case PoseCache::kConstantChannel:
+            weight = weights[0];
+            break;
+        case PoseCache::kLinearChannel:
+            weight = weights[0] + (weights[1] - weights[0]) * position.linearWeight;
+            break;
+        default:
+            weight = weights[position.from] + (weights[position.to] - weights[position.from]) * position.weight;
+            break;
+        }
+    }
+
+    int index;
+    PoseCache::ChannelType weightType;
+    Array<float32> weights;
+};
+
+}
+
+namespace vpvl2
+{
+
+struct PoseCache::PrivateContext {
+    PrivateContext()
+        : interval(0),
+          nsamples(0),
+          nbones(0),
+          nmorphs(0)
+    {
+    }
+    ~PrivateContext() {
+        release();
+    }
+
+    void release() {
+        boneTracks.releaseAll();
+        morphTracks.releaseAll();
+        interval = 0;
+        nsamples = nbones = nmorphs = 0;
+    }
+    void bake(const PoseEvaluator *evaluator, const IKeyframe::TimeIndex &value) {
+        release();
+        const IModel *modelRef = evaluator ? evaluator->parentModelRef() : 0;
+        const IMotion *motionRef = evaluator ? evaluator->motionRef() : 0;
+        if (!modelRef || !motionRef || value <= 0) {
+            return;
+        }
+        Array<IBone *> bones;
+        Array<IMorph *> morphs;
+        Array<int> boneIndices, morphIndices;
+        modelRef->getBoneRefs(bones);
+        modelRef->getMorphRefs(morphs);
+        evaluator->getBoneIndices(boneIndices);
+        evaluator->getMorphIndices(morphIndices);
+        interval = value;
+        nbones = bones.count();
+        nmorphs = morphs.count();
+        nsamples = int(btCeil(Scalar(motionRef->duration() / interval))) + 1;
+        const int nboneTracks = boneIndices.count(), nmorphTracks = morphIndices.count();
+        for (int i = 0; i < nboneTracks; i++) {
+            BoneTrack *track = boneTracks.append(new BoneTrack(boneIndices[i]));
+            track->translations.resize(nsamples);
+            track->rotations.resize(nsamples);
+        }
+        for (int i = 0; i < nmorphTracks; i++) {
+            MorphTrack *track = morphTracks.append(new MorphTrack(morphIndices[i]));
+            track->weights.resize(nsamples);
+        }
+        PointerArray<PoseEvaluator::Pose> poses;
+        Array<PoseEvaluator::Pose *> chunkPoses;
+        Array<IKeyframe::TimeIndex> timeIndices;
+        const int nposes = btMin(nsamples, kBakeChunkSize);
+        for (int i = 0; i < nposes; i++) {
+            evaluator->allocate(*poses.append(new PoseEvaluator::Pose()));
+        }
+        for (int offset = 0; offset < nsamples; offset += kBakeChunkSize) {
+            const int nchunks = btMin(nsamples - offset, kBakeChunkSize);
+            timeIndices.clear();
+            chunkPoses.clear();
+            for (int i = 0; i < nchunks; i++) {
+                timeIndices.append((offset + i) * interval);
+                chunkPoses.append(poses[i]);
+            }
+            evaluator->evaluateAll(timeIndices, chunkPoses, true);
+            for (int i = 0; i < nchunks; i++) {
+                const PoseEvaluator::Pose *pose = chunkPoses[i];
+                const int sampleIndex = offset + i;
+                for (int j = 0; j < nboneTracks; j++) {
+                    BoneTrack *track = boneTracks[j];
+                    track->translations[sampleIndex] = pose->localTranslations[track->index];
+                    quantizeQuaternion(pose->localOrientations[track->index], track->rotations[sampleIndex]);
+                }
+                for (int j = 0; j < nmorphTracks; j++) {
+                    MorphTrack *track = morphTracks[j];
+                    track->weights[sampleIndex] = float32(pose->morphWeights[track->index]);
+                }
+            }
+        }
+        poses.releaseAll();
+        for (int i = 0; i < nboneTracks; i++) {
+            boneTracks[i]->compress(nsamples);
+        }
+        for (int i = 0; i < nmorphTracks; i++) {
+            morphTracks[i]->compress(nsamples);
+        }
+        VPVL2_VLOG(1, "Baked " << nsamples << " samples of " << nboneTracks << " bones and " << nmorphTracks << " morphs"
+                   << " constant=" << countChannels(kConstantChannel) << " linear=" << countChannels(kLinearChannel)
+                   << " sampled=" << countChannels(kSampledChannel));
+    }
+    bool load(const uint8 *data, vsize size) {
+        release();
+        Header header;
+        uint8 *ptr = const_cast<uint8 *>(data);
+        vsize rest = size;
+        if (!data || !internal::getTyped(ptr, rest, header)) {
+            VPVL2_LOG(WARNING, "Data size is too small to read the header of the pose cache: size=" << size);
+            return false;
+        }
+        if (internal::memcmp(header.signature, kSignature, sizeof(header.signature)) != 0) {
+            VPVL2_LOG(WARNING, "Invalid signature of the pose cache detected");
+            return false;
+        }
+        if (header.interval <= 0 || header.nsamples <= 0 || header.nbones < 0 || header.nmorphs < 0
+                || header.nboneTracks < 0 || header.nmorphTracks < 0) {
+            VPVL2_LOG(WARNING, "Invalid header of the pose cache detected: interval=" << header.interval << " nsamples=" << header.nsamples);
+            return false;
+        }
+        for (int i = 0; i < header.nboneTracks; i++) {
+            BoneTrackHeader trackHeader;
+            if (!internal::getTyped(ptr, rest, trackHeader) || !internal::checkBound(trackHeader.index, 0, header.nbones)
+                    || trackHeader.translationType >= kMaxChannelType || trackHeader.rotationType >= kMaxChannelType) {
+                VPVL2_LOG(WARNING, "Invalid bone track of the pose cache detected: index=" << i);
+                release();
+                return false;
+            }
+            BoneTrack *track = boneTracks.append(new BoneTrack(trackHeader.index));
+            track->translationType = static_cast<ChannelType>(trackHeader.translationType);
+            track->rotationType = static_cast<ChannelType>(trackHeader.rotationType);
+            const int ntranslations = countValues(track->translationType, header.nsamples),
+                    nrotations = countValues(track->rotationType, header.nsamples);
+            uint8 *translationPtr = ptr;
+            if (!internal::validateSize(ptr, sizeof(float32) * 3, ntranslations, rest)) {
+                VPVL2_LOG(WARNING, "Invalid translations of the pose cache detected: index=" << i);
+                release();
+                return false;
+            }
+            track->translations.resize(ntranslations);
+            for (int j = 0; j < ntranslations; j++) {
+                float32 values[3];
+                internal::copyBytes(reinterpret_cast<uint8 *>(values), translationPtr + sizeof(values) * j, sizeof(values));
+                internal::setPositionRaw(values, track->translations[j]);
+            }
+            uint8 *rotationPtr = ptr;
+            if (!internal::validateSize(ptr, sizeof(QuantizedQuaternion), nrotations, rest)) {
+                VPVL2_LOG(WARNING, "Invalid rotations of the pose cache detected: index=" << i);
+                release();
+                return false;
+            }
+            track->rotations.resize(nrotations);
+            for (int j = 0; j < nrotations; j++) {
+                internal::getData(rotationPtr + sizeof(QuantizedQuaternion) * j, track->rotations[j]);
+            }
+        }
+        for (int i = 0; i < header.nmorphTracks; i++) {
+            MorphTrackHeader trackHeader;
+            if (!internal::getTyped(ptr, rest, trackHeader) || !internal::checkBound(trackHeader.index, 0, header.nmorphs)
+                    || trackHeader.weightType >= kMaxChannelType) {
+                VPVL2_LOG(WARNING, "Invalid morph track of the pose cache detected: index=" << i);
+                release();
+                return false;
+            }
+            MorphTrack *track = morphTracks.append(new MorphTrack(trackHeader.index));
+            track->weightType = static_cast<ChannelType>(trackHeader.weightType);
+            const int nweights = countValues(track->weightType, header.nsamples);
+            uint8 *weightPtr = ptr;
+            if (!internal::validateSize(ptr, sizeof(float32), nweights, rest)) {
+                VPVL2_LOG(WARNING, "Invalid weights of the pose cache detected: index=" << i);
+                release();
+                return false;
+            }
+            track->weights.resize(nweights);
+            for (int j = 0; j < nweights; j++) {
+                internal::getData(weightPtr + sizeof(float32) * j, track->weights[j]);
+            }
+        }
+        interval = header.interval;
+        nsamples = header.nsamples;
+        nbones = header.nbones;
+        nmorphs = header.nmorphs;
+        return true;
+    }
+    void save(uint8 *data) const {
+        Header header;
+        internal::copyBytes(header.signature, kSignature, sizeof(header.signature));
+        header.interval = float32(interval);
+        header.nsamples = nsamples;
+        header.nbones = nbones;
+        header.nmorphs = nmorphs;
+        header.nboneTracks = boneTracks.count();
+        header.nmorphTracks = morphTracks.count();
+        internal::writeBytes(&header, sizeof(header), data);
+        for (int i = 0; i < header.nboneTracks; i++) {
+            const BoneTrack *track = boneTracks[i];
+            BoneTrackHeader trackHeader;
+            trackHeader.index = track->index;
+            trackHeader.translationType = uint8(track->translationType);
+            trackHeader.rotationType = uint8(track->rotationType);
+            internal::writeBytes(&trackHeader, sizeof(trackHeader), data);
+            const int ntranslations = track->translations.count(), nrotations = track->rotations.count();
+            for (int j = 0; j < ntranslations; j++) {
+                float32 values[3];
+                internal::getPositionRaw(track->translations[j], values);
+                internal::writeBytes(values, sizeof(values), data);
+            }
+            if (nrotations > 0) {
+                internal::writeBytes(&track->rotations[0], sizeof(QuantizedQuaternion) * nrotations, data);
+            }
+        }
+        for (int i = 0; i < header.nmorphTracks; i++) {
+            const MorphTrack *track = morphTracks[i];
+            MorphTrackHeader trackHeader;
+            trackHeader.index = track->index;
+            trackHeader.weightType = uint8(track->weightType);
+            internal::writeBytes(&trackHeader, sizeof(trackHeader), data);
+            const int nweights = track->weights.count();
+            if (nweights > 0) {
+                internal::writeBytes(&track->weights[0], sizeof(float32) * nweights, data);
+            }
+        }
+    }
+    vsize estimateSize() const {
+        vsize size = sizeof(Header);
+        const int nboneTracks = boneTracks.count();
+        for (int i = 0; i < nboneTracks; i++) {
+            const BoneTrack *track = boneTracks[i];
+            size += sizeof(BoneTrackHeader);
+            size += sizeof(float32) * 3 * track->translations.count();
+            size += sizeof(QuantizedQuaternion) * track->rotations.count();
+        }
+        const int nmorphTracks = morphTracks.count();
+        for (int i = 0; i < nmorphTracks; i++) {
+            const MorphTrack *track = morphTracks[i];
+            size += sizeof(MorphTrackHeader);
+            size += sizeof(float32) * track->weights.count();
+        }
+        return size;
+    }
+    int countChannels(ChannelType value) const {
+        int nchannels = 0;
+        const int nboneTracks = boneTracks.count();
+        for (int i = 0; i < nboneTracks; i++) {
+            const BoneTrack *track = boneTracks[i];
+            nchannels += (track->translationType == value ? 1 : 0) + (track->rotationType == value ? 1 : 0);
+        }
+        const int nmorphTracks = morphTracks.count();
+        for (int i = 0; i < nmorphTracks; i++) {
+            nchannels += morphTracks[i]->weightType == value ? 1 : 0;
+        }
+        return nchannels;
+    }
+
+    PointerArray<BoneTrack> boneTracks;
+    PointerArray<MorphTrack> morphTracks;
+    IKeyframe::TimeIndex interval;
+    int nsamples;
+    int nbones;
+    int nmorphs;
+};
+
+PoseCache::PoseCache()
+    : m_context(new PrivateContext())
+{
+}
+
+PoseCache::~PoseCache()
+{
+    internal::deleteObject(m_context);
+}
+
+void PoseCache::bake(const PoseEvaluator *evaluator, const IKeyframe::TimeIndex &interval)
+{
+    m_context->bake(evaluator, interval);
+}
+
+void PoseCache::allocate(PoseEvaluator::Pose &pose) const
+{
+    const int nbones = m_context->nbones, nmorphs = m_context->nmorphs;
+    pose.localTranslations.resize(nbones);
+    pose.localOrientations.resize(nbones);
+    for (int i = 0; i < nbones; i++) {
+        pose.localTranslations[i].setZero();
+        pose.localOrientations[i].setValue(0, 0, 0, 1);
+    }
+    pose.morphWeights.resize(nmorphs);
+    for (int i = 0; i < nmorphs; i++) {
+        pose.morphWeights[i] = 0;
+    }
+    pose.timeIndex = 0;
+}
+
+void PoseCache::evaluate(const IKeyframe::TimeIndex &timeIndex, PoseEvaluator::Pose &pose) const
+{
+    const SamplePosition position(timeIndex, m_context->interval, m_context->nsamples);
+    const PointerArray<BoneTrack> &boneTracks = m_context->boneTracks;
+    const int nboneTracks = boneTracks.count(), nbones = pose.localTranslations.count();
+    for (int i = 0; i < nboneTracks; i++) {
+        const BoneTrack *track = boneTracks[i];
+        if (track->index < nbones) {
+            track->evaluate(position, pose);
+        }
+    }
+    const PointerArray<MorphTrack> &morphTracks = m_context->morphTracks;
+    const int nmorphTracks = morphTracks.count(), nmorphs = pose.morphWeights.count();
+    for (int i = 0; i < nmorphTracks; i++) {
+        const MorphTrack *track = morphTracks[i];
+        if (track->index < nmorphs) {
+            track->evaluate(position, pose);
+        }
+    }
+    pose.timeIndex = timeIndex;
+}
+
+void PoseCache::evaluate(const IKeyframe::TimeIndex &timeIndex, const Array<int> &boneTrackIndices, PoseEvaluator::Pose &pose) const
+{
+    const SamplePosition position(timeIndex, m_context->interval, m_context->nsamples);
+    const PointerArray<BoneTrack> &boneTracks = m_context->boneTracks;
+    const int nindices = boneTrackIndices.count(), nboneTracks = boneTracks.count(), nbones = pose.localTranslations.count();
+    for (int i = 0; i < nindices; i++) {
+        const int index = boneTrackIndices[i];
+        if (internal::checkBound(index, 0, nboneTracks)) {
+            const BoneTrack *track = boneTracks[index];
+            if (track->index < nbones) {
+                track->evaluate(position, pose);
+            }
+        }
+    }
+    const PointerArray<MorphTrack> &morphTracks = m_context->morphTracks;
+    const int nmorphTracks = morphTracks.count(), nmorphs = pose.morphWeights.count();
+    for (int i = 0; i < nmorphTracks; i++) {
+        const MorphTrack *track = morphTracks[i];
+        if (track->index < nmorphs) {
+            track->evaluate(position, pose);
+        }
+    }
+    pose.timeIndex = timeIndex;
+}
+
+void PoseCache::bind(const PoseEvaluator::Pose &pose, IModel *model) const
+{
+    if (!model) {
+        return;
+    }
+    const PointerArray<BoneTrack> &boneTracks = m_context->boneTracks;
+    const int nboneTracks = boneTracks.count(), nbones = pose.localTranslations.count();
+    for (int i = 0; i < nboneTracks; i++) {
+        const int boneIndex = boneTracks[i]->index;
+        if (boneIndex < nbones) {
+            if (IBone *bone = model->findBoneRefAt(boneIndex)) {
+                bone->setLocalTranslation(pose.localTranslations[boneIndex]);
+                bone->setLocalOrientation(pose.localOrientations[boneIndex]);
+            }
+        }
+    }
+    const PointerArray<MorphTrack> &morphTracks = m_context->morphTracks;
+    const int nmorphTracks = morphTracks.count(), nmorphs = pose.morphWeights.count();
+    for (int i = 0; i < nmorphTracks; i++) {
+        const int morphIndex = morphTracks[i]->index;
+        if (morphIndex < nmorphs) {
+            if (IMorph *morph = model->findMorphRefAt(morphIndex)) {
+                morph->setWeight(pose.morphWeights[morphIndex]);
+            }
+        }
+    }
+}
+
+bool PoseCache::load(const uint8 *data, vsize size)
+{
+    return m_context->load(data, size);
+}
+
+void PoseCache::save(uint8 *data) const
+{
+    m_context->save(data);
+}
+
+vsize PoseCache::estimateSize() const
+{
+    return m_context->estimateSize();
+}
+
+void PoseCache::getBoneIndices(Array<int> &value) const
+{
+    const PointerArray<BoneTrack> &tracks = m_context->boneTracks;
+    const int ntracks = tracks.count();
+    value.clear();
+    value.reserve(ntracks);
+    for (int i = 0; i < ntracks; i++) {
+        value.append(tracks[i]->index);
+    }
+}
+
+void PoseCache::getMorphIndices(Array<int> &value) const
+{
+    const PointerArray<MorphTrack> &tracks = m_context->morphTracks;
+    const int ntracks = tracks.count();
+    value.clear();
+    value.reserve(ntracks);
+    for (int i = 0; i < ntracks; i++) {
+        value.append(tracks[i]->index);
+    }
+}
+
+int PoseCache::countChannels(ChannelType value) const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->countChannels(value);
+}
+
+int PoseCache::countSamples() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->nsamples;
+}
+
+int PoseCache::countBoneTracks() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->boneTracks.count();
+}
+
+int PoseCache::countMorphTracks() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->morphTracks.count();
+}
+
+IKeyframe::TimeIndex PoseCache::interval() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->interval;
+}
+
+IKeyframe::TimeIndex PoseCache::duration() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->nsamples > 0 ? (m_context->nsamples - 1) * m_context->interval : 0;
+}
+
+} /* namespace vpvl2 */
@@ -0,0 +1,510 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/util.h"
+#include "vpvl2/internal/Keyframe.h"
+#include "vpvl2/internal/MotionHelper.h"
+
+#ifdef VPVL2_LINK_INTEL_TBB
+#include <tbb/tbb.h>
+#endif
+
+namespace
+{
+
+using namespace vpvl2;
+
+/* same resolution as vmd::BoneKeyframe::kTableSize */
+static const int kInterpolationTableSize = 64;
+
+struct BoneFrame {
+    IKeyframe::TimeIndex timeIndex;
+    Vector3 translation;
+    Quaternion orientation;
+    internal::InterpolationTable tables[IBoneKeyframe::kMaxBoneInterpolationType];
+};
+
+struct BoneTrack {
+    BoneTrack(int index)
+        : boneIndex(index)
+    {
+    }
+    ~BoneTrack() {
+        frames.releaseAll();
+    }
+    bool isNull() const {
+        if (frames.count() == 1) {
+            const BoneFrame *frame = frames[0];
+            return frame->translation == kZeroV3 && frame->orientation == Quaternion::getIdentity();
+        }
+        return false;
+    }
+    PointerArray<BoneFrame> frames;
+    const int boneIndex;
+};
+
+struct MorphFrame {
+    IKeyframe::TimeIndex timeIndex;
+    IMorph::WeightPrecision weight;
+};
+
+struct MorphTrack {
+    MorphTrack(int index)
+        : morphIndex(index)
+    {
+    }
+    ~MorphTrack() {
+        frames.releaseAll();
+    }
+    bool isNull() const {
+        return frames.count() == 1 && frames[0]->weight == 0;
+    }
+    PointerArray<MorphFrame> frames;
+    const int morphIndex;
+};
+
+struct FrameTimeIndexPredication {
+    template<typename T>
+    bool operator()(const T *left, const T *right) const {
+        return left->timeIndex < right->timeIndex;
+    }
+};
+
+/* returns the same keyframe pair as internal::MotionHelper::findKeyframeIndices without a cached index */
+template<typename T>
+static inline void findFrameIndices(const IKeyframe::TimeIndex &timeIndex, const PointerArray<T> &frames, int &fromIndex, int &toIndex)
+{
+    int min = 0, max = frames.count() - 1;
+    while (min < max) {
+        int mid = (min + max) / 2;
+        if (frames[mid]->timeIndex < timeIndex) {
+            min = mid + 1;
+        }
+        else {
+            max = mid;
+        }
+    }
+    toIndex = min;
+    fromIndex = toIndex <= 1 ? 0 : toIndex - 1;
+}
+
+static inline IKeyframe::SmoothPrecision interpolateWeight(const internal::InterpolationTable &table,
+                                                           const IKeyframe::SmoothPrecision &weight)
+{
+    return table.linear ? weight : internal::MotionHelper::calculateInterpolatedWeight(table, weight);
+}
+
+static void evaluateBoneTrack(const IKeyframe::TimeIndex &timeIndex, const BoneTrack *track, PoseEvaluator::Pose &pose)
+{
+    const PointerArray<BoneFrame> &frames = track->frames;
+    const IKeyframe::TimeIndex &currentTimeIndex = btMin(timeIndex, frames[frames.count() - 1]->timeIndex);
+    int fromIndex, toIndex;
+    findFrameIndices(currentTimeIndex, frames, fromIndex, toIndex);
+    const BoneFrame *frameFrom = frames[fromIndex], *frameTo = frames[toIndex];
+    const IKeyframe::TimeIndex &timeIndexFrom = frameFrom->timeIndex, &timeIndexTo = frameTo->timeIndex;
+    Vector3 &translation = pose.localTranslations[track->boneIndex];
+    Quaternion &orientation = pose.localOrientations[track->boneIndex];
+    if (timeIndexFrom != timeIndexTo && currentTimeIndex > timeIndexFrom) {
+        if (currentTimeIndex >= timeIndexTo) {
+            translation = frameTo->translation;
+            orientation = frameTo->orientation;
+        }
+        else {
+            const IKeyframe::SmoothPrecision &w = internal::MotionHelper::calculateWeight(currentTimeIndex, timeIndexFrom, timeIndexTo);
+            const Vector3 &translationFrom = frameFrom->translation, &translationTo = frameTo->translation;
+            IKeyframe::SmoothPrecision x = 0, y = 0, z = 0;
+            internal::MotionHelper::interpolate(frameTo->tables[IBoneKeyframe::kBonePositionX], translationFrom, translationTo, w, 0, x);
+            internal::MotionHelper::interpolate(frameTo->tables[IBoneKeyframe::kBonePositionY], translationFrom, translationTo, w, 1, y);
+            internal::MotionHelper::interpolate(frameTo->tables[IBoneKeyframe::kBonePositionZ], translationFrom, translationTo, w, 2, z);
+            translation.setValue(Scalar(x), Scalar(y), Scalar(z));
+            const IKeyframe::SmoothPrecision &w2 = interpolateWeight(frameTo->tables[IBoneKeyframe::kBoneRotation], w);
+            orientation = frameFrom->orientation.slerp(frameTo->orientation, Scalar(w2));
+        }
+    }
+    else {
+        translation = frameFrom->translation;
+        orientation = frameFrom->orientation;
+    }
+}
+
+static void evaluateMorphTrack(const IKeyframe::TimeIndex &timeIndex, const MorphTrack *track, PoseEvaluator::Pose &pose)
+{
+    const PointerArray<MorphFrame> &frames = track->frames;
+    const IKeyframe::TimeIndex &currentTimeIndex = btMin(timeIndex, frames[frames.count() - 1]->timeIndex);
+    int fromIndex, toIndex;
+    findFrameIndices(currentTimeIndex, frames, fromIndex, toIndex);
+    const MorphFrame *frameFrom = frames[fromIndex], *frameTo = frames[toIndex];
+    const IKeyframe::TimeIndex &timeIndexFrom = frameFrom->timeIndex, &timeIndexTo = frameTo->timeIndex;
+    IMorph::WeightPrecision &weight = pose.morphWeights[track->morphIndex];
+    if (timeIndexFrom != timeIndexTo && currentTimeIndex > timeIndexFrom) {
+        if (currentTimeIndex >= timeIndexTo) {
+            weight = frameTo->weight;
+        }
+        else {
+            const IKeyframe::SmoothPrecision &w = internal::MotionHelper::calculateWeight(currentTimeIndex, timeIndexFrom, timeIndexTo);
+            weight = IMorph::WeightPrecision(internal::MotionHelper::lerp(frameFrom->weight, frameTo->weight, w));
+        }
+    }
+    else {
+        weight = frameFrom->weight;
+    }
+}
+
+}
+
+namespace vpvl2
+{
+
+struct PoseEvaluator::PrivateContext {
+    PrivateContext(const IModel *modelRef, const IMotion *motionRef, const IKeyframe::LayerIndex &layerIndex)
+        : modelRef(modelRef),
+          motionRef(motionRef),
+          layerIndex(layerIndex)
+    {
+    }
+    ~PrivateContext() {
+        boneTracks.releaseAll();
+        morphTracks.releaseAll();
+        modelRef = 0;
+        motionRef = 0;
+    }
+
+    void buildBoneTracks() {
+        Hash<HashInt, BoneTrack *> index2tracks;
+        const int nkeyframes = motionRef->countKeyframes(IKeyframe::kBoneKeyframe);
+        for (int i = 0; i < nkeyframes; i++) {
+            const IBoneKeyframe *keyframe = motionRef->findBoneKeyframeRefAt(i);
+            if (!keyframe || keyframe->layerIndex() != layerIndex) {
+                continue;
+            }
+            const IBone *bone = modelRef->findBoneRef(keyframe->name());
+            if (!bone) {
+                continue;
+            }
+            const int boneIndex = bone->index();
+            BoneTrack *track = 0;
+            if (BoneTrack *const *trackPtr = index2tracks.find(boneIndex)) {
+                track = *trackPtr;
+            }
+            else {
+                track = boneTracks.append(new BoneTrack(boneIndex));
+                index2tracks.insert(boneIndex, track);
+            }
+            BoneFrame *frame = track->frames.append(new BoneFrame());
+            frame->timeIndex = keyframe->timeIndex();
+            frame->translation = keyframe->localTranslation();
+            frame->orientation = keyframe->localOrientation();
+            for (int j = 0; j < IBoneKeyframe::kMaxBoneInterpolationType; j++) {
+                QuadWord parameter;
+                keyframe->getInterpolationParameter(static_cast<IBoneKeyframe::InterpolationType>(j), parameter);
+                frame->tables[j].build(parameter, kInterpolationTableSize);
+            }
+        }
+        const int ntracks = boneTracks.count();
+        for (int i = 0; i < ntracks; i++) {
+            BoneTrack *track = boneTracks[i];
+            track->frames.sort(FrameTimeIndexPredication());
+        }
+    }
+    void buildMorphTracks() {
+        Hash<HashInt, MorphTrack *> index2tracks;
+        const int nkeyframes = motionRef->countKeyframes(IKeyframe::kMorphKeyframe);
+        for (int i = 0; i < nkeyframes; i++) {
+            const IMorphKeyframe *keyframe = motionRef->findMorphKeyframeRefAt(i);
+            if (!keyframe || keyframe->layerIndex() != layerIndex) {
+                continue;
+            }
+            const IMorph *morph = modelRef->findMorphRef(keyframe->name());
+            if (!morph) {
+                continue;
+            }
+            const int morphIndex = morph->index();
+            MorphTrack *track = 0;
+            if (MorphTrack *const *trackPtr = index2tracks.find(morphIndex)) {
+                track = *trackPtr;
+            }
+            else {
+                track = morphTracks.append(new MorphTrack(morphIndex));
+                index2tracks.insert(morphIndex, track);
+            }
+            MorphFrame *frame = track->frames.append(new MorphFrame());
+            frame->timeIndex = keyframe->timeIndex();
+            frame->weight = keyframe->weight();
+        }
+        const int ntracks = morphTracks.count();
+        for (int i = 0; i < ntracks; i++) {
+            MorphTrack *track = morphTracks[i];
+            track->frames.sort(FrameTimeIndexPredication());
+        }
+    }
+    void rebuild() {
+        boneTracks.releaseAll();
+        morphTracks.releaseAll();
+        if (modelRef && motionRef) {
+            buildBoneTracks();
+            buildMorphTracks();
+        }
+    }
+    void evaluateBoneTrackAt(const IKeyframe::TimeIndex &timeIndex, int index, bool enableNullFrame, Pose &pose) const {
+        const BoneTrack *track = boneTracks[index];
+        if (track->boneIndex < pose.localTranslations.count() && !(enableNullFrame && track->isNull())) {
+            evaluateBoneTrack(timeIndex, track, pose);
+        }
+    }
+    void evaluate(const IKeyframe::TimeIndex &timeIndex, Pose &pose) const {
+        const bool enableNullFrame = motionRef && motionRef->isNullFrameEnabled();
+        const int nboneTracks = boneTracks.count();
+        for (int i = 0; i < nboneTracks; i++) {
+            evaluateBoneTrackAt(timeIndex, i, enableNullFrame, pose);
+        }
+        evaluateMorphTracks(timeIndex, enableNullFrame, pose);
+        pose.timeIndex = timeIndex;
+    }
+    void evaluate(const IKeyframe::TimeIndex &timeIndex, const Array<int> &boneTrackIndices, Pose &pose) const {
+        const bool enableNullFrame = motionRef && motionRef->isNullFrameEnabled();
+        const int nindices = boneTrackIndices.count(), nboneTracks = boneTracks.count();
+        for (int i = 0; i < nindices; i++) {
+            const int index = boneTrackIndices[i];
+            if (internal::checkBound(index, 0, nboneTracks)) {
+                evaluateBoneTrackAt(timeIndex, index, enableNullFrame, pose);
+            }
+        }
+        evaluateMorphTracks(timeIndex, enableNullFrame, pose);
+        pose.timeIndex = timeIndex;
+    }
+    void evaluateMorphTracks(const IKeyframe::TimeIndex &timeIndex, bool enableNullFrame, Pose &pose) const {
+        const int nmorphTracks = morphTracks.count(), nmorphs = pose.morphWeights.count();
+        for (int i = 0; i < nmorphTracks; i++) {
+            const MorphTrack *track = morphTracks[i];
+            if (track->morphIndex < nmorphs && !(enableNullFrame && track->isNull())) {
+                evaluateMorphTrack(timeIndex, track, pose);
+            }
+        }
+    }
+
+    const IModel *modelRef;
+    const IMotion *motionRef;
+    const IKeyframe::LayerIndex layerIndex;
+    PointerArray<BoneTrack> boneTracks;
+    PointerArray<MorphTrack> morphTracks;
+};
+
+class ParallelPoseEvaluationProcessor VPVL2_DECL_FINAL {
+public:
+    ParallelPoseEvaluationProcessor(const PoseEvaluator *evaluatorRef,
+                                    const Array<IKeyframe::TimeIndex> *timeIndicesRef,
+                                    const Array<PoseEvaluator::Pose *> *posesRef)
+        : m_evaluatorRef(evaluatorRef),
+          m_timeIndicesRef(timeIndicesRef),
+          m_posesRef(posesRef)
+    {
+    }
+    ~ParallelPoseEvaluationProcessor() {
+        m_evaluatorRef = 0;
+        m_timeIndicesRef = 0;
+        m_posesRef = 0;
+    }
+
+#ifdef VPVL2_LINK_INTEL_TBB
+    void operator()(const tbb::blocked_range<int> &range) const {
+        for (int i = range.begin(); i != range.end(); ++i) {
+            m_evaluatorRef->evaluate(m_timeIndicesRef->at(i), *m_posesRef->at(i));
+        }
+    }
+#endif /* VPVL2_LINK_INTEL_TBB */
+
+    void execute(bool enableParallel) const {
+        const int nposes = btMin(m_timeIndicesRef->count(), m_posesRef->count());
+#if defined(VPVL2_LINK_INTEL_TBB)
+        if (enableParallel) {
+            tbb::parallel_for(tbb::blocked_range<int>(0, nposes), *this);
+        }
+        else {
+#else
+        {
+            (void) enableParallel;
+#endif
+#ifdef VPVL2_ENABLE_OPENMP
+#pragma omp parallel for if(enableParallel)
+#endif
+            for (int i = 0; i < nposes; ++i) {
+                m_evaluatorRef->evaluate(m_timeIndicesRef->at(i), *m_posesRef->at(i));
+            }
+        }
+    }
+
+private:
+    const PoseEvaluator *m_evaluatorRef;
+    const Array<IKeyframe::TimeIndex> *m_timeIndicesRef;
+    const Array<PoseEvaluator::Pose *> *m_posesRef;
+};
+
+PoseEvaluator::PoseEvaluator(const IModel *modelRef, const IMotion *motionRef, const IKeyframe::LayerIndex &layerIndex)
+    : m_context(new PrivateContext(modelRef, motionRef, layerIndex))
+{
+    m_context->rebuild();
+}
+
+PoseEvaluator::~PoseEvaluator()
+{
+    internal::deleteObject(m_context);
+}
+
+void PoseEvaluator::reload()
+{
+    m_context->rebuild();
+}
+
+void PoseEvaluator::allocate(Pose &pose) const
+{
+    Array<IBone *> bones;
+    Array<IMorph *> morphs;
+    if (const IModel *modelRef = m_context->modelRef) {
+        modelRef->getBoneRefs(bones);
+        modelRef->getMorphRefs(morphs);
+    }
+    const int nbones = bones.count(), nmorphs = morphs.count();
+    pose.localTranslations.resize(nbones);
+    pose.localOrientations.resize(nbones);
+    for (int i = 0; i < nbones; i++) {
+        pose.localTranslations[i].setZero();
+        pose.localOrientations[i].setValue(0, 0, 0, 1);
+    }
+    pose.morphWeights.resize(nmorphs);
+    for (int i = 0; i < nmorphs; i++) {
+        pose.morphWeights[i] = 0;
+    }
+    pose.timeIndex = 0;
+}
+
+void PoseEvaluator::evaluate(const IKeyframe::TimeIndex &timeIndex, Pose &pose) const
+{
+    m_context->evaluate(timeIndex, pose);
+}
+
+void PoseEvaluator::evaluate(const IKeyframe::TimeIndex &timeIndex, const Array<int> &boneTrackIndices, Pose &pose) const
+{
+    m_context->evaluate(timeIndex, boneTrackIndices, pose);
+}
+
+void PoseEvaluator::evaluateAll(const Array<IKeyframe::TimeIndex> &timeIndices, const Array<Pose *> &poses, bool enableParallel) const
+{
+    VPVL2_DCHECK(timeIndices.count() == poses.count());
+    ParallelPoseEvaluationProcessor processor(this, &timeIndices, &poses);
+    processor.execute(enableParallel);
+}
+
+void PoseEvaluator::bind(const Pose &pose, IModel *model) const
+{
+    if (!model) {
+        return;
+    }
+    const bool enableNullFrame = m_context->motionRef && m_context->motionRef->isNullFrameEnabled();
+    const PointerArray<BoneTrack> &boneTracks = m_context->boneTracks;
+    const int nboneTracks = boneTracks.count(), nbones = pose.localTranslations.count();
+    for (int i = 0; i < nboneTracks; i++) {
+        const BoneTrack *track = boneTracks[i];
+        const int boneIndex = track->boneIndex;
+        if (boneIndex < nbones && !(enableNullFrame && track->isNull())) {
+            if (IBone *bone = model->findBoneRefAt(boneIndex)) {
+                bone->setLocalTranslation(pose.localTranslations[boneIndex]);
+                bone->setLocalOrientation(pose.localOrientations[boneIndex]);
+            }
+        }
+    }
+    const PointerArray<MorphTrack> &morphTracks = m_context->morphTracks;
+    const int nmorphTracks = morphTracks.count(), nmorphs = pose.morphWeights.count();
+    for (int i = 0; i < nmorphTracks; i++) {
+        const MorphTrack *track = morphTracks[i];
+        const int morphIndex = track->morphIndex;
+        if (morphIndex < nmorphs && !(enableNullFrame && track->isNull())) {
+            if (IMorph *morph = model->findMorphRefAt(morphIndex)) {
+                morph->setWeight(pose.morphWeights[morphIndex]);
+            }
+        }
+    }
+}
+
+int PoseEvaluator::countBoneTracks() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->boneTracks.count();
+}
+
+int PoseEvaluator::countMorphTracks() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->morphTracks.count();
+}
+
+void PoseEvaluator::getBoneIndices(Array<int> &value) const
+{
+    const PointerArray<BoneTrack> &tracks = m_context->boneTracks;
+    const int ntracks = tracks.count();
+    value.clear();
+    value.reserve(ntracks);
+    for (int i = 0; i < ntracks; i++) {
+        value.append(tracks[i]->boneIndex);
+    }
+}
+
+void PoseEvaluator::getMorphIndices(Array<int> &value) const
+{
+    const PointerArray<MorphTrack> &tracks = m_context->morphTracks;
+    const int ntracks = tracks.count();
+    value.clear();
+    value.reserve(ntracks);
+    for (int i = 0; i < ntracks; i++) {
+        value.append(tracks[i]->morphIndex);
+    }
+}
+
+const IModel *PoseEvaluator::parentModelRef() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->modelRef;
+}
+
+const IMotion *PoseEvaluator::motionRef() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->motionRef;
+}
+
+IKeyframe::LayerIndex PoseEvaluator::layerIndex() const VPVL2_DECL_NOEXCEPT
+{
+    return m_context->layerIndex;
+}
+
+} /* namespace vpvl2 */
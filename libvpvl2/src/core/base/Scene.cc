@@ -83,6 +83,7 @@
 namespace vpvl2 {
 namespace cl {
 class PMXAccelerator;
+class SceneAccelerator;
 }
 }
 #endif /* VPVL2_ENABLE_OPENCL */
@@ -395,6 +396,7 @@ struct Scene::PrivateContext VPVL2_DECL_FINAL
         : shadowMapRef(0),
           worldRef(0),
           accelerationType(Scene::kSoftwareFallback),
+          sceneAccelerator(0),
           defaultEffect(0),
           light(sceneRef),
           camera(sceneRef),
@@ -409,6 +411,10 @@ struct Scene::PrivateContext VPVL2_DECL_FINAL
         motions.releaseAll();
         engines.releaseAll();
         models.releaseAll();
+#if defined(VPVL2_ENABLE_EXTENSIONS_APPLICATIONCONTEXT) && defined(VPVL2_ENABLE_OPENCL)
+        /* accelerators of the engines must be released before the shared one */
+        internal::deleteObject(sceneAccelerator);
+#endif /* VPVL2_ENABLE_OPENCL */
         internal::deleteObject(defaultEffect);
         shadowMapRef = 0;
         worldRef = 0;
@@ -526,6 +532,7 @@ struct Scene::PrivateContext VPVL2_DECL_FINAL
             IModel *model = models[i]->value;
             model->performUpdate();
         }
+        VPVL2_PROFILE_COUNT(kUpdatedModelCounter, nmodels);
     }
     void markAllMorphsDirty() {
         Array<IMorph *> morphs;
@@ -547,6 +554,14 @@ struct Scene::PrivateContext VPVL2_DECL_FINAL
             IRenderEngine *engine = engines[i]->value;
             engine->update();
         }
+        flushSceneAccelerator();
+    }
+    void flushSceneAccelerator() {
+#if defined(VPVL2_ENABLE_EXTENSIONS_APPLICATIONCONTEXT) && defined(VPVL2_ENABLE_OPENCL)
+        if (sceneAccelerator) {
+            sceneAccelerator->flush();
+        }
+#endif /* VPVL2_ENABLE_OPENCL */
     }
     void updateCamera() {
         camera.updateTransform();
@@ -559,7 +574,11 @@ struct Scene::PrivateContext VPVL2_DECL_FINAL
         cl::PMXAccelerator *accelerator = 0;
 #if defined(VPVL2_ENABLE_EXTENSIONS_APPLICATIONCONTEXT) && defined(VPVL2_ENABLE_OPENCL)
         if (isOpenCLAcceleration()) {
-            accelerator = new cl::PMXAccelerator(sceneRef, applicationContextRef, modelRef, accelerationType);
+            /* all models share one CL context so that skinning of them can be batched */
+            if (!sceneAccelerator) {
+                sceneAccelerator = new cl::SceneAccelerator(sceneRef, applicationContextRef, accelerationType);
+            }
+            accelerator = new cl::PMXAccelerator(sceneAccelerator, modelRef);
         }
 #else
         (void) sceneRef;
@@ -624,6 +643,7 @@ struct Scene::PrivateContext VPVL2_DECL_FINAL
     IShadowMap *shadowMapRef;
     btDiscreteDynamicsWorld *worldRef;
     Scene::AccelerationType accelerationType;
+    cl::SceneAccelerator *sceneAccelerator;
 #ifdef VPVL2_ENABLE_NVIDIA_CG
     cg::EffectContext effectContextCgFX;
 #endif
@@ -945,6 +965,7 @@ void Scene::advance(const IKeyframe::TimeIndex &delta, int flags)
         m_context->markAllMorphsDirty();
     }
     if (internal::hasFlagBits(flags, kUpdateModels)) {
+        VPVL2_PROFILE_STAGE(kMotionSeekStage);
         const Array<PrivateContext::MotionPtr *> &motions = m_context->motions;
         const int nmotions = motions.count();
         for (int i = 0; i < nmotions; i++) {
@@ -972,6 +993,7 @@ void Scene::seek(const IKeyframe::TimeIndex &timeIndex, int flags)
         }
     }
     if (internal::hasFlagBits(flags, kUpdateModels)) {
+        VPVL2_PROFILE_STAGE(kMotionSeekStage);
         const Array<PrivateContext::MotionPtr *> &motions = m_context->motions;
         const int nmotions = motions.count();
         for (int i = 0; i < nmotions; i++) {
@@ -986,8 +1008,10 @@ void Scene::updateModel(IModel *model) const
 {
     if (model) {
         model->performUpdate();
+        VPVL2_PROFILE_COUNT(kUpdatedModelCounter, 1);
         if (IRenderEngine *engine = findRenderEngine(model)) {
             engine->update();
+            m_context->flushSceneAccelerator();
         }
     }
 }
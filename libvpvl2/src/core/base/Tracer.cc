@@ -0,0 +1,241 @@
+/**
+
+ Copyright (c) 2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/DataSinkWriter.h"
+#include "vpvl2/internal/util.h"
+
+#include <LinearMath/btQuickprof.h>
+
+namespace
+{
+
+using namespace vpvl2;
+
+VPVL2_DECL_TLS static Tracer *g_currentTracerRef = 0;
+
+static const char *const kCounterNames[] = {
+    "parsedObjects",
+    "stringConversions"
+};
+
+static void writeEscapedString(const char *value, internal::DataSinkWriter &writer)
+{
+    writer.write("\"", 1);
+    for (const char *ptr = value ? value : ""; *ptr; ptr++) {
+        const char c = *ptr;
+        if (c == '"' || c == '\\') {
+            writer.write("\\", 1);
+        }
+        writer.write(&c, 1);
+    }
+    writer.write("\"", 1);
+}
+
+}
+
+namespace vpvl2
+{
+
+struct Tracer::PrivateContext {
+    PrivateContext()
+        : depth(0)
+    {
+        clock.reset();
+        clearCounters();
+    }
+    ~PrivateContext() {
+        depth = 0;
+    }
+
+    void clearCounters() {
+        for (int i = 0; i < kMaxCounterType; i++) {
+            counters[i] = 0;
+        }
+    }
+
+    btClock clock;
+    Array<Event> events;
+    vsize counters[kMaxCounterType];
+    int depth;
+};
+
+Tracer::Scope::Scope(const char *category, const char *name)
+    : m_tracerRef(g_currentTracerRef),
+      m_index(-1)
+{
+    if (m_tracerRef) {
+        m_index = m_tracerRef->beginEvent(category, name);
+    }
+}
+
+Tracer::Scope::~Scope()
+{
+    if (m_tracerRef) {
+        m_tracerRef->endEvent(m_index);
+    }
+    m_tracerRef = 0;
+    m_index = -1;
+}
+
+Tracer *Tracer::currentTracerRef()
+{
+    return g_currentTracerRef;
+}
+
+void Tracer::count(CounterType type, vsize value)
+{
+    if (Tracer *tracer = g_currentTracerRef) {
+        tracer->addCounter(type, value);
+    }
+}
+
+Tracer::Tracer()
+    : m_context(new PrivateContext())
+{
+}
+
+Tracer::~Tracer()
+{
+    detach();
+    internal::deleteObject(m_context);
+}
+
+void Tracer::attach()
+{
+    g_currentTracerRef = this;
+}
+
+void Tracer::detach()
+{
+    if (g_currentTracerRef == this) {
+        g_currentTracerRef = 0;
+    }
+}
+
+void Tracer::clear()
+{
+    m_context->events.clear();
+    m_context->clearCounters();
+    m_context->depth = 0;
+    m_context->clock.reset();
+}
+
+int Tracer::beginEvent(const char *category, const char *name)
+{
+    Event event;
+    event.category = category;
+    event.name = name;
+    event.timestamp = m_context->clock.getTimeMicroseconds();
+    event.duration = 0;
+    event.depth = m_context->depth++;
+    /* keep the counters at the beginning and turn them into the delta at endEvent */
+    for (int i = 0; i < kMaxCounterType; i++) {
+        event.counters[i] = m_context->counters[i];
+    }
+    m_context->events.append(event);
+    return m_context->events.count() - 1;
+}
+
+void Tracer::endEvent(int index)
+{
+    if (internal::checkBound(index, 0, m_context->events.count())) {
+        Event &event = m_context->events[index];
+        event.duration = m_context->clock.getTimeMicroseconds() - event.timestamp;
+        for (int i = 0; i < kMaxCounterType; i++) {
+            event.counters[i] = m_context->counters[i] - event.counters[i];
+        }
+        m_context->depth = event.depth;
+    }
+}
+
+void Tracer::addCounter(CounterType type, vsize value)
+{
+    if (internal::checkBound(type, kParsedObjectCounter, kMaxCounterType)) {
+        m_context->counters[type] += value;
+    }
+}
+
+vsize Tracer::counter(CounterType type) const
+{
+    return internal::checkBound(type, kParsedObjectCounter, kMaxCounterType) ? m_context->counters[type] : 0;
+}
+
+int Tracer::countEvents() const
+{
+    return m_context->events.count();
+}
+
+const Tracer::Event &Tracer::eventAt(int index) const
+{
+    return m_context->events[index];
+}
+
+bool Tracer::writeChromeTraceEvents(IDataSink *sink) const
+{
+    static const char kHeader[] = "{\"traceEvents\":[\n";
+    static const char kFooter[] = "\n],\"displayTimeUnit\":\"ms\"}\n";
+    internal::DataSinkWriter writer(sink);
+    char buffer[256];
+    writer.write(kHeader, sizeof(kHeader) - 1);
+    const int nevents = m_context->events.count();
+    for (int i = 0; i < nevents && writer.isOK(); i++) {
+        const Event &event = m_context->events[i];
+        if (i > 0) {
+            writer.write(",\n", 2);
+        }
+        writer.write("{\"cat\":", 7);
+        writeEscapedString(event.category, writer);
+        writer.write(",\"name\":", 8);
+        writeEscapedString(event.name, writer);
+        internal::snprintf(buffer, sizeof(buffer), ",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%llu,\"dur\":%llu,\"args\":{",
+                           static_cast<unsigned long long>(event.timestamp),
+                           static_cast<unsigned long long>(event.duration));
+        writer.write(buffer, std::strlen(buffer));
+        for (int j = 0; j < kMaxCounterType; j++) {
+            internal::snprintf(buffer, sizeof(buffer), "%s\"%s\":%llu", j > 0 ? "," : "", kCounterNames[j],
+                               static_cast<unsigned long long>(event.counters[j]));
+            writer.write(buffer, std::strlen(buffer));
+        }
+        writer.write("}}", 2);
+    }
+    writer.write(kFooter, sizeof(kFooter) - 1);
+    return writer.flush();
+}
+
+} /* namespace vpvl2 */
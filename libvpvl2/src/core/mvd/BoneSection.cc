@@ -129,13 +129,21 @@ struct BoneSection::PrivateContext {
         modelRef = 0;
     }
     void release() {
+        dirtyTrackRefs.clear();
         name2tracks.releaseAll();
         allKeyframeRefs.clear();
         track2names.clear();
     }
+    void markTrackDirty(BoneAnimationTrack *track) {
+        if (!track->dirty) {
+            dirtyTrackRefs.append(track);
+            track->dirty = true;
+        }
+    }
 
     IModel *modelRef;
     Array<IKeyframe *> allKeyframeRefs;
+    Array<BoneAnimationTrack *> dirtyTrackRefs;
     PointerHash<HashInt, BoneAnimationTrack> name2tracks;
     Hash<HashPtr, int> track2names;
 };
@@ -313,13 +321,20 @@ IKeyframe::LayerIndex BoneSection::countLayers(const IString *name) const
 
 void BoneSection::update()
 {
-    IKeyframe::TimeIndex durationTimeIndex = 0;
-    const int nkeyframes = m_context->allKeyframeRefs.count();
-    for (int i = 0; i < nkeyframes; i++) {
-        IKeyframe *keyframe = m_context->allKeyframeRefs[i];
-        btSetMax(durationTimeIndex, keyframe->timeIndex());
+    /* other tracks are kept in order on insertion so only the edited ones need to be checked */
+    Array<BoneAnimationTrack *> &dirtyTrackRefs = m_context->dirtyTrackRefs;
+    const int ntracks = dirtyTrackRefs.count();
+    for (int i = 0; i < ntracks; i++) {
+        BoneAnimationTrack *trackPtr = dirtyTrackRefs[i];
+        if (internal::MotionHelper::sortKeyframesIfNeeded(trackPtr->keyframes)) {
+            trackPtr->reset();
+        }
+        trackPtr->dirty = false;
+    }
+    if (ntracks > 0) {
+        m_durationDirty = true;
+        dirtyTrackRefs.clear();
     }
-    m_durationTimeIndex = durationTimeIndex;
 }
 
 void BoneSection::addKeyframe(IKeyframe *keyframe)
@@ -328,7 +343,8 @@ void BoneSection::addKeyframe(IKeyframe *keyframe)
     BoneAnimationTrack *const *track = m_context->name2tracks.find(key), *trackPtr = 0;
     if (track) {
         trackPtr = *track;
-        trackPtr->keyframes.append(keyframe);
+        internal::MotionHelper::insertKeyframe(keyframe, trackPtr->keyframes);
+        m_context->markTrackDirty(trackPtr);
         setDuration(keyframe);
         m_context->allKeyframeRefs.append(keyframe);
     }
@@ -348,13 +364,25 @@ void BoneSection::removeKeyframe(IKeyframe *keyframe)
     int key = m_nameListSectionRef->key(keyframe->name());
     if (BoneAnimationTrack *const *track = m_context->name2tracks.find(key)) {
         BoneAnimationTrack *trackPtr = *track;
-        trackPtr->keyframes.remove(keyframe);
+        if (internal::MotionHelper::removeKeyframe(keyframe, trackPtr->keyframes) == -1) {
+            return;
+        }
+        trackPtr->reset();
         m_context->allKeyframeRefs.remove(keyframe);
+        if (keyframe->timeIndex() >= m_durationTimeIndex) {
+            m_durationDirty = true;
+        }
         if (trackPtr->keyframes.count() == 0) {
+            if (trackPtr->dirty) {
+                m_context->dirtyTrackRefs.remove(trackPtr);
+            }
             m_context->name2tracks.remove(key);
             m_context->track2names.remove(trackPtr);
             internal::deleteObject(trackPtr);
         }
+        else {
+            m_context->markTrackDirty(trackPtr);
+        }
     }
 }
 
@@ -388,19 +416,25 @@ void BoneSection::setAllKeyframes(const Array<IKeyframe *> &value)
     }
 }
 
+IKeyframe::TimeIndex BoneSection::calculateDuration() const
+{
+    IKeyframe::TimeIndex durationTimeIndex = 0;
+    const int nkeyframes = m_context->allKeyframeRefs.count();
+    for (int i = 0; i < nkeyframes; i++) {
+        const IKeyframe *keyframe = m_context->allKeyframeRefs[i];
+        btSetMax(durationTimeIndex, keyframe->timeIndex());
+    }
+    return durationTimeIndex;
+}
+
 IBoneKeyframe *BoneSection::findKeyframe(const IKeyframe::TimeIndex &timeIndex,
                                          const IString *name,
                                          const IKeyframe::LayerIndex &layerIndex) const
 {
     if (BoneAnimationTrack *const *track = m_context->name2tracks.find(m_nameListSectionRef->key(name))) {
         const BoneAnimationTrack::KeyframeCollection &keyframes = (*track)->keyframes;
-        const int nkeyframes = keyframes.count();
-        for (int i = 0; i < nkeyframes; i++) {
-            BoneKeyframe *keyframe = reinterpret_cast<BoneKeyframe *>(keyframes[i]);
-            if (keyframe->timeIndex() == timeIndex && keyframe->layerIndex() == layerIndex) {
-                return keyframe;
-            }
-        }
+        int index = internal::MotionHelper::findKeyframeIndex(timeIndex, layerIndex, keyframes);
+        return index != -1 ? reinterpret_cast<BoneKeyframe *>(keyframes[index]) : 0;
     }
     return 0;
 }
@@ -114,13 +114,21 @@ struct MorphSection::PrivateContext {
         modelRef = 0;
     }
     void release() {
+        dirtyTrackRefs.clear();
         name2tracks.releaseAll();
         allKeyframeRefs.clear();
         track2names.clear();
     }
+    void markTrackDirty(MorphAnimationTrack *track) {
+        if (!track->dirty) {
+            dirtyTrackRefs.append(track);
+            track->dirty = true;
+        }
+    }
 
     IModel *modelRef;
     Array<IKeyframe *> allKeyframeRefs;
+    Array<MorphAnimationTrack *> dirtyTrackRefs;
     PointerHash<HashInt, MorphAnimationTrack> name2tracks;
     Hash<HashPtr, int> track2names;
 };
@@ -284,13 +292,19 @@ vsize MorphSection::countKeyframes() const
 
 void MorphSection::update()
 {
-    IKeyframe::TimeIndex durationTimeIndex = 0;
-    const int nkeyframes = m_context->allKeyframeRefs.count();
-    for (int i = 0; i < nkeyframes; i++) {
-        IKeyframe *keyframe = m_context->allKeyframeRefs[i];
-        btSetMax(durationTimeIndex, keyframe->timeIndex());
+    Array<MorphAnimationTrack *> &dirtyTrackRefs = m_context->dirtyTrackRefs;
+    const int ntracks = dirtyTrackRefs.count();
+    for (int i = 0; i < ntracks; i++) {
+        MorphAnimationTrack *trackPtr = dirtyTrackRefs[i];
+        if (internal::MotionHelper::sortKeyframesIfNeeded(trackPtr->keyframes)) {
+            trackPtr->reset();
+        }
+        trackPtr->dirty = false;
+    }
+    if (ntracks > 0) {
+        m_durationDirty = true;
+        dirtyTrackRefs.clear();
     }
-    m_durationTimeIndex = durationTimeIndex;
 }
 
 void MorphSection::addKeyframe(IKeyframe *keyframe)
@@ -299,7 +313,8 @@ void MorphSection::addKeyframe(IKeyframe *keyframe)
     MorphAnimationTrack *const *track = m_context->name2tracks.find(key), *trackPtr = 0;
     if (track) {
         trackPtr = *track;
-        trackPtr->keyframes.append(keyframe);
+        internal::MotionHelper::insertKeyframe(keyframe, trackPtr->keyframes);
+        m_context->markTrackDirty(trackPtr);
         BaseSection::setDuration(keyframe);
         m_context->allKeyframeRefs.append(keyframe);
     }
@@ -318,13 +333,25 @@ void MorphSection::removeKeyframe(IKeyframe *keyframe)
     int key = m_nameListSectionRef->key(keyframe->name());
     if (MorphAnimationTrack *const *track = m_context->name2tracks.find(key)) {
         MorphAnimationTrack *trackPtr = *track;
-        trackPtr->keyframes.remove(keyframe);
+        if (internal::MotionHelper::removeKeyframe(keyframe, trackPtr->keyframes) == -1) {
+            return;
+        }
+        trackPtr->reset();
         m_context->allKeyframeRefs.remove(keyframe);
+        if (keyframe->timeIndex() >= m_durationTimeIndex) {
+            m_durationDirty = true;
+        }
         if (trackPtr->keyframes.count() == 0) {
+            if (trackPtr->dirty) {
+                m_context->dirtyTrackRefs.remove(trackPtr);
+            }
             m_context->name2tracks.remove(key);
             m_context->track2names.remove(trackPtr);
             internal::deleteObject(trackPtr);
         }
+        else {
+            m_context->markTrackDirty(trackPtr);
+        }
     }
 }
 
@@ -363,6 +390,17 @@ IKeyframe::LayerIndex MorphSection::countLayers(const IString * /* name */) cons
     return 1;
 }
 
+IKeyframe::TimeIndex MorphSection::calculateDuration() const
+{
+    IKeyframe::TimeIndex durationTimeIndex = 0;
+    const int nkeyframes = m_context->allKeyframeRefs.count();
+    for (int i = 0; i < nkeyframes; i++) {
+        const IKeyframe *keyframe = m_context->allKeyframeRefs[i];
+        btSetMax(durationTimeIndex, keyframe->timeIndex());
+    }
+    return durationTimeIndex;
+}
+
 IMorphKeyframe *MorphSection::findKeyframe(const IKeyframe::TimeIndex &timeIndex,
                                            const IString *name,
                                            const IKeyframe::LayerIndex &layerIndex) const
@@ -370,13 +408,8 @@ IMorphKeyframe *MorphSection::findKeyframe(const IKeyframe::TimeIndex &timeIndex
     MorphAnimationTrack *const *track = m_context->name2tracks.find(m_nameListSectionRef->key(name));
     if (track) {
         const MorphAnimationTrack::KeyframeCollection &keyframes = (*track)->keyframes;
-        const int nkeyframes = keyframes.count();
-        for (int i = 0; i < nkeyframes; i++) {
-            MorphKeyframe *keyframe = reinterpret_cast<MorphKeyframe *>(keyframes[i]);
-            if (keyframe->timeIndex() == timeIndex && keyframe->layerIndex() == layerIndex) {
-                return keyframe;
-            }
-        }
+        int index = internal::MotionHelper::findKeyframeIndex(timeIndex, layerIndex, keyframes);
+        return index != -1 ? reinterpret_cast<MorphKeyframe *>(keyframes[index]) : 0;
     }
     return 0;
 }
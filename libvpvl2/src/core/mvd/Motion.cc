@@ -131,6 +131,7 @@ struct Motion::PrivateContext {
         type2sectionRefs.insert(IKeyframe::kProjectKeyframe, projectSection);
     }
     void parseHeader(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseHeader");
         IEncoding *encoding = info.encoding;
         internal::setStringDirect(encoding->toString(info.namePtr, info.nameSize, info.codec), name);
         internal::setStringDirect(encoding->toString(info.name2Ptr, info.name2Size, info.codec), name2);
@@ -139,6 +140,7 @@ struct Motion::PrivateContext {
         nameListSection->read(info.nameListSectionPtr, info.codec);
     }
     void parseAssetSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseAssetSections");
         const Array<uint8 *> &sections = info.assetSectionPtrs;
         const int nsections = sections.count();
         assetSection = new AssetSection(selfPtr);
@@ -149,6 +151,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseBoneSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseBoneSections");
         const Array<uint8 *> &sections = info.boneSectionPtrs;
         const int nsections = sections.count();
         boneSection = new BoneSection(selfPtr, parentModelRef);
@@ -159,6 +162,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseCameraSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseCameraSections");
         const Array<uint8 *> &sections = info.cameraSectionPtrs;
         const int nsections = sections.count();
         cameraSection = new CameraSection(selfPtr);
@@ -169,6 +173,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseEffectSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseEffectSections");
         const Array<uint8 *> &sections = info.effectSectionPtrs;
         const int nsections = sections.count();
         effectSection = new EffectSection(selfPtr);
@@ -179,6 +184,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseLightSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseLightSections");
         const Array<uint8 *> &sections = info.lightSectionPtrs;
         const int nsections = sections.count();
         lightSection = new LightSection(selfPtr);
@@ -189,6 +195,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseModelSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseModelSections");
         const Array<uint8 *> &sections = info.modelSectionPtrs;
         const int nsections = sections.count();
         modelSection = new ModelSection(selfPtr, parentModelRef, info.adjustAlignment);
@@ -199,6 +206,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseMorphSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseMorphSections");
         const Array<uint8 *> &sections = info.morphSectionPtrs;
         const int nsections = sections.count();
         morphSection = new MorphSection(selfPtr, parentModelRef);
@@ -209,6 +217,7 @@ struct Motion::PrivateContext {
         }
     }
     void parseProjectSections(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::parseProjectSections");
         const Array<uint8 *> &sections = info.projectSectionPtrs;
         const int nsections = sections.count();
         projectSection = new ProjectSection(selfPtr);
@@ -290,6 +299,7 @@ Motion::~Motion()
 
 bool Motion::preparse(const uint8 *data, vsize size, DataInfo &info)
 {
+    VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::preparse");
     vsize rest = size;
     // Header(30)
     Header header;
@@ -454,6 +464,7 @@ bool Motion::preparse(const uint8 *data, vsize size, DataInfo &info)
 
 bool Motion::load(const uint8 *data, vsize size)
 {
+    VPVL2_TRACE_SCOPE("mvd", "mvd::Motion::load");
     DataInfo info;
     internal::zerofill(&info, sizeof(info));
     if (preparse(data, size, info)) {
@@ -677,6 +688,11 @@ void Motion::replaceKeyframe(IKeyframe *value, bool alsoDelete)
     if (!value) {
         return;
     }
+    /* the keyframe may be already owned and its time index changed directly so detach it to reinsert in order */
+    if (BaseSection *const *sectionPtr = m_context->type2sectionRefs.find(value->type())) {
+        BaseSection *section = *sectionPtr;
+        section->removeKeyframe(value);
+    }
     IKeyframe *keyframeToDelete = 0;
     switch (value->type()) {
     case IKeyframe::kAssetKeyframe: {
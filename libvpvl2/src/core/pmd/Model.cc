@@ -85,6 +85,7 @@ struct DefaultStaticVertexBuffer : public IModel::StaticVertexBuffer {
         const uint8_t *base = reinterpret_cast<const uint8_t *>(&kIdent.texcoord);
         switch (type) {
         case kBoneIndexStride:
+        case kBonePaletteIndexStride:
             return reinterpret_cast<const uint8_t *>(&kIdent.boneIndices) - base;
         case kBoneWeightStride:
             return reinterpret_cast<const uint8_t *>(&kIdent.boneWeights) - base;
@@ -196,6 +197,7 @@ struct DefaultDynamicVertexBuffer : public IModel::DynamicVertexBuffer {
         case kBoneWeightStride:
         case kTextureCoordStride:
         case kIndexStride:
+        case kBonePaletteIndexStride:
         default:
             return 0;
         }
@@ -345,13 +347,21 @@ struct DefaultMatrixBuffer : public IModel::MatrixBuffer {
             buffer.delta = vertex->delta();
         }
     }
-    const float *bytes(int materialIndex) const {
+    int countSubsets(int materialIndex) const {
         int nmatrices = meshes.matrices.count();
-        return internal::checkBound(materialIndex, 0, nmatrices) ? meshes.matrices[materialIndex] : 0;
+        return internal::checkBound(materialIndex, 0, nmatrices) ? 1 : 0;
     }
-    size_t size(int materialIndex) const {
+    int indexCount(int materialIndex, int subsetIndex) const {
+        int nmaterials = materials.count();
+        return subsetIndex == 0 && internal::checkBound(materialIndex, 0, nmaterials) ? materials[materialIndex]->indexRange().count : 0;
+    }
+    const float *bytes(int materialIndex, int subsetIndex) const {
+        int nmatrices = meshes.matrices.count();
+        return subsetIndex == 0 && internal::checkBound(materialIndex, 0, nmatrices) ? meshes.matrices[materialIndex] : 0;
+    }
+    size_t size(int materialIndex, int subsetIndex) const {
         int nbones = meshes.bones.size();
-        return internal::checkBound(materialIndex, 0, nbones) ? meshes.bones[materialIndex].size() : 0;
+        return subsetIndex == 0 && internal::checkBound(materialIndex, 0, nbones) ? meshes.bones[materialIndex].size() : 0;
     }
 
     void initialize() {
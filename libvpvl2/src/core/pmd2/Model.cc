@@ -120,6 +120,7 @@ struct DefaultStaticVertexBuffer : public IModel::StaticVertexBuffer {
         const uint8 *base = reinterpret_cast<const uint8 *>(&kIdent.texcoord);
         switch (type) {
         case kBoneIndexStride:
+        case kBonePaletteIndexStride:
             return reinterpret_cast<const uint8 *>(&kIdent.boneIndices) - base;
         case kBoneWeightStride:
             return reinterpret_cast<const uint8 *>(&kIdent.boneWeights) - base;
@@ -234,6 +235,7 @@ struct DefaultDynamicVertexBuffer : public IModel::DynamicVertexBuffer {
         case kBoneWeightStride:
         case kTextureCoordStride:
         case kIndexStride:
+        case kBonePaletteIndexStride:
         default:
             return 0;
         }
@@ -384,13 +386,21 @@ struct DefaultMatrixBuffer : public IModel::MatrixBuffer {
             buffer.position.setW(Scalar(vertex->type()));
         }
     }
-    const float32 *bytes(int materialIndex) const {
+    int countSubsets(int materialIndex) const {
         int nmatrices = meshes.matrices.count();
-        return internal::checkBound(materialIndex, 0, nmatrices) ? meshes.matrices[materialIndex] : 0;
+        return internal::checkBound(materialIndex, 0, nmatrices) ? 1 : 0;
     }
-    vsize size(int materialIndex) const {
+    int indexCount(int materialIndex, int subsetIndex) const {
+        int nmaterials = materials.count();
+        return subsetIndex == 0 && internal::checkBound(materialIndex, 0, nmaterials) ? materials[materialIndex]->indexRange().count : 0;
+    }
+    const float32 *bytes(int materialIndex, int subsetIndex) const {
+        int nmatrices = meshes.matrices.count();
+        return subsetIndex == 0 && internal::checkBound(materialIndex, 0, nmatrices) ? meshes.matrices[materialIndex] : 0;
+    }
+    vsize size(int materialIndex, int subsetIndex) const {
         int nbones = meshes.bones.size();
-        return internal::checkBound(materialIndex, 0, nbones) ? meshes.bones[materialIndex].size() : 0;
+        return subsetIndex == 0 && internal::checkBound(materialIndex, 0, nbones) ? meshes.bones[materialIndex].size() : 0;
     }
 
     struct Predication {
@@ -562,12 +572,15 @@ struct Model::PrivateContext {
         physicsEnabled = false;
     }
     void parseNamesAndComments(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseNamesAndComments");
         internal::setStringDirect(encodingRef->toString(info.namePtr, IString::kShiftJIS, kNameSize), namePtr);
         internal::setStringDirect(encodingRef->toString(info.englishNamePtr, IString::kShiftJIS, kNameSize), englishNamePtr);
         internal::setStringDirect(encodingRef->toString(info.commentPtr, IString::kShiftJIS, kCommentSize), commentPtr);
         internal::setStringDirect(encodingRef->toString(info.englishCommentPtr, IString::kShiftJIS, kCommentSize), englishCommentPtr);
     }
     void parseVertices(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseVertices");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.verticesCount);
         const int nvertices = int(info.verticesCount);
         uint8 *ptr = info.verticesPtr;
         vsize size;
@@ -578,6 +591,7 @@ struct Model::PrivateContext {
         }
     }
     void parseIndices(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseIndices");
         const int nindices = int(info.indicesCount);
         uint8 *ptr = info.indicesPtr;
         for (int i = 0; i < nindices; i++) {
@@ -586,6 +600,8 @@ struct Model::PrivateContext {
         }
     }
     void parseMaterials(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseMaterials");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.materialsCount);
         const int nmaterials = int(info.materialsCount), nindices = int(indices.count());
         uint8 *ptr = info.materialsPtr;
         vsize size;
@@ -610,6 +626,8 @@ struct Model::PrivateContext {
         }
     }
     void parseBones(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseBones");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.bonesCount);
         const int nbones = int(info.bonesCount);
         const uint8 *englishPtr = info.englishBoneNamesPtr;
         uint8 *ptr = info.bonesPtr;
@@ -630,6 +648,8 @@ struct Model::PrivateContext {
         selfRef->performUpdate();
     }
     void parseIKConstraints(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseIKConstraints");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.IKConstraintsCount);
         const int nconstraints = int(info.IKConstraintsCount);
         uint8 *ptr = info.IKConstraintsPtr;
         vsize size;
@@ -648,6 +668,8 @@ struct Model::PrivateContext {
         }
     }
     void parseMorphs(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseMorphs");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.morphsCount);
         const int nmorphs = int(info.morphsCount);
         const uint8 *englishPtr = info.englishFaceNamesPtr;
         uint8 *ptr = info.morphsPtr;
@@ -664,6 +686,7 @@ struct Model::PrivateContext {
         }
     }
     void parseLabels(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseLabels");
         const int ncategories = int(info.boneCategoryNamesCount);
         uint8 *boneCategoryNamesPtr = info.boneCategoryNamesPtr;
         vsize size = 0;
@@ -691,6 +714,7 @@ struct Model::PrivateContext {
         }
     }
     void parseCustomToonTextures(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseCustomToonTextures");
         static const uint8 kFallbackToonTextureName[] = "toon0.bmp";
         uint8 *ptr = info.customToonTextureNamesPtr;
         IString *path = encodingRef->toString(kFallbackToonTextureName,
@@ -706,6 +730,8 @@ struct Model::PrivateContext {
         }
     }
     void parseRigidBodies(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseRigidBodies");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.rigidBodiesCount);
         const int numRigidBodies = int(info.rigidBodiesCount);
         uint8 *ptr = info.rigidBodiesPtr;
         vsize size;
@@ -716,6 +742,8 @@ struct Model::PrivateContext {
         }
     }
     void parseJoints(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::parseJoints");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.jointsCount);
         const int njoints = int(info.jointsCount);
         uint8 *ptr = info.jointsPtr;
         vsize size;
@@ -812,6 +840,7 @@ Model::~Model()
 
 bool Model::preparse(const uint8 *data, vsize size, DataInfo &info)
 {
+    VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::preparse");
     vsize rest = size;
     if (!data || sizeof(Header) > rest) {
         m_context->dataInfo.error = kInvalidHeaderError;
@@ -931,6 +960,7 @@ bool Model::preparse(const uint8 *data, vsize size, DataInfo &info)
 
 bool Model::load(const uint8 *data, vsize size)
 {
+    VPVL2_TRACE_SCOPE("pmd2", "pmd2::Model::load");
     DataInfo info;
     internal::zerofill(&info, sizeof(info));
     if (preparse(data, size, info)) {
@@ -1161,21 +1191,29 @@ void Model::solveInverseKinematics()
 void Model::performUpdate()
 {
     {
+        VPVL2_PROFILE_STAGE(kMorphUpdateStage);
         internal::ParallelResetVertexProcessor<pmd2::Vertex> processor(&m_context->vertices);
         processor.execute();
+        const int nmorphs = m_context->morphs.count();
+        for (int i = 0; i < nmorphs; i++) {
+            Morph *morph = m_context->morphs[i];
+            morph->update();
+        }
     }
-    const int nmorphs = m_context->morphs.count();
-    for (int i = 0; i < nmorphs; i++) {
-        Morph *morph = m_context->morphs[i];
-        morph->update();
+    {
+        VPVL2_PROFILE_STAGE(kBoneTransformStage);
+        const int nbones = m_context->sortedBoneRefs.count();
+        for (int i = 0; i < nbones; i++) {
+            Bone *bone = m_context->sortedBoneRefs[i];
+            bone->performTransform();
+        }
     }
-    const int nbones = m_context->sortedBoneRefs.count();
-    for (int i = 0; i < nbones; i++) {
-        Bone *bone = m_context->sortedBoneRefs[i];
-        bone->performTransform();
+    {
+        VPVL2_PROFILE_STAGE(kIKStage);
+        solveInverseKinematics();
     }
-    solveInverseKinematics();
     if (m_context->physicsEnabled) {
+        VPVL2_PROFILE_STAGE(kRigidBodySyncStage);
         internal::ParallelUpdateRigidBodyProcessor<pmd2::RigidBody> processor(&m_context->rigidBodies);
         processor.execute();
     }
@@ -1166,6 +1166,18 @@ void Bone::setEffectorBoneRef(IBone *effector, int numIteration, float angleLimi
     }
 }
 
+void Bone::addInverseKinematicsConstraint(IBone *jointBone, bool hasAngleLimit, const Vector3 &lowerLimit, const Vector3 &upperLimit)
+{
+    if (jointBone && jointBone->parentModelRef() == m_context->modelRef) {
+        IKConstraint *constraint = m_context->constraints.append(new IKConstraint());
+        constraint->jointBoneRef = static_cast<Bone *>(jointBone);
+        constraint->jointBoneIndex = jointBone->index();
+        constraint->hasAngleLimit = hasAngleLimit;
+        constraint->lowerLimit = lowerLimit;
+        constraint->upperLimit = upperLimit;
+    }
+}
+
 void Bone::setDestinationOriginBoneRef(IBone *value)
 {
     if (!value || (value && value->parentModelRef() == m_context->modelRef)) {
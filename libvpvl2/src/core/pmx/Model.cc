@@ -36,6 +36,8 @@
 */
 
 #include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/BonePalette.h"
+#include "vpvl2/internal/DataSinkWriter.h"
 #include "vpvl2/internal/ModelHelper.h"
 
 #include "vpvl2/pmx/Bone.h"
@@ -109,30 +111,13 @@ struct Flags
 #pragma pack(pop)
 
 struct DefaultStaticVertexBuffer : public IModel::StaticVertexBuffer {
-    typedef btAlignedObjectArray<int32> BoneIndices;
-    typedef Array<BoneIndices> MeshBoneIndices;
-    typedef Hash<HashInt, int> BoneIndexHash;
-
     struct Unit {
         Unit() {}
-        static Scalar resolveRelativeBoneIndex(const IVertex *vertexRef, int offset, const BoneIndexHash *boneIndexHashes) {
-            if (const IBone *boneRef = vertexRef->boneRef(offset)) {
-                const int boneIndex = boneRef->index();
-#if 0
-                if (const int *boneIndexPtr = boneIndexHashes->find(boneIndex)) {
-                    const int relativeBoneIndex = *boneIndexPtr;
-                    return Scalar(relativeBoneIndex);
-                }
-#else
-                (void) boneIndexHashes;
-                return boneIndex;
-#endif
-            }
-            return -1;
-        }
-        void update(const IVertex *vertexRef, const BoneIndexHash *boneIndexHashes) {
+        void update(const IVertex *vertexRef, const internal::BonePalette *paletteRef) {
             for (int i = 0; i < pmx::Vertex::kMaxBones; i++) {
-                boneIndices[i] = resolveRelativeBoneIndex(vertexRef, i, boneIndexHashes);
+                const IBone *boneRef = vertexRef->boneRef(i);
+                boneIndices[i] = boneRef ? Scalar(boneRef->index()) : Scalar(-1);
+                paletteBoneIndices[i] = Scalar(paletteRef ? paletteRef->findSlot(boneRef) : int(internal::BonePalette::kNullBoneSlot));
                 boneWeights[i] = Scalar(vertexRef->weight(i));
             }
             texcoord = vertexRef->textureCoord();
@@ -140,78 +125,15 @@ struct DefaultStaticVertexBuffer : public IModel::StaticVertexBuffer {
         Vector3 texcoord;
         Vector4 boneIndices;
         Vector4 boneWeights;
+        Vector4 paletteBoneIndices;
     };
     static const Unit kIdent;
 
-    struct Predication {
-        inline bool operator()(const int left, const int right) const {
-            return left < right;
-        }
-    };
-    static void addBoneIndices(const IVertex *vertexRef, const int nindices, BoneIndices &indices) {
-        VPVL2_DCHECK(indices.size() > 0);
-        Predication predication;
-        int size = indices.size();
-        for (int i = 0; i < nindices; i++) {
-            int index = vertexRef->boneRef(i)->index();
-            if (indices.findBinarySearch(index) == size) {
-                indices.push_back(index);
-                indices.quickSort(predication);
-                size = indices.size();
-            }
-        }
-    }
-    static void addBoneIndices(const IVertex *vertexRef, BoneIndices &boneIndices) {
-        switch (vertexRef->type()) {
-        case IVertex::kBdef1:
-            addBoneIndices(vertexRef, 1, boneIndices);
-            break;
-        case IVertex::kBdef2:
-        case IVertex::kSdef:
-            addBoneIndices(vertexRef, 2, boneIndices);
-            break;
-        case IVertex::kBdef4:
-        case IVertex::kQdef:
-            addBoneIndices(vertexRef, 4, boneIndices);
-            break;
-        case IVertex::kMaxType:
-        default:
-            break;
-        }
-    }
-    static void updateBoneIndexHashes(const pmx::Model *modelRef, PointerArray<BoneIndexHash> &boneIndexHashes) {
-        const Array<pmx::Material *> &materialRefs = modelRef->materials();
-        const Array<pmx::Vertex *> &verticeRefs = modelRef->vertices();
-        const Array<int> &indices = modelRef->indices();
-        BoneIndices boneIndices;
-        boneIndexHashes.releaseAll();
-        const int nmaterials = materialRefs.count();
-        for (int i = 0, offset = 0; i < nmaterials; i++) {
-            const IMaterial *materialRef = materialRefs[i];
-            const int nindices = materialRef->indexRange().count;
-            boneIndices.clear();
-            boneIndices.push_back(-1);
-            for (int j = 0; j < nindices; j++) {
-                const int vertexIndex = indices[offset + j];
-                const IVertex *vertexRef = verticeRefs[vertexIndex];
-                addBoneIndices(vertexRef, boneIndices);
-            }
-            const int numBoneIndices = boneIndices.size();
-            BoneIndexHash *boneIndexHash = boneIndexHashes.append(new BoneIndexHash());
-            for (int j = 0; j < numBoneIndices; j++) {
-                const int boneIndex = boneIndices[j];
-                boneIndexHash->insert(boneIndex, j);
-            }
-            offset += nindices;
-        }
-    }
-
     DefaultStaticVertexBuffer(const pmx::Model *model)
         : modelRef(model)
     {
     }
     ~DefaultStaticVertexBuffer() {
-        boneIndexHashes.releaseAll();
         modelRef = 0;
     }
 
@@ -225,6 +147,8 @@ struct DefaultStaticVertexBuffer : public IModel::StaticVertexBuffer {
             return reinterpret_cast<const uint8 *>(&kIdent.boneIndices) - base;
         case kBoneWeightStride:
             return reinterpret_cast<const uint8 *>(&kIdent.boneWeights) - base;
+        case kBonePaletteIndexStride:
+            return reinterpret_cast<const uint8 *>(&kIdent.paletteBoneIndices) - base;
         case kTextureCoordStride:
             return reinterpret_cast<const uint8 *>(&kIdent.texcoord) - base;
         case kVertexStride:
@@ -246,31 +170,20 @@ struct DefaultStaticVertexBuffer : public IModel::StaticVertexBuffer {
         return sizeof(kIdent);
     }
     void update(void *address) const {
-        const Array<pmx::Material *> &materials = modelRef->materials();
-        const Array<int> &indices = modelRef->indices();
         const Array<pmx::Vertex *> &vertices = modelRef->vertices();
-        const int nmaterials = materials.count();
+        internal::BonePalette palette(modelRef->maxBonesPerDraw());
+        const bool partitioned = palette.build(modelRef->materials(), vertices, modelRef->indices(), modelRef->bones().count());
+        const int nvertices = vertices.count();
         Unit *unitPtr = static_cast<Unit *>(address);
-        updateBoneIndexHashes(modelRef, boneIndexHashes);
-        for (int i = 0, offset = 0; i < nmaterials; i++) {
-            const IMaterial *materialRef = materials[i];
-            const BoneIndexHash *boneIndexHashRef = boneIndexHashes[i];
-            const int nindices = materialRef->indexRange().count;
-            for (int j = 0; j < nindices; j++) {
-                const int vertexIndex = indices[offset + j];
-                const IVertex *vertex = vertices[vertexIndex];
-                unitPtr[vertexIndex].update(vertex, boneIndexHashRef);
-            }
-            offset += nindices;
+        for (int i = 0; i < nvertices; i++) {
+            unitPtr[i].update(vertices[i], partitioned ? &palette : 0);
         }
-        boneIndexHashes.releaseAll();
     }
     const void *ident() const {
         return &kIdent;
     }
 
     const pmx::Model *modelRef;
-    mutable PointerArray<BoneIndexHash> boneIndexHashes;
 };
 const DefaultStaticVertexBuffer::Unit DefaultStaticVertexBuffer::kIdent = DefaultStaticVertexBuffer::Unit();
 
@@ -287,6 +200,7 @@ struct DefaultDynamicVertexBuffer : public IModel::DynamicVertexBuffer {
         void setPosition(const IVertex *vertex) {
             position = edge = vertex->origin() + vertex->delta();
             position[3] = edge[3] = Scalar(vertex->type());
+            setUVA(vertex);
         }
         void performTransform(const IVertex *vertex, const IVertex::EdgeSizePrecision &materialEdgeSize, Vector3 &p) {
             Vector3 n;
@@ -351,6 +265,7 @@ struct DefaultDynamicVertexBuffer : public IModel::DynamicVertexBuffer {
         case kBoneWeightStride:
         case kTextureCoordStride:
         case kIndexStride:
+        case kBonePaletteIndexStride:
         case kVertexIndexStride:
         case kMorphDeltaStride:
         default:
@@ -531,24 +446,19 @@ struct DefaultIndexBuffer : public IModel::IndexBuffer {
 const int DefaultIndexBuffer::kIdent;
 
 struct DefaultMatrixBuffer : public IModel::MatrixBuffer {
-    typedef btAlignedObjectArray<Transform> MeshLocalTransforms;
     typedef PointerArray<float32> MeshMatrices;
-    struct SkinningMeshes {
-        DefaultStaticVertexBuffer::MeshBoneIndices bones;
-        MeshMatrices matrices;
-        ~SkinningMeshes() { matrices.releaseArrayAll(); }
-    };
 
     DefaultMatrixBuffer(const pmx::Model *model,
                         const DefaultIndexBuffer *indexBuffer,
                         DefaultDynamicVertexBuffer *dynamicBuffer)
         : modelRef(model),
           indexBufferRef(indexBuffer),
-          dynamicBufferRef(dynamicBuffer)
+          dynamicBufferRef(dynamicBuffer),
+          palette(model->maxBonesPerDraw())
     {
-        initialize();
     }
     ~DefaultMatrixBuffer() {
+        matrices.releaseArrayAll();
         modelRef = 0;
         indexBufferRef = 0;
         dynamicBufferRef = 0;
@@ -556,18 +466,16 @@ struct DefaultMatrixBuffer : public IModel::MatrixBuffer {
 
     void updateBoneLocalTransforms() {
         const Array<pmx::Bone *> &boneRefs = modelRef->bones();
-        const Array<pmx::Material *> &materialRefs = modelRef->materials();
         const Transform &staticBoneLocalTransform = Factory::sharedNullBoneRef()->localTransform();
-        const int nmaterials = materialRefs.count();
-        for (int i = 0; i < nmaterials; i++) {
-            const DefaultStaticVertexBuffer::BoneIndices &boneIndices = meshes.bones[i];
-            const int numBoneIndices = boneIndices.size();
-            float32 *matrices = meshes.matrices[i];
-            staticBoneLocalTransform.getOpenGLMatrix(matrices);
-            for (int j = 1; j < numBoneIndices; j++) {
+        const int nsubsets = palette.countSubsets();
+        for (int i = 0; i < nsubsets; i++) {
+            const Array<int> &boneIndices = palette.subsetAt(i)->boneIndices;
+            const int numBoneIndices = boneIndices.count();
+            float32 *subsetMatrices = matrices[i];
+            for (int j = 0; j < numBoneIndices; j++) {
                 const int boneIndex = boneIndices[j];
-                const Transform &localBoneTransform = boneRefs[boneIndex]->localTransform();
-                localBoneTransform.getOpenGLMatrix(&matrices[j * 16]);
+                const Transform &localBoneTransform = boneIndex >= 0 ? boneRefs[boneIndex]->localTransform() : staticBoneLocalTransform;
+                localBoneTransform.getOpenGLMatrix(&subsetMatrices[j * 16]);
             }
         }
     }
@@ -575,46 +483,41 @@ struct DefaultMatrixBuffer : public IModel::MatrixBuffer {
     void update(void * /* address */) {
         updateBoneLocalTransforms();
     }
-    const float32 *bytes(int materialIndex) const {
-        int nmatrices = meshes.matrices.count();
-        return internal::checkBound(materialIndex, 0, nmatrices) ? meshes.matrices[materialIndex] : 0;
+    int countSubsets(int materialIndex) const {
+        return palette.countSubsets(materialIndex);
     }
-    vsize size(int materialIndex) const {
-        int nbones = meshes.bones.count();
-        return internal::checkBound(materialIndex, 0, nbones) ? meshes.bones[materialIndex].size() : 0;
+    int indexCount(int materialIndex, int subsetIndex) const {
+        const internal::BonePalette::Subset *subset = palette.subsetAt(palette.findSubsetIndex(materialIndex, subsetIndex));
+        return subset ? subset->indexCount : 0;
+    }
+    const float32 *bytes(int materialIndex, int subsetIndex) const {
+        const int index = palette.findSubsetIndex(materialIndex, subsetIndex);
+        return index >= 0 ? matrices[index] : 0;
+    }
+    vsize size(int materialIndex, int subsetIndex) const {
+        const internal::BonePalette::Subset *subset = palette.subsetAt(palette.findSubsetIndex(materialIndex, subsetIndex));
+        return subset ? subset->boneIndices.count() : 0;
     }
 
-    void initialize() {
-        const Array<pmx::Material *> &materialRefs = modelRef->materials();
-        const Array<pmx::Vertex *> &verticeRefs = modelRef->vertices();
-        const Array<int> &indices = modelRef->indices();
-        const int nmaterials = materialRefs.count();
-        DefaultStaticVertexBuffer::BoneIndices boneIndices;
-        meshes.bones.reserve(nmaterials);
-        meshes.matrices.reserve(nmaterials);
-        int offset = 0;
-        for (int i = 0; i < nmaterials; i++) {
-            const IMaterial *materialRef = materialRefs[i];
-            const int nindices = materialRef->indexRange().count;
-            boneIndices.clear();
-            boneIndices.push_back(-1);
-            for (int j = 0; j < nindices; j++) {
-                const int vertexIndex = indices[offset + j];
-                const IVertex *vertexRef = verticeRefs[vertexIndex];
-                DefaultStaticVertexBuffer::addBoneIndices(vertexRef, boneIndices);
-            }
-            const vsize size = boneIndices.size() * 16;
-            meshes.matrices.append(new float32[size]);
-            meshes.bones.append(boneIndices);
-            offset += nindices;
+    bool initialize() {
+        if (!palette.build(modelRef->materials(), modelRef->vertices(), modelRef->indices(), modelRef->bones().count())) {
+            return false;
+        }
+        const int nsubsets = palette.countSubsets();
+        matrices.reserve(nsubsets);
+        for (int i = 0; i < nsubsets; i++) {
+            const vsize size = palette.subsetAt(i)->boneIndices.count() * 16;
+            matrices.append(new float32[size]);
         }
         updateBoneLocalTransforms();
+        return true;
     }
 
     const pmx::Model *modelRef;
     const DefaultIndexBuffer *indexBufferRef;
     DefaultDynamicVertexBuffer *dynamicBufferRef;
-    SkinningMeshes meshes;
+    internal::BonePalette palette;
+    MeshMatrices matrices;
 };
 
 }
@@ -643,6 +546,7 @@ struct Model::PrivateContext {
           opacity(1),
           scaleFactor(1),
           edgeWidth(0),
+          maxBonesPerDraw(kDefaultMaxBonesPerDraw),
           visible(false),
           enablePhysics(false)
     {
@@ -677,7 +581,20 @@ struct Model::PrivateContext {
         opacity = 1;
         scaleFactor = 1;
     }
+    void prepareSaving(Header &header, Flags &flags, Model::DataInfo &info) {
+        const IString::Codec codec = IString::kUTF8; // TODO: UTF-16 support
+        uint8 *signature = reinterpret_cast<uint8 *>(header.signature);
+        internal::writeBytes("PMX ", sizeof(header.signature), signature);
+        header.version = dataInfo.version;
+        info = dataInfo;
+        flags.codec = codec == IString::kUTF8 ? 1 : 0;
+        flags.additionalUVSize = uint8(info.additionalUVSize);
+        info.codec = codec;
+        assignIndexSize(info);
+        assignIndexSize(flags);
+    }
     void parseNamesAndComments(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseNamesAndComments");
         IEncoding *encoding = info.encoding;
         internal::setStringDirect(encoding->toString(info.namePtr, info.nameSize, info.codec), namePtr);
         internal::setStringDirect(encodingRef->toString(info.englishNamePtr, info.englishNameSize, info.codec), englishNamePtr);
@@ -685,16 +602,12 @@ struct Model::PrivateContext {
         internal::setStringDirect(encodingRef->toString(info.englishCommentPtr, info.englishCommentSize, info.codec), englishCommentPtr);
     }
     void parseVertices(const Model::DataInfo &info) {
-        const int nvertices = int(info.verticesCount);
-        uint8 *ptr = info.verticesPtr;
-        vsize size;
-        for (int i = 0; i < nvertices; i++) {
-            Vertex *vertex = vertices.append(new Vertex(selfRef));
-            vertex->read(ptr, info, size);
-            ptr += size;
-        }
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseVertices");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.verticesCount);
+        Vertex::readVertices(info, selfRef, vertices);
     }
     void parseIndices(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseIndices");
         const int nindices = int(info.indicesCount), nvertices = int(info.verticesCount);
         uint8 *ptr = info.indicesPtr;
         vsize size = info.vertexIndexSize;
@@ -709,6 +622,8 @@ struct Model::PrivateContext {
         }
     }
     void parseTextures(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseTextures");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.texturesCount);
         const int ntextures = int(info.texturesCount);
         vsize rest = SIZE_MAX;
         uint8 *ptr = info.texturesPtr;
@@ -722,6 +637,8 @@ struct Model::PrivateContext {
         }
     }
     void parseMaterials(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseMaterials");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.materialsCount);
         const int nmaterials = int(info.materialsCount), nindices = indices.count();
         int offset = 0;
         uint8 *ptr = info.materialsPtr;
@@ -746,6 +663,8 @@ struct Model::PrivateContext {
         }
     }
     void parseBones(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseBones");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.bonesCount);
         const int nbones = int(info.bonesCount);
         uint8 *ptr = info.bonesPtr;
         vsize size;
@@ -758,6 +677,8 @@ struct Model::PrivateContext {
         }
     }
     void parseMorphs(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseMorphs");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.morphsCount);
         const int nmorphs = int(info.morphsCount);
         uint8 *ptr = info.morphsPtr;
         vsize size;
@@ -770,6 +691,8 @@ struct Model::PrivateContext {
         }
     }
     void parseLabels(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseLabels");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.labelsCount);
         const int nlabels = int(info.labelsCount);
         uint8 *ptr = info.labelsPtr;
         vsize size;
@@ -780,6 +703,8 @@ struct Model::PrivateContext {
         }
     }
     void parseRigidBodies(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseRigidBodies");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.rigidBodiesCount);
         const int numRigidBodies = int(info.rigidBodiesCount);
         uint8 *ptr = info.rigidBodiesPtr;
         vsize size;
@@ -790,6 +715,8 @@ struct Model::PrivateContext {
         }
     }
     void parseJoints(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseJoints");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.jointsCount);
         const int njoints = int(info.jointsCount);
         uint8 *ptr = info.jointsPtr;
         vsize size;
@@ -800,6 +727,8 @@ struct Model::PrivateContext {
         }
     }
     void parseSoftBodies(const Model::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("pmx", "pmx::Model::parseSoftBodies");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.softBodiesCount);
         if (info.version >= 2.1) {
             const int numSoftBodies = int(info.softBodiesCount);
             uint8 *ptr = info.softBodiesPtr;
@@ -863,6 +792,7 @@ struct Model::PrivateContext {
     Scalar scaleFactor;
     IVertex::EdgeSizePrecision edgeWidth;
     DataInfo dataInfo;
+    int maxBonesPerDraw;
     bool visible;
     bool enablePhysics;
 };
@@ -880,6 +810,7 @@ Model::~Model()
 
 bool Model::load(const uint8 *data, vsize size)
 {
+    VPVL2_TRACE_SCOPE("pmx", "pmx::Model::load");
     DataInfo info;
     internal::zerofill(&info, sizeof(info));
     if (preparse(data, size, info)) {
@@ -920,19 +851,12 @@ bool Model::load(const uint8 *data, vsize size)
 void Model::save(uint8 *data, vsize &written) const
 {
     Header header;
+    Flags flags;
+    DataInfo info;
     uint8 *base = data;
-    uint8 *signature = reinterpret_cast<uint8 *>(header.signature);
-    internal::writeBytes("PMX ", sizeof(header.signature), signature);
-    header.version = m_context->dataInfo.version;
+    m_context->prepareSaving(header, flags, info);
+    const IString::Codec codec = info.codec;
     internal::writeBytes(&header, sizeof(header), data);
-    IString::Codec codec = IString::kUTF8; // TODO: UTF-16 support
-    Flags flags;
-    DataInfo info = m_context->dataInfo;
-    flags.codec = codec == IString::kUTF8 ? 1 : 0;
-    flags.additionalUVSize = uint8(info.additionalUVSize);
-    info.codec = codec;
-    m_context->assignIndexSize(info);
-    m_context->assignIndexSize(flags);
     uint8 flagSize = sizeof(flags);
     internal::writeBytes(&flagSize, sizeof(flagSize), data);
     internal::writeBytes(&flags, sizeof(flags), data);
@@ -964,13 +888,56 @@ void Model::save(uint8 *data, vsize &written) const
     VPVL2_VLOG(1, "PMXEOF: base=" << reinterpret_cast<const void *>(base) << " data=" << reinterpret_cast<const void *>(data) << " written=" << written);
 }
 
+bool Model::save(IDataSink *sink) const
+{
+    Header header;
+    Flags flags;
+    DataInfo info;
+    m_context->prepareSaving(header, flags, info);
+    const IString::Codec codec = info.codec;
+    internal::DataSinkWriter writer(sink);
+    writer.writeValue(header);
+    uint8 flagSize = sizeof(flags);
+    writer.writeValue(flagSize);
+    writer.writeValue(flags);
+    writer.writeString(m_context->namePtr, codec);
+    writer.writeString(m_context->englishNamePtr, codec);
+    writer.writeString(m_context->commentPtr, codec);
+    writer.writeString(m_context->englishCommentPtr, codec);
+    writer.writeObjects(m_context->vertices, info);
+    const int nindices = m_context->indices.count();
+    writer.writeValue(nindices);
+    for (int i = 0; i < nindices; i++) {
+        writer.writeSignedIndex(m_context->indices[i], flags.vertexIndexSize);
+    }
+    const int ntextures = m_context->name2textureRefs.count();
+    writer.writeValue(ntextures);
+    for (int i = 0; i < ntextures; i++) {
+        const IString *texture = *m_context->name2textureRefs.value(i);
+        writer.writeString(texture, codec);
+    }
+    writer.writeObjects(m_context->materials, info);
+    writer.writeObjects(m_context->bones, info);
+    writer.writeObjects(m_context->morphs, info);
+    writer.writeObjects(m_context->labels, info);
+    writer.writeObjects(m_context->rigidBodies, info);
+    writer.writeObjects(m_context->joints, info);
+    if (info.version >= 2.1) {
+        writer.writeObjects(m_context->softBodies, info);
+    }
+    bool ok = writer.flush();
+    VPVL2_VLOG(1, "PMXEOF: sink=" << static_cast<const void *>(sink) << " written=" << writer.written() << " ok=" << ok);
+    return ok;
+}
+
 vsize Model::estimateSize() const
 {
+    Header header;
+    Flags flags;
+    DataInfo info;
     vsize size = 0;
-    IString::Codec codec = IString::kUTF8; // TODO: UTF-16 support
-    DataInfo info = m_context->dataInfo;
-    m_context->assignIndexSize(info);
-    info.codec = codec;
+    m_context->prepareSaving(header, flags, info);
+    const IString::Codec codec = info.codec;
     size += sizeof(Header);
     size += sizeof(uint8) + sizeof(Flags);
     size += internal::estimateSize(m_context->namePtr, codec);
@@ -1064,21 +1031,25 @@ void Model::performUpdate()
         Bone *bone = m_context->bones[i];
         bone->resetIKLink();
     }
-    internal::ParallelResetVertexProcessor<pmx::Vertex> processor(&m_context->vertices);
-    processor.execute();
-    const int nmorphs = m_context->morphs.count();
-    for (int i = 0; i < nmorphs; i++) {
-        Morph *morph = m_context->morphs[i];
-        morph->syncWeight();
-    }
-    for (int i = 0; i < nmorphs; i++) {
-        Morph *morph = m_context->morphs[i];
-        morph->update();
+    {
+        VPVL2_PROFILE_STAGE(kMorphUpdateStage);
+        internal::ParallelResetVertexProcessor<pmx::Vertex> processor(&m_context->vertices);
+        processor.execute();
+        const int nmorphs = m_context->morphs.count();
+        for (int i = 0; i < nmorphs; i++) {
+            Morph *morph = m_context->morphs[i];
+            morph->syncWeight();
+        }
+        for (int i = 0; i < nmorphs; i++) {
+            Morph *morph = m_context->morphs[i];
+            morph->update();
+        }
     }
     // before physics simulation
     updateLocalTransform(m_context->bonesBeforePhysics);
     if (m_context->enablePhysics) {
         // physics simulation
+        VPVL2_PROFILE_STAGE(kRigidBodySyncStage);
         internal::ParallelUpdateRigidBodyProcessor<pmx::RigidBody> processor(&m_context->rigidBodies);
         processor.execute();
     }
@@ -1198,6 +1169,7 @@ void Model::getIndices(Array<int> &value) const
 
 bool Model::preparse(const uint8 *data, vsize size, DataInfo &info)
 {
+    VPVL2_TRACE_SCOPE("pmx", "pmx::Model::preparse");
     vsize rest = size;
     if (!data || sizeof(Header) > rest) {
         VPVL2_LOG(WARNING, "Data is null or PMX header not satisfied: " << size);
@@ -1676,11 +1648,15 @@ void Model::setPhysicsEnable(bool value)
 
 void Model::updateLocalTransform(Array<Bone *> &bones)
 {
+    VPVL2_PROFILE_STAGE(kBoneTransformStage);
     const int nbones = bones.count();
     for (int i = 0; i < nbones; i++) {
         Bone *bone = bones[i];
         bone->performTransform();
-        bone->solveInverseKinematics();
+        if (bone->hasInverseKinematics()) {
+            VPVL2_PROFILE_STAGE(kIKStage);
+            bone->solveInverseKinematics();
+        }
     }
     internal::ParallelUpdateLocalTransformProcessor<pmx::Bone> processor(&bones);
     processor.execute();
@@ -1717,9 +1693,17 @@ void Model::getMatrixBuffer(MatrixBuffer *&matrixBuffer,
     internal::deleteObject(matrixBuffer);
     if (indexBuffer && indexBuffer->ident() == &DefaultIndexBuffer::kIdent &&
             dynamicBuffer && dynamicBuffer->ident() == &DefaultDynamicVertexBuffer::kIdent) {
-        matrixBuffer = new DefaultMatrixBuffer(this,
-                                               static_cast<const DefaultIndexBuffer *>(indexBuffer),
-                                               static_cast<DefaultDynamicVertexBuffer *>(dynamicBuffer));
+        DefaultMatrixBuffer *buffer = new DefaultMatrixBuffer(this,
+                                                              static_cast<const DefaultIndexBuffer *>(indexBuffer),
+                                                              static_cast<DefaultDynamicVertexBuffer *>(dynamicBuffer));
+        if (buffer->initialize()) {
+            matrixBuffer = buffer;
+        }
+        else {
+            VPVL2_LOG(WARNING, "Cannot partition bones of the model into palettes of " << m_context->maxBonesPerDraw << " bones");
+            internal::deleteObject(buffer);
+            matrixBuffer = 0;
+        }
     }
     else {
         matrixBuffer = 0;
@@ -1766,6 +1750,16 @@ void Model::setMaxUVCount(int value)
     }
 }
 
+int Model::maxBonesPerDraw() const
+{
+    return m_context->maxBonesPerDraw;
+}
+
+void Model::setMaxBonesPerDraw(int value)
+{
+    m_context->maxBonesPerDraw = btMin(btMax(value, int(internal::BonePalette::kMinBonesPerDraw)), int(kMaxBonesPerDraw));
+}
+
 IBone *Model::createBone()
 {
     return new Bone(this);
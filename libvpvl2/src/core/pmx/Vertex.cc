@@ -134,6 +134,136 @@ struct Vertex::PrivateContext {
             morphUVs[i].setZero();
         }
     }
+    /* bone index reader of which size is resolved at compile time */
+    template<typename TIndex>
+    struct FixedIndexReader {
+        int operator()(uint8 *&ptr) const {
+            TIndex value;
+            internal::getData(ptr, value);
+            ptr += sizeof(value);
+            return value;
+        }
+    };
+    struct VariableIndexReader {
+        VariableIndexReader(vsize size)
+            : size(size)
+        {
+        }
+        int operator()(uint8 *&ptr) const {
+            return internal::readSignedIndex(ptr, size);
+        }
+        const vsize size;
+    };
+    template<typename TIndexReader>
+    bool readRecord(uint8 *&ptr, int additionalUVSize, const TIndexReader &readIndex) {
+        VertexUnit vertex;
+        internal::getData(ptr, vertex);
+        internal::setPosition(vertex.position, origin);
+        internal::setPosition(vertex.normal, normal);
+        const float32 u = vertex.texcoord[0], v = vertex.texcoord[1];
+        texcoord.setValue(u, v, 0);
+        originUVs[0].setValue(u, v, 0, 0);
+        ptr += sizeof(vertex);
+        AdditinalUVUnit uv;
+        for (int i = 0; i < additionalUVSize; i++) {
+            internal::getData(ptr, uv);
+            originUVs[i + 1].setValue(uv.value[0], uv.value[1], uv.value[2], uv.value[3]);
+            ptr += sizeof(uv);
+        }
+        type = static_cast<Type>(*ptr);
+        ptr += sizeof(uint8);
+        switch (type) {
+        case kBdef1: {
+            boneIndices[0] = readIndex(ptr);
+            break;
+        }
+        case kBdef2: {
+            for (int i = 0; i < 2; i++) {
+                boneIndices[i] = readIndex(ptr);
+            }
+            Bdef2Unit unit;
+            internal::getData(ptr, unit);
+            weight[0] = btClamped(unit.weight, 0.0f, 1.0f);
+            ptr += sizeof(unit);
+            break;
+        }
+        case kBdef4:
+        case kQdef: {
+            for (int i = 0; i < 4; i++) {
+                boneIndices[i] = readIndex(ptr);
+            }
+            Bdef4Unit unit;
+            internal::getData(ptr, unit);
+            for (int i = 0; i < 4; i++) {
+                weight[i] = btClamped(unit.weight[i], 0.0f, 1.0f);
+            }
+            ptr += sizeof(unit);
+            break;
+        }
+        case kSdef: {
+            for (int i = 0; i < 2; i++) {
+                boneIndices[i] = readIndex(ptr);
+            }
+            SdefUnit unit;
+            internal::getData(ptr, unit);
+            c.setValue(unit.c[0], unit.c[1], unit.c[2]);
+            r0.setValue(unit.r0[0], unit.r0[1], unit.r0[2]);
+            r1.setValue(unit.r1[0], unit.r1[1], unit.r1[2]);
+            weight[0] = btClamped(unit.weight, 0.0f, 1.0f);
+            ptr += sizeof(unit);
+            break;
+        }
+        default: /* unexpected value */
+            return false;
+        }
+        float32 value;
+        internal::getData(ptr, value);
+        ptr += sizeof(value);
+        edgeSize = value;
+        return true;
+    }
+    void logRecord(int additionalUVSize) const {
+        VPVL2_VLOG(3, "PMXVertex: position=" << origin.x() << "," << origin.y() << "," << origin.z());
+        VPVL2_VLOG(3, "PMXVertex: normal=" << normal.x() << "," << normal.y() << "," << normal.z());
+        VPVL2_VLOG(3, "PMXVertex: texcoord=" << texcoord.x() << "," << texcoord.y() << "," << texcoord.z());
+        for (int i = 0; i < additionalUVSize; i++) {
+            const Vector4 &v = originUVs[i + 1];
+            VPVL2_VLOG(3, "PMXVertex: uv(" << i << ")=" << v.x() << "," << v.y() << "," << v.z() << "," << v.w());
+        }
+        switch (type) {
+        case kBdef1:
+            VPVL2_VLOG(3, "PMXVertex: type=" << type << " bone=" << boneIndices[0]);
+            break;
+        case kBdef2:
+            VPVL2_VLOG(3, "PMXVertex: type=" << type << " bone=" << boneIndices[0] << "," << boneIndices[1] << " weight=" << weight[0]);
+            break;
+        case kBdef4:
+        case kQdef:
+            VPVL2_VLOG(3, "PMXVertex: type=" << type << " bone=" << boneIndices[0] << "," << boneIndices[1] << "," << boneIndices[2] << "," << boneIndices[3] << " weight=" << weight[0] << "," << weight[1] << "," << weight[2] << "," << weight[3]);
+            break;
+        case kSdef:
+            VPVL2_VLOG(3, "PMXVertex: type=" << type << " bone=" << boneIndices[0] << "," << boneIndices[1] << " weight=" << weight[0]);
+            VPVL2_VLOG(3, "PMXVertex: C=" << c.x() << "," << c.y() << "," << c.z());
+            VPVL2_VLOG(3, "PMXVertex: R0=" << r0.x() << "," << r0.y() << "," << r0.z());
+            VPVL2_VLOG(3, "PMXVertex: R1=" << r1.x() << "," << r1.y() << "," << r1.z());
+            break;
+        default:
+            break;
+        }
+    }
+    template<typename TIndexReader>
+    static void readVertices(const Model::DataInfo &info, IModel *modelRef, const TIndexReader &readIndex, Array<Vertex *> &vertices) {
+        const int nvertices = int(info.verticesCount), additionalUVSize = int(info.additionalUVSize);
+        uint8 *ptr = info.verticesPtr;
+        for (int i = 0; i < nvertices; i++) {
+            Vertex *vertex = vertices.append(new Vertex(modelRef));
+            if (!vertex->m_context->readRecord(ptr, additionalUVSize, readIndex)) {
+                /* preparse already rejects unknown types so this must not be reached */
+                break;
+            }
+        }
+    }
+
     IModel *modelRef;
     IBone *boneRefs[kMaxBones];
     IMaterial *materialRef;
@@ -292,6 +422,25 @@ bool Vertex::loadVertices(const Array<Vertex *> &vertices, const Array<Bone *> &
     return true;
 }
 
+void Vertex::readVertices(const Model::DataInfo &info, IModel *modelRef, Array<Vertex *> &vertices)
+{
+    vertices.reserve(vertices.count() + int(info.verticesCount));
+    switch (info.boneIndexSize) {
+    case 1:
+        PrivateContext::readVertices(info, modelRef, PrivateContext::FixedIndexReader<int8>(), vertices);
+        break;
+    case 2:
+        PrivateContext::readVertices(info, modelRef, PrivateContext::FixedIndexReader<int16>(), vertices);
+        break;
+    case 4:
+        PrivateContext::readVertices(info, modelRef, PrivateContext::FixedIndexReader<int32>(), vertices);
+        break;
+    default:
+        PrivateContext::readVertices(info, modelRef, PrivateContext::VariableIndexReader(info.boneIndexSize), vertices);
+        break;
+    }
+}
+
 void Vertex::writeVertices(const Array<Vertex *> &vertices, const Model::DataInfo &info, uint8 *&data)
 {
     const int32 nveritces = vertices.count();
@@ -317,84 +466,11 @@ vsize Vertex::estimateTotalSize(const Array<Vertex *> &vertices, const Model::Da
 void Vertex::read(const uint8 *data, const Model::DataInfo &info, vsize &size)
 {
     uint8 *ptr = const_cast<uint8 *>(data), *start = ptr;
-    VertexUnit vertex;
-    internal::getData(ptr, vertex);
-    internal::setPosition(vertex.position, m_context->origin);
-    VPVL2_VLOG(3, "PMXVertex: position=" << m_context->origin.x() << "," << m_context->origin.y() << "," << m_context->origin.z());
-    internal::setPosition(vertex.normal, m_context->normal);
-    VPVL2_VLOG(3, "PMXVertex: normal=" << m_context->normal.x() << "," << m_context->normal.y() << "," << m_context->normal.z());
-    float32 u = vertex.texcoord[0], v = vertex.texcoord[1];
-    m_context->texcoord.setValue(u, v, 0);
-    VPVL2_VLOG(3, "PMXVertex: texcoord=" << m_context->texcoord.x() << "," << m_context->texcoord.y() << "," << m_context->texcoord.z());
-    ptr += sizeof(vertex);
-    int additionalUVSize = int(info.additionalUVSize);
-    AdditinalUVUnit uv;
-    m_context->originUVs[0].setValue(u, v, 0, 0);
-    for (int i = 0; i < additionalUVSize; i++) {
-        internal::getData(ptr, uv);
-        Vector4 &v = m_context->originUVs[i + 1];
-        v.setValue(uv.value[0], uv.value[1], uv.value[2], uv.value[3]);
-        VPVL2_VLOG(3, "PMXVertex: uv(" << i << ")=" << v.x() << "," << v.y() << "," << v.z() << "," << v.w());
-        ptr += sizeof(uv);
-    }
-    m_context->type = static_cast<Type>(*reinterpret_cast<uint8 *>(ptr));
-    ptr += sizeof(uint8);
-    switch (m_context->type) {
-    case kBdef1: {
-        m_context->boneIndices[0] = internal::readSignedIndex(ptr, info.boneIndexSize);
-        VPVL2_VLOG(3, "PMXVertex: type=" << m_context->type << " bone=" << m_context->boneIndices[0]);
-        break;
-    }
-    case kBdef2: {
-        for (int i = 0; i < 2; i++) {
-            m_context->boneIndices[i] = internal::readSignedIndex(ptr, info.boneIndexSize);
-        }
-        Bdef2Unit unit;
-        internal::getData(ptr, unit);
-        m_context->weight[0] = btClamped(unit.weight, 0.0f, 1.0f);
-        VPVL2_VLOG(3, "PMXVertex: type=" << m_context->type << " bone=" << m_context->boneIndices[0] << "," << m_context->boneIndices[1] << " weight=" << m_context->weight[0]);
-        ptr += sizeof(unit);
-        break;
-    }
-    case kBdef4:
-    case kQdef: {
-        for (int i = 0; i < 4; i++) {
-            m_context->boneIndices[i] = internal::readSignedIndex(ptr, info.boneIndexSize);
-        }
-        Bdef4Unit unit;
-        internal::getData(ptr, unit);
-        for (int i = 0; i < 4; i++) {
-            m_context->weight[i] = btClamped(unit.weight[i], 0.0f, 1.0f);
-        }
-        VPVL2_VLOG(3, "PMXVertex: type=" << m_context->type << " bone=" << m_context->boneIndices[0] << "," << m_context->boneIndices[1] << "," << m_context->boneIndices[2] << "," << m_context->boneIndices[3] << " weight=" << m_context->weight[0] << "," << m_context->weight[1] << "," << m_context->weight[2] << "," << m_context->weight[3]);
-        ptr += sizeof(unit);
-        break;
-    }
-    case kSdef: {
-        for (int i = 0; i < 2; i++) {
-            m_context->boneIndices[i] = internal::readSignedIndex(ptr, info.boneIndexSize);
-        }
-        SdefUnit unit;
-        internal::getData(ptr, unit);
-        m_context->c.setValue(unit.c[0], unit.c[1], unit.c[2]);
-        m_context->r0.setValue(unit.r0[0], unit.r0[1], unit.r0[2]);
-        m_context->r1.setValue(unit.r1[0], unit.r1[1], unit.r1[2]);
-        m_context->weight[0] = btClamped(unit.weight, 0.0f, 1.0f);
-        VPVL2_VLOG(3, "PMXVertex: type=" << m_context->type << " bone=" << m_context->boneIndices[0] << "," << m_context->boneIndices[1] << " weight=" << m_context->weight[0]);
-        VPVL2_VLOG(3, "PMXVertex: C=" << m_context->c.x() << "," << m_context->c.y() << "," << m_context->c.z());
-        VPVL2_VLOG(3, "PMXVertex: R0=" << m_context->r0.x() << "," << m_context->r0.y() << "," << m_context->r0.z());
-        VPVL2_VLOG(3, "PMXVertex: R1=" << m_context->r1.x() << "," << m_context->r1.y() << "," << m_context->r1.z());
-        ptr += sizeof(unit);
-        break;
-    }
-    default: /* unexpected value */
-        return;
+    const int additionalUVSize = int(info.additionalUVSize);
+    if (m_context->readRecord(ptr, additionalUVSize, PrivateContext::VariableIndexReader(info.boneIndexSize))) {
+        m_context->logRecord(additionalUVSize);
+        size = ptr - start;
     }
-    float32 edgeSize;
-    internal::getData(ptr, edgeSize);
-    ptr += sizeof(edgeSize);
-    m_context->edgeSize = edgeSize;
-    size = ptr - start;
 }
 
 void Vertex::write(uint8 *&data, const Model::DataInfo &info) const
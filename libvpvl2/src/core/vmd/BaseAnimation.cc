@@ -51,7 +51,8 @@ BaseAnimation::BaseAnimation()
     : m_lastTimeIndex(0),
       m_durationTimeIndex(0),
       m_currentTimeIndex(0),
-      m_previousTimeIndex(0)
+      m_previousTimeIndex(0),
+      m_durationDirty(false)
 {
 }
 
@@ -62,6 +63,7 @@ BaseAnimation::~BaseAnimation()
     m_durationTimeIndex = 0.0f;
     m_currentTimeIndex = 0.0f;
     m_previousTimeIndex = 0.0f;
+    m_durationDirty = false;
 }
 
 void BaseAnimation::advance(const IKeyframe::TimeIndex &deltaTimeIndex)
@@ -72,7 +74,7 @@ void BaseAnimation::advance(const IKeyframe::TimeIndex &deltaTimeIndex)
 
 void BaseAnimation::rewind(const IKeyframe::TimeIndex &target, const IKeyframe::TimeIndex &deltaTimeIndex)
 {
-    m_currentTimeIndex = m_previousTimeIndex + deltaTimeIndex - m_durationTimeIndex + target;
+    m_currentTimeIndex = m_previousTimeIndex + deltaTimeIndex - duration() + target;
     m_previousTimeIndex = target;
 }
 
@@ -98,6 +100,26 @@ void BaseAnimation::deleteKeyframe(IKeyframe *&keyframe)
     internal::deleteObject(keyframe);
 }
 
+IKeyframe::TimeIndex BaseAnimation::duration() const
+{
+    /* the duration is recalculated on demand only after removing the last keyframe */
+    if (m_durationDirty) {
+        m_durationTimeIndex = calculateDuration();
+        m_durationDirty = false;
+    }
+    return m_durationTimeIndex;
+}
+
+IKeyframe::TimeIndex BaseAnimation::calculateDuration() const
+{
+    IKeyframe::TimeIndex duration = 0;
+    const int nkeyframes = m_keyframes.count();
+    for (int i = 0; i < nkeyframes; i++) {
+        btSetMax(duration, m_keyframes[i]->timeIndex());
+    }
+    return duration;
+}
+
 void BaseAnimation::getKeyframes(const IKeyframe::TimeIndex &timeIndex, Array<IKeyframe *> &keyframes) const
 {
     const int nkeyframes = m_keyframes.count();
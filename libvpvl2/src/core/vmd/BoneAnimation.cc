@@ -55,6 +55,7 @@ struct BoneAnimation::PrivateContext {
     Vector3 position;
     Quaternion rotation;
     int lastIndex;
+    bool dirty;
 
     bool isNull() const {
         if (keyframes.count() == 1) {
@@ -97,12 +98,14 @@ BoneAnimation::BoneAnimation(IEncoding *encoding)
     : BaseAnimation(),
       m_encodingRef(encoding),
       m_modelRef(0),
-      m_enableNullFrame(false)
+      m_enableNullFrame(false),
+      m_dirty(true)
 {
 }
 
 BoneAnimation::~BoneAnimation()
 {
+    m_dirtyContextRefs.clear();
     m_name2contexts.releaseAll();
     m_modelRef = 0;
 }
@@ -116,6 +119,7 @@ void BoneAnimation::read(const uint8 *data, int size)
         keyframe->read(ptr);
         ptr += keyframe->estimateSize();
     }
+    m_dirty = true;
 }
 
 void BoneAnimation::seek(const IKeyframe::TimeIndex &timeIndexAt)
@@ -144,6 +148,76 @@ void BoneAnimation::setParentModelRef(IModel *model)
     m_modelRef = model;
 }
 
+void BoneAnimation::refresh(IModel *model)
+{
+    if (m_dirty || model != m_modelRef) {
+        setParentModelRef(model);
+        return;
+    }
+    /* only tracks touched by add/remove/replace since the last refresh need to be checked */
+    const int ncontexts = m_dirtyContextRefs.count();
+    for (int i = 0; i < ncontexts; i++) {
+        PrivateContext *context = m_dirtyContextRefs[i];
+        if (internal::MotionHelper::sortKeyframesIfNeeded(context->keyframes)) {
+            context->lastIndex = 0;
+        }
+        context->dirty = false;
+    }
+    if (ncontexts > 0) {
+        m_durationDirty = true;
+        m_dirtyContextRefs.clear();
+    }
+}
+
+void BoneAnimation::addKeyframe(IKeyframe *keyframe)
+{
+    BaseAnimation::addKeyframe(keyframe);
+    if (m_modelRef && !m_dirty) {
+        if (PrivateContext *context = resolvePrivateContext(keyframe->name(), m_modelRef)) {
+            internal::MotionHelper::insertKeyframe(reinterpret_cast<BoneKeyframe *>(keyframe), context->keyframes);
+            context->lastIndex = 0;
+            markContextDirty(context);
+            btSetMax(m_durationTimeIndex, keyframe->timeIndex());
+        }
+    }
+}
+
+void BoneAnimation::removeKeyframe(IKeyframe *keyframe)
+{
+    BaseAnimation::removeKeyframe(keyframe);
+    if (m_modelRef && !m_dirty && keyframe && keyframe->name()) {
+        const HashString &key = keyframe->name()->toHashString();
+        if (PrivateContext *const *ptr = m_name2contexts.find(key)) {
+            PrivateContext *context = *ptr;
+            if (internal::MotionHelper::removeKeyframe(keyframe, context->keyframes) == -1) {
+                return;
+            }
+            context->lastIndex = 0;
+            if (context->keyframes.count() == 0) {
+                if (context->dirty) {
+                    m_dirtyContextRefs.remove(context);
+                }
+                m_name2contexts.remove(key);
+                internal::deleteObject(context);
+            }
+            else {
+                markContextDirty(context);
+            }
+            if (keyframe->timeIndex() >= m_durationTimeIndex) {
+                m_durationDirty = true;
+            }
+        }
+    }
+}
+
+void BoneAnimation::setAllKeyframes(const Array<IKeyframe *> &value, IKeyframe::Type type)
+{
+    BaseAnimation::setAllKeyframes(value, type);
+    m_dirtyContextRefs.clear();
+    m_name2contexts.releaseAll();
+    m_dirty = true;
+}
+
 BoneKeyframe *BoneAnimation::findKeyframeAt(int i) const
 {
     return internal::checkBound(i, 0, m_keyframes.count()) ? reinterpret_cast<BoneKeyframe *>(m_keyframes[i]) : 0;
@@ -164,31 +238,53 @@ BoneKeyframe *BoneAnimation::findKeyframe(const IKeyframe::TimeIndex &timeIndex,
     return 0;
 }
 
+IKeyframe::TimeIndex BoneAnimation::calculateDuration() const
+{
+    IKeyframe::TimeIndex duration = 0;
+    const int ncontexts = m_name2contexts.count();
+    for (int i = 0; i < ncontexts; i++) {
+        const PrivateContext *context = *m_name2contexts.value(i);
+        const Array<BoneKeyframe *> &keyframes = context->keyframes;
+        btSetMax(duration, keyframes[keyframes.count() - 1]->timeIndex());
+    }
+    return duration;
+}
+
+BoneAnimation::PrivateContext *BoneAnimation::resolvePrivateContext(const IString *name, IModel *model)
+{
+    if (!name) {
+        return 0;
+    }
+    const HashString &key = name->toHashString();
+    if (PrivateContext *const *ptr = m_name2contexts.find(key)) {
+        return *ptr;
+    }
+    else if (IBone *bone = model->findBoneRef(name)) {
+        PrivateContext *context = m_name2contexts.insert(key, new PrivateContext());
+        context->bone = bone;
+        context->lastIndex = 0;
+        context->dirty = false;
+        context->position.setZero();
+        context->rotation.setValue(0.0f, 0.0f, 0.0f, 1.0f);
+        return context;
+    }
+    return 0;
+}
+
 void BoneAnimation::createPrivateContexts(IModel *model)
 {
     if (!model) {
         return;
     }
     const int nkeyframes = m_keyframes.count();
+    m_dirtyContextRefs.clear();
     m_name2contexts.releaseAll();
     // Build internal node to find by name, not frame index
     for (int i = 0; i < nkeyframes; i++) {
         BoneKeyframe *keyframe = reinterpret_cast<BoneKeyframe *>(m_keyframes.at(i));
-        const IString *name = keyframe->name();
-        const HashString &key = name->toHashString();
-        PrivateContext **ptr = m_name2contexts[key], *context;
-        if (ptr) {
-            context = *ptr;
+        if (PrivateContext *context = resolvePrivateContext(keyframe->name(), model)) {
             context->keyframes.append(keyframe);
         }
-        else if (IBone *bone = model->findBoneRef(name)) {
-            PrivateContext *context = m_name2contexts.insert(key, new PrivateContext());
-            context->keyframes.append(keyframe);
-            context->bone = bone;
-            context->lastIndex = 0;
-            context->position.setZero();
-            context->rotation.setValue(0.0f, 0.0f, 0.0f, 1.0f);
-        }
     }
     // Sort frames from each internal nodes by frame index ascend
     const int ncontexts = m_name2contexts.count();
@@ -196,8 +292,10 @@ void BoneAnimation::createPrivateContexts(IModel *model)
         PrivateContext *context = *m_name2contexts.value(i);
         Array<BoneKeyframe *> &keyframes = context->keyframes;
         keyframes.sort(internal::MotionHelper::KeyframeTimeIndexPredication());
-        btSetMax(m_durationTimeIndex, keyframes[keyframes.count() - 1]->timeIndex());
     }
+    m_durationTimeIndex = calculateDuration();
+    m_durationDirty = false;
+    m_dirty = false;
 }
 
 void BoneAnimation::calculateKeyframes(const IKeyframe::TimeIndex &timeIndexAt, PrivateContext *context)
@@ -243,6 +341,14 @@ void BoneAnimation::calculateKeyframes(const IKeyframe::TimeIndex &timeIndexAt,
     }
 }
 
+void BoneAnimation::markContextDirty(PrivateContext *context)
+{
+    if (!context->dirty) {
+        m_dirtyContextRefs.append(context);
+        context->dirty = true;
+    }
+}
+
 void BoneAnimation::reset()
 {
     BaseAnimation::reset();
@@ -53,6 +53,7 @@ struct MorphAnimation::PrivateContext {
     Array<MorphKeyframe *> keyframes;
     IMorph::WeightPrecision weight;
     int lastIndex;
+    bool dirty;
 
     bool isNull() const {
         if (keyframes.count() == 1) {
@@ -67,12 +68,14 @@ MorphAnimation::MorphAnimation(IEncoding *encoding)
     : BaseAnimation(),
       m_encodingRef(encoding),
       m_modelRef(0),
-      m_enableNullFrame(false)
+      m_enableNullFrame(false),
+      m_dirty(true)
 {
 }
 
 MorphAnimation::~MorphAnimation()
 {
+    m_dirtyContextRefs.clear();
     m_name2contexts.releaseAll();
     m_modelRef = 0;
 }
@@ -86,6 +89,7 @@ void MorphAnimation::read(const uint8 *data, int size)
         keyframe->read(ptr);
         ptr += keyframe->estimateSize();
     }
+    m_dirty = true;
 }
 
 void MorphAnimation::seek(const IKeyframe::TimeIndex &timeIndexAt)
@@ -113,29 +117,120 @@ void MorphAnimation::setParentModelRef(IModel *model)
     m_modelRef = model;
 }
 
+void MorphAnimation::refresh(IModel *model)
+{
+    if (m_dirty || model != m_modelRef) {
+        setParentModelRef(model);
+        return;
+    }
+    const int ncontexts = m_dirtyContextRefs.count();
+    for (int i = 0; i < ncontexts; i++) {
+        PrivateContext *context = m_dirtyContextRefs[i];
+        if (internal::MotionHelper::sortKeyframesIfNeeded(context->keyframes)) {
+            context->lastIndex = 0;
+        }
+        context->dirty = false;
+    }
+    if (ncontexts > 0) {
+        m_durationDirty = true;
+        m_dirtyContextRefs.clear();
+    }
+}
+
+void MorphAnimation::addKeyframe(IKeyframe *keyframe)
+{
+    BaseAnimation::addKeyframe(keyframe);
+    if (m_modelRef && !m_dirty) {
+        if (PrivateContext *context = resolvePrivateContext(keyframe->name(), m_modelRef)) {
+            internal::MotionHelper::insertKeyframe(reinterpret_cast<MorphKeyframe *>(keyframe), context->keyframes);
+            context->lastIndex = 0;
+            markContextDirty(context);
+            btSetMax(m_durationTimeIndex, keyframe->timeIndex());
+        }
+    }
+}
+
+void MorphAnimation::removeKeyframe(IKeyframe *keyframe)
+{
+    BaseAnimation::removeKeyframe(keyframe);
+    if (m_modelRef && !m_dirty && keyframe && keyframe->name()) {
+        const HashString &key = keyframe->name()->toHashString();
+        if (PrivateContext *const *ptr = m_name2contexts.find(key)) {
+            PrivateContext *context = *ptr;
+            if (internal::MotionHelper::removeKeyframe(keyframe, context->keyframes) == -1) {
+                return;
+            }
+            context->lastIndex = 0;
+            if (context->keyframes.count() == 0) {
+                if (context->dirty) {
+                    m_dirtyContextRefs.remove(context);
+                }
+                m_name2contexts.remove(key);
+                internal::deleteObject(context);
+            }
+            else {
+                markContextDirty(context);
+            }
+            if (keyframe->timeIndex() >= m_durationTimeIndex) {
+                m_durationDirty = true;
+            }
+        }
+    }
+}
+
+void MorphAnimation::setAllKeyframes(const Array<IKeyframe *> &value, IKeyframe::Type type)
+{
+    BaseAnimation::setAllKeyframes(value, type);
+    m_dirtyContextRefs.clear();
+    m_name2contexts.releaseAll();
+    m_dirty = true;
+}
+
+IKeyframe::TimeIndex MorphAnimation::calculateDuration() const
+{
+    IKeyframe::TimeIndex duration = 0;
+    const int ncontexts = m_name2contexts.count();
+    for (int i = 0; i < ncontexts; i++) {
+        const PrivateContext *context = *m_name2contexts.value(i);
+        const Array<MorphKeyframe *> &keyframes = context->keyframes;
+        btSetMax(duration, keyframes[keyframes.count() - 1]->timeIndex());
+    }
+    return duration;
+}
+
+MorphAnimation::PrivateContext *MorphAnimation::resolvePrivateContext(const IString *name, IModel *model)
+{
+    if (!name) {
+        return 0;
+    }
+    const HashString &key = name->toHashString();
+    if (PrivateContext *const *ptr = m_name2contexts.find(key)) {
+        return *ptr;
+    }
+    else if (IMorph *morph = model->findMorphRef(name)) {
+        PrivateContext *context = m_name2contexts.insert(key, new PrivateContext());
+        context->morph = morph;
+        context->lastIndex = 0;
+        context->dirty = false;
+        context->weight = 0.0f;
+        return context;
+    }
+    return 0;
+}
+
 void MorphAnimation::createPrivateContexts(IModel *model)
 {
     if (!model) {
         return;
     }
     const int nkeyframes = m_keyframes.count();
+    m_dirtyContextRefs.clear();
     m_name2contexts.releaseAll();
     // Build internal node to find by name, not frame index
     for (int i = 0; i < nkeyframes; i++) {
         MorphKeyframe *keyframe = reinterpret_cast<MorphKeyframe *>(m_keyframes.at(i));
-        const IString *name = keyframe->name();
-        const HashString &key = name->toHashString();
-        PrivateContext **ptr = m_name2contexts[key], *context;
-        if (ptr) {
-            context = *ptr;
-            context->keyframes.append(keyframe);
-        }
-        else if (IMorph *morph = model->findMorphRef(name)) {
-            PrivateContext *context = m_name2contexts.insert(key, new PrivateContext());
+        if (PrivateContext *context = resolvePrivateContext(keyframe->name(), model)) {
             context->keyframes.append(keyframe);
-            context->morph = morph;
-            context->lastIndex = 0;
-            context->weight = 0.0f;
         }
     }
     // Sort frames from each internal nodes by frame index ascend
@@ -144,7 +239,17 @@ void MorphAnimation::createPrivateContexts(IModel *model)
         PrivateContext *context = *m_name2contexts.value(i);
         Array<MorphKeyframe *> &keyframes = context->keyframes;
         keyframes.sort(internal::MotionHelper::KeyframeTimeIndexPredication());
-        btSetMax(m_durationTimeIndex, keyframes[keyframes.count() - 1]->timeIndex());
+    }
+    m_durationTimeIndex = calculateDuration();
+    m_durationDirty = false;
+    m_dirty = false;
+}
+
+void MorphAnimation::markContextDirty(PrivateContext *context)
+{
+    if (!context->dirty) {
+        m_dirtyContextRefs.append(context);
+        context->dirty = true;
     }
 }
 
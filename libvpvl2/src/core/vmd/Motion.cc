@@ -38,6 +38,7 @@
 */
 
 #include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/DataSinkWriter.h"
 #include "vpvl2/internal/MotionHelper.h"
 
 #include "vpvl2/vmd/BoneAnimation.h"
@@ -83,27 +84,48 @@ struct Motion::PrivateContext {
         release();
     }
 
+    void writeName(uint8 *data) const {
+        /* the byte array is null terminated and may be shorter than the field */
+        internal::zerofill(data, kNameSize);
+        if (uint8 *bytes = encodingRef->toByteArray(name, IString::kShiftJIS)) {
+            const vsize length = std::strlen(reinterpret_cast<const char *>(bytes));
+            internal::copyBytes(data, bytes, btMin(length, vsize(kNameSize)));
+            encodingRef->disposeByteArray(bytes);
+        }
+    }
     void parseHeader(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseHeader");
         name = encodingRef->toString(info.namePtr, IString::kShiftJIS, kNameSize);
     }
     void parseBoneKeyframes(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseBoneKeyframes");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.boneKeyframeCount);
         boneMotion.read(info.boneKeyframePtr, info.boneKeyframeCount);
         boneMotion.setParentModelRef(parentModelRef);
     }
     void parseMorphKeyframes(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseMorphKeyframes");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.morphKeyframeCount);
         morphMotion.read(info.morphKeyframePtr, info.morphKeyframeCount);
         morphMotion.setParentModelRef(parentModelRef);
     }
     void parseCameraKeyframes(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseCameraKeyframes");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.cameraKeyframeCount);
         cameraMotion.read(info.cameraKeyframePtr, info.cameraKeyframeCount);
     }
     void parseLightKeyframes(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseLightKeyframes");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.lightKeyframeCount);
         lightMotion.read(info.lightKeyframePtr, info.lightKeyframeCount);
     }
     void parseSelfShadowKeyframes(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseSelfShadowKeyframes");
         projectMotion.read(info.selfShadowKeyframePtr, info.selfShadowKeyframeCount);
     }
     void parseModelKeyframes(const Motion::DataInfo &info) {
+        VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::parseModelKeyframes");
+        VPVL2_TRACE_COUNT(kParsedObjectCounter, info.modelKeyframeCount);
         modelMotion.read(info.modelKeyframePtr, info.modelKeyframeCount);
     }
     void release() {
@@ -147,6 +169,7 @@ Motion::~Motion()
 
 bool Motion::preparse(const uint8 *data, vsize size, DataInfo &info)
 {
+    VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::preparse");
     vsize rest = size;
     // Header(30) + Name(20)
     if (!data || kSignatureSize + kNameSize > rest) {
@@ -283,6 +306,7 @@ bool Motion::preparse(const uint8 *data, vsize size, DataInfo &info)
 
 bool Motion::load(const uint8 *data, vsize size)
 {
+    VPVL2_TRACE_SCOPE("vmd", "vmd::Motion::load");
     DataInfo info;
     internal::zerofill(&info, sizeof(info));
     if (preparse(data, size, info)) {
@@ -302,9 +326,7 @@ bool Motion::load(const uint8 *data, vsize size)
 void Motion::save(uint8 *data) const
 {
     internal::writeBytes(kSignature, kSignatureSize, data);
-    uint8 *name = m_context->encodingRef->toByteArray(m_context->name, IString::kShiftJIS);
-    internal::copyBytes(data, name, kNameSize);
-    m_context->encodingRef->disposeByteArray(name);
+    m_context->writeName(data);
     data += kNameSize;
     int32 nBoneKeyframes = m_context->boneMotion.countKeyframes();
     internal::writeBytes(&nBoneKeyframes, sizeof(nBoneKeyframes), data);
@@ -347,6 +369,45 @@ void Motion::save(uint8 *data) const
     }
 }
 
+bool Motion::save(IDataSink *sink) const
+{
+    internal::DataSinkWriter writer(sink);
+    writer.write(kSignature, kSignatureSize);
+    m_context->writeName(writer.reserve(kNameSize));
+    writer.commit(kNameSize);
+    int32 nBoneKeyframes = m_context->boneMotion.countKeyframes();
+    writer.writeValue(nBoneKeyframes);
+    for (int32 i = 0; i < nBoneKeyframes; i++) {
+        writer.writeKeyframe(m_context->boneMotion.findKeyframeAt(i), BoneKeyframe::strideSize());
+    }
+    int32 nMorphKeyframes = m_context->morphMotion.countKeyframes();
+    writer.writeValue(nMorphKeyframes);
+    for (int32 i = 0; i < nMorphKeyframes; i++) {
+        writer.writeKeyframe(m_context->morphMotion.findKeyframeAt(i), MorphKeyframe::strideSize());
+    }
+    int32 nCameraKeyframes = m_context->cameraMotion.countKeyframes();
+    writer.writeValue(nCameraKeyframes);
+    for (int32 i = 0; i < nCameraKeyframes; i++) {
+        writer.writeKeyframe(m_context->cameraMotion.findKeyframeAt(i), CameraKeyframe::strideSize());
+    }
+    int32 nLightKeyframes = m_context->lightMotion.countKeyframes();
+    writer.writeValue(nLightKeyframes);
+    for (int32 i = 0; i < nLightKeyframes; i++) {
+        writer.writeKeyframe(m_context->lightMotion.findKeyframeAt(i), LightKeyframe::strideSize());
+    }
+    int32 emptyShadowKeyframes = 0;
+    writer.writeValue(emptyShadowKeyframes);
+    int32 nModelKeyframes = m_context->modelMotion.countKeyframes();
+    if (nModelKeyframes > 0) {
+        writer.writeValue(nModelKeyframes);
+        for (int32 i = 0; i < nModelKeyframes; i++) {
+            const ModelKeyframe *keyframe = m_context->modelMotion.findKeyframeAt(i);
+            writer.writeKeyframe(keyframe, keyframe->estimateSize());
+        }
+    }
+    return writer.flush();
+}
+
 vsize Motion::estimateSize() const
 {
     /*
@@ -522,6 +583,11 @@ void Motion::replaceKeyframe(IKeyframe *value, bool alsoDelete)
     if (!value) {
         return;
     }
+    /* the keyframe may be already owned and its time index changed directly so detach it to reinsert in order */
+    if (BaseAnimation *const *animationPtr = m_context->type2animationRefs.find(value->type())) {
+        BaseAnimation *animation = *animationPtr;
+        animation->removeKeyframe(value);
+    }
     IKeyframe *keyframeToDelete = 0;
     switch (value->type()) {
     case IKeyframe::kBoneKeyframe: {
@@ -723,7 +789,7 @@ void Motion::update(IKeyframe::Type type)
 {
     switch (type) {
     case IKeyframe::kBoneKeyframe:
-        m_context->boneMotion.setParentModelRef(m_context->parentModelRef);
+        m_context->boneMotion.refresh(m_context->parentModelRef);
         break;
     case IKeyframe::kCameraKeyframe:
         m_context->cameraMotion.update();
@@ -732,7 +798,7 @@ void Motion::update(IKeyframe::Type type)
         m_context->lightMotion.update();
         break;
     case IKeyframe::kMorphKeyframe:
-        m_context->morphMotion.setParentModelRef(m_context->parentModelRef);
+        m_context->morphMotion.refresh(m_context->parentModelRef);
         break;
     case IKeyframe::kProjectKeyframe:
         m_context->projectMotion.update();
@@ -44,6 +44,7 @@
 
 #include "vpvl2/IApplicationContext.h"
 #include "vpvl2/cl/PMXAccelerator.h"
+#include "vpvl2/extensions/gl/VertexBundle.h"
 #include "vpvl2/pmx/Bone.h"
 #include "vpvl2/pmx/Material.h"
 #include "vpvl2/pmx/Vertex.h"
@@ -55,11 +56,84 @@ namespace vpvl2
 {
 namespace cl
 {
+using namespace extensions::gl;
 
 static const char kProgramCompileFlags[] = "-cl-fast-relaxed-math";
 static const int kMaxBonesPerVertex = 4;
 
 struct PMXAccelerator::PrivateContext {
+    PrivateContext(SceneAccelerator *sceneAcceleratorRef, IModel *modelRef)
+        : sceneAcceleratorRef(sceneAcceleratorRef),
+          modelRef(modelRef),
+          dynamicBufferRef(0),
+          materialEdgeSizeBuffer(0),
+          boneWeightsBuffer(0),
+          boneIndicesBuffer(0),
+          boneMatricesBuffer(0),
+          aabbMinBuffer(0),
+          aabbMaxBuffer(0),
+          aabbMinRef(0),
+          aabbMaxRef(0),
+          targetBufferName(0),
+          nvertices(0),
+          nbones(0),
+          slot(-1),
+          vertexBase(0),
+          bufferBase(0),
+          boneBase(0),
+          isBufferAllocated(false),
+          isRegistered(false),
+          isPending(false),
+          needsBindPose(true)
+    {
+    }
+    ~PrivateContext() {
+        isBufferAllocated = false;
+        internal::deleteObject(materialEdgeSizeBuffer);
+        internal::deleteObject(boneWeightsBuffer);
+        internal::deleteObject(boneIndicesBuffer);
+        internal::deleteObject(boneMatricesBuffer);
+        internal::deleteObject(aabbMinBuffer);
+        internal::deleteObject(aabbMaxBuffer);
+        sceneAcceleratorRef = 0;
+        modelRef = 0;
+        dynamicBufferRef = 0;
+        aabbMinRef = 0;
+        aabbMaxRef = 0;
+    }
+
+    SceneAccelerator *sceneAcceleratorRef;
+    IModel *modelRef;
+    const IModel::DynamicVertexBuffer *dynamicBufferRef;
+    ::cl::Buffer *materialEdgeSizeBuffer;
+    ::cl::Buffer *boneWeightsBuffer;
+    ::cl::Buffer *boneIndicesBuffer;
+    ::cl::Buffer *boneMatricesBuffer;
+    ::cl::Buffer *aabbMinBuffer;
+    ::cl::Buffer *aabbMaxBuffer;
+    Array<float32> boneTransform;
+    Array<int32> boneIndices;
+    Array<float32> boneWeights;
+    Array<float32> materialEdgeSize;
+    Vector3 *aabbMinRef;
+    Vector3 *aabbMaxRef;
+    GLuint targetBufferName;
+    int nvertices;
+    int nbones;
+    int slot;
+    int vertexBase;
+    int bufferBase;
+    int boneBase;
+    bool isBufferAllocated;
+    bool isRegistered;
+    bool isPending;
+    bool needsBindPose;
+};
+
+struct SceneAccelerator::PrivateContext {
+    typedef void (GLAPIENTRY * PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+    typedef void (GLAPIENTRY * PFNGLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data);
+
     static void dumpPlatform(const ::cl::Platform &platform) {
         std::string value;
         platform.getInfo(CL_PLATFORM_NAME, &value);
@@ -89,21 +163,29 @@ struct PMXAccelerator::PrivateContext {
         VPVL2_LOG(INFO, "CL_DEVICE_EXTENSIONS: " << value);
     }
 
-    PrivateContext(const Scene *sceneRef, IApplicationContext *applicationContextRef, IModel *modelRef, Scene::AccelerationType accelerationType)
+    PrivateContext(const Scene *sceneRef, IApplicationContext *applicationContextRef, Scene::AccelerationType accelerationType)
         : sceneRef(sceneRef),
-          modelRef(modelRef),
+          bindBuffer(0),
+          bufferSubData(0),
           context(0),
           commandQueue(0),
           program(0),
           performSkinningKernel(0),
-          materialEdgeSizeBuffer(0),
           boneWeightsBuffer(0),
           boneIndicesBuffer(0),
+          materialEdgeSizeBuffer(0),
+          vertexModelIndicesBuffer(0),
+          modelLayoutsBuffer(0),
+          modelOffsetsBuffer(0),
+          modelParametersBuffer(0),
           boneMatricesBuffer(0),
-          aabbMinBuffer(0),
-          aabbMaxBuffer(0),
+          inputVerticesBuffer(0),
+          outputVerticesBuffer(0),
           localWGSizeForPerformSkinning(0),
-          isBufferAllocated(false)
+          nvertices(0),
+          isHostResident(false),
+          isLayoutDirty(false),
+          hasPendingResults(false)
     {
         cl_device_type deviceType;
         switch (accelerationType) {
@@ -117,104 +199,355 @@ struct PMXAccelerator::PrivateContext {
             deviceType = CL_DEVICE_TYPE_DEFAULT;
             break;
         }
+        /* CPU runtimes such as POCL are not always the first platform */
         std::vector< ::cl::Platform > platforms;
         ::cl::Platform::get(&platforms);
-        if (platforms.size() > 0) {
-            const ::cl::Platform &platform = platforms[0];
-            cl_context_properties properties[] = {
-                CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(),
-    #if defined(VPVL2_OS_WINDOWS)
-                CL_GL_CONTEXT_KHR,
-                reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLContext()),
-                CL_WGL_HDC_KHR,
-                reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLDevice()),
-    #elif defined(VPVL2_OS_OSX)
-                CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE,
-                reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLDevice()),
-    #elif defined(VPVL2_OS_LINUX)
-                CL_GL_CONTEXT_KHR,
-                reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLContext()),
-                CL_GLX_DISPLAY_KHR,
-                reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLDevice()),
-    #endif
-                0
-            };
-            dumpPlatform(platform);
-            context = new ::cl::Context(deviceType, properties);
-            devices = context->getInfo<CL_CONTEXT_DEVICES>();
-            const IString *source = applicationContextRef->loadKernelSource(IApplicationContext::kModelSkinningKernel, 0);
-            if (source && devices.size() > 0) {
-                const ::cl::Device &device = devices[0];
-                dumpDevice(device);
-                const char *sourceText = reinterpret_cast<const char *>(source->toByteArray());
-                const vsize sourceSize = source->length(IString::kUTF8);
-                ::cl::Program::Sources sourceData(1, std::make_pair(sourceText, sourceSize));
-                internal::deleteObject(program);
-                program = new ::cl::Program(*context, sourceData);
-                program->build(devices);
-                internal::deleteObject(performSkinningKernel);
-                performSkinningKernel = new ::cl::Kernel(*program, "performSkinning2");
-                performSkinningKernel->getWorkGroupInfo(device, CL_KERNEL_WORK_GROUP_SIZE, &localWGSizeForPerformSkinning);
-                commandQueue = new ::cl::CommandQueue(*context, device);
+        const int nplatforms = int(platforms.size());
+        for (int i = 0; i < nplatforms; i++) {
+            std::vector< ::cl::Device > candidates;
+            if (platforms[i].getDevices(deviceType, &candidates) == CL_SUCCESS && candidates.size() > 0) {
+                createContext(platforms[i], candidates[0], applicationContextRef);
+                break;
             }
-            internal::deleteObject(source);
         }
+        const IApplicationContext::FunctionResolver *resolver = applicationContextRef->sharedFunctionResolverInstance();
+        bindBuffer = reinterpret_cast<PFNGLBINDBUFFERPROC>(resolver->resolveSymbol("glBindBuffer"));
+        bufferSubData = reinterpret_cast<PFNGLBUFFERSUBDATAPROC>(resolver->resolveSymbol("glBufferSubData"));
     }
     ~PrivateContext() {
+        waitForAllEvents();
+        acceleratorRefs.clear();
+        pendingAcceleratorRefs.clear();
         localWGSizeForPerformSkinning = 0;
-        isBufferAllocated = false;
-        internal::deleteObject(materialEdgeSizeBuffer);
-        internal::deleteObject(boneWeightsBuffer);
-        internal::deleteObject(boneIndicesBuffer);
-        internal::deleteObject(boneMatricesBuffer);
-        internal::deleteObject(aabbMinBuffer);
-        internal::deleteObject(aabbMaxBuffer);
+        nvertices = 0;
+        releaseBatchBuffers();
         internal::deleteObject(performSkinningKernel);
         internal::deleteObject(program);
         internal::deleteObject(commandQueue);
         internal::deleteObject(context);
-        modelRef = 0;
+        sceneRef = 0;
+    }
+
+    void createContext(const ::cl::Platform &platform, const ::cl::Device &device, IApplicationContext *applicationContextRef) {
+        dumpPlatform(platform);
+        dumpDevice(device);
+        /* skinned vertices of CPU devices are on host memory already so GL interop is not needed */
+        isHostResident = (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU) != 0;
+        cl_context_properties hostProperties[] = {
+            CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(),
+            0
+        };
+        cl_context_properties sharedProperties[] = {
+            CL_CONTEXT_PLATFORM, (cl_context_properties)(platform)(),
+#if defined(VPVL2_OS_WINDOWS)
+            CL_GL_CONTEXT_KHR,
+            reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLContext()),
+            CL_WGL_HDC_KHR,
+            reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLDevice()),
+#elif defined(VPVL2_OS_OSX)
+            CL_CONTEXT_PROPERTY_USE_CGL_SHAREGROUP_APPLE,
+            reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLDevice()),
+#elif defined(VPVL2_OS_LINUX)
+            CL_GL_CONTEXT_KHR,
+            reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLContext()),
+            CL_GLX_DISPLAY_KHR,
+            reinterpret_cast<cl_context_properties>(Scene::opaqueCurrentPlatformOpenGLDevice()),
+#endif
+            0
+        };
+        devices.push_back(device);
+        context = new ::cl::Context(devices, isHostResident ? hostProperties : sharedProperties);
+        const IString *source = applicationContextRef->loadKernelSource(IApplicationContext::kModelSkinningKernel, 0);
+        if (source) {
+            const char *sourceText = reinterpret_cast<const char *>(source->toByteArray());
+            const vsize sourceSize = source->length(IString::kUTF8);
+            ::cl::Program::Sources sourceData(1, std::make_pair(sourceText, sourceSize));
+            program = new ::cl::Program(*context, sourceData);
+            program->build(devices);
+            performSkinningKernel = new ::cl::Kernel(*program, isHostResident ? "performSkinningBatch" : "performSkinning2");
+            performSkinningKernel->getWorkGroupInfo(device, CL_KERNEL_WORK_GROUP_SIZE, &localWGSizeForPerformSkinning);
+            commandQueue = new ::cl::CommandQueue(*context, device);
+        }
+        internal::deleteObject(source);
+    }
+    void releaseBatchBuffers() {
+        internal::deleteObject(boneWeightsBuffer);
+        internal::deleteObject(boneIndicesBuffer);
+        internal::deleteObject(materialEdgeSizeBuffer);
+        internal::deleteObject(vertexModelIndicesBuffer);
+        internal::deleteObject(modelLayoutsBuffer);
+        internal::deleteObject(modelOffsetsBuffer);
+        internal::deleteObject(modelParametersBuffer);
+        internal::deleteObject(boneMatricesBuffer);
+        internal::deleteObject(inputVerticesBuffer);
+        internal::deleteObject(outputVerticesBuffer);
+    }
+    void addAcceleratorRef(PMXAccelerator *value) {
+        PMXAccelerator::PrivateContext *acceleratorContext = value->m_context;
+        if (!acceleratorContext->isRegistered) {
+            waitForAllEvents();
+            acceleratorRefs.append(value);
+            acceleratorContext->isRegistered = true;
+            isLayoutDirty = true;
+        }
+    }
+    void removeAcceleratorRef(PMXAccelerator *value) {
+        PMXAccelerator::PrivateContext *acceleratorContext = value->m_context;
+        if (acceleratorContext->isRegistered) {
+            /* the batch may still read or write the slots of the accelerator */
+            waitForAllEvents();
+            acceleratorRefs.remove(value);
+            acceleratorContext->isRegistered = false;
+            isLayoutDirty = true;
+        }
+    }
+    void waitForAllEvents() {
+        if (pendingAcceleratorRefs.count() > 0) {
+            finish();
+        }
+    }
+    void rebuildLayout() {
+        waitForAllEvents();
+        const int naccelerators = acceleratorRefs.count();
+        Array<int32> newBoneIndices, newVertexModelIndices, newModelLayouts, newModelOffsets;
+        Array<float32> newBoneWeights, newMaterialEdgeSize;
+        int nfloat4s = 0, nbones = 0;
+        nvertices = 0;
+        for (int i = 0; i < naccelerators; i++) {
+            PMXAccelerator::PrivateContext *acceleratorContext = acceleratorRefs[i]->m_context;
+            const IModel::DynamicVertexBuffer *dynamicBufferRef = acceleratorContext->dynamicBufferRef;
+            const int strideSize = int(dynamicBufferRef->strideSize() >> 4);
+            acceleratorContext->slot = i;
+            acceleratorContext->vertexBase = nvertices;
+            acceleratorContext->bufferBase = nfloat4s;
+            acceleratorContext->boneBase = nbones;
+            acceleratorContext->needsBindPose = true;
+            newModelLayouts.append(strideSize);
+            newModelLayouts.append(int(dynamicBufferRef->strideOffset(IModel::DynamicVertexBuffer::kVertexStride) >> 4));
+            newModelLayouts.append(int(dynamicBufferRef->strideOffset(IModel::DynamicVertexBuffer::kNormalStride) >> 4));
+            newModelLayouts.append(int(dynamicBufferRef->strideOffset(IModel::DynamicVertexBuffer::kEdgeVertexStride) >> 4));
+            newModelOffsets.append(nvertices);
+            newModelOffsets.append(nfloat4s);
+            newModelOffsets.append(nbones);
+            newModelOffsets.append(acceleratorContext->nvertices);
+            const int nmodelVertices = acceleratorContext->nvertices;
+            for (int j = 0; j < nmodelVertices; j++) {
+                for (int k = 0; k < kMaxBonesPerVertex; k++) {
+                    const int index = j * kMaxBonesPerVertex + k;
+                    newBoneIndices.append(acceleratorContext->boneIndices[index]);
+                    newBoneWeights.append(acceleratorContext->boneWeights[index]);
+                }
+                newMaterialEdgeSize.append(acceleratorContext->materialEdgeSize[j]);
+                newVertexModelIndices.append(i);
+            }
+            nvertices += nmodelVertices;
+            nfloat4s += nmodelVertices * strideSize;
+            nbones += acceleratorContext->nbones;
+        }
+        releaseBatchBuffers();
+        boneMatrices.resize(nbones << 4);
+        modelParameters.resize(naccelerators * 4);
+        for (int i = 0; i < naccelerators * 4; i++) {
+            modelParameters[i] = 0;
+        }
+        inputVertices.resize(nfloat4s << 4);
+        outputVertices.resize(nfloat4s << 4);
+        if (nvertices > 0) {
+            const vsize nindices = vsize(nvertices) * kMaxBonesPerVertex;
+            boneIndicesBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, nindices * sizeof(int32));
+            boneWeightsBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, nindices * sizeof(float32));
+            materialEdgeSizeBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, nvertices * sizeof(float32));
+            vertexModelIndicesBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, nvertices * sizeof(int32));
+            modelLayoutsBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, naccelerators * 4 * sizeof(int32));
+            modelOffsetsBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, naccelerators * 4 * sizeof(int32));
+            modelParametersBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, naccelerators * 4 * sizeof(float32));
+            boneMatricesBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY, btMax(nbones << 4, 16) * sizeof(float32));
+            inputVerticesBuffer = new ::cl::Buffer(*context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, inputVertices.count());
+            outputVerticesBuffer = new ::cl::Buffer(*context, CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, outputVertices.count());
+            commandQueue->enqueueWriteBuffer(*boneIndicesBuffer, CL_TRUE, 0, nindices * sizeof(int32), &newBoneIndices[0]);
+            commandQueue->enqueueWriteBuffer(*boneWeightsBuffer, CL_TRUE, 0, nindices * sizeof(float32), &newBoneWeights[0]);
+            commandQueue->enqueueWriteBuffer(*materialEdgeSizeBuffer, CL_TRUE, 0, nvertices * sizeof(float32), &newMaterialEdgeSize[0]);
+            commandQueue->enqueueWriteBuffer(*vertexModelIndicesBuffer, CL_TRUE, 0, nvertices * sizeof(int32), &newVertexModelIndices[0]);
+            commandQueue->enqueueWriteBuffer(*modelLayoutsBuffer, CL_TRUE, 0, naccelerators * 4 * sizeof(int32), &newModelLayouts[0]);
+            commandQueue->enqueueWriteBuffer(*modelOffsetsBuffer, CL_TRUE, 0, naccelerators * 4 * sizeof(int32), &newModelOffsets[0]);
+        }
+        isLayoutDirty = false;
+    }
+    void flush() {
+        /* the batch buffers are not allocated unless any model has vertices */
+        if (hasPendingResults || pendingAcceleratorRefs.count() == 0 || nvertices == 0) {
+            return;
+        }
+        const int naccelerators = acceleratorRefs.count();
+        ::cl::Event event;
+        commandQueue->enqueueWriteBuffer(*modelParametersBuffer, CL_FALSE, 0, naccelerators * 4 * sizeof(float32), &modelParameters[0], 0, &event);
+        writeEvents.push_back(event);
+        int argumentIndex = 0;
+        ::cl::Kernel *kernel = performSkinningKernel;
+        kernel->setArg(argumentIndex++, *boneMatricesBuffer);
+        kernel->setArg(argumentIndex++, *boneWeightsBuffer);
+        kernel->setArg(argumentIndex++, *boneIndicesBuffer);
+        kernel->setArg(argumentIndex++, *materialEdgeSizeBuffer);
+        kernel->setArg(argumentIndex++, *vertexModelIndicesBuffer);
+        kernel->setArg(argumentIndex++, *modelLayoutsBuffer);
+        kernel->setArg(argumentIndex++, *modelOffsetsBuffer);
+        kernel->setArg(argumentIndex++, *modelParametersBuffer);
+        kernel->setArg(argumentIndex++, nvertices);
+        kernel->setArg(argumentIndex++, *inputVerticesBuffer);
+        kernel->setArg(argumentIndex++, *outputVerticesBuffer);
+        const vsize local = localWGSizeForPerformSkinning;
+        const ::cl::NDRange offsetRange, localRange(local);
+        const ::cl::NDRange globalRange(local * ((nvertices + (local - 1)) / local));
+        /* all models are skinned by one launch that waits the uploads of them */
+        std::vector< ::cl::Event > kernelEvents(1);
+        commandQueue->enqueueNDRangeKernel(*kernel, offsetRange, globalRange, localRange, &writeEvents, &kernelEvents[0]);
+        writeEvents.clear();
+        const int npendings = pendingAcceleratorRefs.count();
+        for (int i = 0; i < npendings; i++) {
+            const PMXAccelerator::PrivateContext *acceleratorContext = pendingAcceleratorRefs[i]->m_context;
+            const vsize offset = vsize(acceleratorContext->bufferBase) << 4;
+            commandQueue->enqueueReadBuffer(*outputVerticesBuffer, CL_FALSE, offset, acceleratorContext->dynamicBufferRef->size(),
+                                            &outputVertices[offset], &kernelEvents, &event);
+            readEvents.push_back(event);
+        }
+        commandQueue->flush();
+        hasPendingResults = true;
+        VPVL2_PROFILE_COUNT(kSkinnedVertexCounter, nvertices);
+    }
+    void finish() {
+        flush();
+        if (!hasPendingResults) {
+            return;
+        }
+        ::cl::Event::waitForEvents(readEvents);
+        readEvents.clear();
+        const int npendings = pendingAcceleratorRefs.count();
+        for (int i = 0; i < npendings; i++) {
+            PMXAccelerator::PrivateContext *acceleratorContext = pendingAcceleratorRefs[i]->m_context;
+            const IModel::DynamicVertexBuffer *dynamicBufferRef = acceleratorContext->dynamicBufferRef;
+            const vsize offset = vsize(acceleratorContext->bufferBase) << 4, size = dynamicBufferRef->size();
+            const uint8 *outputPtr = &outputVertices[offset];
+            bindBuffer(VertexBundle::kGL_ARRAY_BUFFER, acceleratorContext->targetBufferName);
+            bufferSubData(VertexBundle::kGL_ARRAY_BUFFER, 0, size, outputPtr);
+            bindBuffer(VertexBundle::kGL_ARRAY_BUFFER, 0);
+            VPVL2_PROFILE_COUNT(kUploadedBytesCounter, size);
+            const vsize strideSize = dynamicBufferRef->strideSize(),
+                    offsetPosition = dynamicBufferRef->strideOffset(IModel::DynamicVertexBuffer::kVertexStride);
+            Vector3 aabbMin(SIMD_INFINITY, SIMD_INFINITY, SIMD_INFINITY), aabbMax(-SIMD_INFINITY, -SIMD_INFINITY, -SIMD_INFINITY);
+            const int nmodelVertices = acceleratorContext->nvertices;
+            for (int j = 0; j < nmodelVertices; j++) {
+                const float32 *position = reinterpret_cast<const float32 *>(outputPtr + j * strideSize + offsetPosition);
+                const Vector3 v(position[0], position[1], position[2]);
+                aabbMin.setMin(v);
+                aabbMax.setMax(v);
+            }
+            *acceleratorContext->aabbMinRef = aabbMin;
+            *acceleratorContext->aabbMaxRef = aabbMax;
+            acceleratorContext->modelRef->setAabb(aabbMin, aabbMax);
+            modelParameters[acceleratorContext->slot * 4 + 1] = 0;
+            acceleratorContext->isPending = false;
+        }
+        pendingAcceleratorRefs.clear();
+        hasPendingResults = false;
     }
 
     const Scene *sceneRef;
-    IModel *modelRef;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLBUFFERSUBDATAPROC bufferSubData;
     std::vector< ::cl::Device > devices;
     ::cl::Context *context;
     ::cl::CommandQueue *commandQueue;
     ::cl::Program *program;
     ::cl::Kernel *performSkinningKernel;
-    ::cl::Buffer *materialEdgeSizeBuffer;
     ::cl::Buffer *boneWeightsBuffer;
     ::cl::Buffer *boneIndicesBuffer;
+    ::cl::Buffer *materialEdgeSizeBuffer;
+    ::cl::Buffer *vertexModelIndicesBuffer;
+    ::cl::Buffer *modelLayoutsBuffer;
+    ::cl::Buffer *modelOffsetsBuffer;
+    ::cl::Buffer *modelParametersBuffer;
     ::cl::Buffer *boneMatricesBuffer;
-    ::cl::Buffer *aabbMinBuffer;
-    ::cl::Buffer *aabbMaxBuffer;
-    Array<float32> boneTransform;
+    ::cl::Buffer *inputVerticesBuffer;
+    ::cl::Buffer *outputVerticesBuffer;
+    std::vector< ::cl::Event > writeEvents;
+    std::vector< ::cl::Event > readEvents;
+    Array<PMXAccelerator *> acceleratorRefs;
+    Array<PMXAccelerator *> pendingAcceleratorRefs;
+    Array<float32> boneMatrices;
+    Array<float32> modelParameters;
+    Array<uint8> inputVertices;
+    Array<uint8> outputVertices;
     vsize localWGSizeForPerformSkinning;
-    bool isBufferAllocated;
+    int nvertices;
+    bool isHostResident;
+    bool isLayoutDirty;
+    bool hasPendingResults;
 };
 
-PMXAccelerator::PMXAccelerator(const Scene *sceneRef, IApplicationContext *applicationContextRef, IModel *modelRef, Scene::AccelerationType accelerationType)
-    : m_context(new PrivateContext(sceneRef, applicationContextRef, modelRef, accelerationType))
+SceneAccelerator::SceneAccelerator(const Scene *sceneRef, IApplicationContext *applicationContextRef, Scene::AccelerationType accelerationType)
+    : m_context(new PrivateContext(sceneRef, applicationContextRef, accelerationType))
+{
+}
+
+SceneAccelerator::~SceneAccelerator()
+{
+    internal::deleteObject(m_context);
+}
+
+bool SceneAccelerator::isAvailable() const
+{
+    return m_context->context && m_context->program && m_context->commandQueue;
+}
+
+bool SceneAccelerator::isHostResident() const
+{
+    return m_context->isHostResident;
+}
+
+void SceneAccelerator::flush()
+{
+    if (m_context->isHostResident) {
+        m_context->flush();
+    }
+}
+
+void SceneAccelerator::finish()
+{
+    if (m_context->isHostResident) {
+        m_context->finish();
+    }
+}
+
+PMXAccelerator::PMXAccelerator(SceneAccelerator *sceneAcceleratorRef, IModel *modelRef)
+    : m_context(new PrivateContext(sceneAcceleratorRef, modelRef))
 {
 }
 
 PMXAccelerator::~PMXAccelerator()
 {
+    m_context->sceneAcceleratorRef->m_context->removeAcceleratorRef(this);
     internal::deleteObject(m_context);
 }
 
 bool PMXAccelerator::isAvailable() const
 {
-    return m_context->context && m_context->program;
+    return m_context->sceneAcceleratorRef->isAvailable();
 }
 
-void PMXAccelerator::upload(VertexBufferBridgeArray &buffers, const IModel::IndexBuffer *indexBufferRef)
+bool PMXAccelerator::isHostResident() const
 {
-    const int nbuffers = buffers.count();
-    for (int i = 0; i < nbuffers; i++) {
-        VertexBufferBridge &buffer = buffers[i];
-        buffer.mem = new ::cl::BufferGL(*m_context->context, CL_MEM_READ_WRITE, buffer.name);
+    return m_context->sceneAcceleratorRef->isHostResident();
+}
+
+void PMXAccelerator::upload(VertexBufferBridgeArray &buffers, const IModel::DynamicVertexBuffer *dynamicBufferRef, const IModel::IndexBuffer *indexBufferRef)
+{
+    SceneAccelerator::PrivateContext *sceneContext = m_context->sceneAcceleratorRef->m_context;
+    if (!sceneContext->isHostResident) {
+        const int nbuffers = buffers.count();
+        for (int i = 0; i < nbuffers; i++) {
+            VertexBufferBridge &buffer = buffers[i];
+            buffer.mem = new ::cl::BufferGL(*sceneContext->context, CL_MEM_READ_WRITE, buffer.name);
+        }
     }
     Array<IBone *> bones;
     Array<IVertex *> vertices;
@@ -225,8 +558,8 @@ void PMXAccelerator::upload(VertexBufferBridgeArray &buffers, const IModel::Inde
     const int numBoneMatricesSize = numBoneMatricesAllocs * sizeof(float32);
     const int nvertices = vertices.count();
     const int numVerticesAlloc = nvertices * kMaxBonesPerVertex;
-    Array<int> boneIndices;
-    Array<float32> boneWeights, materialEdgeSize;
+    Array<int32> &boneIndices = m_context->boneIndices;
+    Array<float32> &boneWeights = m_context->boneWeights, &materialEdgeSize = m_context->materialEdgeSize;
     boneIndices.resize(numVerticesAlloc);
     boneWeights.resize(numVerticesAlloc);
     materialEdgeSize.resize(nvertices);
@@ -253,22 +586,30 @@ void PMXAccelerator::upload(VertexBufferBridgeArray &buffers, const IModel::Inde
         }
         offset = offsetTo;
     }
+    m_context->dynamicBufferRef = dynamicBufferRef;
+    m_context->nvertices = nvertices;
+    m_context->nbones = bones.count();
+    if (sceneContext->isHostResident) {
+        /* vertices of all models are skinned at once by the scene accelerator */
+        sceneContext->removeAcceleratorRef(this);
+        sceneContext->addAcceleratorRef(this);
+        m_context->isBufferAllocated = true;
+        return;
+    }
     m_context->boneTransform.resize(numBoneMatricesAllocs);
     internal::deleteObject(m_context->materialEdgeSizeBuffer);
-    m_context->materialEdgeSizeBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_ONLY, nvertices * sizeof(float32));
-    internal::deleteObject(m_context->boneMatricesBuffer);
-    m_context->boneMatricesBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_ONLY, numBoneMatricesSize);
+    m_context->materialEdgeSizeBuffer = new ::cl::Buffer(*sceneContext->context, CL_MEM_READ_ONLY, nvertices * sizeof(float32));
     internal::deleteObject(m_context->boneIndicesBuffer);
-    m_context->boneIndicesBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_ONLY, numVerticesAlloc * sizeof(int32));
+    m_context->boneIndicesBuffer = new ::cl::Buffer(*sceneContext->context, CL_MEM_READ_ONLY, numVerticesAlloc * sizeof(int32));
     internal::deleteObject(m_context->boneWeightsBuffer);
-    m_context->boneWeightsBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_ONLY, numVerticesAlloc * sizeof(float32));
+    m_context->boneWeightsBuffer = new ::cl::Buffer(*sceneContext->context, CL_MEM_READ_ONLY, numVerticesAlloc * sizeof(float32));
     internal::deleteObject(m_context->boneMatricesBuffer);
-    m_context->boneMatricesBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_ONLY, numBoneMatricesSize);
+    m_context->boneMatricesBuffer = new ::cl::Buffer(*sceneContext->context, CL_MEM_READ_ONLY, numBoneMatricesSize);
     internal::deleteObject(m_context->aabbMinBuffer);
-    m_context->aabbMinBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_WRITE, sizeof(Vector3));
+    m_context->aabbMinBuffer = new ::cl::Buffer(*sceneContext->context, CL_MEM_READ_WRITE, sizeof(Vector3));
     internal::deleteObject(m_context->aabbMaxBuffer);
-    m_context->aabbMaxBuffer = new ::cl::Buffer(*m_context->context, CL_MEM_READ_WRITE, sizeof(Vector3));
-    ::cl::CommandQueue *queue = m_context->commandQueue;
+    m_context->aabbMaxBuffer = new ::cl::Buffer(*sceneContext->context, CL_MEM_READ_WRITE, sizeof(Vector3));
+    ::cl::CommandQueue *queue = sceneContext->commandQueue;
     queue->enqueueWriteBuffer(*m_context->materialEdgeSizeBuffer, CL_TRUE, 0, nvertices * sizeof(float32), &materialEdgeSize[0]);
     queue->enqueueWriteBuffer(*m_context->boneIndicesBuffer, CL_TRUE, 0, numVerticesAlloc * sizeof(int32), &boneIndices[0]);
     queue->enqueueWriteBuffer(*m_context->boneWeightsBuffer, CL_TRUE, 0, numVerticesAlloc * sizeof(float32), &boneWeights[0]);
@@ -280,13 +621,57 @@ void PMXAccelerator::update(const IModel::DynamicVertexBuffer *dynamicBufferRef,
     if (!m_context->isBufferAllocated) {
         return;
     }
+    SceneAccelerator::PrivateContext *sceneContext = m_context->sceneAcceleratorRef->m_context;
     Array<IBone *> bones;
-    Array<IVertex *> vertices;
     const IModel *modelRef = m_context->modelRef;
     modelRef->getBoneRefs(bones);
+    const int nbones = bones.count();
+    const ICamera *camera = sceneContext->sceneRef->cameraRef();
+    float32 edgeScaleFactor = float32(modelRef->edgeScaleFactor(camera->position()) * modelRef->edgeWidth());
+    ::cl::CommandQueue *queue = sceneContext->commandQueue;
+    if (sceneContext->isHostResident) {
+        if (sceneContext->isLayoutDirty) {
+            sceneContext->rebuildLayout();
+        }
+        else if (sceneContext->hasPendingResults || m_context->isPending) {
+            /* the slots of the model are still in use by the previous batch */
+            sceneContext->finish();
+        }
+        if (m_context->nvertices == 0) {
+            return;
+        }
+        const vsize bufferOffset = vsize(m_context->bufferBase) << 4, boneOffset = vsize(m_context->boneBase) << 4;
+        uint8 *inputPtr = &sceneContext->inputVertices[bufferOffset];
+        if (m_context->needsBindPose) {
+            dynamicBufferRef->setupBindPose(inputPtr);
+            m_context->needsBindPose = false;
+        }
+        dynamicBufferRef->update(inputPtr);
+        float32 *matricesPtr = &sceneContext->boneMatrices[boneOffset];
+        for (int i = 0; i < nbones; i++) {
+            bones[i]->localTransform().getOpenGLMatrix(&matricesPtr[i << 4]);
+        }
+        float32 *parametersPtr = &sceneContext->modelParameters[m_context->slot * 4];
+        parametersPtr[0] = edgeScaleFactor;
+        parametersPtr[1] = 1;
+        /* uploads are not waited here so the next model can be updated while transferring */
+        ::cl::Event event;
+        queue->enqueueWriteBuffer(*sceneContext->inputVerticesBuffer, CL_FALSE, bufferOffset, dynamicBufferRef->size(), inputPtr, 0, &event);
+        sceneContext->writeEvents.push_back(event);
+        if (nbones > 0) {
+            queue->enqueueWriteBuffer(*sceneContext->boneMatricesBuffer, CL_FALSE, boneOffset * sizeof(float32), (nbones << 4) * sizeof(float32), matricesPtr, 0, &event);
+            sceneContext->writeEvents.push_back(event);
+        }
+        m_context->targetBufferName = buffer.name;
+        m_context->aabbMinRef = &aabbMin;
+        m_context->aabbMaxRef = &aabbMax;
+        sceneContext->pendingAcceleratorRefs.append(this);
+        m_context->isPending = true;
+        return;
+    }
+    Array<IVertex *> vertices;
     modelRef->getVertexRefs(vertices);
     int nvertices = vertices.count();
-    const int nbones = bones.count();
     for (int i = 0; i < nbones; i++) {
         IBone *bone = bones[i];
         int index = i << 4;
@@ -296,22 +681,18 @@ void PMXAccelerator::update(const IModel::DynamicVertexBuffer *dynamicBufferRef,
     ::cl::BufferGL *vertexBuffer = static_cast< ::cl::BufferGL *>(buffer.mem);
     std::vector< ::cl::Memory > objects;
     objects.push_back(*vertexBuffer);
-    ::cl::CommandQueue *queue = m_context->commandQueue;
     queue->enqueueAcquireGLObjects(&objects);
     queue->enqueueWriteBuffer(*m_context->boneMatricesBuffer, CL_TRUE, 0, nsize, &m_context->boneTransform[0]);
     queue->enqueueWriteBuffer(*m_context->aabbMinBuffer, CL_TRUE, 0, sizeof(aabbMin), &aabbMin);
     queue->enqueueWriteBuffer(*m_context->aabbMaxBuffer, CL_TRUE, 0, sizeof(aabbMax), &aabbMax);
     int argumentIndex = 0;
-    ::cl::Kernel *kernel = m_context->performSkinningKernel;
+    ::cl::Kernel *kernel = sceneContext->performSkinningKernel;
     kernel->setArg(argumentIndex++, sizeof(m_context->boneMatricesBuffer), m_context->boneMatricesBuffer);
     kernel->setArg(argumentIndex++, sizeof(m_context->boneWeightsBuffer), m_context->boneWeightsBuffer);
     kernel->setArg(argumentIndex++, sizeof(m_context->boneIndicesBuffer), m_context->boneIndicesBuffer);
     kernel->setArg(argumentIndex++, sizeof(m_context->materialEdgeSizeBuffer), m_context->materialEdgeSizeBuffer);
-    const Scene *sceneRef = m_context->sceneRef;
-    Vector3 lightDirection = sceneRef->lightRef()->direction();
+    Vector3 lightDirection = sceneContext->sceneRef->lightRef()->direction();
     kernel->setArg(argumentIndex++, sizeof(lightDirection), &lightDirection);
-    const ICamera *camera = sceneRef->cameraRef();
-    float32 edgeScaleFactor = float32(modelRef->edgeScaleFactor(camera->position()) * modelRef->edgeWidth());
     kernel->setArg(argumentIndex++, sizeof(edgeScaleFactor), &edgeScaleFactor);
     kernel->setArg(argumentIndex++, sizeof(nvertices), &nvertices);
     vsize strideSize = dynamicBufferRef->strideSize() >> 4;
@@ -327,16 +708,21 @@ void PMXAccelerator::update(const IModel::DynamicVertexBuffer *dynamicBufferRef,
     kernel->setArg(argumentIndex++, sizeof(m_context->aabbMinBuffer), m_context->aabbMinBuffer);
     kernel->setArg(argumentIndex++, sizeof(m_context->aabbMaxBuffer), m_context->aabbMaxBuffer);
     kernel->setArg(argumentIndex++, sizeof(vertexBuffer), vertexBuffer);
-    const vsize local = m_context->localWGSizeForPerformSkinning;
+    const vsize local = sceneContext->localWGSizeForPerformSkinning;
     const ::cl::NDRange offsetRange, localRange(local);
     const ::cl::NDRange globalRange(local * ((nvertices + (local - 1)) / local));
-    queue->enqueueNDRangeKernel(*m_context->performSkinningKernel, offsetRange, globalRange, localRange);
+    queue->enqueueNDRangeKernel(*kernel, offsetRange, globalRange, localRange);
     queue->enqueueReleaseGLObjects(&objects);
     queue->enqueueReadBuffer(*m_context->aabbMinBuffer, CL_TRUE, 0, sizeof(aabbMin), &aabbMin);
     queue->enqueueReadBuffer(*m_context->aabbMaxBuffer, CL_TRUE, 0, sizeof(aabbMax), &aabbMax);
     queue->finish();
 }
 
+void PMXAccelerator::synchronize()
+{
+    m_context->sceneAcceleratorRef->finish();
+}
+
 void PMXAccelerator::release(VertexBufferBridgeArray &buffers) const
 {
     const int nbuffers = buffers.count();
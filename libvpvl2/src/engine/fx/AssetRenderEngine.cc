@@ -224,6 +224,18 @@ bool AssetRenderEngine::upload(void *userData)
     return ret;
 }
 
+IRenderEngine::UploadStatus AssetRenderEngine::uploadIncrementally(void *userData, int /* maxSteps */, UploadProgressListener *listener)
+{
+    /* assets are uploaded at once as they are small enough to fit in a frame */
+    if (!upload(userData)) {
+        return kUploadFailed;
+    }
+    if (listener) {
+        listener->uploadDidProgress(this, 1, 1);
+    }
+    return kUploadCompleted;
+}
+
 void AssetRenderEngine::release()
 {
     pushAnnotationGroup(std::string("AssetRenderEngine#release name=").append(internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "")).c_str(), m_applicationContextRef->sharedFunctionResolverInstance());
@@ -1948,9 +1948,11 @@ void EffectEngine::setScriptStateFromParameter(const IEffect *effectRef,
 void EffectEngine::executePass(IEffect::Pass *pass, const DrawPrimitiveCommand &command) const
 {
     if (pass) {
+        VPVL2_PROFILE_STAGE(kDrawStage);
         pass->setState();
         drawPrimitives(command);
         pass->resetState();
+        VPVL2_PROFILE_COUNT(kDrawCallCounter, 1);
     }
 }
 
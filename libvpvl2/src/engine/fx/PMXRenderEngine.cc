@@ -42,6 +42,7 @@
 #include "vpvl2/cl/PMXAccelerator.h"
 #include "vpvl2/extensions/gl/Texture2D.h"
 #include "vpvl2/extensions/gl/ShaderProgram.h"
+#include "vpvl2/extensions/gl/TransformFeedbackSkinning.h"
 #include "vpvl2/extensions/gl/VertexBundle.h"
 #include "vpvl2/extensions/gl/VertexBundleLayout.h"
 
@@ -112,150 +113,6 @@ private:
     VPVL2_DISABLE_COPY_AND_ASSIGN(PrivateEffectEngine)
 };
 
-class PMXRenderEngine::TransformFeedbackProgram : public ShaderProgram
-{
-public:
-    TransformFeedbackProgram(const IApplicationContext::FunctionResolver *resolver)
-        : ShaderProgram(resolver),
-          m_resolver(resolver),
-          m_boneTransformTexture(0),
-          m_matrixPaletteUniformLocation(-1),
-          m_numBoneIndicesUniformLocation(-1)
-    {
-    }
-    virtual ~TransformFeedbackProgram() {
-        internal::deleteObject(m_boneTransformTexture);
-        m_matrixPaletteUniformLocation = -1;
-        m_numBoneIndicesUniformLocation = -1;
-    }
-
-    void unbind() {
-        ShaderProgram::unbind();
-        m_boneTransformTexture->unbind();
-    }
-    bool linkProgram(VertexBundle *bundle) {
-        static const char outPosition[] = "gl_Position",
-                outNormal[] = "vpvl2_outNormal",
-                outEdgeSize[] = "vpvl2_outEdgeSize"
-                ;
-        Array<const char *> names;
-        names.append(outPosition);
-        names.append(outNormal);
-        names.append(outEdgeSize);
-        bundle->setFeedbackOutput(m_program, names, VertexBundle::kGL_INTERLEAVED_ATTRIBS);
-        bindAttributeLocations();
-        if (!link()) {
-            VPVL2_LOG(ERROR, "Link failed: " << message());
-            return false;
-        }
-        Array<char *> output;
-        bundle->dumpFeedbackOutput(m_program, 2);
-        output.releaseArrayAll();
-        VPVL2_VLOG(2, "Created a shader program (ID=" << m_program << ")");
-        getUniformLocations();
-        return true;
-    }
-    void updateBoneTransformTexture() {
-        m_boneTransformTexture->bind();
-        m_boneTransformTexture->write(&m_boneTransformTextureData[0]);
-    }
-    void activateBoneTransformTexture() {
-        activeTexture(Texture2D::kGL_TEXTURE0);
-        updateBoneTransformTexture();
-        uniform1i(m_matrixPaletteUniformLocation, 0);
-    }
-    void setNumBoneIndices(int value) {
-        uniform1f(m_numBoneIndicesUniformLocation, float32(value));
-    }
-    void createTransformFeedbackBundle(VertexBundleLayout *layout, VertexBundle *bundle, IModel::DynamicVertexBuffer *dynamicBuffer, IModel::StaticVertexBuffer *staticBuffer, GLuint dvbo) {
-        pushAnnotationGroup("PMXRenderEngine#createTransformFeedbackBundle", m_resolver);
-        layout->create();
-        layout->bind();
-        int size = int(dynamicBuffer->strideSize());
-        vsize offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kVertexStride);
-        typedef void (GLAPIENTRY * PFNGLENABLEVERTEXATTRIBARRAYPROC) (GLuint);
-        typedef void (GLAPIENTRY * PFNGLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer);
-        PFNGLENABLEVERTEXATTRIBARRAYPROC enableVertexAttribArray = reinterpret_cast<PFNGLENABLEVERTEXATTRIBARRAYPROC>(m_resolver->resolveSymbol("glEnableVertexAttribArray"));
-        PFNGLVERTEXATTRIBPOINTERPROC vertexAttribPointer = reinterpret_cast<PFNGLVERTEXATTRIBPOINTERPROC>(m_resolver->resolveSymbol("glVertexAttribPointer"));
-        bundle->bind(VertexBundle::kVertexBuffer, dvbo);
-        vertexAttribPointer(IEffect::kPositionVertexAttribute, 4, kGL_FLOAT, kGL_FALSE, size, reinterpret_cast<const GLvoid *>(offset));
-        enableVertexAttribArray(IEffect::kPositionVertexAttribute);
-        offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
-        vertexAttribPointer(IEffect::kNormalVertexAttribute, 4, kGL_FLOAT, kGL_FALSE, size, reinterpret_cast<const GLvoid *>(offset));
-        enableVertexAttribArray(IEffect::kNormalVertexAttribute);
-        bundle->bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
-        size = int(staticBuffer->strideSize());
-        offset = staticBuffer->strideOffset(IModel::StaticVertexBuffer::kBoneIndexStride);
-        vertexAttribPointer(IEffect::kBoneIndexVertexAttribute, 4, kGL_FLOAT, kGL_FALSE, size, reinterpret_cast<const GLvoid *>(offset));
-        enableVertexAttribArray(IEffect::kBoneIndexVertexAttribute);
-        offset = staticBuffer->strideOffset(IModel::StaticVertexBuffer::kBoneWeightStride);
-        vertexAttribPointer(IEffect::kBoneWeightVertexAttribute, 4, kGL_FLOAT, kGL_FALSE, size, reinterpret_cast<const GLvoid *>(offset));
-        enableVertexAttribArray(IEffect::kBoneWeightVertexAttribute);
-        layout->unbind();
-        popAnnotationGroup(m_resolver);
-    }
-
-    void setupTexture(const IModel *modelRef) {
-        internal::deleteObject(m_boneTransformTexture);
-        const int nbones = modelRef->count(IModel::kBone);
-        m_boneTransformTextureData.resize(nbones * 16);
-        updateBoneTransformTextureData(modelRef);
-        BaseSurface::Format format(kGL_RGBA, kGL_RGBA32F, kGL_FLOAT, Texture2D::kGL_TEXTURE_2D);
-        m_boneTransformTexture = new Texture2D(m_resolver, format, Vector3(2, Scalar(nbones), 1), 0);
-        m_boneTransformTexture->create();
-        m_boneTransformTexture->bind();
-        m_boneTransformTexture->allocate(&m_boneTransformTextureData[0]);
-        m_boneTransformTexture->setParameter(BaseTexture::kGL_TEXTURE_MAG_FILTER, int(BaseTexture::kGL_NEAREST));
-        m_boneTransformTexture->setParameter(BaseTexture::kGL_TEXTURE_MIN_FILTER, int(BaseTexture::kGL_NEAREST));
-        m_boneTransformTexture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_S, int(BaseTexture::kGL_CLAMP_TO_EDGE));
-        m_boneTransformTexture->setParameter(BaseTexture::kGL_TEXTURE_WRAP_T, int(BaseTexture::kGL_CLAMP_TO_EDGE));
-        m_boneTransformTexture->unbind();
-        VPVL2_VLOG(1, "Created bone matrices palette texture: ID=" << m_boneTransformTexture->data());
-    }
-    void updateBoneTransformTextureData(const IModel *modelRef) {
-        Array<IBone *> boneRefs;
-        modelRef->getBoneRefs(boneRefs);
-        const int nbones = boneRefs.count();
-        for (int i = nbones - 1; i >= 0; i--) {
-            const IBone *bone = boneRefs[i];
-            const Transform &transform = bone->localTransform();
-            const Vector3 &translation = transform.getOrigin();
-            const Quaternion &orientation = transform.getRotation();
-            const int index = i * 8;
-            m_boneTransformTextureData[index + 0] = translation[0];
-            m_boneTransformTextureData[index + 1] = translation[1];
-            m_boneTransformTextureData[index + 2] = translation[2];
-            m_boneTransformTextureData[index + 3] = 1.0;
-            m_boneTransformTextureData[index + 4] = orientation[0];
-            m_boneTransformTextureData[index + 5] = orientation[1];
-            m_boneTransformTextureData[index + 6] = orientation[2];
-            m_boneTransformTextureData[index + 7] = orientation[3];
-        }
-    }
-    const ITexture *textureRef() const {
-        return m_boneTransformTexture;
-    }
-
-protected:
-    virtual void bindAttributeLocations() {
-        bindAttribLocation(m_program, IEffect::kPositionVertexAttribute, "vpvl2_inPosition");
-        bindAttribLocation(m_program, IEffect::kNormalVertexAttribute, "vpvl2_inNormal");
-        bindAttribLocation(m_program, IEffect::kBoneIndexVertexAttribute, "vpvl2_inBoneIndices");
-        bindAttribLocation(m_program, IEffect::kBoneWeightVertexAttribute, "vpvl2_inBoneWeights");
-    }
-    virtual void getUniformLocations() {
-        m_matrixPaletteUniformLocation = getUniformLocation(m_program, "matrixPalette");
-        m_numBoneIndicesUniformLocation = getUniformLocation(m_program, "numBoneIndices");
-    }
-
-private:
-    const IApplicationContext::FunctionResolver *m_resolver;
-    extensions::gl::Texture2D *m_boneTransformTexture;
-    Array<float32> m_boneTransformTextureData;
-    GLint m_matrixPaletteUniformLocation;
-    GLint m_numBoneIndicesUniformLocation;
-};
-
 PMXRenderEngine::PMXRenderEngine(IApplicationContext *applicationContextRef,
                                  Scene *sceneRef,
                                  cl::PMXAccelerator *accelerator,
@@ -273,7 +130,7 @@ PMXRenderEngine::PMXRenderEngine(IApplicationContext *applicationContextRef,
       m_currentEffectEngineRef(0),
       m_accelerator(accelerator),
       m_applicationContextRef(applicationContextRef),
-      m_transformFeedbackProgram(0),
+      m_skinning(0),
       m_sceneRef(sceneRef),
       m_modelRef(modelRef),
       m_staticBuffer(0),
@@ -285,8 +142,10 @@ PMXRenderEngine::PMXRenderEngine(IApplicationContext *applicationContextRef,
       m_indexType(kGL_UNSIGNED_INT),
       m_aabbMin(SIMD_INFINITY, SIMD_INFINITY, SIMD_INFINITY),
       m_aabbMax(-SIMD_INFINITY, -SIMD_INFINITY, -SIMD_INFINITY),
+      m_uploadStep(0),
       m_cullFaceState(true),
-      m_updateEvenBuffer(true)
+      m_updateEvenBuffer(true),
+      m_renderable(false)
 {
     VPVL2_DCHECK(modelRef);
     VPVL2_DCHECK(sceneRef);
@@ -326,9 +185,42 @@ IModel *PMXRenderEngine::parentModelRef() const
 
 bool PMXRenderEngine::upload(void *userData)
 {
-    if (!uploadMaterials(userData)) {
-        return false;
+    return uploadIncrementally(userData, 1 + m_modelRef->count(IModel::kMaterial), 0) == kUploadCompleted;
+}
+
+IRenderEngine::UploadStatus PMXRenderEngine::uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener)
+{
+    if (m_uploadStep < 0) {
+        return kUploadFailed;
     }
+    /* vertex buffers go first so the model is drawn without textures until all materials are uploaded */
+    Array<IMaterial *> materials;
+    m_modelRef->getMaterialRefs(materials);
+    const int nsteps = 1 + materials.count();
+    for (int i = 0; i < maxSteps && m_uploadStep < nsteps; i++) {
+        const int step = m_uploadStep;
+        if (step == 0) {
+            uploadBuffers(userData);
+        }
+        else if (!uploadMaterial(materials[step - 1], step - 1, userData)) {
+            m_uploadStep = -1;
+            return kUploadFailed;
+        }
+        m_uploadStep = step + 1;
+        if (listener) {
+            listener->uploadDidProgress(this, step + 1, nsteps);
+        }
+    }
+    if (m_uploadStep < nsteps) {
+        return kUploadInProgress;
+    }
+    VPVL2_VLOG(2, "Created the model: " << internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "(null)"));
+    return kUploadCompleted;
+}
+
+void PMXRenderEngine::uploadBuffers(void *userData)
+{
+    m_materialContexts.resize(m_modelRef->count(IModel::kMaterial));
     pushAnnotationGroup(std::string("PMXRenderEngine#upload name=").append(internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "")).c_str(), m_applicationContextRef->sharedFunctionResolverInstance());
     m_bundle->create(VertexBundle::kVertexBuffer, kModelDynamicVertexBufferEven, VertexBundle::kGL_DYNAMIC_DRAW, 0, m_dynamicBuffer->size());
     m_bundle->bind(VertexBundle::kVertexBuffer, kModelDynamicVertexBufferEven);
@@ -358,6 +250,30 @@ bool PMXRenderEngine::upload(void *userData)
     m_bundle->create(VertexBundle::kIndexBuffer, kModelIndexBuffer, VertexBundle::kGL_STATIC_DRAW, m_indexBuffer->bytes(), m_indexBuffer->size());
     labelVertexBuffer(kModelIndexBuffer, "ModelIndexBuffer");
     VPVL2_VLOG(2, "Binding indices to the vertex buffer object: ptr=" << m_indexBuffer->bytes() << " size=" << m_indexBuffer->size());
+    const int nbones = m_modelRef->count(IModel::kBone);
+    internal::deleteObject(m_skinning);
+#ifdef VPVL2_ENABLE_OPENCL
+    const bool hasAccelerator = m_accelerator && m_accelerator->isAvailable();
+#else
+    const bool hasAccelerator = false;
+#endif
+    const IApplicationContext::FunctionResolver *resolver = m_applicationContextRef->sharedFunctionResolverInstance();
+    const Scene::AccelerationType accelerationType = m_sceneRef->accelerationType();
+    const bool vss = accelerationType == Scene::kVertexShaderAccelerationType1 || accelerationType == Scene::kVertexShaderAccelerationType2;
+    if (!hasAccelerator && vss && nbones > 0 && TransformFeedbackSkinning::isSupported(resolver)) {
+        /* must be prepared before the vertex array objects as they refer the skinned vertex buffer */
+        IString *vertexShaderSource = m_applicationContextRef->loadShaderSource(IApplicationContext::kTransformFeedbackVertexShader, m_modelRef, userData);
+        TransformFeedbackSkinning *skinning = new TransformFeedbackSkinning(resolver);
+        if (vertexShaderSource && skinning->link(vertexShaderSource)) {
+            skinning->upload(m_modelRef, m_dynamicBuffer, m_staticBuffer, m_bundle->findName(kModelStaticVertexBuffer));
+            m_skinning = skinning;
+        }
+        else {
+            VPVL2_LOG(WARNING, "Cannot use transform feedback, falls back to skinning on CPU");
+            internal::deleteObject(skinning);
+        }
+        internal::deleteObject(vertexShaderSource);
+    }
     VertexBundleLayout *bundleME = m_layouts[kVertexArrayObjectEven];
     createVertexBundle(bundleME, IModel::Buffer::kVertexStride, kModelDynamicVertexBufferEven);
     labelVertexArray(bundleME, "VertexArrayObjectEven");
@@ -373,42 +289,18 @@ bool PMXRenderEngine::upload(void *userData)
     bundleEO->unbind();
     m_bundle->unbind(VertexBundle::kVertexBuffer);
     m_bundle->unbind(VertexBundle::kIndexBuffer);
-    const int nbones = m_modelRef->count(IModel::kBone);
 #ifdef VPVL2_ENABLE_OPENCL
-    if (m_accelerator && m_accelerator->isAvailable()) {
+    if (hasAccelerator) {
         m_accelerator->release(m_accelerationBuffers);
         m_accelerationBuffers.append(cl::PMXAccelerator::VertexBufferBridge(m_bundle->findName(kModelDynamicVertexBufferEven)));
         m_accelerationBuffers.append(cl::PMXAccelerator::VertexBufferBridge(m_bundle->findName(kModelDynamicVertexBufferOdd)));
-        m_accelerator->upload(m_accelerationBuffers, m_indexBuffer);
+        m_accelerator->upload(m_accelerationBuffers, m_dynamicBuffer, m_indexBuffer);
     }
-    else
-#endif
-        if (m_sceneRef->accelerationType() == Scene::kVertexShaderAccelerationType1 && nbones > 0) {
-            internal::deleteObject(m_transformFeedbackProgram);
-            m_transformFeedbackProgram = new TransformFeedbackProgram(m_applicationContextRef->sharedFunctionResolverInstance());
-            m_transformFeedbackProgram->setupTexture(m_modelRef);
-#if 0
-            m_transformFeedbackProgram->create();
-            IString *vertexShaderSource = m_applicationContextRef->loadShaderSource(IApplicationContext::kTransformFeedbackVertexShader, m_modelRef, 0);
-            VPVL2_DCHECK(vertexShaderSource);
-            m_transformFeedbackProgram->addShaderSource(vertexShaderSource, ShaderProgram::kGL_VERTEX_SHADER);
-            internal::deleteObject(vertexShaderSource);
-            if (m_transformFeedbackProgram->linkProgram(m_bundle)) {
-                m_bundle->create(VertexBundle::kVertexBuffer, kModelBindPoseVertexBuffer, VertexBundle::kGL_STATIC_DRAW, 0, m_dynamicBuffer->size());
-                m_bundle->bind(VertexBundle::kVertexBuffer, kModelBindPoseVertexBuffer);
-                if (void *address = m_bundle->map(VertexBundle::kVertexBuffer, 0, m_dynamicBuffer->size())) {
-                    m_dynamicBuffer->setupBindPose(address);
-                }
-                m_bundle->unbind(VertexBundle::kVertexBuffer);
-                m_transformFeedbackProgram->createTransformFeedbackBundle(m_layouts[kBindPoseVertexArrayObject], m_bundle, m_dynamicBuffer, m_staticBuffer, kModelBindPoseVertexBuffer);
-            }
 #endif
-        }
+    m_renderable = true;
     m_sceneRef->updateModel(m_modelRef);
     m_modelRef->setVisible(true);
     popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
-    VPVL2_VLOG(2, "Created the model: " << internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "(null)"));
-    return true;
 }
 
 void PMXRenderEngine::release()
@@ -424,7 +316,7 @@ void PMXRenderEngine::release()
     internal::deleteObject(m_staticBuffer);
     internal::deleteObject(m_dynamicBuffer);
     internal::deleteObject(m_indexBuffer);
-    internal::deleteObject(m_transformFeedbackProgram);
+    internal::deleteObject(m_skinning);
 #ifdef VPVL2_ENABLE_OPENCL
     internal::deleteObject(m_accelerator);
 #endif
@@ -433,6 +325,7 @@ void PMXRenderEngine::release()
     m_defaultEffectRef = 0;
     m_currentEffectEngineRef = 0;
     m_cullFaceState = false;
+    m_renderable = false;
     popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
 }
 
@@ -442,7 +335,7 @@ void PMXRenderEngine::update()
         return;
     }
     m_currentEffectEngineRef->updateSceneParameters();
-    if (!m_modelRef->isVisible()) {
+    if (!m_modelRef->isVisible() || !m_renderable) {
         return;
     }
     pushAnnotationGroup(std::string("PMXRenderEngine#update name=").append(internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "")).c_str(), m_applicationContextRef->sharedFunctionResolverInstance());
@@ -456,40 +349,33 @@ void PMXRenderEngine::update()
     else
 #endif
     {
-        if (m_transformFeedbackProgram) {
-#if 0
-            VertexBundleLayout *layout = m_layouts[kBindPoseVertexArrayObject];
-            enable(VertexBundle::kGL_RASTERIZER_DISCARD);
-            m_transformFeedbackProgram->bind();
-            m_transformFeedbackProgram->updateBoneTransformTextureData(m_modelRef);
-            m_transformFeedbackProgram->activateBoneTransformTexture();
-            m_transformFeedbackProgram->setNumBoneIndices(m_modelRef->count(IModel::kBone));
-            m_bundle->beginTransform(kGL_POINTS, vbo);
-            layout->bind();
-            drawArrays(kGL_POINTS, 0, m_modelRef->count(IModel::kVertex));
-            layout->unbind();
-            m_bundle->endTransform();
-            disable(VertexBundle::kGL_RASTERIZER_DISCARD);
-            m_transformFeedbackProgram->unbind();
-#else
-            m_transformFeedbackProgram->updateBoneTransformTextureData(m_modelRef);
-            m_transformFeedbackProgram->updateBoneTransformTexture();
-            m_currentEffectEngineRef->boneTransformTexture.setTexture(m_transformFeedbackProgram->textureRef());
-            m_currentEffectEngineRef->boneCount.setValue(m_modelRef->count(IModel::kBone));
-            m_currentEffectEngineRef->edgeScaleFactor.setValue(m_modelRef->edgeScaleFactor(m_sceneRef->cameraRef()->position()));
+        if (m_skinning) {
             m_bundle->bind(VertexBundle::kVertexBuffer, vbo);
             if (void *address = m_bundle->map(VertexBundle::kVertexBuffer, 0, m_dynamicBuffer->size())) {
+                VPVL2_PROFILE_STAGE(kBufferUploadStage);
                 m_dynamicBuffer->update(address);
                 m_bundle->unmap(VertexBundle::kVertexBuffer, address);
+                VPVL2_PROFILE_COUNT(kUploadedBytesCounter, m_dynamicBuffer->size());
             }
             m_bundle->unbind(VertexBundle::kVertexBuffer);
-#endif
+            {
+                VPVL2_PROFILE_STAGE(kSkinningStage);
+                m_skinning->update(m_sceneRef->cameraRef()->position(), m_bundle->findName(vbo));
+                VPVL2_PROFILE_COUNT(kSkinnedVertexCounter, m_modelRef->count(IModel::kVertex));
+            }
+            m_modelRef->getAabb(m_aabbMin, m_aabbMax);
         }
         else {
             m_bundle->bind(VertexBundle::kVertexBuffer, vbo);
             if (void *address = m_bundle->map(VertexBundle::kVertexBuffer, 0, m_dynamicBuffer->size())) {
-                m_dynamicBuffer->performTransform(address, m_sceneRef->cameraRef()->position(), m_aabbMin, m_aabbMax);
+                {
+                    VPVL2_PROFILE_STAGE(kSkinningStage);
+                    m_dynamicBuffer->performTransform(address, m_sceneRef->cameraRef()->position(), m_aabbMin, m_aabbMax);
+                    VPVL2_PROFILE_COUNT(kSkinnedVertexCounter, m_modelRef->count(IModel::kVertex));
+                }
+                VPVL2_PROFILE_STAGE(kBufferUploadStage);
                 m_bundle->unmap(VertexBundle::kVertexBuffer, address);
+                VPVL2_PROFILE_COUNT(kUploadedBytesCounter, m_dynamicBuffer->size());
             }
             m_bundle->unbind(VertexBundle::kVertexBuffer);
         }
@@ -507,7 +393,7 @@ void PMXRenderEngine::setUpdateOptions(int options)
 void PMXRenderEngine::renderModel()
 {
     initializeEffectParameters(0);
-    if (!m_modelRef->isVisible() || !m_currentEffectEngineRef || !m_currentEffectEngineRef->isStandardEffect()) {
+    if (!m_modelRef->isVisible() || !m_renderable || !m_currentEffectEngineRef || !m_currentEffectEngineRef->isStandardEffect()) {
         return;
     }
     pushAnnotationGroup(std::string("PMXRenderEngine#renderModel name=").append(internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "")).c_str(), m_applicationContextRef->sharedFunctionResolverInstance());
@@ -562,7 +448,7 @@ void PMXRenderEngine::renderModel()
 void PMXRenderEngine::renderEdge()
 {
     initializeEffectParameters(0);
-    if (!m_modelRef->isVisible() || btFuzzyZero(m_modelRef->edgeWidth())
+    if (!m_modelRef->isVisible() || !m_renderable || btFuzzyZero(m_modelRef->edgeWidth())
             || !m_currentEffectEngineRef || m_currentEffectEngineRef->scriptOrder() != IEffect::kStandard) {
         return;
     }
@@ -598,7 +484,7 @@ void PMXRenderEngine::renderEdge()
 
 void PMXRenderEngine::renderShadow()
 {
-    if (!m_modelRef->isVisible() || !m_currentEffectEngineRef || m_currentEffectEngineRef->scriptOrder() != IEffect::kStandard) {
+    if (!m_modelRef->isVisible() || !m_renderable || !m_currentEffectEngineRef || m_currentEffectEngineRef->scriptOrder() != IEffect::kStandard) {
         return;
     }
     pushAnnotationGroup(std::string("PMXRenderEngine#renderShadow name=").append(internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "")).c_str(), m_applicationContextRef->sharedFunctionResolverInstance());
@@ -634,7 +520,7 @@ void PMXRenderEngine::renderShadow()
 
 void PMXRenderEngine::renderZPlot()
 {
-    if (!m_modelRef->isVisible() || !m_currentEffectEngineRef || m_currentEffectEngineRef->scriptOrder() != IEffect::kStandard) {
+    if (!m_modelRef->isVisible() || !m_renderable || !m_currentEffectEngineRef || m_currentEffectEngineRef->scriptOrder() != IEffect::kStandard) {
         return;
     }
     pushAnnotationGroup(std::string("PMXRenderEngine#renderZPlot name=").append(internal::cstr(m_modelRef->name(IEncoding::kDefaultLanguage), "")).c_str(), m_applicationContextRef->sharedFunctionResolverInstance());
@@ -807,6 +693,11 @@ void PMXRenderEngine::bindVertexBundle()
     VertexBufferObjectType vbo;
     getVertexBundleType(vao, vbo);
     m_currentEffectEngineRef->setDrawType(PrivateEffectEngine::kVertex);
+#ifdef VPVL2_ENABLE_OPENCL
+    if (m_accelerator) {
+        m_accelerator->synchronize();
+    }
+#endif
     if (!m_layouts[vao]->bind()) {
         m_bundle->bind(VertexBundle::kVertexBuffer, vbo);
         bindDynamicVertexAttributePointers(IModel::Buffer::kVertexStride);
@@ -824,6 +715,11 @@ void PMXRenderEngine::bindEdgeBundle()
     pushAnnotationGroup("PMXRenderEngine#bindEdgeVertexBundle", m_applicationContextRef->sharedFunctionResolverInstance());
     getEdgeBundleType(vao, vbo);
     m_currentEffectEngineRef->setDrawType(PrivateEffectEngine::kEdge);
+#ifdef VPVL2_ENABLE_OPENCL
+    if (m_accelerator) {
+        m_accelerator->synchronize();
+    }
+#endif
     if (!m_layouts[vao]->bind()) {
         m_bundle->bind(VertexBundle::kVertexBuffer, vbo);
         bindDynamicVertexAttributePointers(IModel::Buffer::kEdgeVertexStride);
@@ -834,14 +730,10 @@ void PMXRenderEngine::bindEdgeBundle()
     popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
 }
 
-bool PMXRenderEngine::uploadMaterials(void *userData)
+bool PMXRenderEngine::uploadMaterial(const IMaterial *material, int index, void *userData)
 {
-    pushAnnotationGroup("PMXRenderEngine#uploadMaterials", m_applicationContextRef->sharedFunctionResolverInstance());
-    Array<IMaterial *> materials;
-    m_modelRef->getMaterialRefs(materials);
-    const int nmaterials = materials.count();
+    pushAnnotationGroup("PMXRenderEngine#uploadMaterial", m_applicationContextRef->sharedFunctionResolverInstance());
     IApplicationContext::TextureDataBridge bridge(IApplicationContext::kTexture2D | IApplicationContext::kAsyncLoadingTexture);
-    m_materialContexts.resize(nmaterials);
     EffectEngine *engine = 0;
     if (PrivateEffectEngine *const *enginePtr = m_effectEngines.find(IEffect::kStandard)) {
         engine = *enginePtr;
@@ -849,62 +741,59 @@ bool PMXRenderEngine::uploadMaterials(void *userData)
             bridge.flags |= IApplicationContext::kGenerateTextureMipmap;
         }
     }
-    for (int i = 0; i < nmaterials; i++) {
-        const IMaterial *material = materials[i];
-        const IString *name = material->name(IEncoding::kJapanese); (void) name;
-        const int materialIndex = material->index(); (void) materialIndex;
-        MaterialContext &materialPrivate = m_materialContexts[i];
-        ITexture *textureRef = 0;
-        annotateMaterial("uploadMaterial", material);
-        if (const IString *mainTexturePath = material->mainTexture()) {
-            if (m_applicationContextRef->uploadTexture(mainTexturePath, bridge, userData)) {
-                textureRef = bridge.dataRef;
-                materialPrivate.mainTextureRef = m_allocatedTextures.insert(textureRef, textureRef);
-                if (engine) {
-                    engine->materialTexture.setTexture(material, textureRef);
-                    VPVL2_VLOG(2, "Binding the texture as a main texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << (textureRef ? textureRef->data() : 0));
-                }
-            }
-            else {
-                VPVL2_LOG(WARNING, "Cannot bind a main texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
-                release();
-                popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
-                return false;
+    const IString *name = material->name(IEncoding::kJapanese); (void) name;
+    const int materialIndex = material->index(); (void) materialIndex;
+    MaterialContext &materialPrivate = m_materialContexts[index];
+    ITexture *textureRef = 0;
+    annotateMaterial("uploadMaterial", material);
+    if (const IString *mainTexturePath = material->mainTexture()) {
+        if (m_applicationContextRef->uploadTexture(mainTexturePath, bridge, userData)) {
+            textureRef = bridge.dataRef;
+            materialPrivate.mainTextureRef = m_allocatedTextures.insert(textureRef, textureRef);
+            if (engine) {
+                engine->materialTexture.setTexture(material, textureRef);
+                VPVL2_VLOG(2, "Binding the texture as a main texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << (textureRef ? textureRef->data() : 0));
             }
         }
-        if (const IString *sphereTexturePath = material->sphereTexture()) {
-            if (m_applicationContextRef->uploadTexture(sphereTexturePath, bridge, userData)) {
-                textureRef = bridge.dataRef;
-                materialPrivate.sphereTextureRef = m_allocatedTextures.insert(textureRef, textureRef);
-                if (engine) {
-                    engine->materialSphereMap.setTexture(material, textureRef);
-                    VPVL2_VLOG(2, "Binding the texture as a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << (textureRef ? textureRef->data() : 0));
-                }
-            }
-            else {
-                VPVL2_LOG(WARNING, "Cannot bind a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
-                release();
-                popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
-                return false;
-            }
+        else {
+            VPVL2_LOG(WARNING, "Cannot bind a main texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
+            release();
+            popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
+            return false;
         }
-        if (material->isSharedToonTextureUsed()) {
-            char buf[16];
-            int index = material->toonTextureIndex();
-            if (index == 0) {
-                internal::snprintf(buf, sizeof(buf), "toon%d.bmp", index);
-            }
-            else {
-                internal::snprintf(buf, sizeof(buf), "toon%02d.bmp", index);
-            }
-            if (IString *toonTexturePath = m_applicationContextRef->toUnicode(reinterpret_cast<const uint8 *>(buf))) {
-                uploadToonTexture(material, toonTexturePath, engine, materialPrivate, true, userData);
-                internal::deleteObject(toonTexturePath);
+    }
+    if (const IString *sphereTexturePath = material->sphereTexture()) {
+        if (m_applicationContextRef->uploadTexture(sphereTexturePath, bridge, userData)) {
+            textureRef = bridge.dataRef;
+            materialPrivate.sphereTextureRef = m_allocatedTextures.insert(textureRef, textureRef);
+            if (engine) {
+                engine->materialSphereMap.setTexture(material, textureRef);
+                VPVL2_VLOG(2, "Binding the texture as a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << (textureRef ? textureRef->data() : 0));
             }
         }
-        else if (const IString *toonTexturePath = material->toonTexture()) {
-            uploadToonTexture(material, toonTexturePath, engine, materialPrivate, false, userData);
+        else {
+            VPVL2_LOG(WARNING, "Cannot bind a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
+            release();
+            popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
+            return false;
+        }
+    }
+    if (material->isSharedToonTextureUsed()) {
+        char buf[16];
+        int toonIndex = material->toonTextureIndex();
+        if (toonIndex == 0) {
+            internal::snprintf(buf, sizeof(buf), "toon%d.bmp", toonIndex);
+        }
+        else {
+            internal::snprintf(buf, sizeof(buf), "toon%02d.bmp", toonIndex);
         }
+        if (IString *toonTexturePath = m_applicationContextRef->toUnicode(reinterpret_cast<const uint8 *>(buf))) {
+            uploadToonTexture(material, toonTexturePath, engine, materialPrivate, true, userData);
+            internal::deleteObject(toonTexturePath);
+        }
+    }
+    else if (const IString *toonTexturePath = material->toonTexture()) {
+        uploadToonTexture(material, toonTexturePath, engine, materialPrivate, false, userData);
     }
     popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
     return true;
@@ -915,7 +804,8 @@ void PMXRenderEngine::initializeEffectParameters(int extraCameraFlags)
     m_currentEffectEngineRef->useToon.setValue(true);
     m_currentEffectEngineRef->vertexCount.setValue(m_modelRef->count(IModel::kVertex));
     m_currentEffectEngineRef->subsetCount.setValue(m_modelRef->count(IModel::kMaterial));
-    m_currentEffectEngineRef->boneTransformTexture.setTexture(m_transformFeedbackProgram ? m_transformFeedbackProgram->textureRef() : 0);
+    /* vertices are already skinned by the CPU, OpenCL or transform feedback */
+    m_currentEffectEngineRef->boneTransformTexture.setTexture(0);
     m_currentEffectEngineRef->setModelMatrixParameters(m_modelRef, extraCameraFlags, 0);
     m_currentEffectEngineRef->updateModelLightParameters(m_sceneRef, m_modelRef);
 }
@@ -963,13 +853,8 @@ void PMXRenderEngine::bindDynamicVertexAttributePointers(IModel::IndexBuffer::St
 {
     pushAnnotationGroup("PMXRenderEngine#bindDynamicVertexAttributePointers", m_applicationContextRef->sharedFunctionResolverInstance());
     const vsize size = m_dynamicBuffer->strideSize();
-    vsize offset = m_dynamicBuffer->strideOffset(type);
+    vsize offset = 0;
     IEffect *effectRef = m_currentEffectEngineRef->effect();
-    effectRef->setVertexAttributePointer(IEffect::kPositionVertexAttribute, IEffect::Parameter::kFloat4, size, reinterpret_cast<const GLvoid *>(offset));
-    effectRef->activateVertexAttribute(IEffect::kPositionVertexAttribute);
-    offset = m_dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
-    effectRef->setVertexAttributePointer(IEffect::kNormalVertexAttribute, IEffect::Parameter::kFloat4, size, reinterpret_cast<const GLvoid *>(offset));
-    effectRef->activateVertexAttribute(IEffect::kNormalVertexAttribute);
     for (int i = 0; i <= kMaxUVASize; i++) {
         const IEffect::VertexAttributeType attribType = static_cast<IEffect::VertexAttributeType>(int(IEffect::kUVA1VertexAttribute) + i);
         const IModel::Buffer::StrideType strideType = static_cast<IModel::Buffer::StrideType>(int(IModel::Buffer::kUVA1Stride) + i);
@@ -977,6 +862,23 @@ void PMXRenderEngine::bindDynamicVertexAttributePointers(IModel::IndexBuffer::St
         effectRef->setVertexAttributePointer(attribType, IEffect::Parameter::kFloat4, size, reinterpret_cast<const GLvoid *>(offset));
         effectRef->activateVertexAttribute(attribType);
     }
+    if (m_skinning) {
+        /* positions, edges and normals are read from the transform feedback output instead */
+        m_skinning->bindSkinnedVertexBuffer();
+        const vsize skinnedSize = m_skinning->strideSize();
+        offset = m_skinning->strideOffset(type);
+        effectRef->setVertexAttributePointer(IEffect::kPositionVertexAttribute, IEffect::Parameter::kFloat4, skinnedSize, reinterpret_cast<const GLvoid *>(offset));
+        offset = m_skinning->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
+        effectRef->setVertexAttributePointer(IEffect::kNormalVertexAttribute, IEffect::Parameter::kFloat4, skinnedSize, reinterpret_cast<const GLvoid *>(offset));
+    }
+    else {
+        offset = m_dynamicBuffer->strideOffset(type);
+        effectRef->setVertexAttributePointer(IEffect::kPositionVertexAttribute, IEffect::Parameter::kFloat4, size, reinterpret_cast<const GLvoid *>(offset));
+        offset = m_dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
+        effectRef->setVertexAttributePointer(IEffect::kNormalVertexAttribute, IEffect::Parameter::kFloat4, size, reinterpret_cast<const GLvoid *>(offset));
+    }
+    effectRef->activateVertexAttribute(IEffect::kPositionVertexAttribute);
+    effectRef->activateVertexAttribute(IEffect::kNormalVertexAttribute);
     popAnnotationGroup(m_applicationContextRef->sharedFunctionResolverInstance());
 }
 
@@ -57,6 +57,10 @@ namespace gl2
 {
 using namespace extensions::gl;
 
+/* mat4 attribute takes four consecutive locations following the texture coordinate */
+static const GLuint kInstanceTransformAttribute = IModel::Buffer::kTextureCoordStride + 1;
+static const int kInstanceTransformAttributeSize = 4;
+
 class AssetRenderEngine::Program : public ObjectProgram
 {
 public:
@@ -139,6 +143,10 @@ public:
     }
 
 protected:
+    virtual void bindAttributeLocations() {
+        ObjectProgram::bindAttributeLocations();
+        bindAttribLocation(m_program, kInstanceTransformAttribute, "inInstanceTransform");
+    }
     virtual void getUniformLocations() {
         ObjectProgram::getUniformLocations();
         m_cameraPositionUniformLocation = getUniformLocation(m_program, "cameraPosition");
@@ -172,16 +180,35 @@ private:
     GLuint m_subTextureUniformLocation;
 };
 
+class AssetZPlotProgram : public ZPlotProgram
+{
+public:
+    AssetZPlotProgram(const IApplicationContext::FunctionResolver *resolver)
+        : ZPlotProgram(resolver)
+    {
+    }
+    ~AssetZPlotProgram() {
+    }
+
+protected:
+    virtual void bindAttributeLocations() {
+        ZPlotProgram::bindAttributeLocations();
+        bindAttribLocation(m_program, kInstanceTransformAttribute, "inInstanceTransform");
+    }
+};
+
 class AssetRenderEngine::PrivateContext
 {
 public:
     typedef std::map<std::string, ITexture *> Textures;
     PrivateContext()
-        : cullFaceState(true)
+        : instanceBuffer(0),
+          cullFaceState(true)
     {
     }
     virtual ~PrivateContext() {
         allocatedTextures.releaseAll();
+        internal::deleteObject(instanceBuffer);
     }
 
     Textures textures;
@@ -191,6 +218,8 @@ public:
     std::map<const struct aiMesh *, VertexBundleLayout *> vao;
     std::map<const struct aiNode *, AssetRenderEngine::Program *> assetPrograms;
     std::map<const struct aiNode *, ZPlotProgram *> zplotPrograms;
+    Array<float32> instanceTransforms;
+    VertexBundle *instanceBuffer;
     bool cullFaceState;
 };
 
@@ -228,12 +257,25 @@ AssetRenderEngine::AssetRenderEngine(IApplicationContext *applicationContextRef,
       drawElements(reinterpret_cast<PFNGLDRAWELEMENTS>(applicationContextRef->sharedFunctionResolverInstance()->resolveSymbol("glDrawElements"))),
       enableVertexAttribArray(reinterpret_cast<PFNGLENABLEVERTEXATTRIBARRAYPROC>(applicationContextRef->sharedFunctionResolverInstance()->resolveSymbol("glEnableVertexAttribArray"))),
       vertexAttribPointer(reinterpret_cast<PFNGLVERTEXATTRIBPOINTERPROC>(applicationContextRef->sharedFunctionResolverInstance()->resolveSymbol("glVertexAttribPointer"))),
+      disableVertexAttribArray(reinterpret_cast<PFNGLDISABLEVERTEXATTRIBARRAYPROC>(applicationContextRef->sharedFunctionResolverInstance()->resolveSymbol("glDisableVertexAttribArray"))),
+      vertexAttrib4fv(reinterpret_cast<PFNGLVERTEXATTRIB4FVPROC>(applicationContextRef->sharedFunctionResolverInstance()->resolveSymbol("glVertexAttrib4fv"))),
+      vertexAttribDivisor(0),
+      drawElementsInstanced(0),
       m_applicationContextRef(applicationContextRef),
       m_sceneRef(scene),
       m_modelRef(model),
       m_context(new PrivateContext()),
       m_bundle(applicationContextRef->sharedFunctionResolverInstance())
 {
+    const IApplicationContext::FunctionResolver *resolver = applicationContextRef->sharedFunctionResolverInstance();
+    if (resolver->query(IApplicationContext::FunctionResolver::kQueryVersion) >= makeVersion(3, 3)) {
+        vertexAttribDivisor = reinterpret_cast<PFNGLVERTEXATTRIBDIVISORPROC>(resolver->resolveSymbol("glVertexAttribDivisor"));
+        drawElementsInstanced = reinterpret_cast<PFNGLDRAWELEMENTSINSTANCEDPROC>(resolver->resolveSymbol("glDrawElementsInstanced"));
+    }
+    else if (resolver->hasExtension("ARB_instanced_arrays") && resolver->hasExtension("ARB_draw_instanced")) {
+        vertexAttribDivisor = reinterpret_cast<PFNGLVERTEXATTRIBDIVISORPROC>(resolver->resolveSymbol("glVertexAttribDivisorARB"));
+        drawElementsInstanced = reinterpret_cast<PFNGLDRAWELEMENTSINSTANCEDPROC>(resolver->resolveSymbol("glDrawElementsInstancedARB"));
+    }
 }
 
 AssetRenderEngine::~AssetRenderEngine()
@@ -348,10 +390,26 @@ bool AssetRenderEngine::upload(void *userData)
         }
     }
     ret = uploadRecurse(scene, scene->mRootNode, userData);
+    if (ret) {
+        m_context->instanceBuffer = new VertexBundle(m_applicationContextRef->sharedFunctionResolverInstance());
+        updateInstanceTransforms();
+    }
     m_modelRef->setVisible(ret);
     return ret;
 }
 
+IRenderEngine::UploadStatus AssetRenderEngine::uploadIncrementally(void *userData, int /* maxSteps */, UploadProgressListener *listener)
+{
+    /* assets are uploaded at once as they are small enough to fit in a frame */
+    if (!upload(userData)) {
+        return kUploadFailed;
+    }
+    if (listener) {
+        listener->uploadDidProgress(this, 1, 1);
+    }
+    return kUploadCompleted;
+}
+
 void AssetRenderEngine::release()
 {
     if (m_modelRef) {
@@ -365,7 +423,10 @@ void AssetRenderEngine::release()
 
 void AssetRenderEngine::update()
 {
-    /* do nothing */
+    if (!m_modelRef || !m_context->instanceBuffer) {
+        return;
+    }
+    updateInstanceTransforms();
 }
 
 void AssetRenderEngine::setUpdateOptions(int /* options */)
@@ -435,7 +496,7 @@ bool AssetRenderEngine::uploadRecurse(const aiScene *scene, const aiNode *node,
                        userData)) {
         return ret;
     }
-    ZPlotProgram *zplotProgram = m_context->zplotPrograms[node] = new ZPlotProgram(resolver);
+    ZPlotProgram *zplotProgram = m_context->zplotPrograms[node] = new AssetZPlotProgram(resolver);
     if (!createProgram(zplotProgram,
                        IApplicationContext::kZPlotVertexShader,
                        IApplicationContext::kZPlotFragmentShader,
@@ -613,8 +674,7 @@ void AssetRenderEngine::renderRecurse(const aiScene *scene, const aiNode *node)
         const struct aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
         setAssetMaterial(scene->mMaterials[mesh->mMaterialIndex], program);
         bindVertexBundle(mesh);
-        vsize nindices = m_context->indices[mesh];
-        drawElements(kGL_TRIANGLES, nindices, kGL_UNSIGNED_INT, 0);
+        drawInstances(mesh);
         unbindVertexBundle(mesh);
     }
     program->unbind();
@@ -625,17 +685,21 @@ void AssetRenderEngine::renderRecurse(const aiScene *scene, const aiNode *node)
 
 void AssetRenderEngine::renderZPlotRecurse(const aiScene *scene, const aiNode *node)
 {
-    static const Vertex v;
     float matrix4x4[16], opacity;
     const unsigned int nmeshes = node->mNumMeshes;
-    Program *program = m_context->assetPrograms[node];
+    ZPlotProgram *program = m_context->zplotPrograms[node];
     program->bind();
+    /* plots in the light space same as the shadow coord of the model program so the result does not depend on the camera */
     m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
                                   IApplicationContext::kWorldMatrix
                                   | IApplicationContext::kViewMatrix
                                   | IApplicationContext::kProjectionMatrix
-                                  | IApplicationContext::kCameraMatrix);
+                                  | IApplicationContext::kLightMatrix);
     program->setModelViewProjectionMatrix(matrix4x4);
+    m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
+                                  IApplicationContext::kWorldMatrix
+                                  | IApplicationContext::kCameraMatrix);
+    program->setTransformMatrix(matrix4x4);
     for (unsigned int i = 0; i < nmeshes; i++) {
         const struct aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
         const struct aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
@@ -643,8 +707,7 @@ void AssetRenderEngine::renderZPlotRecurse(const aiScene *scene, const aiNode *n
         if (succeeded && btFuzzyZero(opacity - 0.98f))
             continue;
         bindVertexBundle(mesh);
-        vsize nindices = m_context->indices[mesh];
-        drawElements(kGL_TRIANGLES, nindices, kGL_UNSIGNED_INT, 0);
+        drawInstances(mesh);
         unbindVertexBundle(mesh);
     }
     program->unbind();
@@ -728,6 +791,72 @@ void AssetRenderEngine::bindStaticVertexAttributePointers()
     enableVertexAttribArray(IModel::Buffer::kTextureCoordStride);
 }
 
+void AssetRenderEngine::updateInstanceTransforms()
+{
+    Array<float32> &transforms = m_context->instanceTransforms;
+    const int ninstances = m_modelRef->countInstanceTransforms();
+    const int size = 16 * btMax(ninstances, 1);
+    if (transforms.count() != size) {
+        transforms.resize(size);
+    }
+    if (ninstances == 0) {
+        /* an asset without placements is drawn once at its own position */
+        Transform::getIdentity().getOpenGLMatrix(&transforms[0]);
+    }
+    for (int i = 0; i < ninstances; i++) {
+        m_modelRef->instanceTransformAt(i).getOpenGLMatrix(&transforms[i * 16]);
+    }
+    if (ninstances > 1 && drawElementsInstanced) {
+        VertexBundle *buffer = m_context->instanceBuffer;
+        const vsize bytes = sizeof(transforms[0]) * size;
+        if (buffer->findName(0)) {
+            /* respecifies the storage so the driver does not have to wait for the last draw */
+            buffer->bind(VertexBundle::kVertexBuffer, 0);
+            buffer->allocate(VertexBundle::kVertexBuffer, VertexBundle::kGL_STREAM_DRAW, bytes, &transforms[0]);
+            buffer->unbind(VertexBundle::kVertexBuffer);
+        }
+        else {
+            buffer->create(VertexBundle::kVertexBuffer, 0, VertexBundle::kGL_STREAM_DRAW, &transforms[0], bytes);
+        }
+    }
+}
+
+void AssetRenderEngine::drawInstances(const aiMesh *mesh)
+{
+    const Array<float32> &transforms = m_context->instanceTransforms;
+    const int ninstances = transforms.count() / 16;
+    const vsize nindices = m_context->indices[mesh];
+    if (ninstances > 1 && drawElementsInstanced) {
+        /* the divisor and the attribute pointers are part of the vertex array object state */
+        static const GLsizei kStride = sizeof(float32) * 16;
+        m_context->instanceBuffer->bind(VertexBundle::kVertexBuffer, 0);
+        for (int i = 0; i < kInstanceTransformAttributeSize; i++) {
+            const GLuint location = kInstanceTransformAttribute + i;
+            const void *columnPtr = reinterpret_cast<const void *>(sizeof(transforms[0]) * 4 * i);
+            vertexAttribPointer(location, 4, kGL_FLOAT, kGL_FALSE, kStride, columnPtr);
+            vertexAttribDivisor(location, 1);
+            enableVertexAttribArray(location);
+        }
+        drawElementsInstanced(kGL_TRIANGLES, nindices, kGL_UNSIGNED_INT, 0, ninstances);
+        for (int i = 0; i < kInstanceTransformAttributeSize; i++) {
+            const GLuint location = kInstanceTransformAttribute + i;
+            vertexAttribDivisor(location, 0);
+            disableVertexAttribArray(location);
+        }
+        m_context->instanceBuffer->unbind(VertexBundle::kVertexBuffer);
+    }
+    else {
+        /* falls back to a draw call per instance with the transform as a constant attribute */
+        for (int i = 0; i < ninstances; i++) {
+            const float32 *transform = &transforms[i * 16];
+            for (int j = 0; j < kInstanceTransformAttributeSize; j++) {
+                vertexAttrib4fv(kInstanceTransformAttribute + j, transform + j * 4);
+            }
+            drawElements(kGL_TRIANGLES, nindices, kGL_UNSIGNED_INT, 0);
+        }
+    }
+}
+
 } /* namespace gl2 */
 } /* namespace vpvl2 */
 
@@ -0,0 +1,332 @@
+/**
+
+ Copyright (c) 2009-2011  Nagoya Institute of Technology
+                          Department of Computer Science
+               2010-2013  hkrn
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+
+ - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ - Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following
+   disclaimer in the documentation and/or other materials provided
+   with the distribution.
+ - Neither the name of the MMDAI project team nor the names of
+   its contributors may be used to endorse or promote products
+   derived from this software without specific prior written
+   permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vpvl2/vpvl2.h"
+#include "vpvl2/internal/util.h"
+
+#include "vpvl2/extensions/gl/ShaderProgram.h"
+#include "vpvl2/gl2/BatchRenderer.h"
+#include "vpvl2/gl2/PMXRenderEngine.h"
+
+namespace vpvl2
+{
+namespace gl2
+{
+using namespace extensions::gl;
+
+BatchRenderer::State::State(const IApplicationContext::FunctionResolver *resolver)
+    : cullFace(reinterpret_cast<PFNGLCULLFACEPROC>(resolver->resolveSymbol("glCullFace"))),
+      enable(reinterpret_cast<PFNGLENABLEPROC>(resolver->resolveSymbol("glEnable"))),
+      disable(reinterpret_cast<PFNGLDISABLEPROC>(resolver->resolveSymbol("glDisable"))),
+      drawElements(reinterpret_cast<PFNGLDRAWELEMENTSPROC>(resolver->resolveSymbol("glDrawElements"))),
+      multiDrawElements(reinterpret_cast<PFNGLMULTIDRAWELEMENTSPROC>(resolver->resolveSymbol("glMultiDrawElements"))),
+      m_currentProgramRef(0),
+      m_cullFaceMode(kGL_BACK),
+      m_nextOffset(0),
+      m_nappendedDraws(0),
+      m_nstateChanges(0),
+      m_nunbatchedStateChanges(0),
+      m_nsavedDrawCalls(0),
+      m_cullFaceEnabled(true),
+      m_blendEnabled(true)
+{
+}
+
+BatchRenderer::State::~State()
+{
+    m_currentProgramRef = 0;
+}
+
+void BatchRenderer::State::begin()
+{
+    /* engines assume culling back faces and blending are enabled outside of their passes */
+    m_boundProgramRefs.clear();
+    m_counts.clear();
+    m_offsets.clear();
+    m_currentProgramRef = 0;
+    m_cullFaceMode = kGL_BACK;
+    m_nextOffset = 0;
+    m_nappendedDraws = 0;
+    m_nstateChanges = 0;
+    m_nunbatchedStateChanges = 0;
+    m_nsavedDrawCalls = 0;
+    m_cullFaceEnabled = true;
+    m_blendEnabled = true;
+}
+
+void BatchRenderer::State::end()
+{
+    if (m_currentProgramRef) {
+        m_currentProgramRef->unbind();
+        m_currentProgramRef = 0;
+        m_nstateChanges++;
+    }
+    setCullFaceEnable(true);
+    setCullFaceMode(kGL_BACK);
+    setBlendEnable(true);
+}
+
+bool BatchRenderer::State::bindProgram(ShaderProgram *program, int nframeUniforms)
+{
+    if (m_currentProgramRef != program) {
+        program->bind();
+        m_currentProgramRef = program;
+        m_nstateChanges++;
+    }
+    /* uniforms that are same in the frame are kept by the program until the next frame */
+    if (m_boundProgramRefs.find(program)) {
+        return false;
+    }
+    m_boundProgramRefs.insert(program, nframeUniforms);
+    m_nstateChanges += nframeUniforms;
+    return true;
+}
+
+void BatchRenderer::State::setCullFaceEnable(bool value)
+{
+    if (m_cullFaceEnabled != value) {
+        if (value) {
+            enable(kGL_CULL_FACE);
+        }
+        else {
+            disable(kGL_CULL_FACE);
+        }
+        m_cullFaceEnabled = value;
+        m_nstateChanges++;
+    }
+}
+
+void BatchRenderer::State::setCullFaceMode(GLenum value)
+{
+    if (m_cullFaceMode != value) {
+        cullFace(value);
+        m_cullFaceMode = value;
+        m_nstateChanges++;
+    }
+}
+
+void BatchRenderer::State::setBlendEnable(bool value)
+{
+    if (m_blendEnabled != value) {
+        if (value) {
+            enable(kGL_BLEND);
+        }
+        else {
+            disable(kGL_BLEND);
+        }
+        m_blendEnabled = value;
+        m_nstateChanges++;
+    }
+}
+
+void BatchRenderer::State::addUnbatchedStateChanges(int value)
+{
+    m_nunbatchedStateChanges += value;
+}
+
+void BatchRenderer::State::appendDrawElements(GLsizei count, vsize offset, vsize size)
+{
+    const int nruns = m_counts.count();
+    if (nruns > 0 && m_nextOffset == offset) {
+        /* index ranges of consecutive materials are contiguous in the index buffer */
+        m_counts[nruns - 1] += count;
+    }
+    else {
+        m_counts.append(count);
+        m_offsets.append(reinterpret_cast<const GLvoid *>(offset));
+    }
+    m_nextOffset = offset + count * size;
+    m_nappendedDraws++;
+}
+
+int BatchRenderer::State::flushDrawElements(GLenum type)
+{
+    const int nruns = m_counts.count();
+    int ncalls = 0;
+    if (nruns == 1) {
+        drawElements(kGL_TRIANGLES, m_counts[0], type, m_offsets[0]);
+        ncalls = 1;
+    }
+    else if (nruns > 1 && multiDrawElements) {
+        multiDrawElements(kGL_TRIANGLES, &m_counts[0], type, &m_offsets[0], nruns);
+        ncalls = 1;
+    }
+    else {
+        for (int i = 0; i < nruns; i++) {
+            drawElements(kGL_TRIANGLES, m_counts[i], type, m_offsets[i]);
+        }
+        ncalls = nruns;
+    }
+    m_nsavedDrawCalls += m_nappendedDraws - ncalls;
+    m_counts.clear();
+    m_offsets.clear();
+    m_nextOffset = 0;
+    m_nappendedDraws = 0;
+    return ncalls;
+}
+
+int BatchRenderer::State::countStateChanges() const
+{
+    return m_nstateChanges;
+}
+
+int BatchRenderer::State::countSavedStateChanges() const
+{
+    return m_nunbatchedStateChanges - m_nstateChanges;
+}
+
+int BatchRenderer::State::countSavedDrawCalls() const
+{
+    return m_nsavedDrawCalls;
+}
+
+class BatchRenderer::PrivateContext
+{
+public:
+    PrivateContext(IApplicationContext *applicationContextRef)
+        : state(applicationContextRef->sharedFunctionResolverInstance())
+    {
+    }
+    ~PrivateContext() {
+    }
+
+    void renderBatchedEngines(bool rendersShadow) {
+        const int nengines = batchedEngineRefs.count();
+        for (int i = 0; i < nengines; i++) {
+            PMXRenderEngine *engine = batchedEngineRefs[i];
+            engine->setBatchStateRef(&state);
+            engine->renderModel();
+        }
+        for (int i = 0; i < nengines; i++) {
+            batchedEngineRefs[i]->renderEdge();
+        }
+        if (rendersShadow) {
+            for (int i = 0; i < nengines; i++) {
+                batchedEngineRefs[i]->renderShadow();
+            }
+        }
+        for (int i = 0; i < nengines; i++) {
+            batchedEngineRefs[i]->setBatchStateRef(0);
+        }
+        batchedEngineRefs.clear();
+    }
+
+    State state;
+    Hash<HashPtr, PMXRenderEngine *> engineRefs;
+    Array<PMXRenderEngine *> batchedEngineRefs;
+};
+
+BatchRenderer::BatchRenderer(IApplicationContext *applicationContextRef)
+    : m_context(new PrivateContext(applicationContextRef))
+{
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    internal::deleteObject(m_context);
+}
+
+void BatchRenderer::addEngineRef(PMXRenderEngine *value)
+{
+    if (value) {
+        m_context->engineRefs.insert(static_cast<const IRenderEngine *>(value), value);
+    }
+}
+
+void BatchRenderer::removeEngineRef(PMXRenderEngine *value)
+{
+    m_context->engineRefs.remove(static_cast<const IRenderEngine *>(value));
+}
+
+bool BatchRenderer::containsEngineRef(const IRenderEngine *value) const
+{
+    return m_context->engineRefs.find(value) != 0;
+}
+
+void BatchRenderer::render(const Array<IRenderEngine *> &engines, bool rendersShadow)
+{
+    Array<PMXRenderEngine *> &batchedEngineRefs = m_context->batchedEngineRefs;
+    State &state = m_context->state;
+    batchedEngineRefs.clear();
+    state.begin();
+    for (int i = 0, nengines = engines.count(); i < nengines; i++) {
+        IRenderEngine *engine = engines[i];
+        PMXRenderEngine *const *engineRef = m_context->engineRefs.find(engine);
+        /*
+         * only consecutive engines sharing programs are drawn pass by pass, so the render order
+         * between other engines (e.g. back to front order of transparent models) is kept as is
+         */
+        if (batchedEngineRefs.count() > 0 && (!engineRef || (*engineRef)->batchKey() != batchedEngineRefs[0]->batchKey())) {
+            m_context->renderBatchedEngines(rendersShadow);
+        }
+        if (engineRef) {
+            batchedEngineRefs.append(*engineRef);
+        }
+        else {
+            /* unregistered engines expect the default state and bind their own programs */
+            state.end();
+            engine->renderModel();
+            engine->renderEdge();
+            if (rendersShadow) {
+                engine->renderShadow();
+            }
+        }
+    }
+    m_context->renderBatchedEngines(rendersShadow);
+    state.end();
+    VPVL2_PROFILE_COUNT(kSavedStateChangeCounter, state.countSavedStateChanges());
+}
+
+int BatchRenderer::countStateChanges() const
+{
+    return m_context->state.countStateChanges();
+}
+
+int BatchRenderer::countSavedStateChanges() const
+{
+    return m_context->state.countSavedStateChanges();
+}
+
+int BatchRenderer::countSavedDrawCalls() const
+{
+    return m_context->state.countSavedDrawCalls();
+}
+
+} /* namespace gl2 */
+} /* namespace vpvl2 */
@@ -40,12 +40,18 @@
 #include "vpvl2/vpvl2.h"
 
 #include "EngineCommon.h"
+#include "vpvl2/extensions/gl/BoneMatrixTexture.h"
+#include "vpvl2/extensions/gl/TransformFeedbackSkinning.h"
 #include "vpvl2/extensions/gl/VertexBundle.h"
 #include "vpvl2/extensions/gl/VertexBundleLayout.h"
 #include "vpvl2/internal/util.h" /* internal::snprintf */
+#include "vpvl2/pmx/Model.h" /* pmx::Model::kMaxBonesPerDraw */
 #include "vpvl2/gl2/PMXRenderEngine.h"
 #include "vpvl2/cl/PMXAccelerator.h"
 
+#include <cstring> /* std::memcmp */
+#include <string>
+
 using namespace vpvl2;
 using namespace vpvl2::gl2;
 using namespace vpvl2::extensions::gl;
@@ -70,6 +76,46 @@ enum VertexArrayObjectType
     kMaxVertexArrayObjectType
 };
 
+/* each step runs at once in uploadIncrementally and materials follow kUploadMaterialsStep one by one */
+enum UploadStepType
+{
+    kUploadSkinningStep,
+    kUploadEdgeProgramStep,
+    kUploadModelProgramStep,
+    kUploadShadowProgramStep,
+    kUploadZPlotProgramStep,
+    kUploadBuffersStep,
+    kUploadMaterialsStep
+};
+
+/* fetchBoneMatrix of the skinning vertex shaders, prepended by createProgram for each skinning mode */
+static const char kBoneMatrixTextureFetcherSource[] =
+        "#if __VERSION__ < 130\n"
+        "#define texture texture2D\n"
+        "#endif\n"
+        "uniform sampler2D boneMatrixTexture;\n"
+        "uniform float numBones;\n"
+        "mat4 fetchBoneMatrix(const float index) {\n"
+        "    float newIndex = (index + 0.5) / numBones;\n"
+        "    return mat4(texture(boneMatrixTexture, vec2(0.125, newIndex)),\n"
+        "                texture(boneMatrixTexture, vec2(0.375, newIndex)),\n"
+        "                texture(boneMatrixTexture, vec2(0.625, newIndex)),\n"
+        "                texture(boneMatrixTexture, vec2(0.875, newIndex)));\n"
+        "}\n";
+/* kMaxBones is filled with pmx::Model::kMaxBonesPerDraw */
+static const char kBoneMatricesFetcherSource[] =
+        "const int kMaxBones = %d;\n"
+        "uniform mat4 boneMatrices[kMaxBones];\n"
+        "mat4 fetchBoneMatrix(const float index) {\n"
+        "    return boneMatrices[int(index)];\n"
+        "}\n";
+
+/* uniforms that are same in all engines in a frame and can be skipped in BatchRenderer */
+static const int kModelFrameUniforms = 4;
+static const int kShadowFrameUniforms = 2;
+/* program bind and unbind that BatchRenderer replaces with a bind per run of engines */
+static const int kProgramBindingStateChanges = 2;
+
 struct MaterialTextureRefs
 {
     MaterialTextureRefs()
@@ -88,53 +134,176 @@ struct MaterialTextureRefs
     ITexture *toonTextureRef;
 };
 
-class ExtendedZPlotProgram : public ZPlotProgram
+struct MaterialBoneSphere
+{
+    MaterialBoneSphere()
+        : boneRef(0),
+          radius(0)
+    {
+    }
+    MaterialBoneSphere(const IBone *bone, const Scalar &r)
+        : boneRef(bone),
+          radius(r)
+    {
+    }
+    const IBone *boneRef;
+    Scalar radius;
+};
+
+struct MaterialBounds
+{
+    MaterialBounds()
+        : aabbMin(kZeroV3),
+          aabbMax(kZeroV3),
+          sphereOffset(0),
+          nspheres(0),
+          vertexOffset(0),
+          nvertices(0),
+          maxEdgeSize(0)
+    {
+    }
+    Vector3 aabbMin;
+    Vector3 aabbMax;
+    int sphereOffset;
+    int nspheres;
+    int vertexOffset;
+    int nvertices;
+    IVertex::EdgeSizePrecision maxEdgeSize;
+};
+
+class Frustum
 {
 public:
-    ExtendedZPlotProgram(const IApplicationContext::FunctionResolver *resolver)
-        : ZPlotProgram(resolver),
-          m_boneMatricesUniformLocation(-1)
+    enum Result {
+        kOutside,
+        kIntersect,
+        kInside
+    };
+
+    static bool isValidAabb(const Vector3 &aabbMin, const Vector3 &aabbMax) {
+        return aabbMin.x() <= aabbMax.x() && aabbMin.y() <= aabbMax.y() && aabbMin.z() <= aabbMax.z()
+                && aabbMin != aabbMax && aabbMax.x() < SIMD_INFINITY && aabbMin.x() > -SIMD_INFINITY;
+    }
+
+    Frustum(const float32 *m) {
+        /* extracts six clipping planes from the column major model-view-projection matrix */
+        for (int i = 0; i < 3; i++) {
+            m_planes[i * 2 + 0].setValue(m[3] + m[i], m[7] + m[i + 4], m[11] + m[i + 8], m[15] + m[i + 12]);
+            m_planes[i * 2 + 1].setValue(m[3] - m[i], m[7] - m[i + 4], m[11] - m[i + 8], m[15] - m[i + 12]);
+        }
+    }
+    ~Frustum() {
+    }
+
+    Result classify(const Vector3 &aabbMin, const Vector3 &aabbMax, const Scalar &padding) const {
+        if (!isValidAabb(aabbMin, aabbMax)) {
+            return kIntersect;
+        }
+        const Vector3 &paddingV3 = Vector3(padding, padding, padding),
+                &minV3 = aabbMin - paddingV3, &maxV3 = aabbMax + paddingV3;
+        Result result = kInside;
+        for (int i = 0; i < kMaxPlanes; i++) {
+            const Vector4 &plane = m_planes[i];
+            const Scalar &a = plane.x(), &b = plane.y(), &c = plane.z(), &d = plane.w();
+            const Scalar &farthest = a * (a >= 0 ? maxV3.x() : minV3.x())
+                    + b * (b >= 0 ? maxV3.y() : minV3.y())
+                    + c * (c >= 0 ? maxV3.z() : minV3.z()) + d;
+            if (farthest < 0) {
+                return kOutside;
+            }
+            const Scalar &nearest = a * (a >= 0 ? minV3.x() : maxV3.x())
+                    + b * (b >= 0 ? minV3.y() : maxV3.y())
+                    + c * (c >= 0 ? minV3.z() : maxV3.z()) + d;
+            if (nearest < 0) {
+                result = kIntersect;
+            }
+        }
+        return result;
+    }
+
+private:
+    static const int kMaxPlanes = 6;
+    Vector4 m_planes[kMaxPlanes];
+};
+
+/* bone matrix uniforms shared by the programs of vertex shader skinning */
+template<typename TBaseProgram>
+class SkinningProgram : public TBaseProgram
+{
+public:
+    SkinningProgram(const IApplicationContext::FunctionResolver *resolver)
+        : TBaseProgram(resolver),
+          m_boneMatricesUniformLocation(-1),
+          m_boneMatrixTextureUniformLocation(-1),
+          m_numBonesUniformLocation(-1)
     {
     }
-    ~ExtendedZPlotProgram() {
+    virtual ~SkinningProgram() {
         m_boneMatricesUniformLocation = -1;
+        m_boneMatrixTextureUniformLocation = -1;
+        m_numBonesUniformLocation = -1;
     }
 
     void setBoneMatrices(const Scalar *value, vsize size) {
-        uniformMatrix4fv(m_boneMatricesUniformLocation, int(size), kGL_FALSE, value);
+        this->uniformMatrix4fv(m_boneMatricesUniformLocation, int(size), kGL_FALSE, value);
+    }
+    void setBoneMatrixTexture(GLuint value, int nbones) {
+        this->activeTexture(Texture2D::kGL_TEXTURE0 + 4);
+        this->bindTexture(Texture2D::kGL_TEXTURE_2D, value);
+        this->uniform1i(m_boneMatrixTextureUniformLocation, 4);
+        this->uniform1f(m_numBonesUniformLocation, GLfloat(nbones));
+        this->activeTexture(Texture2D::kGL_TEXTURE0);
     }
 
 protected:
-    virtual void bindAttributeLocations() {
-        ZPlotProgram::bindAttributeLocations();
-        bindAttribLocation(m_program, IModel::Buffer::kBoneIndexStride, "inBoneIndices");
-        bindAttribLocation(m_program, IModel::Buffer::kBoneWeightStride, "inBoneWeights");
+    void bindBoneAttributeLocations() {
+        this->bindAttribLocation(this->m_program, IModel::Buffer::kBoneIndexStride, "inBoneIndices");
+        this->bindAttribLocation(this->m_program, IModel::Buffer::kBoneWeightStride, "inBoneWeights");
     }
     virtual void getUniformLocations() {
-        ZPlotProgram::getUniformLocations();
-        m_boneMatricesUniformLocation = getUniformLocation(m_program, "boneMatrices");
+        TBaseProgram::getUniformLocations();
+        m_boneMatricesUniformLocation = this->getUniformLocation(this->m_program, "boneMatrices");
+        m_boneMatrixTextureUniformLocation = this->getUniformLocation(this->m_program, "boneMatrixTexture");
+        m_numBonesUniformLocation = this->getUniformLocation(this->m_program, "numBones");
     }
 
 private:
     GLint m_boneMatricesUniformLocation;
+    GLint m_boneMatrixTextureUniformLocation;
+    GLint m_numBonesUniformLocation;
 };
 
-class EdgeProgram : public BaseShaderProgram
+class ExtendedZPlotProgram : public SkinningProgram<ZPlotProgram>
+{
+public:
+    ExtendedZPlotProgram(const IApplicationContext::FunctionResolver *resolver)
+        : SkinningProgram<ZPlotProgram>(resolver)
+    {
+    }
+    ~ExtendedZPlotProgram() {
+    }
+
+protected:
+    virtual void bindAttributeLocations() {
+        ZPlotProgram::bindAttributeLocations();
+        bindBoneAttributeLocations();
+    }
+};
+
+class EdgeProgram : public SkinningProgram<BaseShaderProgram>
 {
 public:
     EdgeProgram(const IApplicationContext::FunctionResolver *resolver)
-        : BaseShaderProgram(resolver),
+        : SkinningProgram<BaseShaderProgram>(resolver),
           m_colorUniformLocation(-1),
           m_edgeSizeUniformLocation(-1),
-          m_opacityUniformLocation(-1),
-          m_boneMatricesUniformLocation(-1)
+          m_opacityUniformLocation(-1)
     {
     }
     ~EdgeProgram() {
         m_colorUniformLocation = -1;
         m_edgeSizeUniformLocation = -1;
         m_opacityUniformLocation = -1;
-        m_boneMatricesUniformLocation = -1;
     }
 
     void setColor(const Color &value) {
@@ -146,74 +315,60 @@ public:
     void setOpacity(const Scalar &value) {
         uniform1f(m_opacityUniformLocation, value);
     }
-    void setBoneMatrices(const Scalar *value, vsize size) {
-        uniformMatrix4fv(m_boneMatricesUniformLocation, int(size), kGL_FALSE, value);
-    }
 
 protected:
     virtual void bindAttributeLocations() {
         BaseShaderProgram::bindAttributeLocations();
         bindAttribLocation(m_program, IModel::Buffer::kNormalStride, "inNormal");
-        bindAttribLocation(m_program, IModel::Buffer::kBoneIndexStride, "inBoneIndices");
-        bindAttribLocation(m_program, IModel::Buffer::kBoneWeightStride, "inBoneWeights");
+        bindBoneAttributeLocations();
     }
     virtual void getUniformLocations() {
-        BaseShaderProgram::getUniformLocations();
+        SkinningProgram<BaseShaderProgram>::getUniformLocations();
         m_colorUniformLocation = getUniformLocation(m_program, "color");
         m_edgeSizeUniformLocation = getUniformLocation(m_program, "edgeSize");
         m_opacityUniformLocation = getUniformLocation(m_program, "opacity");
-        m_boneMatricesUniformLocation = getUniformLocation(m_program, "boneMatrices");
     }
 
 private:
     GLint m_colorUniformLocation;
     GLint m_edgeSizeUniformLocation;
     GLint m_opacityUniformLocation;
-    GLint m_boneMatricesUniformLocation;
 };
 
-class ShadowProgram : public ObjectProgram
+class ShadowProgram : public SkinningProgram<ObjectProgram>
 {
 public:
     ShadowProgram(const IApplicationContext::FunctionResolver *resolver)
-        : ObjectProgram(resolver),
-          m_shadowMatrixUniformLocation(-1),
-          m_boneMatricesUniformLocation(-1)
+        : SkinningProgram<ObjectProgram>(resolver),
+          m_shadowMatrixUniformLocation(-1)
     {
     }
     ~ShadowProgram() {
         m_shadowMatrixUniformLocation = -1;
-        m_boneMatricesUniformLocation = -1;
     }
 
     void setShadowMatrix(const float value[16]) {
         uniformMatrix4fv(m_shadowMatrixUniformLocation, 1, kGL_FALSE, value);
     }
-    void setBoneMatrices(const Scalar *value, vsize size) {
-        uniformMatrix4fv(m_boneMatricesUniformLocation, int(size), kGL_FALSE, value);
-    }
 
 protected:
     virtual void bindAttributeLocations() {
-        bindAttribLocation(m_program, IModel::Buffer::kBoneIndexStride, "inBoneIndices");
-        bindAttribLocation(m_program, IModel::Buffer::kBoneWeightStride, "inBoneWeights");
+        bindBoneAttributeLocations();
     }
     virtual void getUniformLocations() {
-        ObjectProgram::getUniformLocations();
+        SkinningProgram<ObjectProgram>::getUniformLocations();
         m_shadowMatrixUniformLocation = getUniformLocation(m_program, "shadowMatrix");
-        m_boneMatricesUniformLocation = getUniformLocation(m_program, "boneMatrices");
     }
 
 private:
     GLint m_shadowMatrixUniformLocation;
-    GLint m_boneMatricesUniformLocation;
 };
 
-class ModelProgram : public ObjectProgram
+class ModelProgram : public SkinningProgram<ObjectProgram>
 {
 public:
     ModelProgram(const IApplicationContext::FunctionResolver *resolver)
-        : ObjectProgram(resolver),
+        : SkinningProgram<ObjectProgram>(resolver),
           m_cameraPositionUniformLocation(-1),
           m_materialColorUniformLocation(-1),
           m_materialSpecularUniformLocation(-1),
@@ -228,8 +383,7 @@ public:
           m_isSubTextureUniformLocation(-1),
           m_toonTextureUniformLocation(-1),
           m_hasToonTextureUniformLocation(-1),
-          m_useToonUniformLocation(-1),
-          m_boneMatricesUniformLocation(-1)
+          m_useToonUniformLocation(-1)
     {
     }
     ~ModelProgram() {
@@ -248,7 +402,6 @@ public:
         m_toonTextureUniformLocation = -1;
         m_hasToonTextureUniformLocation = -1;
         m_useToonUniformLocation = -1;
-        m_boneMatricesUniformLocation = -1;
     }
 
     void setCameraPosition(const Vector3 &value) {
@@ -320,19 +473,15 @@ public:
             uniform1i(m_hasToonTextureUniformLocation, 0);
         }
     }
-    void setBoneMatrices(const Scalar *value, vsize size) {
-        uniformMatrix4fv(m_boneMatricesUniformLocation, int(size), kGL_FALSE, value);
-    }
 
 protected:
     virtual void bindAttributeLocations() {
         ObjectProgram::bindAttributeLocations();
         bindAttribLocation(m_program, IModel::Buffer::kUVA1Stride, "inUVA1");
-        bindAttribLocation(m_program, IModel::Buffer::kBoneIndexStride, "inBoneIndices");
-        bindAttribLocation(m_program, IModel::Buffer::kBoneWeightStride, "inBoneWeights");
+        bindBoneAttributeLocations();
     }
     virtual void getUniformLocations() {
-        ObjectProgram::getUniformLocations();
+        SkinningProgram<ObjectProgram>::getUniformLocations();
         m_cameraPositionUniformLocation = getUniformLocation(m_program, "cameraPosition");
         m_materialColorUniformLocation = getUniformLocation(m_program, "materialColor");
         m_materialSpecularUniformLocation = getUniformLocation(m_program, "materialSpecular");
@@ -348,7 +497,6 @@ protected:
         m_toonTextureUniformLocation = getUniformLocation(m_program, "toonTexture");
         m_hasToonTextureUniformLocation = getUniformLocation(m_program, "hasToonTexture");
         m_useToonUniformLocation = getUniformLocation(m_program, "useToon");
-        m_boneMatricesUniformLocation = getUniformLocation(m_program, "boneMatrices");
     }
 
 private:
@@ -374,9 +522,105 @@ private:
     GLint m_toonTextureUniformLocation;
     GLint m_hasToonTextureUniformLocation;
     GLint m_useToonUniformLocation;
-    GLint m_boneMatricesUniformLocation;
 };
 
+/* immutable GPU resources which engines of the same model data can refer instead of uploading their own */
+class SharedResources VPVL2_DECL_FINAL
+{
+public:
+    SharedResources(const IApplicationContext::FunctionResolver *resolver)
+        : buffer(resolver),
+          edgeProgram(0),
+          modelProgram(0),
+          shadowProgram(0),
+          zplotProgram(0),
+          isVertexShaderSkinning(false),
+          hasBoneMatrixTexture(false),
+          nrefs(1)
+    {
+    }
+    ~SharedResources() {
+        allocatedTextures.releaseAll();
+        internal::deleteObject(edgeProgram);
+        internal::deleteObject(modelProgram);
+        internal::deleteObject(shadowProgram);
+        internal::deleteObject(zplotProgram);
+    }
+
+    void retain() {
+        nrefs++;
+    }
+    void release() {
+        if (--nrefs == 0) {
+            delete this;
+        }
+    }
+
+    VertexBundle buffer;
+    EdgeProgram *edgeProgram;
+    ModelProgram *modelProgram;
+    ShadowProgram *shadowProgram;
+    ExtendedZPlotProgram *zplotProgram;
+    PointerHash<HashPtr, ITexture> allocatedTextures;
+    Array<MaterialTextureRefs> materialTextureRefs;
+    bool isVertexShaderSkinning;
+    bool hasBoneMatrixTexture;
+
+private:
+    int nrefs;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(SharedResources)
+};
+
+static inline bool usesVertexShaderSkinning(const Scene *sceneRef)
+{
+    const Scene::AccelerationType type = sceneRef->accelerationType();
+    return type == Scene::kVertexShaderAccelerationType1 || type == Scene::kVertexShaderAccelerationType2;
+}
+
+static inline bool equalsTextureName(const IString *left, const IString *right)
+{
+    return left && right ? left->equals(right) : left == right;
+}
+
+static bool equalsStaticBuffer(const IModel::StaticVertexBuffer *left, const IModel::StaticVertexBuffer *right)
+{
+    const vsize size = left->size();
+    if (size != right->size() || left->strideSize() != right->strideSize()) {
+        return false;
+    }
+    else if (size == 0) {
+        return true;
+    }
+    Array<uint8> leftBytes, rightBytes;
+    leftBytes.resize(int(size));
+    rightBytes.resize(int(size));
+    left->update(&leftBytes[0]);
+    right->update(&rightBytes[0]);
+    return std::memcmp(&leftBytes[0], &rightBytes[0], size) == 0;
+}
+
+static bool equalsMaterials(const IModel *left, const IModel *right)
+{
+    Array<IMaterial *> leftMaterials, rightMaterials;
+    left->getMaterialRefs(leftMaterials);
+    right->getMaterialRefs(rightMaterials);
+    const int nmaterials = leftMaterials.count();
+    if (nmaterials != rightMaterials.count()) {
+        return false;
+    }
+    for (int i = 0; i < nmaterials; i++) {
+        const IMaterial *leftMaterial = leftMaterials[i], *rightMaterial = rightMaterials[i];
+        if (leftMaterial->indexRange() != rightMaterial->indexRange() ||
+                !equalsTextureName(leftMaterial->mainTexture(), rightMaterial->mainTexture()) ||
+                !equalsTextureName(leftMaterial->sphereTexture(), rightMaterial->sphereTexture()) ||
+                !equalsTextureName(leftMaterial->toonTexture(), rightMaterial->toonTexture())) {
+            return false;
+        }
+    }
+    return true;
+}
+
 }
 
 namespace vpvl2
@@ -393,23 +637,27 @@ public:
           staticBuffer(0),
           dynamicBuffer(0),
           matrixBuffer(0),
-          edgeProgram(0),
-          modelProgram(0),
-          shadowProgram(0),
-          zplotProgram(0),
+          skinning(0),
+          boneMatrixTexture(0),
+          resources(new SharedResources(resolver)),
+          batchStateRef(0),
           buffer(resolver),
           aabbMin(SIMD_INFINITY, SIMD_INFINITY, SIMD_INFINITY),
           aabbMax(-SIMD_INFINITY, -SIMD_INFINITY, -SIMD_INFINITY),
+          nculledDrawCalls(0),
+          nissuedDrawCalls(0),
+          uploadStep(kUploadSkinningStep),
           cullFaceState(true),
           isVertexShaderSkinning(isVertexShaderSkinning),
-          updateEven(true)
+          updateEven(true),
+          frustumCulling(true),
+          materialBoundsDirty(true),
+          renderable(false),
+          sharesResources(false)
     {
         model->getIndexBuffer(indexBuffer);
         model->getStaticVertexBuffer(staticBuffer);
         model->getDynamicVertexBuffer(dynamicBuffer, indexBuffer);
-        if (isVertexShaderSkinning) {
-            model->getMatrixBuffer(matrixBuffer, dynamicBuffer, indexBuffer);
-        }
         switch (indexBuffer->type()) {
         case IModel::IndexBuffer::kIndex32:
             indexType = kGL_UNSIGNED_INT;
@@ -433,18 +681,31 @@ public:
         for (int i = 0; i < kMaxVertexArrayObjectType; i++) {
             internal::deleteObject(bundles[i]);
         }
-        allocatedTextures.releaseAll();
+        internal::deleteObject(matrixBuffer);
         internal::deleteObject(indexBuffer);
         internal::deleteObject(dynamicBuffer);
         internal::deleteObject(staticBuffer);
-        internal::deleteObject(edgeProgram);
-        internal::deleteObject(modelProgram);
-        internal::deleteObject(shadowProgram);
-        internal::deleteObject(zplotProgram);
+        internal::deleteObject(skinning);
+        internal::deleteObject(boneMatrixTexture);
+        resources->release();
+        resources = 0;
+        batchStateRef = 0;
         aabbMin.setZero();
         aabbMax.setZero();
+        nculledDrawCalls = 0;
+        nissuedDrawCalls = 0;
         cullFaceState = false;
         isVertexShaderSkinning = false;
+        frustumCulling = false;
+        renderable = false;
+        sharesResources = false;
+    }
+
+    void shareResources(SharedResources *value) {
+        value->retain();
+        resources->release();
+        resources = value;
+        sharesResources = true;
     }
 
     void getVertexBundleType(VertexArrayObjectType &vao, VertexBufferObjectType &vbo) {
@@ -467,29 +728,185 @@ public:
             vbo = kModelDynamicVertexBufferEven;
         }
     }
+    template<typename T>
+    void drawElementsWithBonePalettes(T *program, PFNGLDRAWELEMENTSPROC drawElements, int materialIndex, vsize offset, vsize size) {
+        /* a material referring too many bones is split into subsets sharing the same index range */
+        const int nsubsets = matrixBuffer->countSubsets(materialIndex);
+        for (int i = 0; i < nsubsets; i++) {
+            const int nindices = matrixBuffer->indexCount(materialIndex, i);
+            program->setBoneMatrices(matrixBuffer->bytes(materialIndex, i), matrixBuffer->size(materialIndex, i));
+            drawElements(kGL_TRIANGLES, nindices, indexType, reinterpret_cast<const GLvoid *>(offset));
+            offset += nindices * size;
+        }
+        nissuedDrawCalls += nsubsets;
+        VPVL2_PROFILE_COUNT(kDrawCallCounter, nsubsets);
+    }
+    void flushDrawElements() {
+        const int ncalls = batchStateRef->flushDrawElements(indexType);
+        nissuedDrawCalls += ncalls;
+        VPVL2_PROFILE_COUNT(kDrawCallCounter, ncalls);
+    }
+    static int countVertexBones(IVertex::Type type) {
+        switch (type) {
+        case IVertex::kBdef1:
+            return 1;
+        case IVertex::kBdef2:
+        case IVertex::kSdef:
+            return 2;
+        case IVertex::kBdef4:
+        case IVertex::kQdef:
+            return 4;
+        case IVertex::kMaxType:
+        default:
+            return 0;
+        }
+    }
+    void buildMaterialBounds() {
+        /*
+         * every skinned vertex stays within |origin - boneOrigin| of its deformed bone origin
+         * because bone transforms are rigid, so the bound of a material is the union of
+         * spheres around the bones referenced from the material's vertices
+         */
+        Array<IMaterial *> materials;
+        Array<IVertex *> vertices;
+        Array<int> vertexStamps;
+        Hash<HashPtr, int> sphereIndices;
+        modelRef->getMaterialRefs(materials);
+        modelRef->getVertexRefs(vertices);
+        const int nmaterials = materials.count(), nvertices = vertices.count();
+        vertexStamps.resize(nvertices);
+        materialBounds.resize(nmaterials);
+        materialSpheres.clear();
+        materialVertexIndices.clear();
+        int offset = 0;
+        for (int i = 0; i < nmaterials; i++) {
+            const IMaterial *material = materials[i];
+            const int nindices = material->indexRange().count;
+            MaterialBounds &bounds = materialBounds[i];
+            bounds.sphereOffset = materialSpheres.count();
+            bounds.vertexOffset = materialVertexIndices.count();
+            bounds.maxEdgeSize = 0;
+            sphereIndices.clear();
+            for (int j = offset, end = offset + nindices; j < end; j++) {
+                const int vertexIndex = indexBuffer->indexAt(j);
+                if (!internal::checkBound(vertexIndex, 0, nvertices) || vertexStamps[vertexIndex] == i + 1) {
+                    continue;
+                }
+                vertexStamps[vertexIndex] = i + 1;
+                materialVertexIndices.append(vertexIndex);
+                const IVertex *vertex = vertices[vertexIndex];
+                const Vector3 &origin = vertex->origin();
+                bounds.maxEdgeSize = btMax(bounds.maxEdgeSize, vertex->edgeSize());
+                for (int k = 0, nbones = countVertexBones(vertex->type()); k < nbones; k++) {
+                    const IBone *bone = vertex->boneRef(k);
+                    const Scalar &radius = origin.distance(bone->origin());
+                    if (const int *sphereIndex = sphereIndices.find(bone)) {
+                        MaterialBoneSphere &sphere = materialSpheres[*sphereIndex];
+                        sphere.radius = btMax(sphere.radius, radius);
+                    }
+                    else {
+                        sphereIndices.insert(bone, materialSpheres.count());
+                        materialSpheres.append(MaterialBoneSphere(bone, radius));
+                    }
+                }
+            }
+            bounds.nspheres = materialSpheres.count() - bounds.sphereOffset;
+            bounds.nvertices = materialVertexIndices.count() - bounds.vertexOffset;
+            offset += nindices;
+        }
+        vertexRefs.copy(vertices);
+        materialBoundsDirty = true;
+    }
+    void updateMaterialBounds() {
+        if (!materialBoundsDirty) {
+            return;
+        }
+        const int nmaterials = materialBounds.count();
+        for (int i = 0; i < nmaterials; i++) {
+            MaterialBounds &bounds = materialBounds[i];
+            Scalar morphDelta2 = 0;
+            for (int j = bounds.vertexOffset, end = bounds.vertexOffset + bounds.nvertices; j < end; j++) {
+                const IVertex *vertex = vertexRefs[materialVertexIndices[j]];
+                morphDelta2 = btMax(morphDelta2, vertex->delta().length2());
+            }
+            const Scalar &morphDelta = btSqrt(morphDelta2);
+            Vector3 aabbMin(SIMD_INFINITY, SIMD_INFINITY, SIMD_INFINITY),
+                    aabbMax(-SIMD_INFINITY, -SIMD_INFINITY, -SIMD_INFINITY);
+            for (int j = bounds.sphereOffset, end = bounds.sphereOffset + bounds.nspheres; j < end; j++) {
+                const MaterialBoneSphere &sphere = materialSpheres[j];
+                const IBone *bone = sphere.boneRef;
+                const Vector3 &center = bone->localTransform() * bone->origin();
+                const Scalar &radius = sphere.radius + morphDelta;
+                const Vector3 &extent = Vector3(radius, radius, radius);
+                aabbMin.setMin(center - extent);
+                aabbMax.setMax(center + extent);
+            }
+            bounds.aabbMin = aabbMin;
+            bounds.aabbMax = aabbMax;
+        }
+        materialBoundsDirty = false;
+    }
+    bool hasBindPoseVertices() const {
+        return skinning || isVertexShaderSkinning;
+    }
+    void updateAabbFromMaterialBounds() {
+        /* skinned vertices never come back to CPU on GPU skinning so bound the model by bone spheres */
+        materialBoundsDirty = true;
+        updateMaterialBounds();
+        aabbMin.setValue(SIMD_INFINITY, SIMD_INFINITY, SIMD_INFINITY);
+        aabbMax.setValue(-SIMD_INFINITY, -SIMD_INFINITY, -SIMD_INFINITY);
+        const int nmaterials = materialBounds.count();
+        for (int i = 0; i < nmaterials; i++) {
+            const MaterialBounds &bounds = materialBounds[i];
+            if (bounds.nspheres > 0) {
+                aabbMin.setMin(bounds.aabbMin);
+                aabbMax.setMax(bounds.aabbMax);
+            }
+        }
+    }
+    Frustum::Result classifyModel(const Frustum &frustum, const Scalar &padding) const {
+        return frustumCulling ? frustum.classify(aabbMin, aabbMax, padding) : Frustum::kInside;
+    }
+    bool testMaterialVisible(const Frustum &frustum, int materialIndex, const Scalar &padding) {
+        if (internal::checkBound(materialIndex, 0, materialBounds.count())) {
+            updateMaterialBounds();
+            const MaterialBounds &bounds = materialBounds[materialIndex];
+            return frustum.classify(bounds.aabbMin, bounds.aabbMax, padding) != Frustum::kOutside;
+        }
+        return true;
+    }
 
     const IModel *modelRef;
     IModel::IndexBuffer *indexBuffer;
     IModel::StaticVertexBuffer *staticBuffer;
     IModel::DynamicVertexBuffer *dynamicBuffer;
     IModel::MatrixBuffer *matrixBuffer;
-    EdgeProgram *edgeProgram;
-    ModelProgram *modelProgram;
-    ShadowProgram *shadowProgram;
-    ExtendedZPlotProgram *zplotProgram;
+    TransformFeedbackSkinning *skinning;
+    BoneMatrixTexture *boneMatrixTexture;
+    SharedResources *resources;
+    BatchRenderer::State *batchStateRef;
     VertexBundle buffer;
     VertexBundleLayout *bundles[kMaxVertexArrayObjectType];
     GLenum indexType;
-    PointerHash<HashPtr, ITexture> allocatedTextures;
-    Array<MaterialTextureRefs> materialTextureRefs;
+    Array<MaterialBounds> materialBounds;
+    Array<MaterialBoneSphere> materialSpheres;
+    Array<int> materialVertexIndices;
+    Array<IVertex *> vertexRefs;
     Vector3 aabbMin;
     Vector3 aabbMax;
+    int nculledDrawCalls;
+    int nissuedDrawCalls;
+    int uploadStep;
 #ifdef VPVL2_ENABLE_OPENCL
     cl::PMXAccelerator::VertexBufferBridgeArray buffers;
 #endif
     bool cullFaceState;
     bool isVertexShaderSkinning;
     bool updateEven;
+    bool frustumCulling;
+    bool materialBoundsDirty;
+    bool renderable;
+    bool sharesResources;
 };
 
 PMXRenderEngine::PMXRenderEngine(IApplicationContext *applicationContextRef,
@@ -511,7 +928,7 @@ PMXRenderEngine::PMXRenderEngine(IApplicationContext *applicationContextRef,
       m_applicationContextRef(applicationContextRef),
       m_sceneRef(scene),
       m_modelRef(modelRef),
-      m_context(new PrivateContext(modelRef, applicationContextRef->sharedFunctionResolverInstance(), m_sceneRef->accelerationType() == Scene::kVertexShaderAccelerationType1))
+      m_context(new PrivateContext(modelRef, applicationContextRef->sharedFunctionResolverInstance(), usesVertexShaderSkinning(scene)))
 {
 }
 
@@ -530,63 +947,178 @@ IModel *PMXRenderEngine::parentModelRef() const
 
 bool PMXRenderEngine::upload(void *userData)
 {
-    bool ret = true, vss = false;
+    return uploadIncrementally(userData, kUploadMaterialsStep + m_modelRef->count(IModel::kMaterial), 0) == kUploadCompleted;
+}
+
+IRenderEngine::UploadStatus PMXRenderEngine::uploadIncrementally(void *userData, int maxSteps, UploadProgressListener *listener)
+{
     const IApplicationContext::FunctionResolver *resolver = m_applicationContextRef->sharedFunctionResolverInstance();
     if (!m_context) {
-        vss = m_sceneRef->accelerationType() == Scene::kVertexShaderAccelerationType1;
-        m_context = new PrivateContext(m_modelRef, resolver, vss);
-    }
-    vss = m_context->isVertexShaderSkinning;
-    EdgeProgram *edgeProgram = m_context->edgeProgram = new EdgeProgram(resolver);
-    ModelProgram *modelProgram = m_context->modelProgram = new ModelProgram(resolver);
-    ShadowProgram *shadowProgram = m_context->shadowProgram = new ShadowProgram(resolver);
-    ExtendedZPlotProgram *zplotProgram = m_context->zplotProgram = new ExtendedZPlotProgram(resolver);
-    if (!createProgram(edgeProgram,
-                       IApplicationContext::kEdgeVertexShader,
-                       IApplicationContext::kEdgeWithSkinningVertexShader,
-                       IApplicationContext::kEdgeFragmentShader,
-                       userData)) {
-        return false;
+        m_context = new PrivateContext(m_modelRef, resolver, usesVertexShaderSkinning(m_sceneRef));
     }
-    if (!createProgram(modelProgram,
-                       IApplicationContext::kModelVertexShader,
-                       IApplicationContext::kModelWithSkinningVertexShader,
-                       IApplicationContext::kModelFragmentShader,
-                       userData)) {
-        return false;
+    if (m_context->uploadStep < 0) {
+        return kUploadFailed;
     }
-    if (!createProgram(shadowProgram,
-                       IApplicationContext::kShadowVertexShader,
-                       IApplicationContext::kShadowWithSkinningVertexShader,
-                       IApplicationContext::kShadowFragmentShader,
-                       userData)) {
-        return false;
+    Array<IMaterial *> materials;
+    m_modelRef->getMaterialRefs(materials);
+    const int nsteps = kUploadMaterialsStep + materials.count();
+    for (int i = 0; i < maxSteps && m_context->uploadStep < nsteps; i++) {
+        const int step = m_context->uploadStep;
+        if (!performUploadStep(step, materials, userData)) {
+            VPVL2_LOG(WARNING, "Cannot upload the model at the step " << step << " of " << nsteps);
+            m_context->uploadStep = -1;
+            m_context->renderable = false;
+            return kUploadFailed;
+        }
+        m_context->uploadStep = step + 1;
+        if (listener) {
+            listener->uploadDidProgress(this, step + 1, nsteps);
+        }
     }
-    if (!createProgram(zplotProgram,
-                       IApplicationContext::kZPlotVertexShader,
-                       IApplicationContext::kZPlotWithSkinningVertexShader,
-                       IApplicationContext::kZPlotFragmentShader,
-                       userData)) {
-        return false;
+    if (m_context->uploadStep < nsteps) {
+        return kUploadInProgress;
+    }
+    VPVL2_VLOG(2, "Created the model: jp=" << internal::cstr(m_modelRef->name(IEncoding::kJapanese), "(null)") << " en=" << internal::cstr(m_modelRef->name(IEncoding::kEnglish), "(null)"));
+    return kUploadCompleted;
+}
+
+bool PMXRenderEngine::performUploadStep(int step, const Array<IMaterial *> &materials, void *userData)
+{
+    const IApplicationContext::FunctionResolver *resolver = m_applicationContextRef->sharedFunctionResolverInstance();
+    if (m_context->sharesResources && step != kUploadSkinningStep && step != kUploadBuffersStep) {
+        /* programs and textures are already uploaded by the engine sharing its resources */
+        return true;
+    }
+    switch (step) {
+    case kUploadSkinningStep:
+        return uploadSkinning(userData);
+    case kUploadEdgeProgramStep:
+        m_context->resources->edgeProgram = new EdgeProgram(resolver);
+        return createProgram(m_context->resources->edgeProgram,
+                             IApplicationContext::kEdgeVertexShader,
+                             IApplicationContext::kEdgeWithSkinningVertexShader,
+                             IApplicationContext::kEdgeFragmentShader,
+                             userData);
+    case kUploadModelProgramStep:
+        m_context->resources->modelProgram = new ModelProgram(resolver);
+        return createProgram(m_context->resources->modelProgram,
+                             IApplicationContext::kModelVertexShader,
+                             IApplicationContext::kModelWithSkinningVertexShader,
+                             IApplicationContext::kModelFragmentShader,
+                             userData);
+    case kUploadShadowProgramStep:
+        m_context->resources->shadowProgram = new ShadowProgram(resolver);
+        return createProgram(m_context->resources->shadowProgram,
+                             IApplicationContext::kShadowVertexShader,
+                             IApplicationContext::kShadowWithSkinningVertexShader,
+                             IApplicationContext::kShadowFragmentShader,
+                             userData);
+    case kUploadZPlotProgramStep:
+        m_context->resources->zplotProgram = new ExtendedZPlotProgram(resolver);
+        return createProgram(m_context->resources->zplotProgram,
+                             IApplicationContext::kZPlotVertexShader,
+                             IApplicationContext::kZPlotWithSkinningVertexShader,
+                             IApplicationContext::kZPlotFragmentShader,
+                             userData);
+    case kUploadBuffersStep:
+        uploadBuffers();
+        return true;
+    default:
+        return uploadMaterial(materials[step - kUploadMaterialsStep], step - kUploadMaterialsStep, userData);
     }
-    if (!uploadMaterials(userData)) {
+}
+
+bool PMXRenderEngine::uploadSkinning(void *userData)
+{
+    const IApplicationContext::FunctionResolver *resolver = m_applicationContextRef->sharedFunctionResolverInstance();
+    bool vss = m_context->isVertexShaderSkinning;
+    if (vss && m_sceneRef->accelerationType() == Scene::kVertexShaderAccelerationType2 && BoneMatrixTexture::isSupported(resolver)) {
+        /* all bone matrices are uploaded once per frame and fetched with global bone indices in each pass */
+        m_context->boneMatrixTexture = new BoneMatrixTexture(resolver);
+    }
+    else if (vss && TransformFeedbackSkinning::isSupported(resolver)) {
+        /* skins vertices once per frame and lets all passes read them as plain vertex input */
+        IString *vertexShaderSource = m_applicationContextRef->loadShaderSource(IApplicationContext::kTransformFeedbackVertexShader, m_modelRef, userData);
+        TransformFeedbackSkinning *skinning = new TransformFeedbackSkinning(resolver);
+        if (vertexShaderSource && skinning->link(vertexShaderSource)) {
+            m_context->skinning = skinning;
+            m_context->isVertexShaderSkinning = vss = false;
+        }
+        else {
+            VPVL2_LOG(WARNING, "Cannot use transform feedback, falls back to skinning in each pass");
+            internal::deleteObject(skinning);
+        }
+        internal::deleteObject(vertexShaderSource);
+    }
+    if (vss && !m_context->boneMatrixTexture) {
+        m_modelRef->getMatrixBuffer(m_context->matrixBuffer, m_context->dynamicBuffer, m_context->indexBuffer);
+        if (!m_context->matrixBuffer) {
+            VPVL2_LOG(WARNING, "Cannot split materials into bone palettes, falls back to skinning on CPU");
+            m_context->isVertexShaderSkinning = vss = false;
+        }
+    }
+    SharedResources *resources = m_context->resources;
+    const bool hasBoneMatrixTexture = m_context->boneMatrixTexture != 0;
+    if (!m_context->sharesResources) {
+        resources->isVertexShaderSkinning = vss;
+        resources->hasBoneMatrixTexture = hasBoneMatrixTexture;
+    }
+    else if (resources->isVertexShaderSkinning != vss || resources->hasBoneMatrixTexture != hasBoneMatrixTexture) {
+        /* shared programs are compiled for the skinning path chosen by the engine uploaded them */
+        VPVL2_LOG(WARNING, "Cannot share resources as the skinning path differs from the shared one");
         return false;
     }
-    VertexBundle &buffer = m_context->buffer;
+    return true;
+}
+
+void PMXRenderEngine::uploadBuffers()
+{
+    m_context->buildMaterialBounds();
+    SharedResources *resources = m_context->resources;
+    VertexBundle &buffer = m_context->buffer, &sharedBuffer = resources->buffer;
+    const bool sharesResources = m_context->sharesResources;
+    if (!sharesResources) {
+        /* materials are drawn without textures until each of them is uploaded in the following steps */
+        resources->materialTextureRefs.resize(m_modelRef->count(IModel::kMaterial));
+    }
     buffer.create(VertexBundle::kVertexBuffer, kModelDynamicVertexBufferEven, VertexBundle::kGL_DYNAMIC_DRAW, 0, m_context->dynamicBuffer->size());
     buffer.create(VertexBundle::kVertexBuffer, kModelDynamicVertexBufferOdd, VertexBundle::kGL_DYNAMIC_DRAW, 0, m_context->dynamicBuffer->size());
     VPVL2_VLOG(2, "Binding model dynamic vertex buffer to the vertex buffer object: size=" << m_context->dynamicBuffer->size());
+    if (m_context->hasBindPoseVertices()) {
+        /* dynamic buffers hold the bind pose with morphs applied and only positions are overwritten every frame */
+        const VertexBufferObjectType dvbos[] = { kModelDynamicVertexBufferEven, kModelDynamicVertexBufferOdd };
+        for (vsize i = 0; i < sizeof(dvbos) / sizeof(dvbos[0]); i++) {
+            buffer.bind(VertexBundle::kVertexBuffer, dvbos[i]);
+            if (void *address = buffer.map(VertexBundle::kVertexBuffer, 0, m_context->dynamicBuffer->size())) {
+                m_context->dynamicBuffer->setupBindPose(address);
+                buffer.unmap(VertexBundle::kVertexBuffer, address);
+            }
+        }
+        buffer.unbind(VertexBundle::kVertexBuffer);
+    }
     const IModel::StaticVertexBuffer *staticBuffer = m_context->staticBuffer;
-    buffer.create(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer, VertexBundle::kGL_STATIC_DRAW, 0, staticBuffer->size());
-    buffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
-    void *address = buffer.map(VertexBundle::kVertexBuffer, 0, staticBuffer->size());
-    staticBuffer->update(address);
-    VPVL2_VLOG(2, "Binding model static vertex buffer to the vertex buffer object: ptr=" << address << " size=" << staticBuffer->size());
-    buffer.unmap(VertexBundle::kVertexBuffer, address);
-    buffer.unbind(VertexBundle::kVertexBuffer);
     const IModel::IndexBuffer *indexBuffer = m_context->indexBuffer;
-    buffer.create(VertexBundle::kIndexBuffer, kModelIndexBuffer, VertexBundle::kGL_STATIC_DRAW, indexBuffer->bytes(), indexBuffer->size());
-    VPVL2_VLOG(2, "Binding indices to the vertex buffer object: ptr=" << indexBuffer->bytes() << " size=" << indexBuffer->size());
+    if (!sharesResources) {
+        sharedBuffer.create(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer, VertexBundle::kGL_STATIC_DRAW, 0, staticBuffer->size());
+        sharedBuffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
+        void *address = sharedBuffer.map(VertexBundle::kVertexBuffer, 0, staticBuffer->size());
+        staticBuffer->update(address);
+        VPVL2_VLOG(2, "Binding model static vertex buffer to the vertex buffer object: ptr=" << address << " size=" << staticBuffer->size());
+        sharedBuffer.unmap(VertexBundle::kVertexBuffer, address);
+        sharedBuffer.unbind(VertexBundle::kVertexBuffer);
+        sharedBuffer.create(VertexBundle::kIndexBuffer, kModelIndexBuffer, VertexBundle::kGL_STATIC_DRAW, indexBuffer->bytes(), indexBuffer->size());
+        VPVL2_VLOG(2, "Binding indices to the vertex buffer object: ptr=" << indexBuffer->bytes() << " size=" << indexBuffer->size());
+    }
+    else {
+        VPVL2_VLOG(2, "Sharing static vertex buffer and indices: ID=" << sharedBuffer.findName(kModelStaticVertexBuffer));
+    }
+    if (TransformFeedbackSkinning *skinning = m_context->skinning) {
+        skinning->upload(m_modelRef, m_context->dynamicBuffer, staticBuffer, sharedBuffer.findName(kModelStaticVertexBuffer));
+    }
+    else if (BoneMatrixTexture *boneMatrixTexture = m_context->boneMatrixTexture) {
+        boneMatrixTexture->upload(m_modelRef);
+        VPVL2_VLOG(2, "Binding bone matrices to the texture: ID=" << boneMatrixTexture->name() << " bones=" << boneMatrixTexture->countBones());
+    }
     VertexBundleLayout *bundleME = m_context->bundles[kVertexArrayObjectEven];
     if (bundleME->create() && bundleME->bind()) {
         VPVL2_VLOG(2, "Binding an vertex array object for even frame: " << bundleME->name());
@@ -620,14 +1152,13 @@ bool PMXRenderEngine::upload(void *userData)
         m_accelerator->release(buffers);
         buffers.append(cl::PMXAccelerator::VertexBufferBridge(buffer.findName(kModelDynamicVertexBufferEven)));
         buffers.append(cl::PMXAccelerator::VertexBufferBridge(buffer.findName(kModelDynamicVertexBufferOdd)));
-        m_accelerator->upload(buffers, m_context->indexBuffer);
+        m_accelerator->upload(buffers, m_context->dynamicBuffer, m_context->indexBuffer);
     }
 #endif
+    m_context->renderable = true;
     m_modelRef->setVisible(true);
     update(); // for updating even frame
     update(); // for updating odd frame
-    VPVL2_VLOG(2, "Created the model: jp=" << internal::cstr(m_modelRef->name(IEncoding::kJapanese), "(null)") << " en=" << internal::cstr(m_modelRef->name(IEncoding::kEnglish), "(null)"));
-    return ret;
 }
 
 void PMXRenderEngine::release()
@@ -645,28 +1176,67 @@ void PMXRenderEngine::release()
 
 void PMXRenderEngine::update()
 {
-    if (!m_modelRef || !m_modelRef->isVisible() || !m_context)
+    if (!m_modelRef || !m_modelRef->isVisible() || !m_context || !m_context->renderable)
         return;
     VertexBufferObjectType vbo = m_context->updateEven
             ? kModelDynamicVertexBufferEven : kModelDynamicVertexBufferOdd;
     IModel::DynamicVertexBuffer *dynamicBuffer = m_context->dynamicBuffer;
     m_context->buffer.bind(VertexBundle::kVertexBuffer, vbo);
-    if (void *address = m_context->buffer.map(VertexBundle::kVertexBuffer, 0, dynamicBuffer->size())) {
-        const ICamera *camera = m_sceneRef->cameraRef();
-        dynamicBuffer->performTransform(address, camera->position(), m_context->aabbMin, m_context->aabbMax);
-        if (m_context->isVertexShaderSkinning) {
-            m_context->matrixBuffer->update(address);
+    if (m_context->hasBindPoseVertices()) {
+        if (void *address = m_context->buffer.map(VertexBundle::kVertexBuffer, 0, dynamicBuffer->size())) {
+            VPVL2_PROFILE_STAGE(kBufferUploadStage);
+            dynamicBuffer->update(address);
+            if (IModel::MatrixBuffer *matrixBuffer = m_context->matrixBuffer) {
+                matrixBuffer->update(address);
+            }
+            m_context->buffer.unmap(VertexBundle::kVertexBuffer, address);
+            VPVL2_PROFILE_COUNT(kUploadedBytesCounter, dynamicBuffer->size());
         }
+        m_context->buffer.unbind(VertexBundle::kVertexBuffer);
+        if (TransformFeedbackSkinning *skinning = m_context->skinning) {
+            VPVL2_PROFILE_STAGE(kSkinningStage);
+            skinning->update(m_sceneRef->cameraRef()->position(), m_context->buffer.findName(vbo));
+            VPVL2_PROFILE_COUNT(kSkinnedVertexCounter, m_modelRef->count(IModel::kVertex));
+        }
+        else if (BoneMatrixTexture *boneMatrixTexture = m_context->boneMatrixTexture) {
+            VPVL2_PROFILE_STAGE(kBufferUploadStage);
+            boneMatrixTexture->update();
+            VPVL2_PROFILE_COUNT(kUploadedBytesCounter, boneMatrixTexture->size());
+        }
+        m_context->updateAabbFromMaterialBounds();
+    }
+#ifdef VPVL2_ENABLE_OPENCL
+    else if (m_accelerator && m_accelerator->isAvailable() && m_accelerator->isHostResident()) {
+        /* vertices are skinned by the scene accelerator with the other models and uploaded before drawing */
+    }
+#endif
+    else if (void *address = m_context->buffer.map(VertexBundle::kVertexBuffer, 0, dynamicBuffer->size())) {
+        {
+            VPVL2_PROFILE_STAGE(kSkinningStage);
+            const ICamera *camera = m_sceneRef->cameraRef();
+            dynamicBuffer->performTransform(address, camera->position(), m_context->aabbMin, m_context->aabbMax);
+            VPVL2_PROFILE_COUNT(kSkinnedVertexCounter, m_modelRef->count(IModel::kVertex));
+        }
+        VPVL2_PROFILE_STAGE(kBufferUploadStage);
         m_context->buffer.unmap(VertexBundle::kVertexBuffer, address);
+        VPVL2_PROFILE_COUNT(kUploadedBytesCounter, dynamicBuffer->size());
     }
     m_context->buffer.unbind(VertexBundle::kVertexBuffer);
+    bool updatesAabb = true;
 #ifdef VPVL2_ENABLE_OPENCL
     if (m_accelerator && m_accelerator->isAvailable()) {
         const cl::PMXAccelerator::VertexBufferBridge &buffer = m_context->buffers[m_context->updateEven ? 0 : 1];
         m_accelerator->update(dynamicBuffer, buffer, m_context->aabbMin, m_context->aabbMax);
+        /* the host resident accelerator sets the AABB to the model when the batch is finished */
+        updatesAabb = !m_accelerator->isHostResident();
     }
 #endif
-    m_modelRef->setAabb(m_context->aabbMin, m_context->aabbMax);
+    if (updatesAabb) {
+        m_modelRef->setAabb(m_context->aabbMin, m_context->aabbMax);
+    }
+    m_context->materialBoundsDirty = !m_context->hasBindPoseVertices();
+    m_context->nculledDrawCalls = 0;
+    m_context->nissuedDrawCalls = 0;
     m_context->updateEven = m_context->updateEven ? false :true;
 }
 
@@ -680,16 +1250,39 @@ void PMXRenderEngine::setUpdateOptions(int options)
 
 void PMXRenderEngine::renderModel()
 {
-    if (!m_modelRef || !m_modelRef->isVisible() || !m_context)
+    VPVL2_PROFILE_STAGE(kDrawStage);
+    if (!m_modelRef || !m_modelRef->isVisible() || !m_context || !m_context->renderable)
         return;
-    ModelProgram *modelProgram = m_context->modelProgram;
-    modelProgram->bind();
     float matrix4x4[16];
     m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
                                        IApplicationContext::kWorldMatrix
                                        | IApplicationContext::kViewMatrix
                                        | IApplicationContext::kProjectionMatrix
                                        | IApplicationContext::kCameraMatrix);
+    Array<IMaterial *> materials;
+    m_modelRef->getMaterialRefs(materials);
+    const int nmaterials = materials.count();
+    const Frustum frustum(matrix4x4);
+    synchronizeAccelerator();
+    const Frustum::Result result = m_context->classifyModel(frustum, 0);
+    if (result == Frustum::kOutside) {
+        m_context->nculledDrawCalls += nmaterials;
+        return;
+    }
+    ModelProgram *modelProgram = m_context->resources->modelProgram;
+    BatchRenderer::State *state = m_context->batchStateRef;
+    const IShadowMap *shadowMapRef = m_sceneRef->shadowMapRef();
+    const int nframeUniforms = kModelFrameUniforms + (shadowMapRef ? 1 : 0);
+    bool setsFrameUniforms = true;
+    if (state) {
+        setsFrameUniforms = state->bindProgram(modelProgram, nframeUniforms);
+        state->addUnbatchedStateChanges(kProgramBindingStateChanges + nframeUniforms);
+        state->setCullFaceMode(kGL_BACK);
+        state->setBlendEnable(true);
+    }
+    else {
+        modelProgram->bind();
+    }
     modelProgram->setModelViewProjectionMatrix(matrix4x4);
     m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
                                        IApplicationContext::kWorldMatrix
@@ -704,30 +1297,41 @@ void PMXRenderEngine::renderModel()
     modelProgram->setLightViewProjectionMatrix(matrix4x4);
     const ILight *light = m_sceneRef->lightRef();
     GLuint textureID = 0;
-    if (const IShadowMap *shadowMapRef = m_sceneRef->shadowMapRef()) {
+    if (shadowMapRef) {
         const void *texture = shadowMapRef->textureRef();
         textureID = texture ? *static_cast<const GLuint *>(texture) : 0;
-        modelProgram->setDepthTextureSize(shadowMapRef->size());
+        if (setsFrameUniforms) {
+            modelProgram->setDepthTextureSize(shadowMapRef->size());
+        }
+    }
+    if (setsFrameUniforms) {
+        modelProgram->setLightColor(light->color());
+        modelProgram->setLightDirection(light->direction());
+        modelProgram->setToonEnable(light->isToonEnabled());
+        modelProgram->setCameraPosition(m_sceneRef->cameraRef()->lookAt());
     }
-    modelProgram->setLightColor(light->color());
-    modelProgram->setLightDirection(light->direction());
-    modelProgram->setToonEnable(light->isToonEnabled());
-    modelProgram->setCameraPosition(m_sceneRef->cameraRef()->lookAt());
     const Scalar &opacity = m_modelRef->opacity();
     modelProgram->setOpacity(opacity);
-    Array<IMaterial *> materials;
-    m_modelRef->getMaterialRefs(materials);
-    const int nmaterials = materials.count();
     const bool hasModelTransparent = !btFuzzyZero(opacity - 1.0f),
-            isVertexShaderSkinning = m_context->isVertexShaderSkinning;
+            hasBonePalettes = m_context->matrixBuffer != 0;
+    if (const BoneMatrixTexture *boneMatrixTexture = m_context->boneMatrixTexture) {
+        modelProgram->setBoneMatrixTexture(boneMatrixTexture->name(), boneMatrixTexture->countBones());
+    }
     const Vector3 &lc = light->color();
-    bool &cullFaceState = m_context->cullFaceState;
     Color diffuse, specular;
     vsize offset = 0, size = m_context->indexBuffer->strideSize();
+    /* the unbatched path toggles culling only when it changes and always starts with culling enabled */
+    bool unbatchedCullFace = true;
     bindVertexBundle();
     for (int i = 0; i < nmaterials; i++) {
         const IMaterial *material = materials[i];
-        const MaterialTextureRefs &materialPrivate = m_context->materialTextureRefs[i];
+        const int nindices = material->indexRange().count;
+        if (result == Frustum::kIntersect && !m_context->testMaterialVisible(frustum, i, 0)) {
+            m_context->nculledDrawCalls++;
+            offset += nindices * size;
+            continue;
+        }
+        const MaterialTextureRefs &materialPrivate = m_context->resources->materialTextureRefs[i];
         const Color &ma = material->ambient(), &md = material->diffuse(), &ms = material->specular();
         diffuse.setValue(ma.x() + md.x() * lc.x(), ma.y() + md.y() * lc.y(), ma.z() + md.z() * lc.z(), md.w());
         specular.setValue(ms.x() * lc.x(), ms.y() * lc.y(), ms.z() * lc.z(), 1.0);
@@ -744,76 +1348,127 @@ void PMXRenderEngine::renderModel()
             modelProgram->setDepthTexture(textureID);
         else
             modelProgram->setDepthTexture(0);
-        if (isVertexShaderSkinning) {
-            const IModel::MatrixBuffer *matrixBuffer = m_context->matrixBuffer;
-            modelProgram->setBoneMatrices(matrixBuffer->bytes(i), matrixBuffer->size(i));
+        /* culling is kept for a transparent model to avoid drawing inner faces through it */
+        const bool cullFaceEnabled = hasModelTransparent || !material->isCullingDisabled();
+        if (state && cullFaceEnabled != unbatchedCullFace) {
+            state->addUnbatchedStateChanges(1);
+            unbatchedCullFace = cullFaceEnabled;
         }
-        if (!hasModelTransparent && cullFaceState && material->isCullingDisabled()) {
-            disable(kGL_CULL_FACE);
-            cullFaceState = false;
+        setCullFaceEnable(cullFaceEnabled);
+        if (hasBonePalettes) {
+            m_context->drawElementsWithBonePalettes(modelProgram, drawElements, i, offset, size);
         }
-        else if (!cullFaceState && !material->isCullingDisabled()) {
-            enable(kGL_CULL_FACE);
-            cullFaceState = true;
+        else {
+            drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
+            m_context->nissuedDrawCalls++;
+            VPVL2_PROFILE_COUNT(kDrawCallCounter, 1);
         }
-        const int nindices = material->indexRange().count;
-        drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
         offset += nindices * size;
     }
     unbindVertexBundle();
-    modelProgram->unbind();
-    if (!cullFaceState) {
-        enable(kGL_CULL_FACE);
-        cullFaceState = true;
+    if (!state) {
+        modelProgram->unbind();
+        setCullFaceEnable(true);
+    }
+    else if (!unbatchedCullFace) {
+        state->addUnbatchedStateChanges(1);
     }
 }
 
 void PMXRenderEngine::renderShadow()
 {
-    if (!m_modelRef || !m_modelRef->isVisible() || !m_context)
+    VPVL2_PROFILE_STAGE(kDrawStage);
+    if (!m_modelRef || !m_modelRef->isVisible() || !m_context || !m_context->renderable)
         return;
-    ShadowProgram *shadowProgram = m_context->shadowProgram;
-    shadowProgram->bind();
     float matrix4x4[16];
     m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
                                        IApplicationContext::kWorldMatrix
                                        | IApplicationContext::kViewMatrix
                                        | IApplicationContext::kProjectionMatrix
                                        | IApplicationContext::kShadowMatrix);
-    shadowProgram->setModelViewProjectionMatrix(matrix4x4);
-    const ILight *light = m_sceneRef->lightRef();
-    shadowProgram->setLightColor(light->color());
-    shadowProgram->setLightDirection(light->direction());
     Array<IMaterial *> materials;
     m_modelRef->getMaterialRefs(materials);
     const int nmaterials = materials.count();
-    const bool isVertexShaderSkinning = m_context->isVertexShaderSkinning;
+    /* the projected shadow matrix is singular but clipping planes are still valid as half spaces */
+    const Frustum frustum(matrix4x4);
+    synchronizeAccelerator();
+    const Frustum::Result result = m_context->classifyModel(frustum, 0);
+    if (result == Frustum::kOutside) {
+        for (int i = 0; i < nmaterials; i++) {
+            m_context->nculledDrawCalls += materials[i]->hasShadow() ? 1 : 0;
+        }
+        return;
+    }
+    ShadowProgram *shadowProgram = m_context->resources->shadowProgram;
+    BatchRenderer::State *state = m_context->batchStateRef;
+    bool setsFrameUniforms = true;
+    if (state) {
+        setsFrameUniforms = state->bindProgram(shadowProgram, kShadowFrameUniforms);
+        /* culling is disabled and enabled again around the shadow pass */
+        state->addUnbatchedStateChanges(kProgramBindingStateChanges + kShadowFrameUniforms + 2);
+    }
+    else {
+        shadowProgram->bind();
+    }
+    shadowProgram->setModelViewProjectionMatrix(matrix4x4);
+    if (setsFrameUniforms) {
+        const ILight *light = m_sceneRef->lightRef();
+        shadowProgram->setLightColor(light->color());
+        shadowProgram->setLightDirection(light->direction());
+    }
+    if (const BoneMatrixTexture *boneMatrixTexture = m_context->boneMatrixTexture) {
+        shadowProgram->setBoneMatrixTexture(boneMatrixTexture->name(), boneMatrixTexture->countBones());
+    }
+    const bool hasBonePalettes = m_context->matrixBuffer != 0,
+            mergesDrawCalls = state && !hasBonePalettes;
     vsize offset = 0, size = m_context->indexBuffer->strideSize();
     bindVertexBundle();
-    disable(kGL_CULL_FACE);
+    if (state) {
+        state->setCullFaceEnable(false);
+        state->setBlendEnable(true);
+    }
+    else {
+        disable(kGL_CULL_FACE);
+    }
     for (int i = 0; i < nmaterials; i++) {
         const IMaterial *material = materials[i];
         const int nindices = material->indexRange().count;
         if (material->hasShadow()) {
-            if (isVertexShaderSkinning) {
-                const IModel::MatrixBuffer *matrixBuffer = m_context->matrixBuffer;
-                shadowProgram->setBoneMatrices(matrixBuffer->bytes(i), matrixBuffer->size(i));
+            if (result == Frustum::kIntersect && !m_context->testMaterialVisible(frustum, i, 0)) {
+                m_context->nculledDrawCalls++;
+            }
+            else {
+                if (hasBonePalettes) {
+                    m_context->drawElementsWithBonePalettes(shadowProgram, drawElements, i, offset, size);
+                }
+                else if (mergesDrawCalls) {
+                    /* shadow has no per material uniforms so all materials are drawn at once */
+                    state->appendDrawElements(nindices, offset, size);
+                }
+                else {
+                    drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
+                    m_context->nissuedDrawCalls++;
+                    VPVL2_PROFILE_COUNT(kDrawCallCounter, 1);
+                }
             }
-            drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
         }
         offset += nindices * size;
     }
+    if (mergesDrawCalls) {
+        m_context->flushDrawElements();
+    }
     unbindVertexBundle();
-    enable(kGL_CULL_FACE);
-    shadowProgram->unbind();
+    if (!state) {
+        enable(kGL_CULL_FACE);
+        shadowProgram->unbind();
+    }
 }
 
 void PMXRenderEngine::renderEdge()
 {
+    VPVL2_PROFILE_STAGE(kDrawStage);
     if (!m_modelRef || !m_modelRef->isVisible() || btFuzzyZero(Scalar(m_modelRef->edgeWidth())) || !m_context)
         return;
-    EdgeProgram *edgeProgram = m_context->edgeProgram;
-    edgeProgram->bind();
     float matrix4x4[16];
     const Scalar &opacity = m_modelRef->opacity();
     m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
@@ -821,63 +1476,145 @@ void PMXRenderEngine::renderEdge()
                                        | IApplicationContext::kViewMatrix
                                        | IApplicationContext::kProjectionMatrix
                                        | IApplicationContext::kCameraMatrix);
-    edgeProgram->setModelViewProjectionMatrix(matrix4x4);
-    edgeProgram->setOpacity(opacity);
     Array<IMaterial *> materials;
     m_modelRef->getMaterialRefs(materials);
     const int nmaterials = materials.count();
-    const bool isVertexShaderSkinning = m_context->isVertexShaderSkinning;
-    IVertex::EdgeSizePrecision edgeScaleFactor = 0;
-    if (isVertexShaderSkinning) {
-        const ICamera *camera = m_sceneRef->cameraRef();
-        edgeScaleFactor = m_modelRef->edgeScaleFactor(camera->position());
+    const bool isVertexShaderSkinning = m_context->isVertexShaderSkinning,
+            hasBonePalettes = m_context->matrixBuffer != 0;
+    const ICamera *camera = m_sceneRef->cameraRef();
+    const IVertex::EdgeSizePrecision &edgeScaleFactor = m_modelRef->edgeScaleFactor(camera->position());
+    /* edges are extruded along normals so bounds must be padded with the largest edge size */
+    const Array<MaterialBounds> &materialBounds = m_context->materialBounds;
+    Scalar modelPadding = 0;
+    for (int i = 0; i < nmaterials && i < materialBounds.count(); i++) {
+        modelPadding = btMax(modelPadding, Scalar(materialBounds[i].maxEdgeSize * materials[i]->edgeSize() * edgeScaleFactor));
+    }
+    const Frustum frustum(matrix4x4);
+    synchronizeAccelerator();
+    const Frustum::Result result = m_context->classifyModel(frustum, modelPadding);
+    if (result == Frustum::kOutside) {
+        for (int i = 0; i < nmaterials; i++) {
+            m_context->nculledDrawCalls += materials[i]->isEdgeEnabled() ? 1 : 0;
+        }
+        return;
+    }
+    EdgeProgram *edgeProgram = m_context->resources->edgeProgram;
+    BatchRenderer::State *state = m_context->batchStateRef;
+    if (state) {
+        state->bindProgram(edgeProgram, 0);
+    }
+    else {
+        edgeProgram->bind();
+    }
+    edgeProgram->setModelViewProjectionMatrix(matrix4x4);
+    edgeProgram->setOpacity(opacity);
+    if (const BoneMatrixTexture *boneMatrixTexture = m_context->boneMatrixTexture) {
+        edgeProgram->setBoneMatrixTexture(boneMatrixTexture->name(), boneMatrixTexture->countBones());
     }
     vsize offset = 0, size = m_context->indexBuffer->strideSize();
     bool isOpaque = btFuzzyZero(opacity - 1);
-    if (isOpaque) {
-        disable(kGL_BLEND);
+    if (state) {
+        /* the unbatched path sets front face culling and then restores it and blending of an opaque model */
+        state->addUnbatchedStateChanges(kProgramBindingStateChanges + (isOpaque ? 4 : 2));
+        state->setCullFaceEnable(true);
+        state->setBlendEnable(!isOpaque);
+        state->setCullFaceMode(kGL_FRONT);
     }
-    cullFace(kGL_FRONT);
+    else {
+        if (isOpaque) {
+            disable(kGL_BLEND);
+        }
+        cullFace(kGL_FRONT);
+    }
+    const bool mergesDrawCalls = state && !hasBonePalettes;
+    Color lastEdgeColor;
+    Scalar lastEdgeSize = 0;
+    bool hasEdgeUniforms = false;
     bindEdgeBundle();
     for (int i = 0; i < nmaterials; i++) {
         const IMaterial *material = materials[i];
         const int nindices = material->indexRange().count;
-        edgeProgram->setColor(material->edgeColor());
         if (material->isEdgeEnabled()) {
-            if (isVertexShaderSkinning) {
-                const IModel::MatrixBuffer *matrixBuffer = m_context->matrixBuffer;
-                edgeProgram->setBoneMatrices(matrixBuffer->bytes(i), matrixBuffer->size(i));
-                edgeProgram->setSize(Scalar(material->edgeSize() * edgeScaleFactor));
+            const Scalar &padding = i < materialBounds.count()
+                    ? Scalar(materialBounds[i].maxEdgeSize * material->edgeSize() * edgeScaleFactor) : modelPadding;
+            if (result == Frustum::kIntersect && !m_context->testMaterialVisible(frustum, i, padding)) {
+                m_context->nculledDrawCalls++;
+            }
+            else {
+                const Color &edgeColor = material->edgeColor();
+                const Scalar &edgeSize = Scalar(material->edgeSize() * edgeScaleFactor);
+                /* consecutive edges of the same color and size are merged into a draw call */
+                if (!mergesDrawCalls || !hasEdgeUniforms || edgeColor != lastEdgeColor
+                        || (isVertexShaderSkinning && edgeSize != lastEdgeSize)) {
+                    if (mergesDrawCalls) {
+                        m_context->flushDrawElements();
+                    }
+                    edgeProgram->setColor(edgeColor);
+                    if (isVertexShaderSkinning) {
+                        edgeProgram->setSize(edgeSize);
+                    }
+                    lastEdgeColor = edgeColor;
+                    lastEdgeSize = edgeSize;
+                    hasEdgeUniforms = true;
+                }
+                if (hasBonePalettes) {
+                    m_context->drawElementsWithBonePalettes(edgeProgram, drawElements, i, offset, size);
+                }
+                else if (mergesDrawCalls) {
+                    state->appendDrawElements(nindices, offset, size);
+                }
+                else {
+                    drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
+                    m_context->nissuedDrawCalls++;
+                    VPVL2_PROFILE_COUNT(kDrawCallCounter, 1);
+                }
             }
-            drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
         }
         offset += nindices * size;
     }
+    if (mergesDrawCalls) {
+        m_context->flushDrawElements();
+    }
     unbindVertexBundle();
-    cullFace(kGL_BACK);
-    if (isOpaque) {
-        enable(kGL_BLEND);
+    if (!state) {
+        cullFace(kGL_BACK);
+        if (isOpaque) {
+            enable(kGL_BLEND);
+        }
+        edgeProgram->unbind();
     }
-    edgeProgram->unbind();
 }
 
 void PMXRenderEngine::renderZPlot()
 {
-    if (!m_modelRef || !m_modelRef->isVisible() || !m_context)
+    VPVL2_PROFILE_STAGE(kDrawStage);
+    if (!m_modelRef || !m_modelRef->isVisible() || !m_context || !m_context->renderable)
         return;
-    ExtendedZPlotProgram *zplotProgram = m_context->zplotProgram;
-    zplotProgram->bind();
     float matrix4x4[16];
     m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
                                        IApplicationContext::kWorldMatrix
                                        | IApplicationContext::kViewMatrix
                                        | IApplicationContext::kProjectionMatrix
                                        | IApplicationContext::kLightMatrix);
-    zplotProgram->setModelViewProjectionMatrix(matrix4x4);
     Array<IMaterial *> materials;
     m_modelRef->getMaterialRefs(materials);
     const int nmaterials = materials.count();
-    const bool isVertexShaderSkinning = m_context->isVertexShaderSkinning;
+    const Frustum frustum(matrix4x4);
+    synchronizeAccelerator();
+    const Frustum::Result result = m_context->classifyModel(frustum, 0);
+    if (result == Frustum::kOutside) {
+        for (int i = 0; i < nmaterials; i++) {
+            m_context->nculledDrawCalls += materials[i]->hasShadowMap() ? 1 : 0;
+        }
+        return;
+    }
+    ExtendedZPlotProgram *zplotProgram = m_context->resources->zplotProgram;
+    zplotProgram->bind();
+    zplotProgram->setModelViewProjectionMatrix(matrix4x4);
+    if (const BoneMatrixTexture *boneMatrixTexture = m_context->boneMatrixTexture) {
+        zplotProgram->setBoneMatrixTexture(boneMatrixTexture->name(), boneMatrixTexture->countBones());
+    }
+    const bool hasBonePalettes = m_context->matrixBuffer != 0;
     vsize offset = 0, size = m_context->indexBuffer->strideSize();
     bindVertexBundle();
     disable(kGL_CULL_FACE);
@@ -885,11 +1622,19 @@ void PMXRenderEngine::renderZPlot()
         const IMaterial *material = materials[i];
         const int nindices = material->indexRange().count;
         if (material->hasShadowMap()) {
-            if (isVertexShaderSkinning) {
-                const IModel::MatrixBuffer *matrixBuffer = m_context->matrixBuffer;
-                zplotProgram->setBoneMatrices(matrixBuffer->bytes(i), matrixBuffer->size(i));
+            if (result == Frustum::kIntersect && !m_context->testMaterialVisible(frustum, i, 0)) {
+                m_context->nculledDrawCalls++;
+            }
+            else {
+                if (hasBonePalettes) {
+                    m_context->drawElementsWithBonePalettes(zplotProgram, drawElements, i, offset, size);
+                }
+                else {
+                    drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
+                    m_context->nissuedDrawCalls++;
+                    VPVL2_PROFILE_COUNT(kDrawCallCounter, 1);
+                }
             }
-            drawElements(kGL_TRIANGLES, nindices, m_context->indexType, reinterpret_cast<const GLvoid *>(offset));
         }
         offset += nindices * size;
     }
@@ -940,9 +1685,95 @@ void PMXRenderEngine::setOverridePass(IEffect::Pass * /* pass */)
 
 bool PMXRenderEngine::testVisible()
 {
+    if (!m_modelRef || !m_modelRef->isVisible() || !m_context || !m_context->renderable)
+        return false;
+    float matrix4x4[16];
+    m_applicationContextRef->getMatrix(matrix4x4, m_modelRef,
+                                       IApplicationContext::kWorldMatrix
+                                       | IApplicationContext::kViewMatrix
+                                       | IApplicationContext::kProjectionMatrix
+                                       | IApplicationContext::kCameraMatrix);
+    const Frustum frustum(matrix4x4);
+    synchronizeAccelerator();
+    return frustum.classify(m_context->aabbMin, m_context->aabbMax, 0) != Frustum::kOutside;
+}
+
+bool PMXRenderEngine::shareResources(const PMXRenderEngine *sourceRef)
+{
+    const PrivateContext *sourceContext = sourceRef ? sourceRef->m_context : 0;
+    if (!sourceContext || sourceRef == this) {
+        return false;
+    }
+    const IModel *sourceModelRef = sourceRef->m_modelRef;
+    if (sourceContext->uploadStep != kUploadMaterialsStep + sourceModelRef->count(IModel::kMaterial)) {
+        VPVL2_LOG(WARNING, "Cannot share resources of the model not uploaded yet: " << internal::cstr(sourceModelRef->name(IEncoding::kDefaultLanguage), "(null)"));
+        return false;
+    }
+    if (!m_context) {
+        m_context = new PrivateContext(m_modelRef, m_applicationContextRef->sharedFunctionResolverInstance(), usesVertexShaderSkinning(m_sceneRef));
+    }
+    if (m_context->uploadStep != kUploadSkinningStep) {
+        VPVL2_LOG(WARNING, "Resources must be shared before uploading the model");
+        return false;
+    }
+    /* buffers are shared as is so the topology must be identical */
+    const IModel::IndexBuffer *indexBuffer = m_context->indexBuffer, *sourceIndexBuffer = sourceContext->indexBuffer;
+    if (m_modelRef->count(IModel::kVertex) != sourceModelRef->count(IModel::kVertex) ||
+            m_modelRef->count(IModel::kMaterial) != sourceModelRef->count(IModel::kMaterial) ||
+            m_modelRef->count(IModel::kBone) != sourceModelRef->count(IModel::kBone) ||
+            indexBuffer->size() != sourceIndexBuffer->size() ||
+            std::memcmp(indexBuffer->bytes(), sourceIndexBuffer->bytes(), indexBuffer->size()) != 0) {
+        VPVL2_LOG(WARNING, "Cannot share resources of the model which has different topology: " << internal::cstr(sourceModelRef->name(IEncoding::kDefaultLanguage), "(null)"));
+        return false;
+    }
+    /* texture coordinates, bone indices/weights and material textures are also baked in the shared resources */
+    if (!equalsStaticBuffer(m_context->staticBuffer, sourceContext->staticBuffer) || !equalsMaterials(m_modelRef, sourceModelRef)) {
+        VPVL2_LOG(WARNING, "Cannot share resources of the model which has different vertices or materials: " << internal::cstr(sourceModelRef->name(IEncoding::kDefaultLanguage), "(null)"));
+        return false;
+    }
+    m_context->shareResources(sourceContext->resources);
     return true;
 }
 
+void PMXRenderEngine::setBatchStateRef(BatchRenderer::State *value)
+{
+    if (m_context) {
+        m_context->batchStateRef = value;
+    }
+}
+
+const void *PMXRenderEngine::batchKey() const
+{
+    return m_context ? m_context->resources : 0;
+}
+
+bool PMXRenderEngine::isResourceShared() const
+{
+    return m_context ? m_context->sharesResources : false;
+}
+
+void PMXRenderEngine::setFrustumCullingEnable(bool value)
+{
+    if (m_context) {
+        m_context->frustumCulling = value;
+    }
+}
+
+bool PMXRenderEngine::isFrustumCullingEnabled() const
+{
+    return m_context ? m_context->frustumCulling : false;
+}
+
+int PMXRenderEngine::countCulledDrawCalls() const
+{
+    return m_context ? m_context->nculledDrawCalls : 0;
+}
+
+int PMXRenderEngine::countIssuedDrawCalls() const
+{
+    return m_context ? m_context->nissuedDrawCalls : 0;
+}
+
 bool PMXRenderEngine::createProgram(BaseShaderProgram *program,
                                     IApplicationContext::ShaderType vertexShaderType,
                                     IApplicationContext::ShaderType vertexSkinningShaderType,
@@ -957,6 +1788,17 @@ bool PMXRenderEngine::createProgram(BaseShaderProgram *program,
     else {
         vertexShaderSource = m_applicationContextRef->loadShaderSource(vertexShaderType, m_modelRef, userData);
     }
+    if (m_context->isVertexShaderSkinning && vertexShaderSource) {
+        /* fetchBoneMatrix must follow the version directive that may be prepended to the source */
+        char matricesFetcher[sizeof(kBoneMatricesFetcherSource) + 16];
+        internal::snprintf(matricesFetcher, sizeof(matricesFetcher), kBoneMatricesFetcherSource, int(pmx::Model::kMaxBonesPerDraw));
+        const char *fetcher = m_context->boneMatrixTexture ? kBoneMatrixTextureFetcherSource : matricesFetcher;
+        std::string source(reinterpret_cast<const char *>(vertexShaderSource->toByteArray()));
+        std::string::size_type position = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+        source.insert(position != std::string::npos ? position + 1 : 0, fetcher);
+        delete vertexShaderSource;
+        vertexShaderSource = m_applicationContextRef->toUnicode(reinterpret_cast<const uint8 *>(source.c_str()));
+    }
     fragmentShaderSource = m_applicationContextRef->loadShaderSource(fragmentShaderType, m_modelRef, userData);
     program->addShaderSource(vertexShaderSource, ShaderProgram::kGL_VERTEX_SHADER);
     program->addShaderSource(fragmentShaderSource, ShaderProgram::kGL_FRAGMENT_SHADER);
@@ -966,108 +1808,129 @@ bool PMXRenderEngine::createProgram(BaseShaderProgram *program,
     return ok;
 }
 
-bool PMXRenderEngine::uploadMaterials(void *userData)
+bool PMXRenderEngine::uploadMaterial(const IMaterial *material, int index, void *userData)
 {
-    Array<IMaterial *> materials;
-    m_modelRef->getMaterialRefs(materials);
-    const int nmaterials = materials.count();
     IApplicationContext::TextureDataBridge bridge(IApplicationContext::kTexture2D);
-    m_context->materialTextureRefs.resize(nmaterials);
-    for (int i = 0; i < nmaterials; i++) {
-        const IMaterial *material = materials[i];
-        const IString *name = material->name(IEncoding::kDefaultLanguage); (void) name;
-        const int materialIndex = material->index(); (void) materialIndex;
-        MaterialTextureRefs &materialPrivate = m_context->materialTextureRefs[i];
-        bridge.flags = IApplicationContext::kTexture2D | IApplicationContext::kAsyncLoadingTexture;
-        if (const IString *mainTexturePath = material->mainTexture()) {
-            if (m_applicationContextRef->uploadTexture(mainTexturePath, bridge, userData)) {
-                ITexture *textureRef = bridge.dataRef;
-                materialPrivate.mainTextureRef = m_context->allocatedTextures.insert(textureRef, textureRef);
-                VPVL2_VLOG(2, "Binding the texture as a main texture (material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef << ")");
-            }
-            else {
-                VPVL2_LOG(WARNING, "Cannot bind a main texture (material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << ")");
-                return false;
-            }
+    const IString *name = material->name(IEncoding::kDefaultLanguage); (void) name;
+    const int materialIndex = material->index(); (void) materialIndex;
+    MaterialTextureRefs &materialPrivate = m_context->resources->materialTextureRefs[index];
+    bridge.flags = IApplicationContext::kTexture2D | IApplicationContext::kAsyncLoadingTexture;
+    if (const IString *mainTexturePath = material->mainTexture()) {
+        if (m_applicationContextRef->uploadTexture(mainTexturePath, bridge, userData)) {
+            ITexture *textureRef = bridge.dataRef;
+            materialPrivate.mainTextureRef = m_context->resources->allocatedTextures.insert(textureRef, textureRef);
+            VPVL2_VLOG(2, "Binding the texture as a main texture (material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef << ")");
         }
-        if (const IString *sphereTexturePath = material->sphereTexture()) {
-            if (m_applicationContextRef->uploadTexture(sphereTexturePath, bridge, userData)) {
-                ITexture *textureRef = bridge.dataRef;
-                materialPrivate.sphereTextureRef = m_context->allocatedTextures.insert(textureRef, textureRef);
-                VPVL2_VLOG(2, "Binding the texture as a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef);
-            }
-            else {
-                VPVL2_LOG(WARNING, "Cannot bind a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
-                return false;
-            }
+        else {
+            VPVL2_LOG(WARNING, "Cannot bind a main texture (material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << ")");
+            return false;
         }
-        bridge.flags |= IApplicationContext::kToonTexture;
-        if (material->isSharedToonTextureUsed()) {
-            char buf[16];
-            internal::snprintf(buf, sizeof(buf), "toon%02d.bmp", material->toonTextureIndex() + 1);
-            IString *s = m_applicationContextRef->toUnicode(reinterpret_cast<const uint8 *>(buf));
-            bridge.flags |= IApplicationContext::kSystemToonTexture;
-            bool ret = m_applicationContextRef->uploadTexture(s, bridge, userData);
-            internal::deleteObject(s);
-            if (ret) {
-                ITexture *textureRef = bridge.dataRef;
-                materialPrivate.toonTextureRef = m_context->allocatedTextures.insert(textureRef, textureRef);
-                VPVL2_VLOG(2, "Binding the texture as a shared toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef);
-            }
-            else {
-                VPVL2_LOG(WARNING, "Cannot bind a shared toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
-                return false;
-            }
+    }
+    if (const IString *sphereTexturePath = material->sphereTexture()) {
+        if (m_applicationContextRef->uploadTexture(sphereTexturePath, bridge, userData)) {
+            ITexture *textureRef = bridge.dataRef;
+            materialPrivate.sphereTextureRef = m_context->resources->allocatedTextures.insert(textureRef, textureRef);
+            VPVL2_VLOG(2, "Binding the texture as a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef);
         }
-        else if (const IString *toonTexturePath = material->toonTexture()) {
-            if (m_applicationContextRef->uploadTexture(toonTexturePath, bridge, userData)) {
-                ITexture *textureRef = bridge.dataRef;
-                materialPrivate.toonTextureRef = m_context->allocatedTextures.insert(textureRef, textureRef);
-                VPVL2_VLOG(2, "Binding the texture as a toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef);
-            }
-            else {
-                VPVL2_LOG(WARNING, "Cannot bind a toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
-                return false;
-            }
+        else {
+            VPVL2_LOG(WARNING, "Cannot bind a sphere texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
+            return false;
+        }
+    }
+    bridge.flags |= IApplicationContext::kToonTexture;
+    if (material->isSharedToonTextureUsed()) {
+        char buf[16];
+        internal::snprintf(buf, sizeof(buf), "toon%02d.bmp", material->toonTextureIndex() + 1);
+        IString *s = m_applicationContextRef->toUnicode(reinterpret_cast<const uint8 *>(buf));
+        bridge.flags |= IApplicationContext::kSystemToonTexture;
+        bool ret = m_applicationContextRef->uploadTexture(s, bridge, userData);
+        internal::deleteObject(s);
+        if (ret) {
+            ITexture *textureRef = bridge.dataRef;
+            materialPrivate.toonTextureRef = m_context->resources->allocatedTextures.insert(textureRef, textureRef);
+            VPVL2_VLOG(2, "Binding the texture as a shared toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef);
+        }
+        else {
+            VPVL2_LOG(WARNING, "Cannot bind a shared toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
+            return false;
+        }
+    }
+    else if (const IString *toonTexturePath = material->toonTexture()) {
+        if (m_applicationContextRef->uploadTexture(toonTexturePath, bridge, userData)) {
+            ITexture *textureRef = bridge.dataRef;
+            materialPrivate.toonTextureRef = m_context->resources->allocatedTextures.insert(textureRef, textureRef);
+            VPVL2_VLOG(2, "Binding the texture as a toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex << " ID=" << bridge.dataRef);
+        }
+        else {
+            VPVL2_LOG(WARNING, "Cannot bind a toon texture: material=" << internal::cstr(name, "(null)") << " index=" << materialIndex);
+            return false;
         }
     }
     return true;
 }
 
+void PMXRenderEngine::setCullFaceEnable(bool value)
+{
+    if (BatchRenderer::State *state = m_context->batchStateRef) {
+        state->setCullFaceEnable(value);
+    }
+    else if (m_context->cullFaceState != value) {
+        if (value) {
+            enable(kGL_CULL_FACE);
+        }
+        else {
+            disable(kGL_CULL_FACE);
+        }
+        m_context->cullFaceState = value;
+    }
+}
+
 void PMXRenderEngine::createVertexBundle(GLuint dvbo)
 {
-    VertexBundle &buffer = m_context->buffer;
+    VertexBundle &buffer = m_context->buffer, &sharedBuffer = m_context->resources->buffer;
     buffer.bind(VertexBundle::kVertexBuffer, dvbo);
     bindDynamicVertexAttributePointers();
-    buffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
+    sharedBuffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
     bindStaticVertexAttributePointers();
-    buffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
+    sharedBuffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
     unbindVertexBundle();
 }
 
 void PMXRenderEngine::createEdgeBundle(GLuint dvbo)
 {
-    VertexBundle &buffer = m_context->buffer;
+    VertexBundle &buffer = m_context->buffer, &sharedBuffer = m_context->resources->buffer;
     buffer.bind(VertexBundle::kVertexBuffer, dvbo);
     bindEdgeVertexAttributePointers();
-    buffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
+    sharedBuffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
     bindStaticVertexAttributePointers();
-    buffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
+    sharedBuffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
     unbindVertexBundle();
 }
 
+void PMXRenderEngine::synchronizeAccelerator()
+{
+    /* vertices and the AABB used in frustum culling are written back when the batch is finished */
+#ifdef VPVL2_ENABLE_OPENCL
+    if (m_accelerator) {
+        m_accelerator->synchronize();
+    }
+#endif
+}
+
 void PMXRenderEngine::bindVertexBundle()
 {
     VertexArrayObjectType vao;
     VertexBufferObjectType vbo;
     m_context->getVertexBundleType(vao, vbo);
+    synchronizeAccelerator();
     if (!m_context->bundles[vao]->bind()) {
         VertexBundle &buffer = m_context->buffer;
         buffer.bind(VertexBundle::kVertexBuffer, vbo);
         bindDynamicVertexAttributePointers();
-        buffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
+        VertexBundle &sharedBuffer = m_context->resources->buffer;
+        sharedBuffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
         bindStaticVertexAttributePointers();
-        buffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
+        sharedBuffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
     }
 }
 
@@ -1076,13 +1939,15 @@ void PMXRenderEngine::bindEdgeBundle()
     VertexArrayObjectType vao;
     VertexBufferObjectType vbo;
     m_context->getEdgeBundleType(vao, vbo);
+    synchronizeAccelerator();
     if (!m_context->bundles[vao]->bind()) {
         VertexBundle &buffer = m_context->buffer;
         buffer.bind(VertexBundle::kVertexBuffer, vbo);
         bindEdgeVertexAttributePointers();
-        buffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
+        VertexBundle &sharedBuffer = m_context->resources->buffer;
+        sharedBuffer.bind(VertexBundle::kVertexBuffer, kModelStaticVertexBuffer);
         bindStaticVertexAttributePointers();
-        buffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
+        sharedBuffer.bind(VertexBundle::kIndexBuffer, kModelIndexBuffer);
     }
 }
 
@@ -1101,16 +1966,29 @@ void PMXRenderEngine::unbindVertexBundle()
 void PMXRenderEngine::bindDynamicVertexAttributePointers()
 {
     const IModel::DynamicVertexBuffer *dynamicBuffer = m_context->dynamicBuffer;
-    vsize offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kVertexStride);
-    const int size = int(dynamicBuffer->strideSize());
-    vertexAttribPointer(IModel::Buffer::kVertexStride, m_context->isVertexShaderSkinning ? 4 : 3, kGL_FLOAT, kGL_FALSE,
-                        size, reinterpret_cast<const GLvoid *>(offset));
-    offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
-    vertexAttribPointer(IModel::Buffer::kNormalStride, 3, kGL_FLOAT, kGL_FALSE,
-                        size, reinterpret_cast<const GLvoid *>(offset));
-    offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kUVA1Stride);
+    vsize offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kUVA1Stride);
+    int size = int(dynamicBuffer->strideSize());
     vertexAttribPointer(IModel::Buffer::kUVA1Stride, 4, kGL_FLOAT, kGL_FALSE,
                         size, reinterpret_cast<const GLvoid *>(offset));
+    if (TransformFeedbackSkinning *skinning = m_context->skinning) {
+        /* positions and normals are written by transform feedback into its own buffer */
+        skinning->bindSkinnedVertexBuffer();
+        offset = skinning->strideOffset(IModel::DynamicVertexBuffer::kVertexStride);
+        size = int(skinning->strideSize());
+        vertexAttribPointer(IModel::Buffer::kVertexStride, 3, kGL_FLOAT, kGL_FALSE,
+                            size, reinterpret_cast<const GLvoid *>(offset));
+        offset = skinning->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
+        vertexAttribPointer(IModel::Buffer::kNormalStride, 3, kGL_FLOAT, kGL_FALSE,
+                            size, reinterpret_cast<const GLvoid *>(offset));
+    }
+    else {
+        offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kVertexStride);
+        vertexAttribPointer(IModel::Buffer::kVertexStride, m_context->isVertexShaderSkinning ? 4 : 3, kGL_FLOAT, kGL_FALSE,
+                            size, reinterpret_cast<const GLvoid *>(offset));
+        offset = dynamicBuffer->strideOffset(IModel::DynamicVertexBuffer::kNormalStride);
+        vertexAttribPointer(IModel::Buffer::kNormalStride, 3, kGL_FLOAT, kGL_FALSE,
+                            size, reinterpret_cast<const GLvoid *>(offset));
+    }
     enableVertexAttribArray(IModel::Buffer::kVertexStride);
     enableVertexAttribArray(IModel::Buffer::kNormalStride);
     enableVertexAttribArray(IModel::Buffer::kUVA1Stride);
@@ -1119,6 +1997,14 @@ void PMXRenderEngine::bindDynamicVertexAttributePointers()
 void PMXRenderEngine::bindEdgeVertexAttributePointers()
 {
     const IModel::DynamicVertexBuffer *dynamicBuffer = m_context->dynamicBuffer;
+    if (TransformFeedbackSkinning *skinning = m_context->skinning) {
+        skinning->bindSkinnedVertexBuffer();
+        vsize offset = skinning->strideOffset(IModel::DynamicVertexBuffer::kEdgeVertexStride);
+        vertexAttribPointer(IModel::Buffer::kVertexStride, 3, kGL_FLOAT, kGL_FALSE,
+                            int(skinning->strideSize()), reinterpret_cast<const GLvoid *>(offset));
+        enableVertexAttribArray(IModel::Buffer::kVertexStride);
+        return;
+    }
     const int size = int(dynamicBuffer->strideSize());
     vsize offset = dynamicBuffer->strideOffset(m_context->isVertexShaderSkinning ? IModel::DynamicVertexBuffer::kVertexStride
                                                                                  : IModel::DynamicVertexBuffer::kEdgeVertexStride);
@@ -1142,7 +2028,9 @@ void PMXRenderEngine::bindStaticVertexAttributePointers()
                         size, reinterpret_cast<const GLvoid *>(offset));
     enableVertexAttribArray(IModel::Buffer::kTextureCoordStride);
     if (m_context->isVertexShaderSkinning) {
-        offset = staticBuffer->strideOffset(IModel::StaticVertexBuffer::kBoneIndexStride);
+        /* palette slots are bound for split materials, otherwise global bone indices for the bone matrix texture */
+        offset = staticBuffer->strideOffset(m_context->matrixBuffer ? IModel::StaticVertexBuffer::kBonePaletteIndexStride
+                                                                     : IModel::StaticVertexBuffer::kBoneIndexStride);
         vertexAttribPointer(IModel::Buffer::kBoneIndexStride, 4, kGL_FLOAT, kGL_FALSE,
                             size, reinterpret_cast<const GLvoid *>(offset));
         enableVertexAttribArray(IModel::Buffer::kBoneIndexStride);
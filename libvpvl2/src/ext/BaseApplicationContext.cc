@@ -40,6 +40,7 @@
 /* libvpvl2 */
 #include <vpvl2/vpvl2.h>
 #include <vpvl2/internal/util.h>
+#include <vpvl2/asset/Model.h>
 #include <vpvl2/extensions/Archive.h>
 #include <vpvl2/extensions/fx/Util.h>
 #include <vpvl2/extensions/gl/FrameBufferObject.h>
@@ -367,6 +368,7 @@ int BaseApplicationContext::ModelContext::countCachedTextures() const
 
 ITexture *BaseApplicationContext::ModelContext::createTexture(const void *ptr, const BaseSurface::Format &format, const Vector3 &size, bool /* mipmap */) const
 {
+    VPVL2_TRACE_SCOPE("texture", "ModelContext::uploadTexture");
     VPVL2_DCHECK(ptr);
     FunctionResolver *resolver = m_applicationContextRef->sharedFunctionResolverInstance();
     pushAnnotationGroup("BaseApplicationContext::ModelContext#createTexture", resolver);
@@ -384,6 +386,7 @@ ITexture *BaseApplicationContext::ModelContext::createTexture(const void *ptr, c
 
 ITexture *BaseApplicationContext::ModelContext::createTexture(const uint8 *data, vsize size, bool mipmap)
 {
+    VPVL2_TRACE_SCOPE("texture", "ModelContext::decodeTexture");
     VPVL2_DCHECK(data && size > 0);
     Vector3 textureSize;
     ITexture *texturePtr = 0;
@@ -533,9 +536,12 @@ BaseApplicationContext::BaseApplicationContext(Scene *sceneRef, IEncoding *encod
       m_cameraWorldMatrix(1),
       m_cameraViewMatrix(1),
       m_cameraProjectionMatrix(1),
+      m_staticShadowLightMatrix(1),
+      m_staticShadowCameraWorldMatrix(1),
       m_aspectRatio(1),
       m_samplesMSAA(0),
-      m_viewportRegionInvalidated(false)
+      m_viewportRegionInvalidated(false),
+      m_staticShadowCastersInvalidated(true)
 {
     FreeImage_Initialise();
 }
@@ -575,6 +581,9 @@ void BaseApplicationContext::release()
 {
     pushAnnotationGroup("BaseApplicationContext#release", sharedFunctionResolverInstance());
     m_shadowMap.reset();
+    m_staticShadowCasterRefs.clear();
+    m_staticShadowCasterRevisions.clear();
+    m_staticShadowCastersInvalidated = true;
     m_currentModelRef = 0;
     m_offscreenTextures.releaseAll();
     m_renderTargets.releaseAll();
@@ -1584,6 +1593,7 @@ void BaseApplicationContext::createShadowMap(const Vector3 &size)
         pushAnnotationGroup("BaseApplicationContext#createShadowMap", sharedFunctionResolverInstance());
         m_shadowMap.reset(new SimpleShadowMap(resolver, vsize(size.x()), vsize(size.y())));
         m_shadowMap->create();
+        m_staticShadowCastersInvalidated = true;
         popAnnotationGroup(sharedFunctionResolverInstance());
     }
     m_sceneRef->setShadowMapRef(m_shadowMap.get());
@@ -1601,22 +1611,71 @@ void BaseApplicationContext::renderShadowMap()
 {
     if (SimpleShadowMap *shadowMapRef = m_shadowMap.get()) {
         pushAnnotationGroup("BaseApplicationContext#renderShadowMap", sharedFunctionResolverInstance());
-        shadowMapRef->bind();
-        const Vector3 &size = shadowMapRef->size();
-        viewport(0, 0, GLsizei(size.x()), GLsizei(size.y()));
-        clear(kGL_COLOR_BUFFER_BIT | kGL_DEPTH_BUFFER_BIT);
-        Array<IRenderEngine *> engines;
+        Array<IRenderEngine *> engines, staticEngines, dynamicEngines;
+        Array<int> staticRevisions;
         m_sceneRef->getRenderEngineRefs(engines);
         const int nengines = engines.count();
         for (int i = 0; i < nengines; i++) {
             IRenderEngine *engine = engines[i];
+            const IModel *model = engine->parentModelRef();
+            /* assets not attached to a bone only move when they are edited and can be cached */
+            if (model && model->type() == IModel::kAssetModel && !model->parentBoneRef()) {
+                staticEngines.append(engine);
+                staticRevisions.append(static_cast<const asset::Model *>(model)->revision());
+            }
+            else {
+                dynamicEngines.append(engine);
+            }
+        }
+        const glm::mat4x4 &lightMatrix = m_lightProjectionMatrix * m_lightViewMatrix * m_lightWorldMatrix;
+        const int nstaticEngines = staticEngines.count();
+        bool invalidated = m_staticShadowCastersInvalidated
+                || nstaticEngines != m_staticShadowCasterRefs.count()
+                || lightMatrix != m_staticShadowLightMatrix
+                || m_cameraWorldMatrix != m_staticShadowCameraWorldMatrix;
+        for (int i = 0; !invalidated && i < nstaticEngines; i++) {
+            invalidated = staticEngines[i] != m_staticShadowCasterRefs[i]
+                    || staticRevisions[i] != m_staticShadowCasterRevisions[i];
+        }
+        const Vector3 &size = shadowMapRef->size();
+        viewport(0, 0, GLsizei(size.x()), GLsizei(size.y()));
+        if (nstaticEngines > 0) {
+            if (invalidated) {
+                shadowMapRef->bindStaticLayer();
+                clear(kGL_COLOR_BUFFER_BIT | kGL_DEPTH_BUFFER_BIT);
+                for (int i = 0; i < nstaticEngines; i++) {
+                    IRenderEngine *engine = staticEngines[i];
+                    engine->renderZPlot();
+                }
+            }
+            shadowMapRef->copyStaticLayer();
+        }
+        else {
+            shadowMapRef->bind();
+            clear(kGL_COLOR_BUFFER_BIT | kGL_DEPTH_BUFFER_BIT);
+        }
+        const int ndynamicEngines = dynamicEngines.count();
+        for (int i = 0; i < ndynamicEngines; i++) {
+            IRenderEngine *engine = dynamicEngines[i];
             engine->renderZPlot();
         }
         shadowMapRef->unbind();
+        if (invalidated) {
+            m_staticShadowCasterRefs.copy(staticEngines);
+            m_staticShadowCasterRevisions.copy(staticRevisions);
+            m_staticShadowLightMatrix = lightMatrix;
+            m_staticShadowCameraWorldMatrix = m_cameraWorldMatrix;
+            m_staticShadowCastersInvalidated = false;
+        }
         popAnnotationGroup(sharedFunctionResolverInstance());
     }
 }
 
+void BaseApplicationContext::invalidateStaticShadowCasters()
+{
+    m_staticShadowCastersInvalidated = true;
+}
+
 std::string BaseApplicationContext::toonDirectory() const
 {
     return m_configRef->value("dir.system.toon", std::string(":textures"));
@@ -36,9 +36,13 @@
 */
 
 #include <vpvl2/extensions/icu4c/Encoding.h>
+#include <vpvl2/Tracer.h>
 #include <vpvl2/internal/util.h>
 
 #include <cstring> /* for std::strlen */
+#include <deque>
+#include <map>
+#include <string>
 
 #if defined(VPVL2_OS_WINDOWS)
 #define strncasecmp _strnicmp
@@ -51,6 +55,98 @@ namespace extensions
 namespace icu4c
 {
 
+namespace {
+
+static inline bool isASCIIString(const uint8 *value, vsize size, IString::Codec codec)
+{
+    if (codec == IString::kUTF16) {
+        if (size % 2 != 0) {
+            return false;
+        }
+        for (vsize i = 0; i < size; i += 2) {
+            if (value[i] >= 0x80 || value[i + 1] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    for (vsize i = 0; i < size; i++) {
+        if (value[i] >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} /* namespace anonymous */
+
+struct Encoding::DecodeCache {
+    /* names longer than this are rarely shared so they are not cached */
+    static const vsize kMaxKeyLength = 128;
+    typedef std::map<std::string, String *> EntryMap;
+
+    DecodeCache()
+        : capacity(kDefaultDecodeCacheCapacity)
+    {
+    }
+    ~DecodeCache() {
+        clear();
+    }
+
+    static bool isCacheable(vsize size) {
+        return size <= kMaxKeyLength;
+    }
+    const String *find(const uint8 *value, vsize size, IString::Codec codec) {
+        if (capacity > 0 && isCacheable(size)) {
+            setKey(value, size, codec);
+            EntryMap::const_iterator it = entries.find(key);
+            if (it != entries.end()) {
+                statistics.numCacheHits++;
+                return it->second;
+            }
+            statistics.numCacheMisses++;
+        }
+        return 0;
+    }
+    void insert(const uint8 *value, vsize size, IString::Codec codec, const String *s) {
+        if (capacity > 0 && isCacheable(size)) {
+            /* evict the oldest entry first to keep the cache bounded */
+            while (order.size() >= vsize(capacity)) {
+                EntryMap::iterator it = entries.find(order.front());
+                if (it != entries.end()) {
+                    internal::deleteObject(it->second);
+                    entries.erase(it);
+                }
+                order.pop_front();
+                statistics.numCacheEvictions++;
+            }
+            setKey(value, size, codec);
+            if (entries.find(key) == entries.end()) {
+                entries.insert(std::make_pair(key, static_cast<String *>(s->clone())));
+                order.push_back(key);
+            }
+        }
+    }
+    void setKey(const uint8 *value, vsize size, IString::Codec codec) {
+        /* reuse the buffer of the key to avoid allocation on every lookup */
+        key.assign(1, char(codec));
+        key.append(reinterpret_cast<const char *>(value), size);
+    }
+    void clear() {
+        for (EntryMap::iterator it = entries.begin(); it != entries.end(); ++it) {
+            internal::deleteObject(it->second);
+        }
+        entries.clear();
+        order.clear();
+    }
+
+    EntryMap entries;
+    std::deque<std::string> order;
+    std::string key;
+    DecodeStatistics statistics;
+    int capacity;
+};
+
 const char *Encoding::commonDataPath()
 {
     return "icudt50l.dat";
@@ -59,7 +155,8 @@ const char *Encoding::commonDataPath()
 Encoding::Encoding(const Dictionary *dictionaryRef)
     : m_dictionaryRef(dictionaryRef),
       m_null(UnicodeString()),
-      m_detector(0)
+      m_detector(0),
+      m_cache(new DecodeCache())
 {
     UErrorCode status = U_ZERO_ERROR;
     m_detector = ucsdet_open(&status);
@@ -68,6 +165,7 @@ Encoding::Encoding(const Dictionary *dictionaryRef)
 
 Encoding::~Encoding()
 {
+    internal::deleteObject(m_cache);
     ucsdet_close(m_detector);
     m_detector = 0;
     m_dictionaryRef = 0;
@@ -83,28 +181,13 @@ const IString *Encoding::stringConstant(ConstantType value) const
 
 IString *Encoding::toString(const uint8 *value, vsize size, IString::Codec codec) const
 {
-    const char *str = reinterpret_cast<const char *>(value);
-    UConverter *converter = 0;
-    switch (codec) {
-    case IString::kShiftJIS:
-        converter = m_converter.shiftJIS;
-        break;
-    case IString::kUTF8:
-        converter = m_converter.utf8;
-        break;
-    case IString::kUTF16:
-        converter = m_converter.utf16;
-        break;
-    case IString::kMaxCodecType:
-    default:
-        break;
+    VPVL2_TRACE_COUNT(kStringConversionCounter, 1);
+    if (const String *cached = m_cache->find(value, size, codec)) {
+        return cached->clone();
     }
-    IString *s = 0;
-    if (converter) {
-        UErrorCode status = U_ZERO_ERROR;
-        UnicodeString us(str, int(size), converter, status);
-        /* remove head and trail spaces and 0x1a (appended by PMDEditor) */
-        s = new (std::nothrow) String(us.trim().findAndReplace(UChar(0x1a), UChar()), &m_converter);
+    String *s = decode(value, size, codec);
+    if (s) {
+        m_cache->insert(value, size, codec, s);
     }
     return s;
 }
@@ -195,6 +278,67 @@ IString *Encoding::createString(const UnicodeString &value) const
     return new String(value, &m_converter);
 }
 
+void Encoding::setDecodeCacheCapacity(int value)
+{
+    m_cache->clear();
+    m_cache->capacity = btMax(value, 0);
+}
+
+Encoding::DecodeStatistics Encoding::decodeStatistics() const
+{
+    return m_cache->statistics;
+}
+
+void Encoding::resetDecodeStatistics()
+{
+    m_cache->statistics = DecodeStatistics();
+}
+
+String *Encoding::decode(const uint8 *value, vsize size, IString::Codec codec) const
+{
+    const char *str = reinterpret_cast<const char *>(value);
+    UConverter *converter = 0;
+    switch (codec) {
+    case IString::kShiftJIS:
+        converter = m_converter.shiftJIS;
+        break;
+    case IString::kUTF8:
+        converter = m_converter.utf8;
+        break;
+    case IString::kUTF16:
+        converter = m_converter.utf16;
+        break;
+    case IString::kMaxCodecType:
+    default:
+        break;
+    }
+    String *s = 0;
+    if (converter) {
+        UnicodeString us;
+        if (isASCIIString(value, size, codec)) {
+            /* ASCII is same in all supported codecs so the converter can be skipped */
+            if (codec == IString::kUTF16) {
+                us = UnicodeString(int32_t(size / 2), UChar32(0), 0);
+                for (vsize i = 0; i < size; i += 2) {
+                    us.append(UChar(value[i]));
+                }
+            }
+            else {
+                us = UnicodeString::fromUTF8(StringPiece(str, int32_t(size)));
+            }
+            m_cache->statistics.numASCIIDecodes++;
+        }
+        else {
+            UErrorCode status = U_ZERO_ERROR;
+            us = UnicodeString(str, int32_t(size), converter, status);
+            m_cache->statistics.numConverterDecodes++;
+        }
+        /* remove head and trail spaces and 0x1a (appended by PMDEditor) */
+        s = new (std::nothrow) String(us.trim().findAndReplace(UChar(0x1a), UChar()), &m_converter);
+    }
+    return s;
+}
+
 } /* namespace icu4c */
 } /* namespace extensions */
 } /* namespace vpvl2 */
@@ -90,6 +90,14 @@ String::String(const UnicodeString &value, const Converter *converterRef)
             static_cast<UConverter *>(converterRef ? converterRef->utf8 : 0), status);
 }
 
+String::String(const UnicodeString &value, const Array<uint8> &bytes, const Converter *converterRef)
+    : m_converterRef(converterRef),
+      m_value(value)
+{
+    /* reuse encoded bytes of the source string instead of converting again */
+    m_bytes.copy(bytes);
+}
+
 String::~String()
 {
     m_converterRef = 0;
@@ -163,7 +171,7 @@ IString *String::join(const Array<IString *> &tokens) const
 
 IString *String::clone() const
 {
-    return new String(m_value, m_converterRef);
+    return new String(m_value, m_bytes, m_converterRef);
 }
 
 const HashString String::toHashString() const
@@ -37,6 +37,7 @@
 
 #include <vpvl2/extensions/World.h>
 
+#include <vpvl2/FrameProfiler.h>
 #include <vpvl2/IModel.h>
 #include <vpvl2/Scene.h>
 #include <vpvl2/internal/util.h>
@@ -173,6 +174,7 @@ void World::removeRigidBody(btRigidBody *value)
 
 void World::stepSimulation(const vpvl2::Scalar &delta)
 {
+    VPVL2_PROFILE_STAGE(kPhysicsStepStage);
     m_context->world->stepSimulation(delta, m_context->maxSubSteps, m_context->fixedTimeStep);
 }
 
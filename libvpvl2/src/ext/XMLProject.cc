@@ -81,6 +81,630 @@ namespace vpvl2
 namespace extensions
 {
 
+namespace {
+
+class StreamAttribute VPVL2_DECL_FINAL {
+public:
+    StreamAttribute()
+        : m_next(0)
+    {
+    }
+    ~StreamAttribute() {
+        m_next = 0;
+    }
+
+    const char *Name() const { return m_name.c_str(); }
+    const char *Value() const { return m_value.c_str(); }
+    const StreamAttribute *Next() const { return m_next; }
+    int IntValue() const {
+        int value = 0;
+        XMLUtil::ToInt(Value(), &value);
+        return value;
+    }
+    bool BoolValue() const {
+        bool value = false;
+        XMLUtil::ToBool(Value(), &value);
+        return value;
+    }
+    float FloatValue() const {
+        float value = 0;
+        XMLUtil::ToFloat(Value(), &value);
+        return value;
+    }
+    double DoubleValue() const {
+        double value = 0;
+        XMLUtil::ToDouble(Value(), &value);
+        return value;
+    }
+
+private:
+    friend class StreamReader;
+    std::string m_name;
+    std::string m_value;
+    const StreamAttribute *m_next;
+};
+
+/**
+ * Reads a project document sequentially and calls back the handler without building DOM tree.
+ *
+ * The document is pulled from the source in chunks of kChunkSize bytes and the consumed part
+ * of the window is dropped on each refill, so only the token being read is kept in memory.
+ *
+ * Callbacks follow the same rules as tinyxml2::XMLVisitor so that the handler can be shared
+ * with the previous DOM based implementation:
+ *   - visitReadExit is called even if visitReadEnter returns false but children of the element are skipped
+ *   - remaining siblings are skipped if a callback of the node returns false
+ *   - text node is reported only if it contains non whitespace characters (CDATA is always reported)
+ */
+class StreamReader VPVL2_DECL_FINAL {
+public:
+    class ISource {
+    public:
+        virtual ~ISource() {}
+        virtual vsize read(char *buffer, vsize size) = 0;
+    };
+    class MemorySource VPVL2_DECL_FINAL : public ISource {
+    public:
+        MemorySource(const char *data, vsize size)
+            : m_ptr(data),
+              m_rest(size)
+        {
+        }
+        ~MemorySource() {
+            m_ptr = 0;
+            m_rest = 0;
+        }
+
+        vsize read(char *buffer, vsize size) {
+            const vsize nread = btMin(size, m_rest);
+            std::memcpy(buffer, m_ptr, nread);
+            m_ptr += nread;
+            m_rest -= nread;
+            return nread;
+        }
+
+    private:
+        const char *m_ptr;
+        vsize m_rest;
+    };
+    class FileSource VPVL2_DECL_FINAL : public ISource {
+    public:
+        FileSource(FILE *fp)
+            : m_fp(fp)
+        {
+        }
+        ~FileSource() {
+            m_fp = 0;
+        }
+
+        vsize read(char *buffer, vsize size) {
+            return std::fread(buffer, 1, size, m_fp);
+        }
+
+    private:
+        FILE *m_fp;
+    };
+    static const vsize kChunkSize = 8192;
+
+    StreamReader(ISource *sourceRef)
+        : m_sourceRef(sourceRef),
+          m_pos(0),
+          m_mark(kNoMark),
+          m_line(1),
+          m_markedLine(1),
+          m_nattributes(0),
+          m_eof(false)
+    {
+    }
+    ~StreamReader() {
+        m_sourceRef = 0;
+        m_pos = 0;
+        m_line = 0;
+        m_nattributes = 0;
+    }
+
+    template<typename THandler>
+    bool parse(THandler *handler) {
+        bool visit = true, hasElement = false;
+        m_buffer.clear();
+        m_error.clear();
+        m_pos = 0;
+        m_mark = kNoMark;
+        m_line = 1;
+        m_eof = false;
+        if (startsWith("\xef\xbb\xbf")) {
+            m_pos += 3;
+        }
+        while (true) {
+            mark();
+            skipWhiteSpace();
+            const bool isText = peek() && (peek() != '<' || startsWith("<![CDATA["));
+            if (isText) {
+                rewind();
+            }
+            else {
+                releaseMark();
+            }
+            if (!peek()) {
+                break;
+            }
+            else if (isText) {
+                if (!parseText(handler, visit)) {
+                    return false;
+                }
+            }
+            else if (startsWith("<?") || startsWith("<!")) {
+                if (!skipMarkup()) {
+                    return false;
+                }
+            }
+            else {
+                bool accepted = true;
+                if (!parseElement(handler, visit, accepted)) {
+                    return false;
+                }
+                visit = visit && accepted;
+                hasElement = true;
+            }
+        }
+        if (!hasElement) {
+            setError("no element is found");
+        }
+        return hasElement;
+    }
+    const std::string &errorString() const { return m_error; }
+    int line() const { return m_line; }
+
+private:
+    static const vsize kNoMark = ~vsize(0);
+    static inline bool isWhiteSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    static inline bool isNameTerminator(char c) {
+        return !c || isWhiteSpace(c) || c == '/' || c == '>' || c == '=';
+    }
+    void fill() {
+        /* drop the consumed bytes but keep the marked token because it is not decoded yet */
+        const vsize consumed = m_mark != kNoMark ? m_mark : m_pos;
+        if (consumed > 0) {
+            m_buffer.erase(0, consumed);
+            m_pos -= consumed;
+            if (m_mark != kNoMark) {
+                m_mark -= consumed;
+            }
+        }
+        char chunk[kChunkSize];
+        const vsize nread = m_sourceRef->read(chunk, sizeof(chunk));
+        if (nread > 0) {
+            m_buffer.append(chunk, nread);
+        }
+        else {
+            m_eof = true;
+        }
+    }
+    /* returns the character at the offset from the current position or zero at the end of document */
+    char peek(vsize offset = 0) {
+        while (m_pos + offset >= m_buffer.size() && !m_eof) {
+            fill();
+        }
+        return m_pos + offset < m_buffer.size() ? m_buffer[m_pos + offset] : 0;
+    }
+    bool startsWith(const char *const value) {
+        for (vsize i = 0; value[i]; i++) {
+            if (peek(i) != value[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    void mark() {
+        m_mark = m_pos;
+        m_markedLine = m_line;
+    }
+    void rewind() {
+        m_pos = m_mark;
+        m_line = m_markedLine;
+        m_mark = kNoMark;
+    }
+    void releaseMark() {
+        m_mark = kNoMark;
+    }
+    void decodeMarked(vsize suffixLength, bool processEntities, std::string &value) {
+        const char *base = m_buffer.c_str();
+        appendDecoded(base + m_mark, base + m_pos - suffixLength, processEntities, value);
+        m_mark = kNoMark;
+    }
+    void advance() {
+        if (peek() == '\n') {
+            m_line++;
+        }
+        m_pos++;
+    }
+    void skipWhiteSpace() {
+        while (isWhiteSpace(peek())) {
+            advance();
+        }
+    }
+    void setError(const char *const message) {
+        m_error.assign(message);
+    }
+    bool skipUntil(const char *const terminator) {
+        while (peek() && !startsWith(terminator)) {
+            advance();
+        }
+        if (!peek()) {
+            setError("unexpected end of document");
+            return false;
+        }
+        m_pos += std::strlen(terminator);
+        return true;
+    }
+    bool skipMarkup() {
+        if (startsWith("<!--")) {
+            return skipUntil("-->");
+        }
+        else if (startsWith("<?")) {
+            return skipUntil("?>");
+        }
+        return skipUntil(">");
+    }
+    bool readName(std::string &name) {
+        mark();
+        while (!isNameTerminator(peek())) {
+            m_pos++;
+        }
+        const vsize length = m_pos - m_mark;
+        if (length == 0) {
+            releaseMark();
+            setError("name is expected");
+            return false;
+        }
+        name.assign(m_buffer, m_mark, length);
+        releaseMark();
+        return true;
+    }
+    /* decodes entities and normalizes newlines as tinyxml2 does */
+    void appendDecoded(const char *start, const char *end, bool processEntities, std::string &value) {
+        value.clear();
+        value.reserve(end - start);
+        for (const char *p = start; p < end; ) {
+            const char c = *p;
+            if (c == '\r') {
+                value.push_back('\n');
+                p += (p + 1 < end && p[1] == '\n') ? 2 : 1;
+            }
+            else if (c == '&' && processEntities) {
+                p = appendEntity(p, end, value);
+            }
+            else {
+                value.push_back(c);
+                p++;
+            }
+        }
+    }
+    const char *appendEntity(const char *p, const char *end, std::string &value) {
+        static const struct {
+            const char *name;
+            vsize length;
+            char value;
+        } kEntities[] = {
+            { "&amp;",  5, '&'  },
+            { "&lt;",   4, '<'  },
+            { "&gt;",   4, '>'  },
+            { "&quot;", 6, '"'  },
+            { "&apos;", 6, '\'' }
+        };
+        if (p + 1 < end && p[1] == '#') {
+            char buffer[8] = { 0 };
+            int length = 0;
+            const char *next = XMLUtil::GetCharacterRef(p, buffer, &length);
+            if (next && next <= end && length > 0) {
+                value.append(buffer, length);
+                return next;
+            }
+        }
+        else {
+            for (vsize i = 0; i < sizeof(kEntities) / sizeof(kEntities[0]); i++) {
+                const vsize length = kEntities[i].length;
+                if (vsize(end - p) >= length && std::strncmp(p, kEntities[i].name, length) == 0) {
+                    value.push_back(kEntities[i].value);
+                    return p + length;
+                }
+            }
+        }
+        /* unknown entity is left as it is */
+        value.push_back(*p);
+        return p + 1;
+    }
+    bool readAttributes() {
+        m_nattributes = 0;
+        while (true) {
+            skipWhiteSpace();
+            const char c = peek();
+            if (!c) {
+                setError("unexpected end of document");
+                return false;
+            }
+            else if (c == '/' || c == '>') {
+                break;
+            }
+            if (m_nattributes >= m_attributes.size()) {
+                m_attributes.resize(m_nattributes + 1);
+            }
+            StreamAttribute &attribute = m_attributes[m_nattributes];
+            if (!readName(attribute.m_name)) {
+                return false;
+            }
+            skipWhiteSpace();
+            if (peek() != '=') {
+                setError("'=' is expected after attribute name");
+                return false;
+            }
+            m_pos++;
+            skipWhiteSpace();
+            const char quote = peek();
+            if (quote != '"' && quote != '\'') {
+                setError("attribute value must be quoted");
+                return false;
+            }
+            m_pos++;
+            mark();
+            while (peek() && peek() != quote) {
+                advance();
+            }
+            if (!peek()) {
+                releaseMark();
+                setError("unexpected end of document");
+                return false;
+            }
+            decodeMarked(0, true, attribute.m_value);
+            m_pos++;
+            m_nattributes++;
+        }
+        /* links are built after all attributes are read because resizing may move the array */
+        for (vsize i = 0; i < m_nattributes; i++) {
+            m_attributes[i].m_next = i + 1 < m_nattributes ? &m_attributes[i + 1] : 0;
+        }
+        return true;
+    }
+    template<typename THandler>
+    bool parseText(THandler *handler, bool &visit) {
+        if (startsWith("<![CDATA[")) {
+            m_pos += 9;
+            mark();
+            if (!skipUntil("]]>")) {
+                releaseMark();
+                return false;
+            }
+            if (visit) {
+                decodeMarked(3, false, m_text);
+                visit = handler->visitRead(m_text.c_str());
+            }
+            releaseMark();
+        }
+        else {
+            mark();
+            while (peek() && peek() != '<') {
+                advance();
+            }
+            if (visit) {
+                decodeMarked(0, true, m_text);
+                visit = handler->visitRead(m_text.c_str());
+            }
+            releaseMark();
+        }
+        return true;
+    }
+    template<typename THandler>
+    bool parseElement(THandler *handler, bool visit, bool &accepted) {
+        std::string name;
+        m_pos++;
+        if (!readName(name) || !readAttributes()) {
+            return false;
+        }
+        bool closed = false;
+        if (startsWith("/>")) {
+            m_pos += 2;
+            closed = true;
+        }
+        else {
+            m_pos++;
+        }
+        bool visitChildren = visit && handler->visitReadEnter(name.c_str(), m_nattributes > 0 ? &m_attributes[0] : 0);
+        while (!closed) {
+            mark();
+            skipWhiteSpace();
+            const bool isText = peek() && (peek() != '<' || startsWith("<![CDATA["));
+            if (isText) {
+                rewind();
+            }
+            else {
+                releaseMark();
+            }
+            if (!peek()) {
+                setError("unexpected end of document");
+                return false;
+            }
+            else if (isText) {
+                if (!parseText(handler, visitChildren)) {
+                    return false;
+                }
+            }
+            else if (startsWith("</")) {
+                std::string endName;
+                m_pos += 2;
+                if (!readName(endName)) {
+                    return false;
+                }
+                skipWhiteSpace();
+                if (endName != name || peek() != '>') {
+                    setError("mismatched end tag");
+                    return false;
+                }
+                m_pos++;
+                closed = true;
+            }
+            else if (startsWith("<?") || startsWith("<!")) {
+                if (!skipMarkup()) {
+                    return false;
+                }
+            }
+            else {
+                bool childAccepted = true;
+                if (!parseElement(handler, visitChildren, childAccepted)) {
+                    return false;
+                }
+                visitChildren = visitChildren && childAccepted;
+            }
+        }
+        accepted = visit ? handler->visitReadExit(name.c_str()) : true;
+        return true;
+    }
+
+    ISource *m_sourceRef;
+    std::string m_buffer;
+    std::vector<StreamAttribute> m_attributes;
+    std::string m_text;
+    std::string m_error;
+    vsize m_pos;
+    vsize m_mark;
+    int m_line;
+    int m_markedLine;
+    vsize m_nattributes;
+    bool m_eof;
+
+    VPVL2_DISABLE_COPY_AND_ASSIGN(StreamReader)
+};
+
+class BinaryChunkWriter VPVL2_DECL_FINAL {
+public:
+    BinaryChunkWriter() {}
+    ~BinaryChunkWriter() {}
+
+    template<typename T>
+    void write(const T &value) {
+        const uint8 *ptr = reinterpret_cast<const uint8 *>(&value);
+        m_bytes.insert(m_bytes.end(), ptr, ptr + sizeof(value));
+    }
+    void writeString(const std::string &value) {
+        write(int32(value.size()));
+        m_bytes.insert(m_bytes.end(), value.begin(), value.end());
+    }
+    void writeBool(bool value) {
+        write(uint8(value ? 1 : 0));
+    }
+    void writeVector3(const Vector3 &value) {
+        for (int i = 0; i < 3; i++) {
+            write(float32(value[i]));
+        }
+    }
+    void writeVector4(const QuadWord &value) {
+        for (int i = 0; i < 4; i++) {
+            write(float32(value[i]));
+        }
+    }
+    void writeInterpolation(const QuadWord &value) {
+        for (int i = 0; i < 4; i++) {
+            write(uint8(value[i]));
+        }
+    }
+    bool writeChunk(FILE *fp) const {
+        const uint32 size = uint32(m_bytes.size());
+        if (fwrite(&size, sizeof(size), 1, fp) != 1) {
+            return false;
+        }
+        return size == 0 || fwrite(&m_bytes[0], 1, size, fp) == size;
+    }
+
+private:
+    std::vector<uint8> m_bytes;
+};
+
+class BinaryChunkReader VPVL2_DECL_FINAL {
+public:
+    BinaryChunkReader(const uint8 *data, vsize size)
+        : m_ptr(data),
+          m_rest(size),
+          m_valid(true)
+    {
+    }
+    ~BinaryChunkReader() {
+        m_ptr = 0;
+        m_rest = 0;
+        m_valid = false;
+    }
+
+    template<typename T>
+    T read() {
+        T value = T();
+        if (m_valid && sizeof(value) <= m_rest) {
+            internal::getData(m_ptr, value);
+            m_ptr += sizeof(value);
+            m_rest -= sizeof(value);
+        }
+        else {
+            m_valid = false;
+        }
+        return value;
+    }
+    const uint8 *readBytes(vsize size) {
+        if (m_valid && size <= m_rest) {
+            const uint8 *ptr = m_ptr;
+            m_ptr += size;
+            m_rest -= size;
+            return ptr;
+        }
+        m_valid = false;
+        return 0;
+    }
+    std::string readString() {
+        const int32 size = read<int32>();
+        if (size >= 0) {
+            if (const uint8 *ptr = readBytes(size)) {
+                return std::string(reinterpret_cast<const char *>(ptr), size);
+            }
+        }
+        m_valid = false;
+        return std::string();
+    }
+    bool readBool() {
+        return read<uint8>() != 0;
+    }
+    Vector3 readVector3() {
+        Vector3 value(kZeroV3);
+        for (int i = 0; i < 3; i++) {
+            value[i] = read<float32>();
+        }
+        return value;
+    }
+    Vector4 readVector4() {
+        Vector4 value(kZeroV4);
+        for (int i = 0; i < 4; i++) {
+            value[i] = read<float32>();
+        }
+        return value;
+    }
+    Quaternion readQuaternion() {
+        const Vector4 &value = readVector4();
+        return Quaternion(value.x(), value.y(), value.z(), value.w());
+    }
+    QuadWord readInterpolation() {
+        QuadWord value(0, 0, 0, 0);
+        for (int i = 0; i < 4; i++) {
+            value[i] = read<uint8>();
+        }
+        return value;
+    }
+    bool isValid() const { return m_valid; }
+
+private:
+    const uint8 *m_ptr;
+    vsize m_rest;
+    bool m_valid;
+};
+
+} /* namespace anonymous */
+
 struct XMLProject::PrivateContext {
     enum State {
         kInitial,
@@ -107,9 +731,15 @@ struct XMLProject::PrivateContext {
         kMVDProjectMotion
     };
     static const int kElementContentBufferSize = 128;
+    static const uint8 kBinaryProjectSignature[];
+    static const vsize kBinaryProjectSignatureSize = 8;
     static const std::string kEmpty;
     typedef std::map<XMLProject::UUID, IModel *> ModelMap;
     typedef std::map<XMLProject::UUID, IMotion *> MotionMap;
+    typedef std::vector<std::pair<XMLProject::UUID, IModel::Type> > PendingModelList;
+    typedef std::vector<std::pair<IMotion *, XMLProject::UUID> > PendingParentModelList;
+    typedef std::pair<const uint8 *, vsize> BinaryChunkRef;
+    typedef std::vector<BinaryChunkRef> BinaryChunkRefList;
 
     static inline const char *projectPrefix() {
         return "vpvm";
@@ -170,12 +800,9 @@ struct XMLProject::PrivateContext {
     static inline bool equalsConstant(const char *left, const char *const right) {
         return left && std::strncmp(left, right, std::strlen(right)) == 0;
     }
-    static inline bool equalsToAttribute(const XMLAttribute *attribute, const char *const name) {
+    static inline bool equalsToAttribute(const StreamAttribute *attribute, const char *const name) {
         return attribute && equalsConstant(attribute->Name(), name);
     }
-    static inline bool equalsToElement(const XMLElement &element, const char *const name) {
-        return equalsConstant(element.Name(), name);
-    }
     static void splitString(const std::string &value, Array<std::string> &tokens) {
         const std::string &delimiter = ",";
         std::string item(value);
@@ -228,8 +855,10 @@ struct XMLProject::PrivateContext {
           currentMotion(0),
           currentMotionType(IMotion::kVMDMotion),
           state(kInitial),
+          keyframeFormat(XMLProject::kTextKeyframeFormat),
           depth(0),
-          dirty(false)
+          dirty(false),
+          hasInvalidChunk(false)
     {
     }
     ~PrivateContext() {
@@ -239,6 +868,8 @@ struct XMLProject::PrivateContext {
         motionRefs.clear();
         internal::deleteObject(currentString);
         internal::deleteObject(currentMotion);
+        binaryChunkWriters.releaseAll();
+        binaryChunkRefs.clear();
         state = kInitial;
         depth = 0;
         dirty = false;
@@ -508,6 +1139,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "bone");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeVMDBoneKeyframes(motion), printer);
+        }
         const vmd::BoneAnimation &ba = motion->boneAnimation();
         int nkeyframes = ba.countKeyframes();
         for (int i = 0; i < nkeyframes; i++) {
@@ -549,6 +1183,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "camera");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeVMDCameraKeyframes(motion), printer);
+        }
         const vmd::CameraAnimation &ca = motion->cameraAnimation();
         int nkeyframes = ca.countKeyframes();
         for (int i = 0; i < nkeyframes; i++) {
@@ -594,6 +1231,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "light");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeVMDLightKeyframes(motion), printer);
+        }
         const vmd::LightAnimation &la = motion->lightAnimation();
         int nkeyframes = la.countKeyframes();
         for (int i = 0; i < nkeyframes; i++) {
@@ -614,6 +1254,9 @@ struct XMLProject::PrivateContext {
     bool writeVMDMorphKeyframes(const vmd::Motion *motion, XMLPrinter &printer) const {
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "morph");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeVMDMorphKeyframes(motion), printer);
+        }
         const vmd::MorphAnimation &fa = motion->morphAnimation();
         int nkeyframes = fa.countKeyframes();
         for (int i = 0; i < nkeyframes; i++) {
@@ -633,6 +1276,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "bone");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDBoneKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kBoneKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::BoneKeyframe *keyframe = static_cast<const mvd::BoneKeyframe *>(motion->findBoneKeyframeRefAt(i));
@@ -673,6 +1319,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "camera");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDCameraKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kCameraKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::CameraKeyframe *keyframe = static_cast<const mvd::CameraKeyframe *>(motion->findCameraKeyframeRefAt(i));
@@ -711,6 +1360,9 @@ struct XMLProject::PrivateContext {
     bool writeMVDEffectKeyframes(const mvd::Motion *motion, XMLPrinter &printer) const {
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "effect");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDEffectKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kEffectKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::EffectKeyframe *keyframe = static_cast<const mvd::EffectKeyframe *>(motion->findEffectKeyframeRefAt(i));
@@ -730,6 +1382,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "light");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDLightKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kLightKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::LightKeyframe *keyframe = static_cast<const mvd::LightKeyframe *>(motion->findLightKeyframeRefAt(i));
@@ -750,6 +1405,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "model");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDModelKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kModelKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::ModelKeyframe *keyframe = static_cast<const mvd::ModelKeyframe *>(motion->findModelKeyframeRefAt(i));
@@ -772,6 +1430,9 @@ struct XMLProject::PrivateContext {
     bool writeMVDMorphKeyframes(const mvd::Motion *motion, XMLPrinter &printer) const {
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "morph");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDMorphKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kMorphKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::MorphKeyframe *keyframe = static_cast<const mvd::MorphKeyframe *>(motion->findMorphKeyframeRefAt(i));
@@ -789,6 +1450,9 @@ struct XMLProject::PrivateContext {
         char buffer[kElementContentBufferSize];
         printer.OpenElement("vpvm:animation");
         printer.PushAttribute("type", "project");
+        if (keyframeFormat == XMLProject::kBinaryKeyframeFormat) {
+            return writeBinaryChunk(encodeMVDProjectKeyframes(motion), printer);
+        }
         int nkeyframes = motion->countKeyframes(IKeyframe::kProjectKeyframe);
         for (int i = 0; i < nkeyframes; i++) {
             const mvd::ProjectKeyframe *keyframe = static_cast<const mvd::ProjectKeyframe *>(motion->findProjectKeyframeRefAt(i));
@@ -806,6 +1470,194 @@ struct XMLProject::PrivateContext {
         printer.CloseElement();
         return true;
     }
+    bool writeBinaryChunk(BinaryChunkWriter *writer, XMLPrinter &printer) const {
+        /* keyframes are stored after the XML document and referred by the index of the chunk */
+        printer.PushAttribute("chunk", binaryChunkWriters.count());
+        binaryChunkWriters.append(writer);
+        printer.CloseElement(); /* vpvm:animation */
+        return true;
+    }
+    BinaryChunkWriter *encodeVMDBoneKeyframes(const vmd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        QuadWord qw;
+        const vmd::BoneAnimation &ba = motion->boneAnimation();
+        int nkeyframes = ba.countKeyframes();
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const vmd::BoneKeyframe *keyframe = static_cast<const vmd::BoneKeyframe *>(ba.findKeyframeAt(i));
+            writer->writeString(delegateRef->toStdFromString(keyframe->name()));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->writeVector3(keyframe->localTranslation());
+            writer->writeVector4(keyframe->localOrientation());
+            for (int j = 0; j < 4; j++) {
+                keyframe->getInterpolationParameter(static_cast<IBoneKeyframe::InterpolationType>(j), qw);
+                writer->writeInterpolation(qw);
+            }
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeVMDCameraKeyframes(const vmd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        QuadWord qw;
+        const vmd::CameraAnimation &ca = motion->cameraAnimation();
+        int nkeyframes = ca.countKeyframes();
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const vmd::CameraKeyframe *keyframe = static_cast<const vmd::CameraKeyframe *>(ca.findKeyframeAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->writeVector3(keyframe->lookAt());
+            writer->writeVector3(keyframe->angle());
+            writer->write(float32(keyframe->fov()));
+            writer->write(float32(keyframe->distance()));
+            for (int j = 0; j < ICameraKeyframe::kCameraMaxInterpolationType; j++) {
+                keyframe->getInterpolationParameter(static_cast<ICameraKeyframe::InterpolationType>(j), qw);
+                writer->writeInterpolation(qw);
+            }
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeVMDLightKeyframes(const vmd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        const vmd::LightAnimation &la = motion->lightAnimation();
+        int nkeyframes = la.countKeyframes();
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const vmd::LightKeyframe *keyframe = static_cast<vmd::LightKeyframe *>(la.findKeyframeAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->writeVector3(keyframe->color());
+            writer->writeVector3(keyframe->direction());
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeVMDMorphKeyframes(const vmd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        const vmd::MorphAnimation &fa = motion->morphAnimation();
+        int nkeyframes = fa.countKeyframes();
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const vmd::MorphKeyframe *keyframe = static_cast<vmd::MorphKeyframe *>(fa.findKeyframeAt(i));
+            writer->writeString(delegateRef->toStdFromString(keyframe->name()));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->write(float64(keyframe->weight()));
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDBoneKeyframes(const mvd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        QuadWord qw;
+        int nkeyframes = motion->countKeyframes(IKeyframe::kBoneKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::BoneKeyframe *keyframe = static_cast<const mvd::BoneKeyframe *>(motion->findBoneKeyframeRefAt(i));
+            writer->writeString(delegateRef->toStdFromString(keyframe->name()));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->write(int32(keyframe->layerIndex()));
+            writer->writeVector3(keyframe->localTranslation());
+            writer->writeVector4(keyframe->localOrientation());
+            for (int j = 0; j < 4; j++) {
+                keyframe->getInterpolationParameter(static_cast<IBoneKeyframe::InterpolationType>(j), qw);
+                writer->writeInterpolation(qw);
+            }
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDCameraKeyframes(const mvd::Motion *motion) const {
+        static const ICameraKeyframe::InterpolationType kTypes[] = {
+            ICameraKeyframe::kCameraLookAtX,
+            ICameraKeyframe::kCameraAngle,
+            ICameraKeyframe::kCameraDistance,
+            ICameraKeyframe::kCameraFov
+        };
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        QuadWord qw;
+        int nkeyframes = motion->countKeyframes(IKeyframe::kCameraKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::CameraKeyframe *keyframe = static_cast<const mvd::CameraKeyframe *>(motion->findCameraKeyframeRefAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->write(int32(keyframe->layerIndex()));
+            writer->writeVector3(keyframe->lookAt());
+            writer->writeVector3(keyframe->angle());
+            writer->write(float32(keyframe->fov()));
+            writer->write(float32(keyframe->distance()));
+            for (int j = 0; j < 4; j++) {
+                keyframe->getInterpolationParameter(kTypes[j], qw);
+                writer->writeInterpolation(qw);
+            }
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDEffectKeyframes(const mvd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        int nkeyframes = motion->countKeyframes(IKeyframe::kEffectKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::EffectKeyframe *keyframe = static_cast<const mvd::EffectKeyframe *>(motion->findEffectKeyframeRefAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->writeBool(keyframe->isVisible());
+            writer->writeBool(keyframe->isAddBlendEnabled());
+            writer->writeBool(keyframe->isShadowEnabled());
+            writer->write(float32(keyframe->scaleFactor()));
+            writer->write(float32(keyframe->opacity()));
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDLightKeyframes(const mvd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        int nkeyframes = motion->countKeyframes(IKeyframe::kLightKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::LightKeyframe *keyframe = static_cast<const mvd::LightKeyframe *>(motion->findLightKeyframeRefAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->writeVector3(keyframe->color());
+            writer->writeVector3(keyframe->direction());
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDModelKeyframes(const mvd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        int nkeyframes = motion->countKeyframes(IKeyframe::kModelKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::ModelKeyframe *keyframe = static_cast<const mvd::ModelKeyframe *>(motion->findModelKeyframeRefAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->writeBool(keyframe->isVisible());
+            writer->writeBool(keyframe->isAddBlendEnabled());
+            writer->writeBool(keyframe->isShadowEnabled());
+            writer->writeBool(keyframe->isPhysicsEnabled());
+            writer->write(int32(keyframe->physicsStillMode()));
+            writer->write(float64(keyframe->edgeWidth()));
+            writer->writeVector4(keyframe->edgeColor());
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDMorphKeyframes(const mvd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        int nkeyframes = motion->countKeyframes(IKeyframe::kMorphKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::MorphKeyframe *keyframe = static_cast<const mvd::MorphKeyframe *>(motion->findMorphKeyframeRefAt(i));
+            writer->writeString(delegateRef->toStdFromString(keyframe->name()));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->write(float64(keyframe->weight()));
+        }
+        return writer;
+    }
+    BinaryChunkWriter *encodeMVDProjectKeyframes(const mvd::Motion *motion) const {
+        BinaryChunkWriter *writer = new BinaryChunkWriter();
+        int nkeyframes = motion->countKeyframes(IKeyframe::kProjectKeyframe);
+        writer->write(int32(nkeyframes));
+        for (int i = 0; i < nkeyframes; i++) {
+            const mvd::ProjectKeyframe *keyframe = static_cast<const mvd::ProjectKeyframe *>(motion->findProjectKeyframeRefAt(i));
+            writer->write(float64(keyframe->timeIndex()));
+            writer->write(float32(keyframe->gravityFactor()));
+            writer->writeVector3(keyframe->gravityDirection());
+            writer->write(int32(keyframe->shadowMode()));
+            writer->write(float32(keyframe->shadowDepth()));
+            writer->write(float32(keyframe->shadowDistance()));
+        }
+        return writer;
+    }
     bool writeStringMap(const StringMap &map, XMLPrinter &printer) const {
         for (StringMap::const_iterator it = map.begin(); it != map.end(); it++) {
             if (it->first.empty() || it->second.empty()) {
@@ -819,49 +1671,49 @@ struct XMLProject::PrivateContext {
         return true;
     }
 
-    bool visitReadEnter(const XMLElement &element, const XMLAttribute *firstAttribute) {
-        if (depth == 0 && equalsToElement(element, "vpvm:project")) {
+    bool visitReadEnter(const char *name, const StreamAttribute *firstAttribute) {
+        if (depth == 0 && equalsConstant(name, "vpvm:project")) {
             readVersion(firstAttribute);
         }
         else if (depth == 1 && state == kProject) {
-            if (equalsToElement(element, "vpvm:settings")) {
+            if (equalsConstant(name, "vpvm:settings")) {
                 pushState(kSettings);
             }
-            else if (equalsToElement(element, "vpvm:physics")) {
+            else if (equalsConstant(name, "vpvm:physics")) {
                 pushState(kPhysics);
             }
-            else if (equalsToElement(element, "vpvm:models")) {
+            else if (equalsConstant(name, "vpvm:models")) {
                 pushState(kModels);
             }
-            else if (equalsToElement(element, "vpvm:assets")) {
+            else if (equalsConstant(name, "vpvm:assets")) {
                 pushState(kAssets);
             }
-            else if (equalsToElement(element, "vpvm:motions")) {
+            else if (equalsConstant(name, "vpvm:motions")) {
                 pushState(kMotions);
             }
         }
         else if (depth == 2) {
-            if (state == kSettings && equalsToElement(element, "vpvm:value")) {
+            if (state == kSettings && equalsConstant(name, "vpvm:value")) {
                 readGlobalSettingKey(firstAttribute);
             }
-            if (state == kModels && equalsToElement(element, "vpvm:model")) {
+            if (state == kModels && equalsConstant(name, "vpvm:model")) {
                 readModel(firstAttribute);
             }
-            else if (state == kAssets && equalsToElement(element, "vpvm:asset")) {
+            else if (state == kAssets && equalsConstant(name, "vpvm:asset")) {
                 readAsset(firstAttribute);
             }
-            else if (state == kMotions && equalsToElement(element, "vpvm:motion")) {
+            else if (state == kMotions && equalsConstant(name, "vpvm:motion")) {
                 readMotion(firstAttribute);
             }
         }
         else if (depth == 3) {
-            if ((state == kModel || state == kAsset) && equalsToElement(element, "vpvm:value")) {
+            if ((state == kModel || state == kAsset) && equalsConstant(name, "vpvm:value")) {
                 readLocalSettingKey(firstAttribute);
             }
-            else if (state == kAnimation && equalsToElement(element, "vpvm:animation")) {
+            else if (state == kAnimation && equalsConstant(name, "vpvm:animation")) {
                 readMotionType(firstAttribute);
             }
-            else if (equalsToElement(element, "vpvm:keyframe")) {
+            else if (equalsConstant(name, "vpvm:keyframe")) {
 #if 0
                 // currently do nothing
                 switch (state) {
@@ -871,7 +1723,7 @@ struct XMLProject::PrivateContext {
 #endif
             }
         }
-        else if (depth == 4 && equalsToElement(element, "vpvm:keyframe")) {
+        else if (depth == 4 && equalsConstant(name, "vpvm:keyframe")) {
             switch (state) {
             case kVMDBoneMotion:
                 readVMDBoneKeyframe(firstAttribute);
@@ -928,24 +1780,24 @@ struct XMLProject::PrivateContext {
         }
         return true;
     }
-    bool visitRead(const XMLText &text) {
+    bool visitRead(const char *text) {
         if (state == kSettings) {
-            globalSettings[settingKey].assign(text.Value());
+            globalSettings[settingKey].assign(text);
         }
         else if (state == kModel) {
-            localModelSettings[uuid][settingKey].assign(text.Value());
+            localModelSettings[uuid][settingKey].assign(text);
         }
         else if (state == kAsset) {
-            localAssetSettings[uuid][settingKey].assign(text.Value());
+            localAssetSettings[uuid][settingKey].assign(text);
         }
         else {
             return false;
         }
         return true;
     }
-    bool visitReadExit(const XMLElement &element) {
+    bool visitReadExit(const char *name) {
         if (depth == 4) {
-            if (!equalsToElement(element, "vpvm:keyframe")) {
+            if (!equalsConstant(name, "vpvm:keyframe")) {
                 popState(kAnimation);
             }
             /* else { conitnue reading keyframes of current motion } */
@@ -953,19 +1805,19 @@ struct XMLProject::PrivateContext {
         else if (depth == 3) {
             switch (state) {
             case kAsset:
-                if (equalsToElement(element, "vpvm:asset")) {
+                if (equalsConstant(name, "vpvm:asset")) {
                     addAsset();
                 }
                 settingKey.clear();
                 break;
             case kModel:
-                if (equalsToElement(element, "vpvm:model")) {
+                if (equalsConstant(name, "vpvm:model")) {
                     addModel();
                 }
                 settingKey.clear();
                 break;
             case kAnimation:
-                if (equalsToElement(element, "vpvm:motion")) {
+                if (equalsConstant(name, "vpvm:motion")) {
                     addMotion();
                 }
                 break;
@@ -995,28 +1847,28 @@ struct XMLProject::PrivateContext {
         else if (depth == 2) {
             switch (state) {
             case kAssets:
-                if (equalsToElement(element, "vpvm:assets")) {
+                if (equalsConstant(name, "vpvm:assets")) {
                     popState(kProject);
                 }
                 break;
             case kModels:
-                if (equalsToElement(element, "vpvm:models")) {
+                if (equalsConstant(name, "vpvm:models")) {
                     popState(kProject);
                 }
                 break;
             case kMotions:
-                if (equalsToElement(element, "vpvm:motions")) {
+                if (equalsConstant(name, "vpvm:motions")) {
                     popState(kProject);
                 }
                 break;
             case kSettings:
-                if (equalsToElement(element, "vpvm:settings")) {
+                if (equalsConstant(name, "vpvm:settings")) {
                     popState(kProject);
                 }
                 settingKey.clear();
                 break;
             case kPhysics:
-                if (equalsToElement(element, "vpvm:physics")) {
+                if (equalsConstant(name, "vpvm:physics")) {
                     popState(kProject);
                 }
                 break;
@@ -1041,7 +1893,7 @@ struct XMLProject::PrivateContext {
                 break;
             }
         }
-        else if (depth == 1 && state == kProject && equalsToElement(element, "vpvm:project")) {
+        else if (depth == 1 && state == kProject && equalsConstant(name, "vpvm:project")) {
             depth--;
         }
         else {
@@ -1050,40 +1902,40 @@ struct XMLProject::PrivateContext {
         return true;
     }
 
-    void readVersion(const XMLAttribute *firstAttribute) {
-        for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+    void readVersion(const StreamAttribute *firstAttribute) {
+        for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
             if (equalsToAttribute(attr, "version")) {
                 version.assign(attr->Value());
             }
         }
         pushState(kProject);
     }
-    void readGlobalSettingKey(const XMLAttribute *firstAttribute) {
-        for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+    void readGlobalSettingKey(const StreamAttribute *firstAttribute) {
+        for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
             if (equalsToAttribute(attr, "name")) {
                 settingKey.assign(attr->Value());
             }
         }
     }
-    void readModel(const XMLAttribute *firstAttribute) {
-        for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+    void readModel(const StreamAttribute *firstAttribute) {
+        for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
             if (equalsToAttribute(attr, "uuid")) {
                 uuid.assign(attr->Value());
             }
         }
         pushState(kModel);
     }
-    void readAsset(const XMLAttribute *firstAttribute) {
-        for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+    void readAsset(const StreamAttribute *firstAttribute) {
+        for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
             if (equalsToAttribute(attr, "uuid")) {
                 uuid.assign(attr->Value());
             }
         }
         pushState(kAsset);
     }
-    void readMotion(const XMLAttribute *firstAttribute) {
+    void readMotion(const StreamAttribute *firstAttribute) {
         currentMotionType = IMotion::kVMDMotion;
-        for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+        for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
             if (equalsToAttribute(attr, "uuid")) {
                 uuid.assign(attr->Value());
             }
@@ -1110,13 +1962,18 @@ struct XMLProject::PrivateContext {
         }
         pushState(kAnimation);
     }
-    void readLocalSettingKey(const XMLAttribute *firstAttribute) {
+    void readLocalSettingKey(const StreamAttribute *firstAttribute) {
         readGlobalSettingKey(firstAttribute);
     }
-    void readMotionType(const XMLAttribute *firstAttribute) {
+    void readMotionType(const StreamAttribute *firstAttribute) {
         bool isMVD = currentMotionType == IMotion::kMVDMotion;
-        for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
-            if (!equalsToAttribute(attr, "type")) {
+        int chunkIndex = -1;
+        for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            if (equalsToAttribute(attr, "chunk")) {
+                chunkIndex = attr->IntValue();
+                continue;
+            }
+            else if (!equalsToAttribute(attr, "type")) {
                 continue;
             }
             const char *value = attr->Value();
@@ -1161,15 +2018,18 @@ struct XMLProject::PrivateContext {
                 }
             }
         }
+        if (chunkIndex >= 0 && state != kAnimation && !readBinaryChunk(chunkIndex)) {
+            hasInvalidChunk = true;
+        }
     }
-    void readVMDBoneKeyframe(const XMLAttribute *firstAttribute) {
+    void readVMDBoneKeyframe(const StreamAttribute *firstAttribute) {
         if (IBoneKeyframe *keyframe = factoryRef->createBoneKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector4 vec4(kZeroV4);
             Vector3 vec3(kZeroV3);
             QuadWord qw(0, 0, 0, 0);
             keyframe->setDefaultInterpolationParameter();
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "name")) {
                     internal::deleteObject(currentString);
                     currentString = delegateRef->toStringFromStd(attr->Value());
@@ -1214,13 +2074,13 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readVMDCameraKeyframe(const XMLAttribute *firstAttribute) {
+    void readVMDCameraKeyframe(const StreamAttribute *firstAttribute) {
         if (ICameraKeyframe *keyframe = factoryRef->createCameraKeyframe(currentMotion)) {
             Vector3 vec3(kZeroV3);
             QuadWord qw(0, 0, 0, 0);
             Array<std::string> tokens;
             keyframe->setDefaultInterpolationParameter();
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "fovy")) {
                     keyframe->setFov(attr->FloatValue());
                 }
@@ -1265,11 +2125,11 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readVMDLightKeyframe(const XMLAttribute *firstAttribute) {
+    void readVMDLightKeyframe(const StreamAttribute *firstAttribute) {
         if (ILightKeyframe *keyframe = factoryRef->createLightKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector3 vec3(kZeroV3);
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "index")) {
                     keyframe->setTimeIndex(IKeyframe::TimeIndex(attr->DoubleValue()));
                 }
@@ -1289,9 +2149,9 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readVMDMorphKeyframe(const XMLAttribute *firstAttribute) {
+    void readVMDMorphKeyframe(const StreamAttribute *firstAttribute) {
         if (IMorphKeyframe *keyframe = factoryRef->createMorphKeyframe(currentMotion)) {
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "name")) {
                     internal::deleteObject(currentString);
                     currentString = delegateRef->toStringFromStd(attr->Value());
@@ -1307,21 +2167,21 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDAssetKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDAssetKeyframe(const StreamAttribute *firstAttribute) {
         // FIXME: add createAssetKeyframe
         if (IMorphKeyframe *keyframe = factoryRef->createMorphKeyframe(currentMotion)) {
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
             }
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDBoneKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDBoneKeyframe(const StreamAttribute *firstAttribute) {
         if (IBoneKeyframe *keyframe = factoryRef->createBoneKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector4 vec4(kZeroV4);
             Vector3 vec3(kZeroV3);
             QuadWord qw(0, 0, 0, 0);
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "name")) {
                     internal::deleteObject(currentString);
                     currentString = delegateRef->toStringFromStd(attr->Value());
@@ -1369,12 +2229,12 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDCameraKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDCameraKeyframe(const StreamAttribute *firstAttribute) {
         if (ICameraKeyframe *keyframe = factoryRef->createCameraKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector3 vec3(kZeroV3);
             QuadWord qw(0, 0, 0, 0);
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "fovy")) {
                     keyframe->setFov(attr->FloatValue());
                 }
@@ -1422,9 +2282,9 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDEffectKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDEffectKeyframe(const StreamAttribute *firstAttribute) {
         if (IEffectKeyframe *keyframe = factoryRef->createEffectKeyframe(currentMotion)) {
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "index")) {
                     keyframe->setTimeIndex(IKeyframe::TimeIndex(attr->DoubleValue()));
                 }
@@ -1451,11 +2311,11 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDLightKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDLightKeyframe(const StreamAttribute *firstAttribute) {
         if (ILightKeyframe *keyframe = factoryRef->createLightKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector3 vec3(kZeroV3);
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "index")) {
                     keyframe->setTimeIndex(IKeyframe::TimeIndex(attr->DoubleValue()));
                 }
@@ -1475,11 +2335,11 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDModelKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDModelKeyframe(const StreamAttribute *firstAttribute) {
         if (IModelKeyframe *keyframe = factoryRef->createModelKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector4 vec4(kZeroV4);
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "index")) {
                     keyframe->setTimeIndex(IKeyframe::TimeIndex(attr->DoubleValue()));
                 }
@@ -1511,9 +2371,9 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDMorphKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDMorphKeyframe(const StreamAttribute *firstAttribute) {
         if (IMorphKeyframe *keyframe = factoryRef->createMorphKeyframe(currentMotion)) {
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "name")) {
                     internal::deleteObject(currentString);
                     currentString = delegateRef->toStringFromStd(attr->Value());
@@ -1529,11 +2389,11 @@ struct XMLProject::PrivateContext {
             currentMotion->addKeyframe(keyframe);
         }
     }
-    void readMVDProjectKeyframe(const XMLAttribute *firstAttribute) {
+    void readMVDProjectKeyframe(const StreamAttribute *firstAttribute) {
         if (IProjectKeyframe *keyframe = factoryRef->createProjectKeyframe(currentMotion)) {
             Array<std::string> tokens;
             Vector3 vec3(kZeroV3);
-            for (const XMLAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
+            for (const StreamAttribute *attr = firstAttribute; attr; attr = attr->Next()) {
                 if (equalsToAttribute(attr, "index")) {
                     keyframe->setTimeIndex(IKeyframe::TimeIndex(attr->DoubleValue()));
                 }
@@ -1560,6 +2420,163 @@ struct XMLProject::PrivateContext {
         }
     }
 
+    bool readBinaryChunk(int index) {
+        if (!internal::checkBound(index, 0, int(binaryChunkRefs.size()))) {
+            VPVL2_LOG(WARNING, "Invalid keyframe chunk index: " << index);
+            return false;
+        }
+        const BinaryChunkRef &chunk = binaryChunkRefs[index];
+        BinaryChunkReader reader(chunk.first, chunk.second);
+        const int nkeyframes = reader.read<int32>();
+        for (int i = 0; i < nkeyframes && reader.isValid(); i++) {
+            switch (state) {
+            case kVMDBoneMotion:
+            case kMVDBoneMotion:
+                decodeBoneKeyframe(reader, state == kMVDBoneMotion);
+                break;
+            case kVMDCameraMotion:
+            case kMVDCameraMotion:
+                decodeCameraKeyframe(reader, state == kMVDCameraMotion);
+                break;
+            case kVMDLightMotion:
+            case kMVDLightMotion:
+                decodeLightKeyframe(reader);
+                break;
+            case kVMDMorphMotion:
+            case kMVDMorphMotion:
+                decodeMorphKeyframe(reader);
+                break;
+            case kMVDEffectMotion:
+                decodeEffectKeyframe(reader);
+                break;
+            case kMVDModelMotion:
+                decodeModelKeyframe(reader);
+                break;
+            case kMVDProjectMotion:
+                decodeProjectKeyframe(reader);
+                break;
+            case kInitial:
+            case kProject:
+            case kSettings:
+            case kPhysics:
+            case kModels:
+            case kModel:
+            case kAssets:
+            case kAsset:
+            case kMotions:
+            case kAnimation:
+            case kMVDAssetMotion:
+            default:
+                return true;
+            }
+        }
+        if (!reader.isValid()) {
+            VPVL2_LOG(WARNING, "Keyframe chunk " << index << " is truncated");
+        }
+        return reader.isValid();
+    }
+    void setNameFromBinary(BinaryChunkReader &reader, IKeyframe *keyframe) {
+        internal::deleteObject(currentString);
+        currentString = delegateRef->toStringFromStd(reader.readString());
+        keyframe->setName(currentString);
+    }
+    void decodeBoneKeyframe(BinaryChunkReader &reader, bool hasLayer) {
+        if (IBoneKeyframe *keyframe = factoryRef->createBoneKeyframe(currentMotion)) {
+            setNameFromBinary(reader, keyframe);
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            if (hasLayer) {
+                keyframe->setLayerIndex(IKeyframe::LayerIndex(reader.read<int32>()));
+            }
+            keyframe->setLocalTranslation(reader.readVector3());
+            keyframe->setLocalOrientation(reader.readQuaternion());
+            for (int i = 0; i < 4; i++) {
+                keyframe->setInterpolationParameter(static_cast<IBoneKeyframe::InterpolationType>(i), reader.readInterpolation());
+            }
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+    void decodeCameraKeyframe(BinaryChunkReader &reader, bool isMVD) {
+        static const ICameraKeyframe::InterpolationType kMVDTypes[] = {
+            ICameraKeyframe::kCameraLookAtX,
+            ICameraKeyframe::kCameraAngle,
+            ICameraKeyframe::kCameraDistance,
+            ICameraKeyframe::kCameraFov
+        };
+        if (ICameraKeyframe *keyframe = factoryRef->createCameraKeyframe(currentMotion)) {
+            keyframe->setDefaultInterpolationParameter();
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            if (isMVD) {
+                keyframe->setLayerIndex(IKeyframe::LayerIndex(reader.read<int32>()));
+            }
+            keyframe->setLookAt(reader.readVector3());
+            keyframe->setAngle(reader.readVector3());
+            keyframe->setFov(reader.read<float32>());
+            keyframe->setDistance(reader.read<float32>());
+            if (isMVD) {
+                for (int i = 0; i < 4; i++) {
+                    keyframe->setInterpolationParameter(kMVDTypes[i], reader.readInterpolation());
+                }
+            }
+            else {
+                for (int i = 0; i < ICameraKeyframe::kCameraMaxInterpolationType; i++) {
+                    keyframe->setInterpolationParameter(static_cast<ICameraKeyframe::InterpolationType>(i), reader.readInterpolation());
+                }
+            }
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+    void decodeLightKeyframe(BinaryChunkReader &reader) {
+        if (ILightKeyframe *keyframe = factoryRef->createLightKeyframe(currentMotion)) {
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            keyframe->setColor(reader.readVector3());
+            keyframe->setDirection(reader.readVector3());
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+    void decodeMorphKeyframe(BinaryChunkReader &reader) {
+        if (IMorphKeyframe *keyframe = factoryRef->createMorphKeyframe(currentMotion)) {
+            setNameFromBinary(reader, keyframe);
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            keyframe->setWeight(IMorph::WeightPrecision(reader.read<float64>()));
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+    void decodeEffectKeyframe(BinaryChunkReader &reader) {
+        if (IEffectKeyframe *keyframe = factoryRef->createEffectKeyframe(currentMotion)) {
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            keyframe->setVisible(reader.readBool());
+            keyframe->setAddBlendEnable(reader.readBool());
+            keyframe->setShadowEnable(reader.readBool());
+            keyframe->setScaleFactor(reader.read<float32>());
+            keyframe->setOpacity(reader.read<float32>());
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+    void decodeModelKeyframe(BinaryChunkReader &reader) {
+        if (IModelKeyframe *keyframe = factoryRef->createModelKeyframe(currentMotion)) {
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            keyframe->setVisible(reader.readBool());
+            keyframe->setAddBlendEnable(reader.readBool());
+            keyframe->setShadowEnable(reader.readBool());
+            keyframe->setPhysicsEnable(reader.readBool());
+            keyframe->setPhysicsStillMode(uint8(reader.read<int32>()));
+            keyframe->setEdgeWidth(IVertex::EdgeSizePrecision(reader.read<float64>()));
+            keyframe->setEdgeColor(reader.readVector4());
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+    void decodeProjectKeyframe(BinaryChunkReader &reader) {
+        if (IProjectKeyframe *keyframe = factoryRef->createProjectKeyframe(currentMotion)) {
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(reader.read<float64>()));
+            keyframe->setGravityFactor(reader.read<float32>());
+            keyframe->setGravityDirection(reader.readVector3());
+            keyframe->setShadowMode(reader.read<int32>());
+            keyframe->setShadowDepth(reader.read<float32>());
+            keyframe->setShadowDistance(reader.read<float32>());
+            currentMotion->addKeyframe(keyframe);
+        }
+    }
+
     void addAsset() {
         if (!uuid.empty()) {
             if (uuid != XMLProject::kNullUUID) {
@@ -1570,13 +2587,9 @@ struct XMLProject::PrivateContext {
                     sceneRef->removeModel(it->second);
                     internal::deleteObject(it->second);
                 }
-                IModel *assetPtr = 0;
-                IRenderEngine *enginePtr = 0;
-                int priority = 0;
-                if (delegateRef->loadModel(uuid, localAssetSettings[uuid], IModel::kAssetModel, assetPtr, enginePtr, priority)) {
-                    assetRefs.insert(std::make_pair(uuid, assetPtr));
-                    sceneRef->addModel(assetPtr, enginePtr, priority);
-                }
+                /* let the delegate start loading while reading the rest of the project */
+                delegateRef->prefetchModel(uuid, localAssetSettings[uuid], IModel::kAssetModel);
+                pendingModels.push_back(std::make_pair(uuid, IModel::kAssetModel));
             }
             else {
                 localAssetSettings.erase(uuid);
@@ -1595,13 +2608,8 @@ struct XMLProject::PrivateContext {
                     sceneRef->removeModel(it->second);
                     internal::deleteObject(it->second);
                 }
-                IModel *modelPtr = 0;
-                IRenderEngine *enginePtr = 0;
-                int priority = 0;
-                if (delegateRef->loadModel(uuid, localModelSettings[uuid], IModel::kPMDModel, modelPtr, enginePtr, priority)) {
-                    modelRefs.insert(std::make_pair(uuid, modelPtr));
-                    sceneRef->addModel(modelPtr, enginePtr, priority);
-                }
+                delegateRef->prefetchModel(uuid, localModelSettings[uuid], IModel::kPMDModel);
+                pendingModels.push_back(std::make_pair(uuid, IModel::kPMDModel));
             }
             else {
                 localModelSettings.erase(uuid);
@@ -1620,10 +2628,8 @@ struct XMLProject::PrivateContext {
                     internal::deleteObject(it->second);
                 }
                 if (!parentModel.empty()) {
-                    ModelMap::const_iterator it2 = modelRefs.find(parentModel);
-                    if (it2 != modelRefs.end()) {
-                        currentMotion->setParentModelRef(it2->second);
-                    }
+                    /* parent model is bound after all models are loaded at resolvePendingModels */
+                    pendingParentModels.push_back(std::make_pair(currentMotion, parentModel));
                 }
                 motionRefs.insert(std::make_pair(uuid, currentMotion));
                 sceneRef->addMotion(currentMotion);
@@ -1647,14 +2653,107 @@ struct XMLProject::PrivateContext {
         const ILight *light = sceneRef->lightRef();
         globalSettings["state.light.color"] = XMLProject::toStringFromVector3(light->color());
         globalSettings["state.light.direction"] = XMLProject::toStringFromVector3(light->direction());
+        binaryChunkWriters.releaseAll();
         bool ret = writeXml(printer);
         if (ret) {
             dirty = false;
         }
+        else {
+            binaryChunkWriters.releaseAll();
+        }
+        return ret;
+    }
+    bool writeBinaryProject(const XMLPrinter &printer, FILE *fp) {
+        /* signature, length prefixed XML document and length prefixed keyframe chunks */
+        const uint32 xmlSize = uint32(printer.CStrSize() - 1);
+        const int nchunks = binaryChunkWriters.count();
+        const uint32 nchunksValue = uint32(nchunks);
+        bool ret = fwrite(kBinaryProjectSignature, 1, kBinaryProjectSignatureSize, fp) == kBinaryProjectSignatureSize &&
+                fwrite(&xmlSize, sizeof(xmlSize), 1, fp) == 1 &&
+                fwrite(printer.CStr(), 1, xmlSize, fp) == xmlSize &&
+                fwrite(&nchunksValue, sizeof(nchunksValue), 1, fp) == 1;
+        for (int i = 0; ret && i < nchunks; i++) {
+            ret = binaryChunkWriters[i]->writeChunk(fp);
+        }
+        binaryChunkWriters.releaseAll();
+        return ret;
+    }
+    static bool isBinaryProject(const uint8 *data, vsize size) {
+        return size >= kBinaryProjectSignatureSize && std::memcmp(data, kBinaryProjectSignature, kBinaryProjectSignatureSize) == 0;
+    }
+    bool readBinaryProject(const uint8 *data, vsize size, const uint8 *&xmlPtr, vsize &xmlSize) {
+        BinaryChunkReader reader(data + kBinaryProjectSignatureSize, size - kBinaryProjectSignatureSize);
+        xmlSize = reader.read<uint32>();
+        xmlPtr = reader.readBytes(xmlSize);
+        const uint32 nchunks = reader.read<uint32>();
+        binaryChunkRefs.clear();
+        for (uint32 i = 0; i < nchunks && reader.isValid(); i++) {
+            const vsize chunkSize = reader.read<uint32>();
+            if (const uint8 *chunkPtr = reader.readBytes(chunkSize)) {
+                binaryChunkRefs.push_back(BinaryChunkRef(chunkPtr, chunkSize));
+            }
+        }
+        return reader.isValid();
+    }
+    bool parseDocument(StreamReader::ISource *source) {
+        /* read the project without building DOM tree and let the delegate load models while reading motions */
+        StreamReader reader(source);
+        bool ret = false;
+        {
+            VPVL2_TRACE_SCOPE("project", "XMLProject::parse");
+            ret = reader.parse(this);
+        }
+        if (!ret) {
+            /* models of the broken document must not be added to the scene */
+            pendingModels.clear();
+            pendingParentModels.clear();
+            binaryChunkRefs.clear();
+            VPVL2_LOG(WARNING, "Cannot load project: line=" << reader.line() << " error=" << reader.errorString());
+            return false;
+        }
+        resolvePendingModels();
+        binaryChunkRefs.clear();
+        ret = validate(ret);
+        if (ret) {
+            sort();
+            restoreStates();
+        }
         return ret;
     }
+    void resolvePendingModels() {
+        VPVL2_TRACE_SCOPE("project", "XMLProject::resolvePendingModels");
+        for (PendingModelList::const_iterator it = pendingModels.begin(); it != pendingModels.end(); ++it) {
+            const XMLProject::UUID &modelUUID = it->first;
+            const bool isAsset = it->second == IModel::kAssetModel;
+            ModelMap &modelMap = isAsset ? assetRefs : modelRefs;
+            /* delete the previous model before assigning to prevent memory leak */
+            ModelMap::iterator it2 = modelMap.find(modelUUID);
+            if (it2 != modelMap.end()) {
+                IModel *previousModel = it2->second;
+                modelMap.erase(it2);
+                sceneRef->removeModel(previousModel);
+                internal::deleteObject(previousModel);
+            }
+            IModel *modelPtr = 0;
+            IRenderEngine *enginePtr = 0;
+            int priority = 0;
+            const StringMap &settings = isAsset ? localAssetSettings[modelUUID] : localModelSettings[modelUUID];
+            if (delegateRef->loadModel(modelUUID, settings, it->second, modelPtr, enginePtr, priority)) {
+                modelMap.insert(std::make_pair(modelUUID, modelPtr));
+                sceneRef->addModel(modelPtr, enginePtr, priority);
+            }
+        }
+        for (PendingParentModelList::const_iterator it = pendingParentModels.begin(); it != pendingParentModels.end(); ++it) {
+            ModelMap::const_iterator it2 = modelRefs.find(it->second);
+            if (it2 != modelRefs.end()) {
+                it->first->setParentModelRef(it2->second);
+            }
+        }
+        pendingModels.clear();
+        pendingParentModels.clear();
+    }
     bool validate(bool result) {
-        return result && depth == 0 && checkDuplicateUUID();
+        return result && depth == 0 && !hasInvalidChunk && checkDuplicateUUID();
     }
     void restoreModelStates(const ModelMap &modelMap, const ModelSettings &settings) {
         std::string value;
@@ -1804,33 +2903,14 @@ struct XMLProject::PrivateContext {
         }
     }
 
-    struct Reader : XMLVisitor {
-        Reader(PrivateContext *context)
-            : contextRef(context)
-        {
-        }
-        ~Reader() {
-            contextRef = 0;
-        }
-
-        bool VisitEnter(const XMLElement &element, const XMLAttribute *firstAttribute) {
-            return contextRef->visitReadEnter(element, firstAttribute);
-        }
-        bool Visit(const XMLText &text) {
-            return contextRef->visitRead(text);
-        }
-        bool VisitExit(const XMLElement &element) {
-            return contextRef->visitReadExit(element);
-        }
-        PrivateContext *contextRef;
-    };
-
     XMLProject::IDelegate *delegateRef;
     Scene *sceneRef;
     Factory *factoryRef;
     ModelMap assetRefs;
     ModelMap modelRefs;
     MotionMap motionRefs;
+    PendingModelList pendingModels;
+    PendingParentModelList pendingParentModels;
     StringMap globalSettings;
     ModelSettings localAssetSettings;
     ModelSettings localModelSettings;
@@ -1842,11 +2922,16 @@ struct XMLProject::PrivateContext {
     IMotion *currentMotion;
     IMotion::Type currentMotionType;
     State state;
+    XMLProject::KeyframeFormat keyframeFormat;
+    BinaryChunkRefList binaryChunkRefs;
+    mutable PointerArray<BinaryChunkWriter> binaryChunkWriters;
     int depth;
     bool dirty;
+    bool hasInvalidChunk;
 };
 
 const std::string XMLProject::PrivateContext::kEmpty = "";
+const uint8 XMLProject::PrivateContext::kBinaryProjectSignature[] = { 'V', 'P', 'V', 'M', 'B', 'I', 'N', 0x01 };
 const XMLProject::UUID XMLProject::kNullUUID = "{00000000-0000-0000-0000-000000000000}";
 const std::string XMLProject::kSettingNameKey = "name";
 const std::string XMLProject::kSettingURIKey = "uri";
@@ -1945,47 +3030,69 @@ XMLProject::~XMLProject()
 
 bool XMLProject::load(const char *path)
 {
-    tinyxml2::XMLDocument document;
     bool ret = false;
-    if (document.LoadFile(path) == XML_NO_ERROR) {
-        PrivateContext::Reader reader(m_context);
-        ret = m_context->validate(document.Accept(&reader));
-        if (ret) {
-            m_context->sort();
-            m_context->restoreStates();
+    if (FILE *fp = fopen(path, "rb")) {
+        uint8 signature[PrivateContext::kBinaryProjectSignatureSize];
+        const vsize nread = fread(signature, 1, sizeof(signature), fp);
+        std::rewind(fp);
+        if (PrivateContext::isBinaryProject(signature, nread)) {
+            /* keyframe chunks are referred while reading the document so binary project is read at once */
+            std::vector<char> bytes;
+            char buffer[StreamReader::kChunkSize];
+            vsize nchunk = 0;
+            while ((nchunk = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+                bytes.insert(bytes.end(), buffer, buffer + nchunk);
+            }
+            ret = load(reinterpret_cast<const uint8 *>(&bytes[0]), bytes.size());
+        }
+        else {
+            VPVL2_TRACE_SCOPE("project", "XMLProject::load");
+            m_context->keyframeFormat = kTextKeyframeFormat;
+            StreamReader::FileSource source(fp);
+            ret = m_context->parseDocument(&source);
         }
+        fclose(fp);
     }
     else {
-        VPVL2_LOG(WARNING, "Cannot load project from file " << path << ": first=" << document.GetErrorStr1() << " second=" << document.GetErrorStr2());
+        VPVL2_LOG(WARNING, "Cannot open project file " << path);
     }
     return ret;
 }
 
 bool XMLProject::load(const uint8 *data, vsize size)
 {
-    tinyxml2::XMLDocument document;
-    bool ret = false;
-    if (document.Parse(reinterpret_cast<const char *>(data), size) == XML_NO_ERROR) {
-        PrivateContext::Reader reader(m_context);
-        ret = m_context->validate(document.Accept(&reader));
-        if (ret) {
-            m_context->sort();
-            m_context->restoreStates();
+    VPVL2_TRACE_SCOPE("project", "XMLProject::load");
+    const uint8 *xmlPtr = data;
+    vsize xmlSize = size;
+    if (PrivateContext::isBinaryProject(data, size)) {
+        if (!m_context->readBinaryProject(data, size, xmlPtr, xmlSize)) {
+            VPVL2_LOG(WARNING, "Cannot load project: keyframe chunks are broken");
+            return false;
         }
+        m_context->keyframeFormat = kBinaryKeyframeFormat;
     }
     else {
-        VPVL2_LOG(WARNING, "Cannot load project from memory: first=" << document.GetErrorStr1() << " second=" << document.GetErrorStr2());
+        m_context->keyframeFormat = kTextKeyframeFormat;
     }
-    return ret;
+    StreamReader::MemorySource source(reinterpret_cast<const char *>(xmlPtr), xmlSize);
+    return m_context->parseDocument(&source);
 }
 
 bool XMLProject::save(const char *path)
 {
-    if (FILE *fp = fopen(path, "w")) {
+    if (m_context->keyframeFormat == kBinaryKeyframeFormat) {
+        if (FILE *fp = fopen(path, "wb")) {
+            /* write XML document to memory first to prefix its length */
+            XMLPrinter printer;
+            bool ret = m_context->save(printer) && m_context->writeBinaryProject(printer, fp);
+            /* buffered data may fail to be flushed on closing */
+            return fclose(fp) == 0 && ret;
+        }
+    }
+    else if (FILE *fp = fopen(path, "w")) {
         XMLPrinter printer(fp);
-        bool ret = m_context->save(printer);
-        fclose(fp);
-        return ret;
+        bool ret = m_context->save(printer) && !ferror(fp);
+        return fclose(fp) == 0 && ret;
     }
     return false;
 }
@@ -1998,6 +3105,16 @@ void XMLProject::clear()
     m_context = new PrivateContext(this, delegateRef, factoryRef);
 }
 
+XMLProject::KeyframeFormat XMLProject::keyframeFormat() const
+{
+    return m_context->keyframeFormat;
+}
+
+void XMLProject::setKeyframeFormat(KeyframeFormat value)
+{
+    m_context->keyframeFormat = value;
+}
+
 std::string XMLProject::version() const
 {
     return m_context->version;
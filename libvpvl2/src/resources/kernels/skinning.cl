@@ -125,3 +125,80 @@ performSkinning2(const __global float *localMatrices,
     }
 }
 
+/*
+ * Skins vertices of all models registered to the scene accelerator in one launch.
+ * Each model occupies a contiguous slice of inVertices/outVertices and of the bone matrices,
+ * modelLayouts holds (strideSize, offsetPosition, offsetNormal, offsetEdgeVertex) in float4 unit,
+ * modelOffsets holds (vertexBase, bufferBase, boneBase, nvertices) and modelParameters holds
+ * (edgeScaleFactor, active) of each model. Vertices are not skinned in place so inVertices
+ * keeps the bind pose (with morphs applied) between frames.
+ */
+__kernel void
+performSkinningBatch(const __global float *localMatrices,
+                     const __global float *boneWeights,
+                     const __global int *boneIndices,
+                     const __global float *materialEdgeSize,
+                     const __global int *vertexModelIndices,
+                     const __global int4 *modelLayouts,
+                     const __global int4 *modelOffsets,
+                     const __global float4 *modelParameters,
+                     const int nvertices,
+                     const __global float4 *inVertices,
+                     __global float4 *outVertices)
+{
+    int id = get_global_id(0);
+    if (id >= nvertices) {
+        return;
+    }
+    const int modelIndex     = vertexModelIndices[id];
+    const float4 parameters  = modelParameters[modelIndex];
+    if (parameters.y == 0.0) {
+        return;
+    }
+    const int4 layout        = modelLayouts[modelIndex];
+    const int4 offsets       = modelOffsets[modelIndex];
+    const int strideOffset   = offsets.y + layout.x * (id - offsets.x);
+    for (int i = 0; i < layout.x; i++) {
+        outVertices[strideOffset + i] = inVertices[strideOffset + i];
+    }
+    const float4 position4   = inVertices[strideOffset + layout.y];
+    const float4 normal4     = inVertices[strideOffset + layout.z];
+    const float edgeSize     = normal4.w * materialEdgeSize[id] * parameters.x;
+    const int4 boneIndex     = vload4(id, boneIndices);
+    const int4 boneOffset    = boneIndex + (int4)(offsets.z);
+    const float4 weight      = vload4(id, boneWeights);
+    const float4 position    = (float4)(position4.xyz, 1.0);
+    const float4 normal      = (float4)(normal4.xyz, 0.0);
+    float4 position2, normal2;
+    if (boneIndex.w >= 0) { // bdef4
+        const float16 transform1 = vload16(boneOffset.x, localMatrices);
+        const float16 transform2 = vload16(boneOffset.y, localMatrices);
+        const float16 transform3 = vload16(boneOffset.z, localMatrices);
+        const float16 transform4 = vload16(boneOffset.w, localMatrices);
+        const float4 v1 = matrixMultVector4(&transform1, &position);
+        const float4 v2 = matrixMultVector4(&transform2, &position);
+        const float4 v3 = matrixMultVector4(&transform3, &position);
+        const float4 v4 = matrixMultVector4(&transform4, &position);
+        const float4 n1 = matrixMultVector3(&transform1, &normal);
+        const float4 n2 = matrixMultVector3(&transform2, &normal);
+        const float4 n3 = matrixMultVector3(&transform3, &normal);
+        const float4 n4 = matrixMultVector3(&transform4, &normal);
+        position2 = fma(weight.x, v1, fma(weight.y, v2, fma(weight.z, v3, weight.w * v4)));
+        normal2   = fma(weight.x, n1, fma(weight.y, n2, fma(weight.z, n3, weight.w * n4)));
+    }
+    else if (boneIndex.y >= 0) { // bdef2 or sdef2
+        const float16 transformA = vload16(boneOffset.x, localMatrices);
+        const float16 transformB = vload16(boneOffset.y, localMatrices);
+        const float w = weight.x, s = 1.0f - w;
+        position2 = fma(s, matrixMultVector4(&transformB, &position), w * matrixMultVector4(&transformA, &position));
+        normal2   = fma(s, matrixMultVector3(&transformB, &normal), w * matrixMultVector3(&transformA, &normal));
+    }
+    else { // bdef1
+        const float16 transform = vload16(boneOffset.x, localMatrices);
+        position2 = matrixMultVector4(&transform, &position);
+        normal2   = matrixMultVector3(&transform, &normal);
+    }
+    outVertices[strideOffset + layout.y] = (float4)(position2.xyz, position4.w);
+    outVertices[strideOffset + layout.z] = (float4)(normal2.xyz, normal4.w);
+    outVertices[strideOffset + layout.w] = (float4)(fma(normal2.xyz, edgeSize, position2.xyz), position4.w);
+}
@@ -79,3 +79,59 @@ TEST(AssetModelTest, OpacityMorph)
     morphRef->setWeight(expected2);
     ASSERT_FLOAT_EQ(expected2, model.opacity());
 }
+
+TEST(AssetModelTest, InstanceTransforms)
+{
+    Encoding::Dictionary dict;
+    Encoding encoding(&dict);
+    asset::Model model(&encoding);
+    ASSERT_EQ(0, model.countInstanceTransforms());
+    Transform transform1(Quaternion::getIdentity(), Vector3(1, 2, 3)),
+            transform2(Quaternion(Vector3(0, 1, 0), btRadians(90)), Vector3(4, 5, 6)),
+            transform3(Quaternion::getIdentity(), Vector3(7, 8, 9));
+    ASSERT_EQ(0, model.addInstanceTransform(transform1));
+    ASSERT_EQ(1, model.addInstanceTransform(transform2));
+    ASSERT_EQ(2, model.addInstanceTransform(transform3));
+    ASSERT_EQ(3, model.countInstanceTransforms());
+    ASSERT_TRUE(CompareVector(transform2.getOrigin(), model.instanceTransformAt(1).getOrigin()));
+    ASSERT_TRUE(CompareVector(transform2.getRotation(), model.instanceTransformAt(1).getRotation()));
+    /* out of bound index is ignored and returns identity */
+    model.setInstanceTransform(3, transform1);
+    ASSERT_EQ(3, model.countInstanceTransforms());
+    ASSERT_TRUE(CompareVector(kZeroV3, model.instanceTransformAt(-1).getOrigin()));
+    model.setInstanceTransform(0, transform3);
+    ASSERT_TRUE(CompareVector(transform3.getOrigin(), model.instanceTransformAt(0).getOrigin()));
+    /* removing keeps the order of the rest */
+    model.removeInstanceTransformAt(1);
+    ASSERT_EQ(2, model.countInstanceTransforms());
+    ASSERT_TRUE(CompareVector(transform3.getOrigin(), model.instanceTransformAt(1).getOrigin()));
+    model.removeAllInstanceTransforms();
+    ASSERT_EQ(0, model.countInstanceTransforms());
+}
+
+TEST(AssetModelTest, Revision)
+{
+    Encoding::Dictionary dict;
+    Encoding encoding(&dict);
+    asset::Model model(&encoding);
+    int revision = model.revision();
+    /* setting the same value does not change the revision */
+    model.setOpacity(model.opacity());
+    model.setVisible(model.isVisible());
+    model.setWorldPositionInternal(model.worldTranslation());
+    ASSERT_EQ(revision, model.revision());
+    model.setOpacity(0.5);
+    ASSERT_GT(model.revision(), revision);
+    revision = model.revision();
+    model.setWorldPositionInternal(Vector3(1, 2, 3));
+    ASSERT_GT(model.revision(), revision);
+    revision = model.revision();
+    model.setWorldRotationInternal(Quaternion(Vector3(0, 1, 0), btRadians(45)));
+    ASSERT_GT(model.revision(), revision);
+    revision = model.revision();
+    model.addInstanceTransform(Transform::getIdentity());
+    ASSERT_GT(model.revision(), revision);
+    revision = model.revision();
+    model.removeAllInstanceTransforms();
+    ASSERT_GT(model.revision(), revision);
+}
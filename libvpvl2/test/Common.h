@@ -5,6 +5,7 @@
 #include <gmock/gmock.h>
 #include <QtCore>
 #include <vpvl2/Common.h>
+#include <vpvl2/IDataSink.h>
 
 #define ASSERT_OR_RETURN(expr) do { AssertionResult r = (expr); if (!r) { return r; } } while (0)
 
@@ -69,6 +70,15 @@ static const float kEpsilon = 0.000001;
 
 void AssertMatrix(const float *expected, const float *actual);
 
+class ByteArrayDataSink : public vpvl2::IDataSink {
+public:
+    bool write(const vpvl2::uint8 *data, vpvl2::vsize size) {
+        bytes.append(reinterpret_cast<const char *>(data), int(size));
+        return true;
+    }
+    QByteArray bytes;
+};
+
 struct ScopedPointerListDeleter {
     template<typename T>
     static inline void cleanup(vpvl2::Array<T *> *list) {
@@ -166,5 +166,86 @@ TEST(EncodingTest, ConvertNullToByteArray)
     encoding.disposeByteArray(result);
 }
 
+TEST_P(ConvertTest, DecodeASCIIWithoutConverter)
+{
+    Encoding encoding(0);
+    const IString::Codec codecEnum = GetParam();
+    const QString source(" center\x1a"), expected("center");
+    const QTextCodec *codec = QTextCodec::codecForName(GetCodecString(codecEnum));
+    const QByteArray &bytes = codec->fromUnicode(source);
+    const uint8 *stringInBytes = reinterpret_cast<const uint8 *>(bytes.constData());
+    QScopedPointer<IString> result(encoding.toString(stringInBytes, bytes.length(), codecEnum));
+    ASSERT_STREQ(expected.toUtf8().constData(), String::toStdString(TO_CSTRING(result)->value()).c_str());
+    ASSERT_STREQ(expected.toUtf8().constData(), TO_BYTES(result));
+    const Encoding::DecodeStatistics &statistics = encoding.decodeStatistics();
+    ASSERT_EQ(vsize(1), statistics.numASCIIDecodes);
+    ASSERT_EQ(vsize(0), statistics.numConverterDecodes);
+}
+
+TEST_P(ConvertTest, DecodeCache)
+{
+    Encoding encoding(0);
+    const IString::Codec codecEnum = GetParam();
+    const QString source("センター");
+    const QTextCodec *codec = QTextCodec::codecForName(GetCodecString(codecEnum));
+    const QByteArray &bytes = codec->fromUnicode(source);
+    const uint8 *stringInBytes = reinterpret_cast<const uint8 *>(bytes.constData());
+    QScopedPointer<IString> first(encoding.toString(stringInBytes, bytes.length(), codecEnum));
+    QScopedPointer<IString> second(encoding.toString(stringInBytes, bytes.length(), codecEnum));
+    /* cached string must be a distinct instance with the same value */
+    ASSERT_NE(first.data(), second.data());
+    ASSERT_TRUE(first->equals(second.data()));
+    ASSERT_STREQ(TO_BYTES(first), TO_BYTES(second));
+    Encoding::DecodeStatistics statistics = encoding.decodeStatistics();
+    ASSERT_EQ(vsize(1), statistics.numConverterDecodes);
+    ASSERT_EQ(vsize(1), statistics.numCacheHits);
+    ASSERT_EQ(vsize(1), statistics.numCacheMisses);
+    /* cache is bounded by the capacity */
+    encoding.setDecodeCacheCapacity(1);
+    encoding.resetDecodeStatistics();
+    const uint8 other[] = "other";
+    QScopedPointer<IString> third(encoding.toString(stringInBytes, bytes.length(), codecEnum));
+    QScopedPointer<IString> fourth(encoding.toString(other, sizeof(other) - 1, codecEnum));
+    QScopedPointer<IString> fifth(encoding.toString(stringInBytes, bytes.length(), codecEnum));
+    statistics = encoding.decodeStatistics();
+    ASSERT_EQ(vsize(0), statistics.numCacheHits);
+    ASSERT_EQ(vsize(3), statistics.numCacheMisses);
+    ASSERT_EQ(vsize(2), statistics.numCacheEvictions);
+    /* capacity 0 disables the cache */
+    encoding.setDecodeCacheCapacity(0);
+    encoding.resetDecodeStatistics();
+    QScopedPointer<IString> sixth(encoding.toString(stringInBytes, bytes.length(), codecEnum));
+    statistics = encoding.decodeStatistics();
+    ASSERT_EQ(vsize(0), statistics.numCacheHits);
+    ASSERT_EQ(vsize(0), statistics.numCacheMisses);
+}
+
+TEST(EncodingTest, DecodeUTF16LE)
+{
+    Encoding encoding(0);
+    encoding.setDecodeCacheCapacity(0);
+    const QTextCodec *codec = QTextCodec::codecForName("UTF-16LE");
+    /* ASCII only input is decoded without the converter */
+    const QString ascii(" center\x1a"), asciiExpected("center");
+    const QByteArray &asciiBytes = codec->fromUnicode(ascii);
+    QScopedPointer<IString> asciiResult(encoding.toString(reinterpret_cast<const uint8 *>(asciiBytes.constData()),
+                                                          asciiBytes.length(), IString::kUTF16));
+    ASSERT_STREQ(asciiExpected.toUtf8().constData(), String::toStdString(TO_CSTRING(asciiResult)->value()).c_str());
+    ASSERT_STREQ(asciiExpected.toUtf8().constData(), TO_BYTES(asciiResult));
+    Encoding::DecodeStatistics statistics = encoding.decodeStatistics();
+    ASSERT_EQ(vsize(1), statistics.numASCIIDecodes);
+    ASSERT_EQ(vsize(0), statistics.numConverterDecodes);
+    /* the low byte of U+3041 is 'A' so the high byte must be checked to reject the fast path */
+    const QString nonASCII = QString::fromUtf8("センターぁA");
+    const QByteArray &nonASCIIBytes = codec->fromUnicode(nonASCII);
+    QScopedPointer<IString> nonASCIIResult(encoding.toString(reinterpret_cast<const uint8 *>(nonASCIIBytes.constData()),
+                                                             nonASCIIBytes.length(), IString::kUTF16));
+    ASSERT_STREQ(nonASCII.toUtf8().constData(), String::toStdString(TO_CSTRING(nonASCIIResult)->value()).c_str());
+    ASSERT_STREQ(nonASCII.toUtf8().constData(), TO_BYTES(nonASCIIResult));
+    statistics = encoding.decodeStatistics();
+    ASSERT_EQ(vsize(1), statistics.numASCIIDecodes);
+    ASSERT_EQ(vsize(1), statistics.numConverterDecodes);
+}
+
 // skip IString::kUTF16
 INSTANTIATE_TEST_CASE_P(EncodingInstance, ConvertTest, Values(IString::kShiftJIS, IString::kUTF8));
@@ -1,4 +1,7 @@
 #include "Common.h"
+#include "vpvl2/FrameProfiler.h"
+#include "vpvl2/IDataSink.h"
+#include "vpvl2/Tracer.h"
 #include "vpvl2/extensions/icu4c/String.h"
 #include "vpvl2/internal/MotionHelper.h"
 #include "vpvl2/internal/util.h"
@@ -244,3 +247,125 @@ TEST(InternalTest, ToggleFlag)
     vpvl2::internal::toggleFlag(0x0400, false, flag);
     ASSERT_EQ(0x0000, int(flag));
 }
+
+TEST(TracerTest, RecordNestedScopes)
+{
+    Tracer tracer;
+    ASSERT_EQ(static_cast<Tracer *>(0), Tracer::currentTracerRef());
+    {
+        /* not recorded because the tracer is not attached yet */
+        Tracer::Scope scope("test", "ignored");
+    }
+    tracer.attach();
+    ASSERT_EQ(&tracer, Tracer::currentTracerRef());
+    {
+        Tracer::Scope outer("test", "outer");
+        Tracer::count(Tracer::kParsedObjectCounter, 3);
+        {
+            Tracer::Scope inner("test", "inner");
+            Tracer::count(Tracer::kStringConversionCounter, 2);
+        }
+    }
+    tracer.detach();
+    ASSERT_EQ(static_cast<Tracer *>(0), Tracer::currentTracerRef());
+    Tracer::count(Tracer::kParsedObjectCounter, 42);
+    ASSERT_EQ(2, tracer.countEvents());
+    const Tracer::Event &outer = tracer.eventAt(0), &inner = tracer.eventAt(1);
+    ASSERT_STREQ("outer", outer.name);
+    ASSERT_EQ(0, outer.depth);
+    ASSERT_EQ(vsize(3), outer.counters[Tracer::kParsedObjectCounter]);
+    ASSERT_EQ(vsize(2), outer.counters[Tracer::kStringConversionCounter]);
+    ASSERT_STREQ("inner", inner.name);
+    ASSERT_EQ(1, inner.depth);
+    ASSERT_EQ(vsize(0), inner.counters[Tracer::kParsedObjectCounter]);
+    ASSERT_EQ(vsize(2), inner.counters[Tracer::kStringConversionCounter]);
+    ASSERT_GE(inner.timestamp, outer.timestamp);
+    ASSERT_LE(inner.duration, outer.duration);
+    ASSERT_EQ(vsize(3), tracer.counter(Tracer::kParsedObjectCounter));
+    tracer.clear();
+    ASSERT_EQ(0, tracer.countEvents());
+    ASSERT_EQ(vsize(0), tracer.counter(Tracer::kParsedObjectCounter));
+}
+
+TEST(TracerTest, WriteChromeTraceEvents)
+{
+    Tracer tracer;
+    tracer.endEvent(tracer.beginEvent("test", "quoted \"name\""));
+    ByteArrayDataSink sink;
+    ASSERT_TRUE(tracer.writeChromeTraceEvents(&sink));
+    const QByteArray &bytes = sink.bytes;
+    ASSERT_TRUE(bytes.startsWith("{\"traceEvents\":["));
+    ASSERT_TRUE(bytes.contains("\"cat\":\"test\""));
+    ASSERT_TRUE(bytes.contains("\"name\":\"quoted \\\"name\\\"\""));
+    ASSERT_TRUE(bytes.contains("\"ph\":\"X\""));
+    ASSERT_TRUE(bytes.contains("\"args\":{\"parsedObjects\":0,\"stringConversions\":0}"));
+    ASSERT_TRUE(bytes.trimmed().endsWith("}"));
+}
+
+TEST(FrameProfilerTest, RecordStagesInFrame)
+{
+    FrameProfiler profiler(4);
+    ASSERT_EQ(static_cast<FrameProfiler *>(0), FrameProfiler::currentProfilerRef());
+    profiler.attach();
+    ASSERT_EQ(&profiler, FrameProfiler::currentProfilerRef());
+    {
+        /* not recorded because no frame is begun */
+        FrameProfiler::Scope scope(FrameProfiler::kDrawStage);
+        FrameProfiler::count(FrameProfiler::kDrawCallCounter, 1);
+    }
+    ASSERT_FALSE(profiler.isInFrame());
+    profiler.beginFrame();
+    ASSERT_TRUE(profiler.isInFrame());
+    {
+        FrameProfiler::Scope outer(FrameProfiler::kBoneTransformStage);
+        {
+            FrameProfiler::Scope inner(FrameProfiler::kIKStage);
+            FrameProfiler::count(FrameProfiler::kDrawCallCounter, 2);
+        }
+        FrameProfiler::Scope inner(FrameProfiler::kIKStage);
+    }
+    profiler.endFrame();
+    profiler.detach();
+    ASSERT_EQ(static_cast<FrameProfiler *>(0), FrameProfiler::currentProfilerRef());
+    ASSERT_EQ(1, profiler.countFrames());
+    const FrameProfiler::Frame &frame = profiler.frameAt(0);
+    ASSERT_EQ(uint64(0), frame.index);
+    ASSERT_EQ(1, frame.stageCalls[FrameProfiler::kBoneTransformStage]);
+    ASSERT_EQ(2, frame.stageCalls[FrameProfiler::kIKStage]);
+    ASSERT_EQ(0, frame.stageCalls[FrameProfiler::kDrawStage]);
+    ASSERT_EQ(vsize(2), frame.counters[FrameProfiler::kDrawCallCounter]);
+    /* stage durations are exclusive so the sum never exceeds the frame duration */
+    uint64 total = 0;
+    for (int i = 0; i < FrameProfiler::kMaxStage; i++) {
+        total += frame.stageDurations[i];
+    }
+    ASSERT_LE(total, frame.duration);
+    ASSERT_STREQ("IK", FrameProfiler::stageName(FrameProfiler::kIKStage));
+}
+
+TEST(FrameProfilerTest, KeepLatestFramesInRingBuffer)
+{
+    FrameProfiler profiler(3);
+    profiler.attach();
+    for (int i = 0; i < 5; i++) {
+        profiler.beginFrame();
+        FrameProfiler::count(FrameProfiler::kUpdatedModelCounter, i);
+        profiler.endFrame();
+    }
+    ASSERT_EQ(3, profiler.capacity());
+    ASSERT_EQ(3, profiler.countFrames());
+    for (int i = 0; i < 3; i++) {
+        const FrameProfiler::Frame &frame = profiler.frameAt(i);
+        ASSERT_EQ(uint64(i + 2), frame.index);
+        ASSERT_EQ(vsize(i + 2), frame.counters[FrameProfiler::kUpdatedModelCounter]);
+    }
+    ASSERT_LE(profiler.frameAt(1).timestamp, profiler.frameAt(2).timestamp);
+    /* beginFrame without endFrame closes the previous frame */
+    profiler.beginFrame();
+    profiler.beginFrame();
+    profiler.endFrame();
+    ASSERT_EQ(uint64(6), profiler.frameAt(2).index);
+    profiler.clear();
+    ASSERT_EQ(0, profiler.countFrames());
+    ASSERT_EQ(uint64(0), profiler.averageStageDuration(FrameProfiler::kDrawStage));
+}
@@ -965,6 +965,49 @@ TEST_P(PMXFragmentTest, ReadWriteVertexSdef)
     ASSERT_TRUE(CompareVertex(expected, actual, bones));
 }
 
+TEST_P(PMXFragmentTest, ReadVertices)
+{
+    const Vertex::Type types[] = { Vertex::kBdef1, Vertex::kBdef2, Vertex::kBdef4, Vertex::kSdef };
+    const int nbonesOfType[] = { 1, 2, 4, 2 };
+    vsize indexSize = GetParam();
+    Bone bone1(0), bone2(0), bone3(0), bone4(0);
+    Bone *allBones[] = { &bone1, &bone2, &bone3, &bone4 };
+    for (int i = 0; i < 4; i++) {
+        allBones[i]->setIndex(i);
+    }
+    for (int i = 0; i < 4; i++) {
+        Array<Bone *> bones;
+        for (int j = 0; j < nbonesOfType[i]; j++) {
+            bones.append(allBones[j]);
+        }
+        Vertex expected(0);
+        SetVertex(expected, types[i], bones);
+        /* records with and without additional UVs share the same parser */
+        for (vsize additionalUVSize = 0; additionalUVSize <= 2; additionalUVSize += 2) {
+            Model::DataInfo info;
+            info.additionalUVSize = additionalUVSize;
+            info.boneIndexSize = indexSize;
+            const int nvertices = 3;
+            vsize size = expected.estimateSize(info) * nvertices;
+            QScopedArrayPointer<uint8> bytes(new uint8[size]);
+            uint8 *ptr = bytes.data();
+            for (int j = 0; j < nvertices; j++) {
+                expected.write(ptr, info);
+            }
+            ASSERT_EQ(size, vsize(ptr - bytes.data()));
+            info.verticesPtr = bytes.data();
+            info.verticesCount = nvertices;
+            PointerArray<Vertex> vertices;
+            Vertex::readVertices(info, 0, vertices);
+            ASSERT_EQ(nvertices, vertices.count());
+            for (int j = 0; j < nvertices; j++) {
+                ASSERT_TRUE(CompareVertex(expected, *vertices[j], bones));
+            }
+            vertices.releaseAll();
+        }
+    }
+}
+
 TEST_P(PMXFragmentWithUVTest, ReadWriteUVMorph)
 {
     vsize indexSize = get<0>(GetParam());
@@ -1739,6 +1782,123 @@ TEST(PMXModelTest, AddAndRemoveVertex)
     ASSERT_EQ(0, model.vertices().count());
 }
 
+TEST(PMXModelTest, SaveToDataSink)
+{
+    Encoding encoding(0);
+    Model model(&encoding);
+    QScopedPointer<IBone> bone(model.createBone());
+    QScopedPointer<IVertex> vertex1(model.createVertex()), vertex2(model.createVertex());
+    vertex1->setOrigin(Vector3(1, 2, 3));
+    vertex2->setOrigin(Vector3(4, 5, 6));
+    model.addBone(bone.data());
+    model.addVertex(vertex1.data());
+    model.addVertex(vertex2.data());
+    vsize written = 0;
+    QByteArray expected(model.estimateSize(), 0);
+    model.save(reinterpret_cast<uint8 *>(expected.data()), written);
+    ByteArrayDataSink sink;
+    ASSERT_TRUE(model.save(&sink));
+    ASSERT_EQ(int(written), sink.bytes.size());
+    ASSERT_EQ(expected.left(int(written)), sink.bytes);
+    Model model2(&encoding);
+    ASSERT_TRUE(model2.load(reinterpret_cast<const uint8 *>(sink.bytes.constData()), sink.bytes.size()));
+    ASSERT_EQ(2, model2.vertices().count());
+    ASSERT_EQ(1, model2.bones().count());
+    ASSERT_TRUE(CompareVector(Vector3(4, 5, 6), model2.vertices()[1]->origin()));
+    model.removeVertex(vertex1.data());
+    model.removeVertex(vertex2.data());
+    model.removeBone(bone.data());
+}
+
+TEST(PMXModelTest, ClampMaxBonesPerDraw)
+{
+    Encoding encoding(0);
+    Model model(&encoding);
+    ASSERT_EQ(int(Model::kDefaultMaxBonesPerDraw), model.maxBonesPerDraw());
+    model.setMaxBonesPerDraw(16);
+    ASSERT_EQ(16, model.maxBonesPerDraw());
+    model.setMaxBonesPerDraw(Model::kMaxBonesPerDraw + 1);
+    ASSERT_EQ(int(Model::kMaxBonesPerDraw), model.maxBonesPerDraw());
+    model.setMaxBonesPerDraw(1024);
+    ASSERT_EQ(int(Model::kMaxBonesPerDraw), model.maxBonesPerDraw());
+    model.setMaxBonesPerDraw(0);
+    ASSERT_GT(model.maxBonesPerDraw(), 0);
+    ASSERT_LT(model.maxBonesPerDraw(), int(Model::kMaxBonesPerDraw));
+}
+
+TEST(PMXModelTest, SplitMaterialIntoBonePalettes)
+{
+    Encoding encoding(0);
+    Model model(&encoding);
+    model.setMaxBonesPerDraw(16);
+    const int nbones = 64, nvertices = 256;
+    Array<IBone *> bones;
+    for (int i = 0; i < nbones; i++) {
+        IBone *bone = model.createBone();
+        model.addBone(bone);
+        bone->setLocalTransform(Transform(Matrix3x3::getIdentity(), Vector3(Scalar(bone->index()), 0, 0)));
+        bones.append(bone);
+    }
+    for (int i = 0; i < nvertices; i++) {
+        IVertex *vertex = model.createVertex();
+        vertex->setType(IVertex::kBdef2);
+        vertex->setBoneRef(0, bones[(i / 2) % nbones]);
+        vertex->setBoneRef(1, bones[(i / 2 + 1) % nbones]);
+        vertex->setWeight(0, 0.5);
+        model.addVertex(vertex);
+    }
+    Array<int> indices;
+    for (int i = 0; i < nvertices - 2; i++) {
+        indices.append(i);
+        indices.append(i + 1);
+        indices.append(i + 2);
+    }
+    model.setIndices(indices);
+    IMaterial *material = model.createMaterial();
+    IMaterial::IndexRange range;
+    range.count = indices.count();
+    material->setIndexRange(range);
+    model.addMaterial(material);
+    IModel::IndexBuffer *indexBuffer = 0;
+    IModel::StaticVertexBuffer *staticBuffer = 0;
+    IModel::DynamicVertexBuffer *dynamicBuffer = 0;
+    IModel::MatrixBuffer *matrixBuffer = 0;
+    model.getIndexBuffer(indexBuffer);
+    model.getStaticVertexBuffer(staticBuffer);
+    model.getDynamicVertexBuffer(dynamicBuffer, indexBuffer);
+    model.getMatrixBuffer(matrixBuffer, dynamicBuffer, indexBuffer);
+    ASSERT_TRUE(matrixBuffer);
+    const int nsubsets = matrixBuffer->countSubsets(0);
+    ASSERT_GT(nsubsets, 1);
+    QByteArray bytes(int(staticBuffer->size()), 0);
+    staticBuffer->update(bytes.data());
+    const vsize stride = staticBuffer->strideSize(),
+            offset = staticBuffer->strideOffset(IModel::StaticVertexBuffer::kBonePaletteIndexStride);
+    int indexOffset = 0;
+    for (int i = 0; i < nsubsets; i++) {
+        const int nindices = matrixBuffer->indexCount(0, i);
+        const int nmatrices = int(matrixBuffer->size(0, i));
+        const float32 *matrices = matrixBuffer->bytes(0, i);
+        ASSERT_LE(nmatrices, model.maxBonesPerDraw());
+        for (int j = indexOffset; j < indexOffset + nindices; j++) {
+            const int vertexIndex = indices[j];
+            const Scalar *slots = reinterpret_cast<const Scalar *>(bytes.constData() + stride * vertexIndex + offset);
+            for (int k = 0; k < 2; k++) {
+                const int slot = int(slots[k]);
+                ASSERT_LT(slot, nmatrices);
+                /* the translation of the matrix in the palette slot must belong to the vertex bone */
+                ASSERT_FLOAT_EQ(Scalar(model.vertices()[vertexIndex]->boneRef(k)->index()), matrices[slot * 16 + 12]);
+            }
+        }
+        indexOffset += nindices;
+    }
+    ASSERT_EQ(indices.count(), indexOffset);
+    delete matrixBuffer;
+    delete dynamicBuffer;
+    delete staticBuffer;
+    delete indexBuffer;
+}
+
 TEST(PMXModelTest, ParseEmpty)
 {
     Encoding encoding(0);
@@ -86,6 +86,28 @@ private:
     Factory m_factory;
 };
 
+class PrefetchDelegate : public Delegate
+{
+public:
+    PrefetchDelegate()
+        : Delegate(),
+          m_nloaded(0)
+    {
+    }
+
+    bool loadModel(const XMLProject::UUID &uuid, const XMLProject::StringMap &settings, IModel::Type type, IModel *&model, IRenderEngine *&engine, int &priority) {
+        m_nloadedAtPrefetch.append(m_prefetched.count());
+        m_nloaded++;
+        return Delegate::loadModel(uuid, settings, type, model, engine, priority);
+    }
+    void prefetchModel(const XMLProject::UUID &uuid, const XMLProject::StringMap & /* settings */, IModel::Type /* type */) {
+        m_prefetched.append(uuid);
+    }
+
+    QList<XMLProject::UUID> m_prefetched;
+    QList<int> m_nloadedAtPrefetch;
+    int m_nloaded;
+};
 
 static void TestGlobalSettings(const XMLProject &project)
 {
@@ -365,6 +387,51 @@ TEST(ProjectTest, Load)
     TestMorphMotion(motion3);
 }
 
+TEST(ProjectTest, PrefetchModelsBeforeLoading)
+{
+    PrefetchDelegate delegate;
+    Encoding encoding(0);
+    Factory factory(&encoding);
+    XMLProject project(&delegate, &factory, true);
+    ASSERT_TRUE(project.load("../../docs/project.xml"));
+    /* all models and assets except null UUID should be prefetched before loading any of them */
+    ASSERT_EQ(delegate.m_prefetched.count(), delegate.m_nloaded);
+    ASSERT_TRUE(delegate.m_prefetched.contains(kModel1UUID));
+    ASSERT_TRUE(delegate.m_prefetched.contains(kModel2UUID));
+    ASSERT_TRUE(delegate.m_prefetched.contains(kAsset1UUID));
+    ASSERT_TRUE(delegate.m_prefetched.contains(kAsset2UUID));
+    foreach (int nprefetched, delegate.m_nloadedAtPrefetch) {
+        ASSERT_EQ(delegate.m_prefetched.count(), nprefetched);
+    }
+    ASSERT_EQ(project.findModel(kModel1UUID), project.findMotion(kMotion1UUID)->parentModelRef());
+    ASSERT_EQ(project.findModel(kAsset2UUID), project.findMotion(kMotion3UUID)->parentModelRef());
+}
+
+TEST(ProjectTest, LoadFromMemory)
+{
+    Delegate delegate;
+    Encoding encoding(0);
+    Factory factory(&encoding);
+    XMLProject project(&delegate, &factory, true);
+    const char kProject[] =
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<!-- comment -->\n"
+            "<vpvm:project version=\"0.1\" xmlns:vpvm=\"https://github.com/hkrn/MMDAI/\">\n"
+            " <vpvm:settings>\n"
+            "  <vpvm:value name=\"title\">foo &amp; bar &#x41;&#66;</vpvm:value>\n"
+            "  <vpvm:value name=\'width\'><![CDATA[<640>]]></vpvm:value>\n"
+            " </vpvm:settings>\n"
+            "</vpvm:project>\n";
+    ASSERT_TRUE(project.load(reinterpret_cast<const uint8 *>(kProject), sizeof(kProject) - 1));
+    ASSERT_STREQ("0.1", project.version().c_str());
+    ASSERT_STREQ("foo & bar AB", project.globalSetting("title").c_str());
+    ASSERT_STREQ("<640>", project.globalSetting("width").c_str());
+    /* mismatched end tag must be rejected */
+    const char kBrokenProject[] = "<vpvm:project version=\"0.1\"><vpvm:settings></vpvm:project>";
+    XMLProject project2(&delegate, &factory, true);
+    ASSERT_FALSE(project2.load(reinterpret_cast<const uint8 *>(kBrokenProject), sizeof(kBrokenProject) - 1));
+}
+
 TEST(ProjectTest, Save)
 {
     Delegate delegate;
@@ -417,6 +484,66 @@ TEST(ProjectTest, Save)
     TestMorphMotion(motion3);
 }
 
+#ifdef Q_OS_LINUX
+TEST(ProjectTest, SaveBinaryKeyframesToFullDevice)
+{
+    Delegate delegate;
+    Encoding encoding(0);
+    Factory factory(&encoding);
+    XMLProject project(&delegate, &factory, true);
+    ASSERT_TRUE(project.load("../../docs/project.xml"));
+    project.setKeyframeFormat(XMLProject::kBinaryKeyframeFormat);
+    /* writing to /dev/full always fails with ENOSPC */
+    ASSERT_FALSE(project.save("/dev/full"));
+    project.setKeyframeFormat(XMLProject::kTextKeyframeFormat);
+    ASSERT_FALSE(project.save("/dev/full"));
+}
+#endif
+
+TEST(ProjectTest, SaveBinaryKeyframes)
+{
+    Delegate delegate;
+    Encoding encoding(0);
+    Factory factory(&encoding);
+    XMLProject project(&delegate, &factory, true);
+    ASSERT_TRUE(project.load("../../docs/project.xml"));
+    ASSERT_EQ(XMLProject::kTextKeyframeFormat, project.keyframeFormat());
+    QTemporaryFile file;
+    file.open();
+    file.setAutoRemove(true);
+    project.setKeyframeFormat(XMLProject::kBinaryKeyframeFormat);
+    ASSERT_TRUE(project.save(file.fileName().toUtf8()));
+    XMLProject project2(&delegate, &factory, true);
+    ASSERT_TRUE(project2.load(file.fileName().toUtf8()));
+    /* format should be detected automatically */
+    ASSERT_EQ(XMLProject::kBinaryKeyframeFormat, project2.keyframeFormat());
+    ASSERT_EQ(vsize(4), project2.modelUUIDs().size());
+    ASSERT_EQ(vsize(3), project2.motionUUIDs().size());
+    TestGlobalSettings(project2);
+    TestLocalSettings(project2);
+    IMotion *motion = project2.findMotion(kMotion1UUID);
+    ASSERT_EQ(project2.findModel(kModel1UUID), motion->parentModelRef());
+    TestBoneMotion(motion, false);
+    TestMorphMotion(motion);
+    TestCameraMotion(motion, false);
+    TestLightMotion(motion);
+    IMotion *motion2 = project2.findMotion(kMotion2UUID);
+    ASSERT_EQ(project2.findModel(kModel2UUID), motion2->parentModelRef());
+    TestBoneMotion(motion2, true);
+    TestMorphMotion(motion2);
+    TestCameraMotion(motion2, true);
+    TestLightMotion(motion2);
+    TestEffectMotion(motion2);
+    TestModelMotion(motion2);
+    TestProjectMotion(motion2);
+    /* truncated keyframe chunks must be rejected */
+    QFile input(file.fileName());
+    ASSERT_TRUE(input.open(QFile::ReadOnly));
+    const QByteArray &bytes = input.readAll();
+    XMLProject project3(&delegate, &factory, true);
+    ASSERT_FALSE(project3.load(reinterpret_cast<const uint8 *>(bytes.constData()), bytes.size() - 4));
+}
+
 TEST(ProjectTest, HandleAssets)
 {
     const QString &uuid = QUuid::createUuid().toString();
@@ -32,6 +32,25 @@ struct MockResolver : IApplicationContext::FunctionResolver {
     int query(QueryType /* type */) const { return 0; }
 } g_resolver;
 
+static int g_nstateCalls = 0;
+
+static void GLAPIENTRY countStateCall(extensions::gl::GLenum /* value */)
+{
+    g_nstateCalls++;
+}
+
+struct StateCountingResolver : IApplicationContext::FunctionResolver {
+    bool hasExtension(const char * /* name */) const { return false; }
+    void *resolveSymbol(const char *name) const {
+        const QByteArray symbol(name);
+        if (symbol == "glEnable" || symbol == "glDisable" || symbol == "glCullFace") {
+            return reinterpret_cast<void *>(&countStateCall);
+        }
+        return 0;
+    }
+    int query(QueryType /* type */) const { return 0; }
+};
+
 TEST(SceneTest, AddModel)
 {
     Array<IModel *> models;
@@ -582,6 +601,57 @@ TEST(SceneTest, CreateRenderEngine)
     ASSERT_EQ(static_cast<IRenderEngine *>(0), scene.createRenderEngine(&applicationContext, 0, 0));
 }
 
+TEST(SceneTest, ShareResourcesRequiresUploadedSource)
+{
+    Scene scene(true);
+    Encoding encoding(0);
+    MockIApplicationContext applicationContext;
+    EXPECT_CALL(applicationContext, sharedFunctionResolverInstance()).Times(AnyNumber()).WillRepeatedly(Return(&g_resolver));
+    pmx::Model sourceModel(&encoding), model(&encoding);
+    QScopedPointer<IRenderEngine> sourceEngine(scene.createRenderEngine(&applicationContext, &sourceModel, 0));
+    QScopedPointer<IRenderEngine> engine(scene.createRenderEngine(&applicationContext, &model, 0));
+    gl2::PMXRenderEngine *sourceEngineRef = dynamic_cast<gl2::PMXRenderEngine *>(sourceEngine.data());
+    gl2::PMXRenderEngine *engineRef = dynamic_cast<gl2::PMXRenderEngine *>(engine.data());
+    ASSERT_TRUE(sourceEngineRef);
+    ASSERT_TRUE(engineRef);
+    ASSERT_FALSE(engineRef->shareResources(0));
+    ASSERT_FALSE(engineRef->shareResources(engineRef));
+    /* the source engine is not uploaded yet */
+    ASSERT_FALSE(engineRef->shareResources(sourceEngineRef));
+    ASSERT_FALSE(engineRef->isResourceShared());
+    ASSERT_NE(sourceEngineRef->batchKey(), engineRef->batchKey());
+}
+
+TEST(SceneTest, CountSavedStateChangesOfBatchRenderer)
+{
+    StateCountingResolver resolver;
+    gl2::BatchRenderer::State state(&resolver);
+    g_nstateCalls = 0;
+    state.begin();
+    /* shadow passes of two engines that disable and enable culling without the batch */
+    for (int i = 0; i < 2; i++) {
+        state.addUnbatchedStateChanges(2);
+        state.setCullFaceEnable(false);
+        state.setBlendEnable(true);
+    }
+    state.end();
+    ASSERT_EQ(2, g_nstateCalls);
+    ASSERT_EQ(2, state.countStateChanges());
+    ASSERT_EQ(2, state.countSavedStateChanges());
+    /* calls that are also skipped without the batch are not saved */
+    g_nstateCalls = 0;
+    state.begin();
+    for (int i = 0; i < 3; i++) {
+        state.setCullFaceEnable(true);
+        state.setCullFaceMode(0x0405 /* GL_BACK */);
+        state.setBlendEnable(true);
+    }
+    state.end();
+    ASSERT_EQ(0, g_nstateCalls);
+    ASSERT_EQ(0, state.countStateChanges());
+    ASSERT_EQ(0, state.countSavedStateChanges());
+}
+
 TEST(SceneModel, HandleDefaultCamera)
 {
     Scene scene(true);
@@ -69,6 +69,43 @@ static void CompareCameraInterpolationMatrix(const QuadWord p[], const vmd::Came
     ASSERT_TRUE(CompareVector(expected, actual));
 }
 
+class AppendBoneRef {
+public:
+    AppendBoneRef(IBone *bone) : m_bone(bone) {}
+    void operator()(Array<IBone *> &bones) const { bones.append(m_bone); }
+private:
+    IBone *m_bone;
+};
+
+static void AddBoneKeyframe(vmd::Motion &motion, Encoding *encoding, const IString *name,
+                            const IKeyframe::TimeIndex &timeIndex, const Vector3 &translation)
+{
+    QScopedPointer<IBoneKeyframe> keyframe(new vmd::BoneKeyframe(encoding));
+    keyframe->setTimeIndex(timeIndex);
+    keyframe->setName(name);
+    keyframe->setDefaultInterpolationParameter();
+    keyframe->setLocalTranslation(translation);
+    motion.addKeyframe(keyframe.take());
+}
+
+/*
+ * Makes the model have only the bone and the motion translate it to (10, 20, 30) at lastTimeIndex,
+ * starting from the origin at time index 0 when lastTimeIndex is greater than 0.
+ */
+static void SetupSingleBoneMotion(MockIModel &model, MockIBone &bone, vmd::Motion &motion,
+                                  Encoding *encoding, const IString *name, const IKeyframe::TimeIndex &lastTimeIndex)
+{
+    EXPECT_CALL(model, findBoneRef(_)).Times(AnyNumber()).WillRepeatedly(Return(&bone));
+    EXPECT_CALL(model, findBoneRefAt(0)).Times(AnyNumber()).WillRepeatedly(Return(&bone));
+    EXPECT_CALL(model, getBoneRefs(_)).Times(AnyNumber()).WillRepeatedly(Invoke(AppendBoneRef(&bone)));
+    EXPECT_CALL(bone, index()).Times(AnyNumber()).WillRepeatedly(Return(0));
+    if (lastTimeIndex > 0) {
+        AddBoneKeyframe(motion, encoding, name, 0, kZeroV3);
+    }
+    AddBoneKeyframe(motion, encoding, name, lastTimeIndex, Vector3(10, 20, 30));
+    motion.update(IKeyframe::kBoneKeyframe);
+}
+
 }
 
 TEST(VMDMotionTest, ParseEmpty)
@@ -332,6 +369,37 @@ TEST(VMDMotionTest, SaveMotion)
     }
 }
 
+TEST(VMDMotionTest, SaveMotionToDataSink)
+{
+    Encoding encoding(0);
+    String name("bone");
+    MockIModel model;
+    MockIBone bone;
+    EXPECT_CALL(model, findBoneRef(_)).Times(AnyNumber()).WillRepeatedly(Return(&bone));
+    vmd::Motion motion(&model, &encoding);
+    for (int i = 0; i < 3; i++) {
+        QScopedPointer<IBoneKeyframe> keyframe(new vmd::BoneKeyframe(&encoding));
+        keyframe->setTimeIndex(i * 10);
+        keyframe->setName(&name);
+        keyframe->setDefaultInterpolationParameter();
+        keyframe->setLocalTranslation(Vector3(i, i * 2, i * 3));
+        motion.addKeyframe(keyframe.take());
+    }
+    motion.update(IKeyframe::kBoneKeyframe);
+    QByteArray expected(motion.estimateSize(), 0);
+    motion.save(reinterpret_cast<uint8 *>(expected.data()));
+    /* five keyframe counts are written because the count of model keyframes is omitted when empty */
+    const int written = int(vmd::Motion::kSignatureSize + vmd::Motion::kNameSize
+                            + sizeof(int32) * 5 + vmd::BoneKeyframe::strideSize() * 3);
+    ByteArrayDataSink sink;
+    ASSERT_TRUE(motion.save(&sink));
+    ASSERT_EQ(written, sink.bytes.size());
+    ASSERT_EQ(expected.left(written), sink.bytes);
+    vmd::Motion motion2(&model, &encoding);
+    ASSERT_TRUE(motion2.load(reinterpret_cast<const uint8 *>(sink.bytes.constData()), sink.bytes.size()));
+    ASSERT_EQ(3, motion2.countKeyframes(IKeyframe::kBoneKeyframe));
+}
+
 TEST(VMDMotionTest, CloneMotion)
 {
     QFile file("motion.vmd");
@@ -763,6 +831,169 @@ TEST(VMDMotionTest, AddAndRemoveMorphKeyframes)
     }
 }
 
+TEST(VMDMotionTest, EvaluatePoseWithoutModel)
+{
+    Encoding encoding(0);
+    String name("bone");
+    MockIModel model;
+    MockIBone bone;
+    /* evaluating poses must not touch the shared model */
+    EXPECT_CALL(bone, setLocalTranslation(_)).Times(0);
+    EXPECT_CALL(bone, setLocalOrientation(_)).Times(0);
+    vmd::Motion motion(&model, &encoding);
+    SetupSingleBoneMotion(model, bone, motion, &encoding, &name, 10);
+    PoseEvaluator evaluator(&model, &motion);
+    ASSERT_EQ(1, evaluator.countBoneTracks());
+    ASSERT_EQ(0, evaluator.countMorphTracks());
+    PoseEvaluator::Pose pose1, pose2;
+    pose1.localTranslations.resize(1);
+    pose1.localOrientations.resize(1);
+    pose2.localTranslations.resize(1);
+    pose2.localOrientations.resize(1);
+    evaluator.evaluate(5, pose1);
+    ASSERT_TRUE(CompareVector(Vector3(5, 10, 15), pose1.localTranslations[0]));
+    ASSERT_EQ(IKeyframe::TimeIndex(5), pose1.timeIndex);
+    /* time index beyond the last keyframe should be clamped */
+    evaluator.evaluate(42, pose2);
+    ASSERT_TRUE(CompareVector(Vector3(10, 20, 30), pose2.localTranslations[0]));
+    /* only the specified bone tracks should be evaluated */
+    Array<int> boneTrackIndices;
+    evaluator.evaluate(5, boneTrackIndices, pose2);
+    ASSERT_TRUE(CompareVector(Vector3(10, 20, 30), pose2.localTranslations[0]));
+    boneTrackIndices.append(0);
+    evaluator.evaluate(5, boneTrackIndices, pose2);
+    ASSERT_TRUE(CompareVector(Vector3(5, 10, 15), pose2.localTranslations[0]));
+    Array<IKeyframe::TimeIndex> timeIndices;
+    Array<PoseEvaluator::Pose *> poses;
+    timeIndices.append(0);
+    timeIndices.append(10);
+    poses.append(&pose1);
+    poses.append(&pose2);
+    evaluator.evaluateAll(timeIndices, poses, true);
+    ASSERT_TRUE(CompareVector(kZeroV3, pose1.localTranslations[0]));
+    ASSERT_TRUE(CompareVector(Vector3(10, 20, 30), pose2.localTranslations[0]));
+}
+
+TEST(VMDMotionTest, BakePoseCache)
+{
+    Encoding encoding(0);
+    String name("bone");
+    MockIModel model;
+    MockIBone bone;
+    vmd::Motion motion(&model, &encoding);
+    SetupSingleBoneMotion(model, bone, motion, &encoding, &name, 10);
+    PoseEvaluator evaluator(&model, &motion);
+    PoseCache cache;
+    cache.bake(&evaluator, 1);
+    ASSERT_EQ(11, cache.countSamples());
+    ASSERT_EQ(1, cache.countBoneTracks());
+    /* linear translation and constant rotation should be detected */
+    ASSERT_EQ(1, cache.countChannels(PoseCache::kLinearChannel));
+    ASSERT_EQ(1, cache.countChannels(PoseCache::kConstantChannel));
+    ASSERT_EQ(0, cache.countChannels(PoseCache::kSampledChannel));
+    PoseEvaluator::Pose pose;
+    cache.allocate(pose);
+    cache.evaluate(2.5, pose);
+    ASSERT_TRUE(CompareVector(Vector3(2.5, 5, 7.5), pose.localTranslations[0]));
+    ASSERT_TRUE(CompareVector(Quaternion::getIdentity(), pose.localOrientations[0]));
+    /* round trip */
+    QByteArray bytes(int(cache.estimateSize()), 0);
+    cache.save(reinterpret_cast<uint8 *>(bytes.data()));
+    PoseCache cache2;
+    ASSERT_TRUE(cache2.load(reinterpret_cast<const uint8 *>(bytes.constData()), bytes.size()));
+    ASSERT_EQ(cache.countSamples(), cache2.countSamples());
+    ASSERT_EQ(cache.estimateSize(), cache2.estimateSize());
+    PoseEvaluator::Pose pose2;
+    cache2.allocate(pose2);
+    cache2.evaluate(2.5, pose2);
+    ASSERT_TRUE(CompareVector(pose.localTranslations[0], pose2.localTranslations[0]));
+    ASSERT_FALSE(cache2.load(reinterpret_cast<const uint8 *>(bytes.constData()), 4));
+}
+
+TEST(VMDMotionTest, BlendPoseLayers)
+{
+    Encoding encoding(0);
+    String name("bone");
+    MockIModel model;
+    MockIBone bone;
+    vmd::Motion motion(&model, &encoding);
+    SetupSingleBoneMotion(model, bone, motion, &encoding, &name, 0);
+    PoseEvaluator evaluator(&model, &motion);
+    PoseBlender blender(&model);
+    int base = blender.addLayer(&evaluator, PoseBlender::kBlendLayer);
+    int additive = blender.addLayer(&evaluator, PoseBlender::kAdditiveLayer);
+    ASSERT_EQ(2, blender.countLayers());
+    blender.setLayerWeight(base, 0.5);
+    blender.setLayerWeight(additive, 0);
+    blender.evaluate();
+    ASSERT_EQ(1, blender.countBlendedBones());
+    ASSERT_TRUE(CompareVector(Vector3(5, 10, 15), blender.pose().localTranslations[0]));
+    blender.setLayerWeight(additive, 1);
+    blender.evaluate();
+    ASSERT_TRUE(CompareVector(Vector3(15, 30, 45), blender.pose().localTranslations[0]));
+    /* masked layer should not touch the bone */
+    Array<int> mask;
+    mask.append(42);
+    blender.setLayerBoneMask(additive, mask);
+    blender.evaluate();
+    ASSERT_TRUE(CompareVector(Vector3(5, 10, 15), blender.pose().localTranslations[0]));
+    /* crossfade moves weights from a layer to another */
+    blender.crossfade(base, additive, 10);
+    ASSERT_FLOAT_EQ(1.0f, blender.layerWeight(base));
+    ASSERT_FLOAT_EQ(0.0f, blender.layerWeight(additive));
+    blender.advance(5);
+    ASSERT_FLOAT_EQ(0.5f, blender.layerWeight(base));
+    ASSERT_FLOAT_EQ(0.5f, blender.layerWeight(additive));
+    ASSERT_EQ(IKeyframe::TimeIndex(5), blender.layerTimeIndex(base));
+    EXPECT_CALL(bone, setLocalTranslation(_)).Times(1);
+    EXPECT_CALL(bone, setLocalOrientation(_)).Times(1);
+    blender.evaluate();
+    blender.apply();
+}
+
+TEST(VMDMotionTest, MaintainKeyframeIndicesIncrementally)
+{
+    Encoding encoding(0);
+    String name("bone");
+    MockIModel model;
+    MockIBone bone;
+    vmd::Motion motion(&model, &encoding);
+    EXPECT_CALL(model, findBoneRef(_)).WillRepeatedly(Return(&bone));
+    IBoneKeyframe *keyframe10 = new vmd::BoneKeyframe(&encoding);
+    keyframe10->setTimeIndex(10);
+    keyframe10->setName(&name);
+    motion.addKeyframe(keyframe10);
+    motion.update(IKeyframe::kBoneKeyframe);
+    ASSERT_EQ(IKeyframe::TimeIndex(10), motion.duration());
+    /* keyframes added out of order should be found without updating motion */
+    IBoneKeyframe *keyframe30 = new vmd::BoneKeyframe(&encoding);
+    keyframe30->setTimeIndex(30);
+    keyframe30->setName(&name);
+    motion.addKeyframe(keyframe30);
+    IBoneKeyframe *keyframe20 = new vmd::BoneKeyframe(&encoding);
+    keyframe20->setTimeIndex(20);
+    keyframe20->setName(&name);
+    motion.addKeyframe(keyframe20);
+    ASSERT_EQ(keyframe10, motion.findBoneKeyframeRef(10, &name, 0));
+    ASSERT_EQ(keyframe20, motion.findBoneKeyframeRef(20, &name, 0));
+    ASSERT_EQ(keyframe30, motion.findBoneKeyframeRef(30, &name, 0));
+    ASSERT_EQ(IKeyframe::TimeIndex(30), motion.duration());
+    /* removing the last keyframe should shrink duration */
+    IKeyframe *keyframeToDelete = keyframe30;
+    motion.deleteKeyframe(keyframeToDelete);
+    ASSERT_EQ(2, motion.countKeyframes(IKeyframe::kBoneKeyframe));
+    ASSERT_EQ(static_cast<IBoneKeyframe *>(0), motion.findBoneKeyframeRef(30, &name, 0));
+    ASSERT_EQ(IKeyframe::TimeIndex(20), motion.duration());
+    /* changing time index directly requires replacing the keyframe to resort its track */
+    keyframe20->setTimeIndex(5);
+    motion.replaceKeyframe(keyframe20, false);
+    motion.update(IKeyframe::kBoneKeyframe);
+    ASSERT_EQ(2, motion.countKeyframes(IKeyframe::kBoneKeyframe));
+    ASSERT_EQ(keyframe20, motion.findBoneKeyframeRef(5, &name, 0));
+    ASSERT_EQ(keyframe10, motion.findBoneKeyframeRef(10, &name, 0));
+    ASSERT_EQ(IKeyframe::TimeIndex(10), motion.duration());
+}
+
 TEST(VMDMotionTest, AddAndRemoveNullKeyframe)
 {
     /* should happen nothing */
@@ -0,0 +1,367 @@
+#include <vpvl2/vpvl2.h>
+#include <vpvl2/extensions/BaseApplicationContext.h> /* BaseApplicationContext::initializeOnce */
+#include <vpvl2/extensions/icu4c/Encoding.h>
+#include "../generator/Generator.h"
+
+#include <LinearMath/btQuickprof.h>
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace vpvl2;
+using namespace vpvl2::extensions;
+using namespace vpvl2::extensions::icu4c;
+
+/*
+ * Measures the hot paths of the core library with the synthesized models and motions of
+ * generator::Size. The flags and the JSON output follow Google Benchmark so the results can
+ * be compared across commits with its tools/compare.py.
+ *
+ *   vpvl2_benchmark [--benchmark_filter=substring] [--benchmark_min_time=seconds]
+ *                   [--benchmark_format=console|json] [--benchmark_out=path]
+ */
+
+namespace {
+
+static const generator::Size kSizes[] = {
+    /* name, vertices, bones, IK chains, IK links, morphs, materials, keyframes */
+    { "small",   4096,  32, 2, 2,  16,  4,  30 },
+    { "medium", 32768, 128, 4, 3,  64, 16, 120 },
+    { "large", 131072, 256, 8, 4, 256, 32, 600 }
+};
+
+#if defined(VPVL2_LINK_INTEL_TBB)
+static const char kParallelBackend[] = "tbb";
+#elif defined(VPVL2_ENABLE_OPENMP)
+static const char kParallelBackend[] = "openmp";
+#else
+static const char kParallelBackend[] = "serial";
+#endif
+
+struct Result {
+    std::string name;
+    vsize iterations;
+    double realTime;
+    double cpuTime;
+    double itemsPerSecond;
+};
+
+struct Options {
+    Options()
+        : minTime(0.5),
+          json(false)
+    {
+    }
+    std::string filter;
+    std::string output;
+    double minTime;
+    bool json;
+};
+
+class Fixture {
+public:
+    Fixture(const generator::Size &size, Factory &factory)
+        : m_size(size),
+          m_factory(factory),
+          m_model(0),
+          m_motion(0),
+          m_dynamicBuffer(0),
+          m_indexBuffer(0)
+    {
+        IModel *model = factory.newModel(IModel::kPMXModel);
+        generator::CreateModel(model, size);
+        m_modelBytes.resize(model->estimateSize());
+        vsize written = 0;
+        model->save(&m_modelBytes[0], written);
+        m_modelBytes.resize(written);
+        delete model;
+        /* measure with the loaded model to resolve all references as the application does */
+        bool ok = false;
+        m_model = factory.createModel(&m_modelBytes[0], m_modelBytes.size(), ok);
+        if (!ok) {
+            fprintf(stderr, "Cannot load the generated model: error=%d\n", m_model ? int(m_model->error()) : -1);
+            abort();
+        }
+        IMotion *motion = factory.newMotion(IMotion::kVMDMotion, m_model);
+        generator::CreateMotion(motion, m_model, factory, size);
+        m_motionBytes.resize(motion->estimateSize());
+        motion->save(&m_motionBytes[0]);
+        delete motion;
+        m_motion = factory.createMotion(&m_motionBytes[0], m_motionBytes.size(), m_model, ok);
+        if (!ok) {
+            fprintf(stderr, "Cannot load the generated motion\n");
+            abort();
+        }
+        m_model->getIndexBuffer(m_indexBuffer);
+        m_model->getDynamicVertexBuffer(m_dynamicBuffer, m_indexBuffer);
+        m_vertexBytes.resize(m_dynamicBuffer->size());
+    }
+    ~Fixture() {
+        delete m_dynamicBuffer;
+        delete m_indexBuffer;
+        delete m_motion;
+        delete m_model;
+    }
+
+    const generator::Size &size() const { return m_size; }
+    const Factory &factory() const { return m_factory; }
+    IModel *model() const { return m_model; }
+    IMotion *motion() const { return m_motion; }
+    IModel::DynamicVertexBuffer *dynamicBuffer() const { return m_dynamicBuffer; }
+    const std::vector<uint8> &modelBytes() const { return m_modelBytes; }
+    const std::vector<uint8> &motionBytes() const { return m_motionBytes; }
+    std::vector<uint8> &vertexBytes() { return m_vertexBytes; }
+
+private:
+    const generator::Size &m_size;
+    Factory &m_factory;
+    IModel *m_model;
+    IMotion *m_motion;
+    IModel::DynamicVertexBuffer *m_dynamicBuffer;
+    IModel::IndexBuffer *m_indexBuffer;
+    std::vector<uint8> m_modelBytes;
+    std::vector<uint8> m_motionBytes;
+    std::vector<uint8> m_vertexBytes;
+};
+
+typedef void (*BenchmarkFunction)(Fixture &fixture, vsize iteration);
+
+static void LoadModel(Fixture &fixture, vsize /* iteration */)
+{
+    const std::vector<uint8> &bytes = fixture.modelBytes();
+    IModel *model = fixture.factory().newModel(IModel::kPMXModel);
+    model->load(&bytes[0], bytes.size());
+    delete model;
+}
+
+static void SaveModel(Fixture &fixture, vsize /* iteration */)
+{
+    const IModel *model = fixture.model();
+    std::vector<uint8> bytes(model->estimateSize());
+    vsize written = 0;
+    model->save(&bytes[0], written);
+}
+
+static void LoadMotion(Fixture &fixture, vsize /* iteration */)
+{
+    const std::vector<uint8> &bytes = fixture.motionBytes();
+    IMotion *motion = fixture.factory().newMotion(IMotion::kVMDMotion, fixture.model());
+    motion->load(&bytes[0], bytes.size());
+    delete motion;
+}
+
+static void SaveMotion(Fixture &fixture, vsize /* iteration */)
+{
+    const IMotion *motion = fixture.motion();
+    std::vector<uint8> bytes(motion->estimateSize());
+    motion->save(&bytes[0]);
+}
+
+static void SeekMotion(Fixture &fixture, vsize iteration)
+{
+    /* step forward by a frame and wrap around to exercise both sequential and backward seeking */
+    const IKeyframe::TimeIndex duration = btMax(fixture.motion()->duration(), IKeyframe::TimeIndex(1));
+    fixture.motion()->seek(IKeyframe::TimeIndex(iteration % vsize(duration)));
+}
+
+static void PerformUpdate(Fixture &fixture, vsize iteration)
+{
+    SeekMotion(fixture, iteration);
+    fixture.model()->performUpdate();
+}
+
+static void PerformTransform(Fixture &fixture, vsize /* iteration */, bool parallel)
+{
+    Vector3 aabbMin, aabbMax;
+    IModel::DynamicVertexBuffer *dynamicBuffer = fixture.dynamicBuffer();
+    dynamicBuffer->setParallelUpdateEnable(parallel);
+    dynamicBuffer->performTransform(&fixture.vertexBytes()[0], Vector3(0, 10, -50), aabbMin, aabbMax);
+}
+
+static void PerformTransformSerial(Fixture &fixture, vsize iteration)
+{
+    PerformTransform(fixture, iteration, false);
+}
+
+static void PerformTransformParallel(Fixture &fixture, vsize iteration)
+{
+    PerformTransform(fixture, iteration, true);
+}
+
+struct Benchmark {
+    const char *name;
+    BenchmarkFunction function;
+    bool countsVertices;
+};
+
+static const Benchmark kBenchmarks[] = {
+    { "PMXModel/load", LoadModel, true },
+    { "PMXModel/save", SaveModel, true },
+    { "PMXModel/performUpdate", PerformUpdate, false },
+    { "VMDMotion/load", LoadMotion, false },
+    { "VMDMotion/save", SaveMotion, false },
+    { "VMDMotion/seek", SeekMotion, false },
+    { "DynamicVertexBuffer/performTransform/serial", PerformTransformSerial, true },
+    { "DynamicVertexBuffer/performTransform/parallel", PerformTransformParallel, true }
+};
+
+static Result RunBenchmark(const std::string &name, const Benchmark &benchmark, Fixture &fixture, const Options &options)
+{
+    btClock clock;
+    vsize iterations = 1;
+    double elapsed = 0, cpuElapsed = 0;
+    benchmark.function(fixture, 0); /* warm up */
+    while (true) {
+        clock.reset();
+        const std::clock_t cpuStartedAt = std::clock();
+        for (vsize i = 0; i < iterations; i++) {
+            benchmark.function(fixture, i);
+        }
+        elapsed = clock.getTimeMicroseconds() * 1e-6;
+        cpuElapsed = double(std::clock() - cpuStartedAt) / CLOCKS_PER_SEC;
+        if (elapsed >= options.minTime || iterations >= 1000000000) {
+            break;
+        }
+        /* predict the iterations to reach the minimum time like Google Benchmark does */
+        const double multiplier = elapsed > 0 ? btMin(options.minTime * 1.4 / elapsed, 10.0) : 10.0;
+        iterations = btMax(vsize(iterations * multiplier), iterations + 1);
+    }
+    const generator::Size &size = fixture.size();
+    const vsize items = benchmark.countsVertices ? size.nvertices : 1;
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.realTime = elapsed * 1e9 / iterations;
+    result.cpuTime = cpuElapsed * 1e9 / iterations;
+    result.itemsPerSecond = elapsed > 0 ? (double(items) * iterations) / elapsed : 0;
+    return result;
+}
+
+static void WriteJSON(FILE *fp, const std::vector<Result> &results)
+{
+    char date[64];
+    const std::time_t now = std::time(0);
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    fprintf(fp, "{\n  \"context\": {\n");
+    fprintf(fp, "    \"date\": \"%s\",\n", date);
+    fprintf(fp, "    \"library_version\": \"%s\",\n", VPVL2_VERSION_STRING);
+    fprintf(fp, "    \"parallel_backend\": \"%s\",\n", kParallelBackend);
+#ifdef NDEBUG
+    fprintf(fp, "    \"library_build_type\": \"release\"\n");
+#else
+    fprintf(fp, "    \"library_build_type\": \"debug\"\n");
+#endif
+    fprintf(fp, "  },\n  \"benchmarks\": [\n");
+    const vsize nresults = results.size();
+    for (vsize i = 0; i < nresults; i++) {
+        const Result &result = results[i];
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"name\": \"%s\",\n", result.name.c_str());
+        fprintf(fp, "      \"iterations\": %lu,\n", static_cast<unsigned long>(result.iterations));
+        fprintf(fp, "      \"real_time\": %.3f,\n", result.realTime);
+        fprintf(fp, "      \"cpu_time\": %.3f,\n", result.cpuTime);
+        fprintf(fp, "      \"time_unit\": \"ns\",\n");
+        fprintf(fp, "      \"items_per_second\": %.3f\n", result.itemsPerSecond);
+        fprintf(fp, "    }%s\n", i + 1 < nresults ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+}
+
+static void WriteConsoleHeader(FILE *fp)
+{
+    fprintf(fp, "parallel backend: %s\n", kParallelBackend);
+    fprintf(fp, "%-64s %15s %15s %12s\n", "Benchmark", "Time(ns)", "CPU(ns)", "Iterations");
+}
+
+static void WriteConsoleRow(FILE *fp, const Result &result)
+{
+    fprintf(fp, "%-64s %15.0f %15.0f %12lu\n", result.name.c_str(), result.realTime, result.cpuTime,
+            static_cast<unsigned long>(result.iterations));
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &options)
+{
+    static const char kFilter[] = "--benchmark_filter=";
+    static const char kMinTime[] = "--benchmark_min_time=";
+    static const char kFormat[] = "--benchmark_format=";
+    static const char kOutput[] = "--benchmark_out=";
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, kFilter, sizeof(kFilter) - 1) == 0) {
+            options.filter = arg + sizeof(kFilter) - 1;
+        }
+        else if (strncmp(arg, kMinTime, sizeof(kMinTime) - 1) == 0) {
+            options.minTime = atof(arg + sizeof(kMinTime) - 1);
+        }
+        else if (strncmp(arg, kFormat, sizeof(kFormat) - 1) == 0) {
+            options.json = strcmp(arg + sizeof(kFormat) - 1, "json") == 0;
+        }
+        else if (strncmp(arg, kOutput, sizeof(kOutput) - 1) == 0) {
+            options.output = arg + sizeof(kOutput) - 1;
+        }
+        else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+    BaseApplicationContext::initializeOnce(argv[0], 0, 0);
+    Encoding::Dictionary dictionary;
+    Encoding encoding(&dictionary);
+    Factory factory(&encoding);
+    std::vector<Result> results;
+    if (!options.json) {
+        WriteConsoleHeader(stdout);
+    }
+    const int nsizes = int(sizeof(kSizes) / sizeof(kSizes[0]));
+    const int nbenchmarks = int(sizeof(kBenchmarks) / sizeof(kBenchmarks[0]));
+    for (int i = 0; i < nsizes; i++) {
+        const generator::Size &size = kSizes[i];
+        Fixture *fixture = 0;
+        for (int j = 0; j < nbenchmarks; j++) {
+            const Benchmark &benchmark = kBenchmarks[j];
+            std::string name(benchmark.name);
+            name.append("/").append(size.name);
+            if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+            if (!fixture) {
+                fixture = new Fixture(size, factory);
+            }
+            results.push_back(RunBenchmark(name, benchmark, *fixture, options));
+            if (!options.json) {
+                WriteConsoleRow(stdout, results.back());
+            }
+        }
+        delete fixture;
+    }
+    if (options.json) {
+        WriteJSON(stdout, results);
+    }
+    if (!options.output.empty()) {
+        if (FILE *fp = fopen(options.output.c_str(), "wb")) {
+            WriteJSON(fp, results);
+            fclose(fp);
+        }
+        else {
+            fprintf(stderr, "Cannot open %s for writing\n", options.output.c_str());
+            return 1;
+        }
+    }
+    dictionary.releaseAll();
+    return 0;
+}
@@ -0,0 +1,212 @@
+#ifndef VPVL2_TEST_GENERATOR_GENERATOR_H_
+#define VPVL2_TEST_GENERATOR_GENERATOR_H_
+
+#include <vpvl2/vpvl2.h>
+#include <vpvl2/extensions/icu4c/String.h>
+#include <vpvl2/pmx/Bone.h>
+
+#include <stdio.h>
+
+namespace vpvl2
+{
+namespace generator
+{
+
+/* controls the size of the synthesized model and motion */
+struct Size {
+    const char *name;
+    int nvertices;
+    int nbones;
+    int nIKChains;
+    int nIKLinks;
+    int nmorphs;
+    int nmaterials;
+    int nkeyframes;
+};
+
+static inline void SetName(const char *prefix, int index, IString *&value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%s%d", prefix, index);
+    value = new extensions::icu4c::String(UnicodeString::fromUTF8(buffer));
+}
+
+static inline IBone *CreateBone(IModel *model, const char *prefix, int index, IBone *parentBone, const Vector3 &origin)
+{
+    IString *name = 0;
+    SetName(prefix, index, name);
+    IBone *bone = model->createBone();
+    bone->setName(name, IEncoding::kJapanese);
+    bone->setName(name, IEncoding::kEnglish);
+    bone->setOrigin(origin);
+    bone->setRotateable(true);
+    bone->setMovable(true);
+    bone->setVisible(true);
+    bone->setInteractive(true);
+    bone->setParentBoneRef(parentBone);
+    model->addBone(bone);
+    delete name;
+    return bone;
+}
+
+/*
+ * Builds a PMX model which has the vertices skinned by BDEF1/BDEF2/BDEF4 to the bone tree,
+ * IK chains appended after the bone tree and vertex morphs distributed over all vertices.
+ * The bone tree consists of size.nbones bones, and each IK chain adds size.nIKLinks link bones,
+ * an effector bone and an IK bone.
+ */
+static inline void CreateModel(IModel *model, const Size &size)
+{
+    Array<IBone *> bones;
+    IBone *rootBone = CreateBone(model, "bone", 0, 0, kZeroV3);
+    bones.append(rootBone);
+    for (int i = 1; i < size.nbones; i++) {
+        IBone *parentBone = bones[(i - 1) / 4];
+        bones.append(CreateBone(model, "bone", i, parentBone, parentBone->origin() + Vector3(0, 1, 0)));
+    }
+    for (int i = 0; i < size.nIKChains; i++) {
+        const Vector3 base(Scalar(i + 1), 0, 0);
+        Array<IBone *> links;
+        IBone *parentBone = rootBone;
+        for (int j = 0; j < size.nIKLinks; j++) {
+            parentBone = CreateBone(model, "link", i * size.nIKLinks + j, parentBone, base + Vector3(0, Scalar(j + 1), 0));
+            links.append(parentBone);
+        }
+        IBone *effectorBone = CreateBone(model, "effector", i, parentBone, base + Vector3(0, Scalar(size.nIKLinks + 1), 0));
+        pmx::Bone *ikBone = static_cast<pmx::Bone *>(CreateBone(model, "ik", i, rootBone, base + Vector3(1, Scalar(size.nIKLinks), 0)));
+        ikBone->setHasInverseKinematics(true);
+        ikBone->setEffectorBoneRef(effectorBone, 40, btRadians(114.5916f));
+        for (int j = links.count() - 1; j >= 0; j--) {
+            const bool hasAngleLimit = j == links.count() - 1;
+            ikBone->addInverseKinematicsConstraint(links[j], hasAngleLimit, Vector3(-btRadians(180), 0, 0), Vector3(-btRadians(0.5f), 0, 0));
+        }
+    }
+    const int ntriangles = btMax(size.nvertices - 2, 0), nmaterials = btMax(size.nmaterials, 1);
+    for (int i = 0; i < nmaterials; i++) {
+        IString *name = 0;
+        SetName("material", i, name);
+        IMaterial *material = model->createMaterial();
+        material->setName(name, IEncoding::kJapanese);
+        material->setName(name, IEncoding::kEnglish);
+        material->setAmbient(Color(0.1, 0.2, 0.3, 1.0));
+        material->setDiffuse(Color(0.4, 0.3, 0.2, 1.0));
+        material->setSpecular(Color(0.9, 0.8, 0.7, 1.0));
+        material->setEdgeColor(Color(0, 0, 0, 1));
+        material->setEdgeSize(1.0);
+        material->setShininess(0.8);
+        material->setFlags(IMaterial::kEnableEdge | IMaterial::kHasShadow);
+        IMaterial::IndexRange range;
+        range.count = (ntriangles / nmaterials + (i == nmaterials - 1 ? ntriangles % nmaterials : 0)) * 3;
+        material->setIndexRange(range);
+        model->addMaterial(material);
+        delete name;
+    }
+    const int nbones = bones.count();
+    for (int i = 0; i < size.nvertices; i++) {
+        IVertex *vertex = model->createVertex();
+        const Scalar x = Scalar(i % 256), y = Scalar(i / 256);
+        vertex->setOrigin(Vector3(x * 0.01f, y * 0.01f, 0));
+        vertex->setNormal(Vector3(0, 0, 1));
+        vertex->setTextureCoord(Vector3(x / 256.0f, y / 256.0f, 0));
+        vertex->setEdgeSize(1.0);
+        switch (i % 3) {
+        case 0:
+            vertex->setType(IVertex::kBdef1);
+            vertex->setBoneRef(0, bones[i % nbones]);
+            vertex->setWeight(0, 1.0);
+            break;
+        case 1:
+            vertex->setType(IVertex::kBdef2);
+            vertex->setBoneRef(0, bones[i % nbones]);
+            vertex->setBoneRef(1, bones[(i + 1) % nbones]);
+            vertex->setWeight(0, 0.7);
+            break;
+        default:
+            vertex->setType(IVertex::kBdef4);
+            for (int j = 0; j < 4; j++) {
+                vertex->setBoneRef(j, bones[(i + j) % nbones]);
+            }
+            vertex->setWeight(0, 0.4);
+            vertex->setWeight(1, 0.3);
+            vertex->setWeight(2, 0.2);
+            vertex->setWeight(3, 0.1);
+            break;
+        }
+        model->addVertex(vertex);
+    }
+    Array<int> indices;
+    indices.reserve(ntriangles * 3);
+    for (int i = 0; i < ntriangles; i++) {
+        indices.append(i);
+        indices.append(i + 1);
+        indices.append(i + 2);
+    }
+    model->setIndices(indices);
+    Array<IVertex *> vertices;
+    model->getVertexRefs(vertices);
+    for (int i = 0; i < size.nmorphs; i++) {
+        IString *name = 0;
+        SetName("morph", i, name);
+        IMorph *morph = model->createMorph();
+        morph->setName(name, IEncoding::kJapanese);
+        morph->setName(name, IEncoding::kEnglish);
+        morph->setType(IMorph::kVertexMorph);
+        for (int j = i; j < size.nvertices; j += size.nmorphs) {
+            IMorph::Vertex *vmorph = new IMorph::Vertex();
+            vmorph->vertex = vertices[j];
+            vmorph->index = j;
+            vmorph->position.setValue(0.01f, 0.02f, 0.03f);
+            morph->addVertexMorph(vmorph);
+        }
+        model->addMorph(morph);
+        delete name;
+    }
+    IString *name = 0;
+    SetName("model", size.nvertices, name);
+    model->setName(name, IEncoding::kJapanese);
+    model->setName(name, IEncoding::kEnglish);
+    model->setVersion(2.0);
+    delete name;
+}
+
+/*
+ * Adds size.nkeyframes keyframes to every bone and morph of the model, spaced by 5 frames.
+ */
+static inline void CreateMotion(IMotion *motion, const IModel *model, const Factory &factory, const Size &size)
+{
+    Array<IBone *> bones;
+    model->getBoneRefs(bones);
+    const int nbones = bones.count();
+    for (int i = 0; i < nbones; i++) {
+        const IBone *bone = bones[i];
+        for (int j = 0; j < size.nkeyframes; j++) {
+            IBoneKeyframe *keyframe = factory.createBoneKeyframe(motion);
+            keyframe->setName(bone->name(IEncoding::kDefaultLanguage));
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(j * 5));
+            keyframe->setDefaultInterpolationParameter();
+            keyframe->setLocalTranslation(Vector3(0, Scalar(j % 2) * 0.1f, 0));
+            keyframe->setLocalOrientation(Quaternion(Vector3(1, 0, 0), btRadians(Scalar((i + j) % 30))));
+            motion->addKeyframe(keyframe);
+        }
+    }
+    Array<IMorph *> morphs;
+    model->getMorphRefs(morphs);
+    const int nmorphs = morphs.count();
+    for (int i = 0; i < nmorphs; i++) {
+        const IMorph *morph = morphs[i];
+        for (int j = 0; j < size.nkeyframes; j++) {
+            IMorphKeyframe *keyframe = factory.createMorphKeyframe(motion);
+            keyframe->setName(morph->name(IEncoding::kDefaultLanguage));
+            keyframe->setTimeIndex(IKeyframe::TimeIndex(j * 5));
+            keyframe->setWeight(IMorph::WeightPrecision(j % 2));
+            motion->addKeyframe(keyframe);
+        }
+    }
+    motion->update(IKeyframe::kBoneKeyframe);
+    motion->update(IKeyframe::kMorphKeyframe);
+}
+
+} /* namespace generator */
+} /* namespace vpvl2 */
+
+#endif
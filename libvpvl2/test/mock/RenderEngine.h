@@ -6,6 +6,8 @@ class MockIRenderEngine : public IRenderEngine {
       IModel*());
   MOCK_METHOD1(upload,
       bool(void *userData));
+  MOCK_METHOD3(uploadIncrementally,
+      UploadStatus(void *userData, int maxSteps, UploadProgressListener *listener));
   MOCK_METHOD0(release,
       void());
   MOCK_METHOD0(renderModel,